@@ -0,0 +1,2151 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "station_index.h"
+#include "station_compact.h"
+#include "station_key.h"
+#include "csv_loader.h"
+#include "json_loader.h"
+#include "station_meta.h"
+#include "reload.h"
+#include "dataset.h"
+#include "rules.h"
+#include "rule_plan.h"
+#include "subscribe.h"
+#include "query_cache.h"
+#include "pipeline.h"
+#include "geo.h"
+#include "nary_flat.h"
+#include "spatial.h"
+#include "recommend.h"
+#include "pool.h"
+#include "rule_par.h"
+#include "snapshot.h"
+#include "wal.h"
+#include "connector.h"
+#include "hash.h"
+#include "pricing.h"
+#include "bench.h"
+
+/**
+ * @brief Micro-benchmarks ChargeCraft.
+ *
+ * Usage : ./bench [scenario] [nb_stations]
+ *   scenario : csv (défaut), json, meta, reload, dataset, rules, subs, cache, geo, flat, compact, keys, par, snap, wal, conn, price, recommend
+ *
+ *         ./bench suite [options]   (voir bench_suite.c)
+ */
+
+double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Génère un CSV IRVE synthétique de n lignes. Une adresse sur quatre est entre
+ * guillemets avec une virgule, et 1% des identifiants sont répétés pour
+ * vérifier la règle du dernier écrivain.
+ * Avec edited, une ligne sur 200 disparaît, une autre change de puissance et
+ * n/200 stations nouvelles sont ajoutées en fin de fichier.
+ */
+static int gen_csv_edited(const char* path, int n, int edited) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "id_station_itinerance,nom_operateur,nom_station,adresse_station,code_insee_commune,"
+               "puissance_nominale,nbre_pdc,condition_acces,latitude,longitude\n");
+    static const int powers[] = {7, 22, 50, 100, 150, 350};
+    unsigned seed = 12345;
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int id = (i % 100 == 99) ? 1000 + (int)(seed % (unsigned)(i + 1)) : 1000 + i;
+        int pw = powers[(seed >> 8) % 6];
+        int pdc = 1 + (int)((seed >> 4) % 8);
+        if (edited && i % 200 == 0) continue;
+        if (edited && i % 200 == 1) pw += 1;
+        // points de charge ajoutés ou retirés, parfois au-delà d'un mot de bitset
+        if (edited && i % 200 == 2) pdc = i % 2000 == 2 ? 70 : 9 - pdc;
+        if (i % 4 == 0)
+            fprintf(f, "FRIZI_%d,IZIVIA,IZIVIA Station %d,\"%d, Rue de l'Énergie\",%05d,%d,%d,ACCES_LIBRE,47.%06d,2.%06d\n",
+                    id, id, i % 200, i % 35000, pw, pdc, i % 999999, (i * 7) % 999999);
+        else
+            fprintf(f, "FRIZI_%d,IZIVIA,IZIVIA Station %d,%d Rue de l'Énergie,%05d,%d,%d,ACCES_PAYANT,47.%06d,2.%06d\n",
+                    id, id, i % 200, i % 35000, pw, pdc, i % 999999, (i * 7) % 999999);
+    }
+    for (int i = 0; edited && i < n / 200; i++)
+        fprintf(f, "FRIZI_%d,IZIVIA,IZIVIA Station neuve,1 Rue Neuve,75056,150,4,ACCES_LIBRE,48.8,2.3\n", 1000 + n + i);
+    fclose(f);
+    return 1;
+}
+
+int gen_csv(const char* path, int n) {
+    return gen_csv_edited(path, n, 0);
+}
+
+/* deux index sont identiques s'ils contiennent les mêmes clés avec les mêmes infos */
+static int same_index(StationIndex* a, StationIndex* b) {
+    SiCursor ca, cb;
+    si_cursor_begin(&ca, a, INT_MIN, INT_MAX);
+    si_cursor_begin(&cb, b, INT_MIN, INT_MAX);
+    for (;;) {
+        StationNode* x = si_cursor_next(&ca);
+        StationNode* y = si_cursor_next(&cb);
+        if (!x || !y) return x == y;
+        if (x->station_id != y->station_id || memcmp(&x->info, &y->info, sizeof(StationInfo)) != 0) return 0;
+    }
+}
+
+/**
+ * Génère l'équivalent JSON de gen_csv. L'identifiant vient en dernier : l'ancien
+ * chargeur prend le dernier '_' de l'objet, qui est alors le sien. Sans nested,
+ * les deux chargeurs lisent donc les mêmes stations ; avec, chaque station porte
+ * en plus un objet et un tableau imbriqués (avec un '}' dans une chaîne) pour
+ * exercer le lecteur, ce que l'ancien chargeur ne sait pas lire.
+ */
+int gen_json(const char* path, int n, int nested) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    static const int powers[] = {7, 22, 50, 100, 150, 350};
+    unsigned seed = 12345;
+    fprintf(f, "[\n");
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int id = (i % 100 == 99) ? 1000 + (int)(seed % (unsigned)(i + 1)) : 1000 + i;
+        fprintf(f, "  {\n    \"nom_operateur\": \"IZIVIA\",\n"
+                   "    \"nom_station\": \"IZIVIA \\\"Station\\\" %d\",\n"
+                   "    \"adresse_station\": \"%d Rue de l'\\u00c9nergie\",\n"
+                   "    \"code_insee_commune\": \"%05d\",\n"
+                   "    \"puissance_nominale\": %d,\n"
+                   "    \"nbre_pdc\": %d,\n"
+                   "    \"condition_acces\": \"%s\",\n",
+                id, i % 200, i % 35000, powers[(seed >> 8) % 6], 1 + (int)((seed >> 4) % 8),
+                (i % 4 == 0) ? "ACCES_LIBRE" : "ACCES_PAYANT");
+        if (nested)
+            fprintf(f, "    \"coordonnees\": {\"latitude\": 47.%06d, \"longitude\": 2.%06d},\n"
+                       "    \"tags\": [\"}\", {\"x\": [1, 2]}],\n",
+                    i % 999999, (i * 7) % 999999);
+        else
+            fprintf(f, "    \"latitude\": 47.%06d,\n    \"longitude\": 2.%06d,\n",
+                    i % 999999, (i * 7) % 999999);
+        fprintf(f, "    \"id_station_itinerance\": \"FRIZI_%d\"\n  }%s\n", id, i + 1 < n ? "," : "");
+    }
+    fprintf(f, "]\n");
+    fclose(f);
+    return 1;
+}
+
+/**
+ * Chargeur JSON d'origine (fichier entier en mémoire, strchr/strstr par champ),
+ * conservé uniquement comme référence de débit.
+ */
+static int legacy_find_int_field(const char* s, const char* key, int* out) {
+    char pat[128];
+    snprintf(pat, sizeof pat, "\"%s\"", key);
+    const char* p = strstr(s, pat);
+    if (!p) return 0;
+    p = strchr(p, ':'); if (!p) return 0;
+    p++;
+    while (*p == ' ' || *p == '\t') p++;
+    *out = atoi(p);
+    return 1;
+}
+
+static int legacy_find_str_suffix_id(const char* s, const char* key) {
+    char pat[128];
+    snprintf(pat, sizeof pat, "\"%s\"", key);
+    const char* p = strstr(s, pat);
+    if (!p) return -1;
+    p = strchr(p, ':'); if (!p) return -1;
+    p++;
+    while (*p == ' ' || *p == '\t' || *p == '\"') p++;
+    const char* end = strchr(p, '\"'); if (!end) end = p + strlen(p);
+    const char* us = strrchr(p, '_');
+    if (!us || us >= end) return -1;
+    return atoi(us + 1);
+}
+
+static int legacy_load_json(const char* path, StationIndex* idx) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END); long sz = ftell(f); fseek(f, 0, SEEK_SET);
+    char* buf = (char*)malloc(sz + 1);
+    if (!buf) { fclose(f); return -1; }
+    if (fread(buf, 1, sz, f) != (size_t)sz) { free(buf); fclose(f); return -1; }
+    buf[sz] = 0; fclose(f);
+
+    int inserted = 0;
+    char* p = buf;
+    while ((p = strchr(p, '{'))) {
+        char* q = strchr(p, '}');
+        if (!q) break;
+        *q = 0;
+        int id = legacy_find_str_suffix_id(p, "id_station_itinerance");
+        int power = 0, slots = 0;
+        legacy_find_int_field(p, "puissance_nominale", &power);
+        legacy_find_int_field(p, "nbre_pdc", &slots);
+        if (id > 0) {
+            StationInfo info = { power ? power : 50, 300, slots ? slots : 2, 0 };
+            si_add(idx, id, info);
+            inserted++;
+        }
+        p = q + 1;
+    }
+    free(buf);
+    return inserted;
+}
+
+static long file_size(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fclose(f);
+    return sz;
+}
+
+/**
+ * Chronomètre le chargeur en flux et, avec compare, l'ancien sur le même fichier.
+ * Une lecture de contrôle non chronométrée vérifie d'abord que les deux lisent
+ * les mêmes stations ; sinon leurs débits ne se comparent pas.
+ */
+static void bench_json_file(const char* path, const char* label, int n, int compare) {
+    double mb = file_size(path) / (1024.0 * 1024.0);
+    StationIndex ref, idx;
+    si_init(&ref);
+    si_init(&idx);
+    printf("[json] %.1f Mo, %d stations, %s\n", mb, n, label);
+    double t0, t_old = 0;
+    if (compare) {
+        int r_old = legacy_load_json(path, &ref);
+        int r_new = ds_load_stations_from_json(path, &idx);
+        int same = r_old == r_new && same_index(&ref, &idx);
+        si_clear(&ref);
+        si_clear(&idx);
+        if (!same) {
+            printf("[json] chargeurs en désaccord (%d contre %d stations lues) : pas de comparaison\n", r_old, r_new);
+            compare = 0;
+        } else {
+            t0 = now_sec();
+            r_old = legacy_load_json(path, &ref);
+            t_old = now_sec() - t0;
+            printf("[json] ancien (strstr) : %8.2f ms  %7.1f Mo/s  (%d stations lues)\n", t_old * 1e3, mb / t_old, r_old);
+        }
+    }
+    t0 = now_sec();
+    int r_new = ds_load_stations_from_json(path, &idx);
+    double t_new = now_sec() - t0;
+    printf("[json] flux (SAX)      : %8.2f ms  %7.1f Mo/s  (%d stations lues)\n", t_new * 1e3, mb / t_new, r_new);
+    if (compare) printf("[json] débit du flux : %.2f x celui de l'ancien, mêmes stations\n", t_old / t_new);
+    si_clear(&ref);
+    si_clear(&idx);
+}
+
+/* nom de la station j du fichier à champs longs : len octets, un '"' sur 50 */
+static void long_name(char* buf, int j, int len) {
+    for (int k = 0; k < len; k++) buf[k] = k % 50 == 49 ? '"' : (char)('a' + (j + k) % 26);
+    buf[len] = 0;
+}
+
+#define CSV_LONG_ROWS 400
+#define CSV_LONG_MAX 4200
+#define LONG_ID_PAD 300
+
+/**
+ * Export à champs longs, en CSV ou en JSON : noms de 200 à 4199 octets avec
+ * des '"' échappés, et un identifiant d'itinérance de plus de 300 octets une
+ * ligne sur quatre.
+ */
+static int gen_long(const char* path, int json) {
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    char name[CSV_LONG_MAX + 1], pad[LONG_ID_PAD + 1];
+    memset(pad, 'X', LONG_ID_PAD);
+    pad[LONG_ID_PAD] = 0;
+    if (json) fputc('[', f);
+    else fprintf(f, "id_station_itinerance,nom_operateur,nom_station,adresse_station,code_insee_commune,"
+                    "puissance_nominale,nbre_pdc,condition_acces,latitude,longitude\n");
+    for (int j = 0; j < CSV_LONG_ROWS; j++) {
+        long_name(name, j, 200 + (j * 37) % (CSV_LONG_MAX - 200));
+        const char* p = j % 4 == 0 ? pad : "";
+        if (json) fprintf(f, "%s{\"id_station_itinerance\":\"FRIZI_%s%s%d\",\"nom_operateur\":\"IZIVIA\",\"nom_station\":\"",
+                          j ? ",\n" : "", p, *p ? "_" : "", 1000 + j);
+        else fprintf(f, "FRIZI_%s%s%d,IZIVIA,\"", p, *p ? "_" : "", 1000 + j);
+        for (const char* c = name; *c; c++) {
+            if (*c == '"') fputc(json ? '\\' : '"', f);
+            fputc(*c, f);
+        }
+        if (json) fprintf(f, "\",\"adresse_station\":\"1 Rue Longue\",\"code_insee_commune\":\"75056\",\"puissance_nominale\":22,"
+                             "\"nbre_pdc\":2,\"condition_acces\":\"ACCES_LIBRE\",\"latitude\":48.8,\"longitude\":2.3}");
+        else fprintf(f, "\",1 Rue Longue,75056,22,2,ACCES_LIBRE,48.8,2.3\n");
+    }
+    if (json) fprintf(f, "]\n");
+    fclose(f);
+    return 1;
+}
+
+/**
+ * Noms de station de 200 à 4199 octets, entre guillemets avec des "" échappés :
+ * chaque chargeur doit les rendre entiers aux métadonnées.
+ */
+static int check_long_fields(const char* path, int nthreads) {
+    StationIndex idx;
+    StationMeta meta;
+    si_init(&idx);
+    sm_init(&meta);
+    idx.meta = &meta;
+    int r = nthreads ? ds_load_stations_from_csv_parallel(path, &idx, nthreads) : ds_load_stations_from_csv(path, &idx);
+    int ok = r == CSV_LONG_ROWS;
+    char want[CSV_LONG_MAX + 1];
+    for (int j = 0; ok && j < CSV_LONG_ROWS; j++) {
+        StationMetaView v;
+        long_name(want, j, 200 + (j * 37) % (CSV_LONG_MAX - 200));
+        ok = sm_get(&meta, 1000 + j, &v) && strcmp(v.name, want) == 0;
+    }
+    si_clear(&idx);
+    return ok;
+}
+
+/* empreinte de chaque ligne lue (contenu et identifiant d'itinérance), rangée par station */
+static void long_print(void* ctx, const StationRow* row) {
+    uint64_t* h = (uint64_t*)ctx;
+    int j = row->station_id - 1000;
+    if (j >= 0 && j < CSV_LONG_ROWS) h[j] = ds_hash_bytes(row->itinerance.p, (size_t)row->itinerance.len, ds_row_hash(row));
+}
+
+/* l'ancien chargeur coupe chaque objet au premier '}' : il ne lit pas les objets imbriqués */
+static void bench_json(int n) {
+    const char* path = "/tmp/chargecraft_bench.json";
+    const char* csv = "/tmp/chargecraft_bench_long.csv";
+    // même export dans les deux formats : mêmes lignes, même empreinte
+    if (gen_long(path, 1) && gen_long(csv, 0)) {
+        uint64_t hj[CSV_LONG_ROWS] = {0}, hc[CSV_LONG_ROWS] = {0};
+        int rj = ds_scan_stations_from_json(path, long_print, hj);
+        int rc = ds_scan_stations_from_csv(csv, long_print, hc);
+        int diff = 0;
+        for (int j = 0; j < CSV_LONG_ROWS; j++) diff += hj[j] != hc[j] || !hj[j];
+        printf("[json] champs longs (identifiants de %d octets, noms jusqu'à %d) : %d lignes JSON, %d CSV, "
+               "%d empreintes différentes  %s\n", LONG_ID_PAD + 11, CSV_LONG_MAX - 1, rj, rc, diff,
+               rj == rc && !diff ? "identique" : "DIFFERENT");
+    }
+    remove(csv);
+    if (gen_json(path, n, 0)) bench_json_file(path, "objets plats", n, 1);
+    if (gen_json(path, n, 1)) bench_json_file(path, "objets imbriqués", n, 0);
+    remove(path);
+}
+
+static void bench_csv(int n) {
+    const char* path = "/tmp/chargecraft_bench.csv";
+    if (gen_long(path, 0)) {
+        int seq = check_long_fields(path, 0), par = check_long_fields(path, 4);
+        printf("[csv] champs longs (%d à %d octets, \"\" échappés) : séquentiel %s | 4 threads %s\n",
+               200, CSV_LONG_MAX - 1, seq ? "entiers" : "TRONQUÉS", par ? "entiers" : "TRONQUÉS");
+    }
+    if (!gen_csv(path, n)) { printf("[csv] impossible d'écrire %s\n", path); return; }
+
+    StationIndex ref;
+    si_init(&ref);
+    double t0 = now_sec();
+    int rows = ds_load_stations_from_csv(path, &ref);
+    double t_seq = now_sec() - t0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("[csv] %d lignes, séquentiel : %8.2f ms\n", rows, t_seq * 1e3);
+
+    static const int threads[] = {1, 2, 4, 8};
+    for (int k = 0; k < 4; k++) {
+        StationIndex idx;
+        si_init(&idx);
+        t0 = now_sec();
+        int r = ds_load_stations_from_csv_parallel(path, &idx, threads[k]);
+        double t = now_sec() - t0;
+        printf("[csv] %d thread(s) / %ld coeur(s) : %8.2f ms  (x%.2f)  %s\n",
+               threads[k], cpus, t * 1e3, t_seq / t,
+               (r == rows && same_index(&ref, &idx)) ? "identique" : "DIFFERENT");
+        si_clear(&idx);
+    }
+    si_clear(&ref);
+    remove(path);
+}
+
+/**
+ * Rapport mémoire des métadonnées. Le jeu synthétique reprend la forme du jeu
+ * national IRVE : quelques opérateurs, ~35 000 communes, nom et adresse libres.
+ */
+#define META_CHURN_ROUNDS 10
+
+static void bench_meta(int n) {
+    const char* path = "/tmp/chargecraft_bench.csv";
+    if (!gen_csv(path, n)) { printf("[meta] impossible d'écrire %s\n", path); return; }
+
+    StationIndex idx;
+    StationMeta meta;
+    si_init(&idx);
+    sm_init(&meta);
+    idx.meta = &meta;
+    double t0 = now_sec();
+    int rows = ds_load_stations_from_csv(path, &idx);
+    double t = now_sec() - t0;
+    printf("[meta] %d lignes chargées avec métadonnées en %.2f ms\n", rows, t * 1e3);
+    sm_print_memory_report(&meta);
+    printf("  noeud AVL chaud  : %10zu o/station (StationInfo = %zu o)\n", sizeof(StationNode), sizeof(StationInfo));
+
+    StationMetaView v;
+    if (sm_get(&meta, 1004, &v))
+        printf("  ex. 1004 : %s | %s | %s | INSEE %s | %s\n", v.operator_name, v.name, v.address, v.insee, v.access);
+
+    // renommages et suppressions répétés : l'arène reste bornée par le texte vivant
+    size_t start = meta.arena_len, peak = 0, written = 0;
+    int failed = 0, wrong = 0;
+    char name[64], addr[64];
+    t0 = now_sec();
+    for (int round = 1; round <= META_CHURN_ROUNDS; round++) {
+        for (int id = 1000; id < 1000 + n; id++) {
+            if (id % 10 == round % 10) { sm_remove(&meta, id); continue; }
+            int ln = snprintf(name, sizeof name, "Station %d, version %d", id, round);
+            int la = snprintf(addr, sizeof addr, "%d Avenue du Rechargement %d", round, id);
+            StationMetaInput in = { { "IZIVIA", 6 }, { name, ln }, { addr, la }, { "75056", 5 }, { "ACCES_LIBRE", 11 } };
+            failed += !sm_set(&meta, id, &in);
+            written += (size_t)(ln + la + 2);
+            if (meta.arena_len > peak) peak = meta.arena_len;
+        }
+    }
+    t = now_sec() - t0;
+    for (int id = 1000; id < 1000 + n; id++) {
+        int kept = id % 10 != META_CHURN_ROUNDS % 10;
+        snprintf(name, sizeof name, "Station %d, version %d", id, META_CHURN_ROUNDS);
+        wrong += kept ? !sm_get(&meta, id, &v) || strcmp(v.name, name) != 0 : sm_get(&meta, id, &v);
+    }
+    printf("[meta] %d tours de renommages : %.2f ms | %.1f Mo écrits, arène %.1f Mo au départ, %.1f Mo au plus, "
+           "%.1f Mo (%zu o morts) à la fin | %d échecs, %d stations fausses  %s\n", META_CHURN_ROUNDS, t * 1e3,
+           written / 1048576.0, start / 1048576.0, peak / 1048576.0, meta.arena_len / 1048576.0, meta.arena_dead,
+           failed, wrong, !failed && !wrong && peak < 3 * (start + written / META_CHURN_ROUNDS) ? "bornée" : "DIFFERENT");
+    si_clear(&idx);
+    remove(path);
+}
+
+/**
+ * Rechargement complet (si_clear + chargement) contre rechargement incrémental
+ * d'un export où ~1,5% des lignes ont changé.
+ */
+static void bench_reload(int n) {
+    const char* v1 = "/tmp/chargecraft_bench.csv";
+    const char* v2 = "/tmp/chargecraft_bench_v2.csv";
+    if (!gen_csv(v1, n) || !gen_csv_edited(v2, n, 1)) { printf("[reload] impossible d'écrire les fichiers\n"); return; }
+
+    StationIndex idx;
+    ReloadState st;
+    ReloadStats stats;
+    si_init(&idx);
+    rl_init(&st);
+    double t0 = now_sec();
+    ds_reload_stations_from_csv(v1, &idx, &st, &stats);
+    printf("[reload] chargement initial : %8.2f ms  ", (now_sec() - t0) * 1e3);
+    rl_print_stats(&stats);
+
+    // occupation vivante à préserver
+    StationNode* live = si_find(idx.root, 1002);
+    if (live) { live->info.slots_free = 0; live->info.last_ts = 42; }
+
+    t0 = now_sec();
+    ds_reload_stations_from_csv(v2, &idx, &st, &stats);
+    printf("[reload] incrémental        : %8.2f ms  ", (now_sec() - t0) * 1e3);
+    rl_print_stats(&stats);
+    live = si_find(idx.root, 1002);
+    printf("[reload] station 1002 après : slots=%d last_ts=%d (occupation conservée)\n",
+           live ? live->info.slots_free : -1, live ? live->info.last_ts : -1);
+
+    t0 = now_sec();
+    ds_reload_stations_from_csv(v2, &idx, &st, &stats);
+    printf("[reload] sans changement    : %8.2f ms  ", (now_sec() - t0) * 1e3);
+    rl_print_stats(&stats);
+
+    t0 = now_sec();
+    si_clear(&idx);
+    ds_load_stations_from_csv(v2, &idx);
+    printf("[reload] complet (si_clear) : %8.2f ms\n", (now_sec() - t0) * 1e3);
+    si_clear(&idx);
+    rl_clear(&st);
+
+    // tarification attachée : les stations modifiées gardent le prix de leur palier
+    PriceCurve curve;
+    PricingEngine pe;
+    pr_default_curve(&curve);
+    memset(&pe, 0, sizeof pe);
+    rl_init(&st);
+    if (ds_reload_stations_from_csv(v1, &idx, &st, NULL) >= 0 && pr_init(&pe, &curve, NULL, NULL) &&
+        pr_attach(&pe, &idx, 0) >= 0) {
+        Pipeline pl;
+        pl_init(&pl, &idx, NULL, 0, 0);
+        pl.pricing = &pe;
+        unsigned seed = 5;
+        for (int k = 0; k < 4 * n; k++) {
+            Event e = { k / 100, -1, 1000 + (int)(rand_r(&seed) % (unsigned)n), rand_r(&seed) % 4 != 0 };
+            pl_apply(&pl, &e);
+        }
+        st.pricing = &pe;
+        ds_reload_stations_from_csv(v2, &idx, &st, &stats);
+        int off = 0, tiered = 0;
+        SiCursor cur;
+        si_cursor_begin(&cur, &idx, INT_MIN, INT_MAX);
+        for (StationNode* s; (s = si_cursor_next(&cur)) != NULL;) {
+            off += s->info.price_cents != pr_price(&pe, s->station_id);
+            tiered += s->info.price_cents != 300;
+        }
+        printf("[reload] avec tarification : %lld changements de prix, ~%d modifiées | %d stations hors prix de base, "
+               "%d prix différents de leur palier  %s\n", pe.stats.changes, stats.updated, tiered, off,
+               off ? "DIFFERENT" : "identique");
+    }
+    pr_clear(&pe);
+    si_clear(&idx);
+    rl_clear(&st);
+
+    // connecteurs attachés : le rechargement redimensionne, ajoute et retire les stations suivies
+    ConnStore conns, fresh;
+    cn_init(&conns);
+    cn_init(&fresh);
+    rl_init(&st);
+    StationIndex ref;
+    si_init(&ref);
+    if (ds_reload_stations_from_csv(v1, &idx, &st, NULL) >= 0 && cn_attach(&conns, &idx) >= 0) {
+        idx.conns = &conns;
+        Pipeline pl;
+        pl_init(&pl, &idx, NULL, 0, 0);
+        unsigned seed = 6;
+        for (int k = 0; k < 4 * n; k++) {
+            Event e = { k, (int)(rand_r(&seed) % 1000), 1000 + (int)(rand_r(&seed) % (unsigned)n), rand_r(&seed) % 3 != 0 };
+            pl_apply(&pl, &e);
+        }
+        ds_reload_stations_from_csv(v2, &idx, &st, &stats);
+        // puis des événements sur les stations rechargées : le bitset doit suivre la nouvelle capacité
+        for (int k = 0; k < 4 * n; k++) {
+            Event e = { k, (int)(rand_r(&seed) % 1000), 1000 + (int)(rand_r(&seed) % (unsigned)(n + n / 200)),
+                        rand_r(&seed) % 3 != 0 };
+            pl_apply(&pl, &e);
+        }
+        // capacités de référence : le nouveau jeu chargé de zéro
+        int* cap = (int*)calloc((size_t)(n + n / 200 + 1), sizeof(int));
+        if (cap && ds_load_stations_from_csv(v2, &ref) >= 0 && cn_attach(&fresh, &ref) >= 0) {
+            for (int r = 0; r < fresh.count; r++) cap[fresh.st[r].station_id - 1000] = fresh.st[r].capacity;
+            int mismatch = 0, wrong_cap = 0;
+            for (int r = 0; r < conns.count; r++) {
+                const CnStation* s = &conns.st[r];
+                StationNode* node = si_find(idx.root, s->station_id);
+                wrong_cap += !node || s->capacity != cap[s->station_id - 1000];
+                mismatch += node && node->info.slots_free != cn_free(&conns, s->station_id);
+            }
+            printf("[reload] avec connecteurs  : %d stations suivies pour %d indexées (%d attendues), "
+                   "%d capacités fausses, %d créneaux libres incohérents  %s\n",
+                   conns.count, idx.size, ref.size, wrong_cap, mismatch,
+                   conns.count == ref.size && idx.size == ref.size && !wrong_cap && !mismatch ? "identique" : "DIFFERENT");
+            cn_print_stats(&conns);
+        }
+        free(cap);
+    }
+    idx.conns = NULL;
+    cn_clear(&conns);
+    cn_clear(&fresh);
+    si_clear(&idx);
+    si_clear(&ref);
+    rl_clear(&st);
+    remove(v1);
+    remove(v2);
+}
+
+static MetaText meta_text(const char* s) {
+    MetaText t = { s, (int)strlen(s) };
+    return t;
+}
+
+/* métadonnées de deux magasins comparées champ par champ, station par station */
+static int meta_diff(const StationDataset* ds, const StationMeta* a, const StationMeta* b) {
+    int diff = 0;
+    for (uint32_t i = 0; i < ds->hdr->count; i++) {
+        StationMetaView x, y;
+        int id = ds->ids[i];
+        if (!sm_get(a, id, &x) || !sm_get(b, id, &y)) { diff++; continue; }
+        diff += strcmp(x.operator_name, y.operator_name) || strcmp(x.name, y.name) || strcmp(x.address, y.address) ||
+                strcmp(x.insee, y.insee) || strcmp(x.access, y.access);
+    }
+    return diff;
+}
+
+/**
+ * Passage du .ccds à l'AVL (ev_sim, ev_server) avec métadonnées : une station
+ * à la fois (si_add + sm_set) contre un bloc construit depuis ids[] et le
+ * magasin repris du fichier. L'index en bloc subit ensuite instantané,
+ * suppressions et renommages, pour vérifier qu'il se comporte comme un autre.
+ */
+static void dataset_to_index(const StationDataset* ds, StationIndex* csv) {
+    StationIndex one, bulk;
+    StationMeta m1, m2;
+    si_init(&one);
+    si_init(&bulk);
+    sm_init(&m1);
+    sm_init(&m2);
+    one.meta = &m1;
+    bulk.meta = &m2;
+    int n = (int)ds->hdr->count;
+    double t0 = now_sec();
+    for (int i = 0; i < n; i++) {
+        StationMetaView v;
+        dset_meta(ds, (uint32_t)i, &v);
+        si_add(&one, ds->recs[i].station_id, ds->recs[i].info);
+        StationMetaInput in = { meta_text(v.operator_name), meta_text(v.name), meta_text(v.address),
+                                meta_text(v.insee), meta_text(v.access) };
+        sm_set(&m1, ds->recs[i].station_id, &in);
+    }
+    double t_one = now_sec() - t0;
+    t0 = now_sec();
+    int r = dset_to_index(ds, &bulk);
+    double t_bulk = now_sec() - t0;
+    int same = r == n && same_index(csv, &bulk) && same_index(&one, &bulk);
+    int diff = meta_diff(ds, &m1, &m2);
+    printf("[dataset] vers l'AVL + métadonnées : une à une %8.2f ms | d'un bloc %8.2f ms (x%.1f, %s) | %d métadonnées différentes  %s\n",
+           t_one * 1e3, t_bulk * 1e3, t_one / t_bulk, m2.arena_borrowed ? "texte lu dans la projection" : "texte copié",
+           diff, same && !diff ? "identique" : "DIFFERENT");
+
+    // les noeuds du bloc : figés par un instantané, copiés, supprimés, renommés
+    SiSnapshot* snap = si_snapshot(&bulk);
+    int wrong = 0;
+    for (int i = 0; i < n; i++) {
+        int id = ds->ids[i];
+        if (i % 7 == 0) {
+            si_delete(&bulk, id);
+            si_delete(&one, id);
+        } else if (i % 7 == 1) {
+            StationNode* node = si_find_mut(&bulk, id);
+            if (node) node->info.slots_free++;
+            node = si_find(one.root, id);
+            if (node) node->info.slots_free++;
+            StationMetaInput in = { meta_text("IZIVIA"), meta_text("Renommée"), meta_text("1 Rue Neuve"),
+                                    meta_text("75056"), meta_text("ACCES_LIBRE") };
+            sm_set(&m1, id, &in);
+            sm_set(&m2, id, &in);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        StationNode* a = si_find(snap->root, ds->ids[i]);
+        wrong += !a || memcmp(&a->info, &ds->recs[i].info, sizeof a->info) != 0;
+    }
+    si_snapshot_release(snap);
+    same = same_index(&one, &bulk);
+    diff = 0;
+    for (int i = 0; i < n; i++) {
+        StationMetaView x, y;
+        int ka = sm_get(&m1, ds->ids[i], &x), kb = sm_get(&m2, ds->ids[i], &y);
+        diff += ka != kb || (ka && (strcmp(x.name, y.name) || strcmp(x.address, y.address)));
+    }
+    printf("[dataset] index en bloc après suppressions et renommages : %d stations, instantané %s, "
+           "%d métadonnées différentes  %s\n", bulk.size, wrong ? "MODIFIÉ" : "intact", diff,
+           same && !wrong && !diff ? "identique" : "DIFFERENT");
+    si_clear(&one);
+    si_clear(&bulk);
+}
+
+/**
+ * Identifiants d'itinérance à travers le .ccds : deux opérateurs partagent
+ * leurs numéros, la compilation renumérote l'un d'eux. Le registre rechargé
+ * par dset_to_index doit redonner, chaîne par chaîne, l'identifiant attribué
+ * en chargeant le CSV directement.
+ */
+static void dataset_keys(int n) {
+    const char* csv = "/tmp/chargecraft_keys.csv";
+    const char* bin = "/tmp/chargecraft_keys.ccds";
+    FILE* f = fopen(csv, "w");
+    if (!f) { printf("[dataset] impossible d'écrire %s\n", csv); return; }
+    fprintf(f, "id_station_itinerance,nom_operateur,nom_station,adresse_station,code_insee_commune,"
+               "puissance_nominale,nbre_pdc,condition_acces,latitude,longitude\n");
+    for (int i = 0; i < n; i++)
+        fprintf(f, "%s_%d,OP,Station %d,1 Rue Neuve,75056,%d,2,ACCES_LIBRE,48.8,2.3\n",
+                i % 2 ? "FRTSL" : "FRIZI", 1000 + i / 2, i, i % 2 ? 150 : 22);
+    fclose(f);
+
+    StationIndex direct, bulk;
+    StationKeys k1, k2;
+    StationDataset ds;
+    si_init(&direct);
+    si_init(&bulk);
+    sk_init(&k1);
+    sk_init(&k2);
+    direct.keys = &k1;
+    bulk.keys = &k2;
+    int rows = ds_load_stations_from_csv(csv, &direct);
+    int compiled = dset_compile(csv, bin);
+    int r = compiled == rows && dset_open(bin, &ds, DSET_OPEN_VERIFY) ? dset_to_index(&ds, &bulk) : -1;
+    if (compiled == rows) dset_close(&ds);
+    int bad = 0;
+    char s[32];
+    for (int i = 0; i < n; i++) {
+        int len = snprintf(s, sizeof s, "%s_%d", i % 2 ? "FRTSL" : "FRIZI", 1000 + i / 2);
+        int id = sk_find(&k2, s, len);
+        bad += id < 0 || id != sk_find(&k1, s, len) || !si_find(bulk.root, id);
+    }
+    printf("[dataset] identifiants d'itinérance : %d stations dont %d renumérotées, %d chaînes perdues  %s\n",
+           r, k1.renumbered, bad, r == rows && k1.renumbered && !bad ? "identique" : "DIFFERENT");
+    si_clear(&direct);
+    si_clear(&bulk);
+    sk_clear(&k1);
+    sk_clear(&k2);
+    remove(csv);
+    remove(bin);
+}
+
+/* démarrage : jeu .ccds projeté contre rechargement du CSV */
+static void bench_dataset(int n) {
+    const char* csv = "/tmp/chargecraft_bench.csv";
+    const char* bin = "/tmp/chargecraft_bench.ccds";
+    if (!gen_csv(csv, n)) { printf("[dataset] impossible d'écrire %s\n", csv); return; }
+
+    double t0 = now_sec();
+    int count = dset_compile(csv, bin);
+    printf("[dataset] compilation hors ligne : %8.2f ms (%d stations)\n", (now_sec() - t0) * 1e3, count);
+
+    StationIndex idx;
+    si_init(&idx);
+    t0 = now_sec();
+    ds_load_stations_from_csv(csv, &idx);
+    printf("[dataset] démarrage CSV          : %8.2f ms\n", (now_sec() - t0) * 1e3);
+
+    StationDataset ds;
+    t0 = now_sec();
+    int ok = dset_open(bin, &ds, 0);
+    printf("[dataset] démarrage .ccds (mmap) : %8.3f ms\n", (now_sec() - t0) * 1e3);
+    if (!ok) { printf("[dataset] ouverture impossible\n"); si_clear(&idx); return; }
+    dset_close(&ds);
+    t0 = now_sec();
+    ok = dset_open(bin, &ds, DSET_OPEN_VERIFY);
+    printf("[dataset] .ccds + empreinte      : %8.3f ms  (%.1f Mo)\n", (now_sec() - t0) * 1e3, ds.size / (1024.0 * 1024.0));
+
+    // toutes les stations de l'index doivent se retrouver à l'identique
+    SiCursor cur;
+    si_cursor_begin(&cur, &idx, INT_MIN, INT_MAX);
+    int m = 0, same = ok;
+    t0 = now_sec();
+    for (StationNode* node; same && (node = si_cursor_next(&cur)) != NULL; m++) {
+        DatasetRecord* r = dset_find(&ds, node->station_id);
+        same = r && memcmp(&r->info, &node->info, sizeof(StationInfo)) == 0;
+    }
+    same = same && m == count;
+    double t = now_sec() - t0;
+    printf("[dataset] recherche x%-9d    : %8.2f ms  %s\n", m, t * 1e3, same ? "identique" : "DIFFERENT");
+    if (ok) dataset_to_index(&ds, &idx);
+
+    dset_close(&ds);
+    si_clear(&idx);
+    remove(csv);
+    remove(bin);
+    dataset_keys(n < 20000 ? n : 20000);
+}
+
+typedef struct PostfixScan {
+    char** toks;
+    int n_toks;
+    int matches;
+} PostfixScan;
+
+static void postfix_scan_rec(StationNode* node, PostfixScan* s) {
+    if (!node) return;
+    postfix_scan_rec(node->left, s);
+    s->matches += eval_rule_postfix(s->toks, s->n_toks, &node->info);
+    postfix_scan_rec(node->right, s);
+}
+
+static int count_match(void* ctx, StationNode* node) {
+    (void)node;
+    (*(int*)ctx)++;
+    return 1;
+}
+
+static void bench_rules(int n) {
+    // puissances réalistes : beaucoup de 22 kW, peu de 350 kW
+    static const int POWERS[] = { 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+                                  50, 50, 50, 50, 50, 50, 150, 150, 150, 350 };
+    StationIndex idx;
+    si_init(&idx);
+    srand(42);
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { POWERS[rand() % 20], 20 + rand() % 60, rand() % 8, 0 };
+        si_add(&idx, i + 1, in);
+    }
+    RuleIndexes ri;
+    ri_init(&ri);
+    double t0 = now_sec();
+    ri_refresh(&ri, &idx);
+    printf("[rules] index secondaires (power, price) : %8.2f ms\n", (now_sec() - t0) * 1e3);
+
+    static const struct { const char* infix; char* postfix[7]; int n_postfix; } Q[] = {
+        { "power >= 300 && slots >= 1",  { "power", "300", ">=", "slots", "1", ">=", "&&" }, 7 },
+        { "price < 25 && power >= 50",   { "price", "25", "<", "power", "50", ">=", "&&" }, 7 },
+        { "slots >= 1 && power >= 22",   { "slots", "1", ">=", "power", "22", ">=", "&&" }, 7 },
+    };
+    RulePlan* plan = (RulePlan*)malloc(sizeof(RulePlan));
+    for (size_t q = 0; plan && q < sizeof Q / sizeof Q[0]; q++) {
+        PostfixScan ps = { (char**)Q[q].postfix, Q[q].n_postfix, 0 };
+        t0 = now_sec();
+        postfix_scan_rec(idx.root, &ps);
+        double t_post = now_sec() - t0;
+
+        int matches = 0;
+        t0 = now_sec();
+        rplan_build(plan, Q[q].infix, &idx, &ri, NULL, 0);
+        rplan_execute(plan, &idx, count_match, &matches);
+        double t_plan = now_sec() - t0;
+
+        printf("[rules] %-28s postfixe %8.2f ms | planifiée %8.2f ms (%s %s, %d/%d) %s\n",
+               Q[q].infix, t_post * 1e3, t_plan * 1e3,
+               plan->access == PA_RANGE ? "index" : "balayage",
+               plan->access == PA_RANGE ? rule_attr_name(plan->attr) : "",
+               matches, ps.matches, matches == ps.matches ? "identique" : "DIFFERENT");
+    }
+    free(plan);
+    ri_clear(&ri);
+    si_clear(&idx);
+}
+
+static void count_notify(void* ctx, int sub_id, int station_id, int matched) {
+    (void)sub_id; (void)station_id; (void)matched;
+    (*(long long*)ctx)++;
+}
+
+/**
+ * Règle d'alerte aléatoire : surtout des alertes locales (plage d'id voisines),
+ * quelques alertes globales sur power/price et des règles à filtre résiduel.
+ */
+static void gen_alert(char* buf, size_t len, int n_stations) {
+    static const int POWERS[] = { 22, 50, 100, 150, 350 };
+    int id = 1 + rand() % n_stations;
+    int k = rand() % 100;
+    if (k < 55)
+        snprintf(buf, len, "id >= %d && id <= %d && power >= %d && slots >= 1", id, id + 50, POWERS[rand() % 5]);
+    else if (k < 80)
+        snprintf(buf, len, "id == %d && slots >= %d", id, 1 + rand() % 3);
+    else if (k < 90)
+        snprintf(buf, len, "id >= %d && id <= %d && (slots >= 2 || ts < 10000)", id, id + 20);
+    else if (k < 95)
+        snprintf(buf, len, "(id >= %d && id <= %d && slots >= 4) || (id == %d && price < 30)", id, id + 30, id + 1);
+    else if (k < 99)
+        snprintf(buf, len, "power >= 350 && price <= %d && slots >= %d", 20 + rand() % 10, 3 + rand() % 3);
+    else
+        snprintf(buf, len, "slots >= 7 || price < %d", 20 + rand() % 3);
+}
+
+static void bench_subs(int n) {
+    int n_rules = 100000;
+    int n_stations = 100000;
+    int n_events = n;
+    StationInfo* st = (StationInfo*)malloc(sizeof(StationInfo) * (n_stations + 1));
+    char (*texts)[128] = malloc(sizeof *texts * (size_t)n_rules);
+    if (!st || !texts) { free(st); free(texts); return; }
+    srand(7);
+    for (int i = 1; i <= n_stations; i++) {
+        StationInfo in = { (int[]){ 22, 50, 100, 150, 350 }[rand() % 5], 20 + rand() % 60, rand() % 8, 0 };
+        st[i] = in;
+    }
+
+    long long notified = 0;
+    SubEngine e;
+    sub_init(&e, count_notify, &notified);
+    double t0 = now_sec();
+    for (int r = 0; r < n_rules; r++) {
+        gen_alert(texts[r], sizeof texts[r], n_stations);
+        sub_register(&e, texts[r], NULL, 0);
+    }
+    printf("[subs] %d règles enregistrées : %8.2f ms\n", n_rules, (now_sec() - t0) * 1e3);
+
+    // contrôle : même nombre de notifications qu'une réévaluation de toutes les règles
+    Rule* rules = (Rule*)malloc(sizeof(Rule) * 2000);
+    int n_check = rules ? 2000 : 0;
+    for (int r = 0; r < n_check; r++) rule_parse(texts[r], &rules[r], NULL, 0);
+    SubEngine small;
+    long long small_notified = 0, naive_notified = 0;
+    sub_init(&small, count_notify, &small_notified);
+    for (int r = 0; r < n_check; r++) sub_register(&small, texts[r], NULL, 0);
+    double t_index = 0, t_naive = 0;
+    for (int k = 0; k < 5000 && n_check; k++) {
+        int id = 1 + rand() % n_stations;
+        StationInfo before = st[id];
+        st[id].slots_free += (rand() & 1) ? 1 : (st[id].slots_free > 0 ? -1 : 0);
+        st[id].last_ts = k;
+        t0 = now_sec();
+        sub_on_update(&small, id, &before, &st[id]);
+        t_index += now_sec() - t0;
+        t0 = now_sec();
+        for (int r = 0; r < n_check; r++)
+            naive_notified += (rule_eval(&rules[r], rules[r].root, id, &before) != 0)
+                           != (rule_eval(&rules[r], rules[r].root, id, &st[id]) != 0);
+        t_naive += now_sec() - t0;
+    }
+    printf("[subs] contrôle sur %d règles : %lld notifications (%.0f ns/maj), réévaluation complète %lld "
+           "(%.0f ns/maj)  %s\n", n_check, small_notified, t_index * 1e9 / 5000, naive_notified,
+           t_naive * 1e9 / 5000, small_notified == naive_notified ? "identique" : "DIFFERENT");
+    sub_clear(&small);
+    free(rules);
+
+    t0 = now_sec();
+    for (int k = 0; k < n_events; k++) {
+        int id = 1 + rand() % n_stations;
+        StationInfo before = st[id];
+        st[id].slots_free += (rand() & 1) ? 1 : (st[id].slots_free > 0 ? -1 : 0);
+        st[id].last_ts = k;
+        sub_on_update(&e, id, &before, &st[id]);
+    }
+    double t = now_sec() - t0;
+    printf("[subs] %d mises à jour : %8.2f ms  (%.0f ns/maj, %lld notifications)\n",
+           n_events, t * 1e3, t * 1e9 / n_events, notified);
+    sub_print_stats(&e);
+    sub_clear(&e);
+    free(texts);
+    free(st);
+}
+
+/* top-N recalculé sans cache (cache jetable d'une entrée) */
+static int fresh_query(StationIndex* idx, RuleIndexes* ri, const char* text, int rank, int n, int* out) {
+    QueryCache t;
+    const int* ids = NULL;
+    if (!qc_init(&t, idx, ri, 1)) return -1;
+    int count = qc_query(&t, text, rank, n, &ids);
+    for (int i = 0; i < count; i++) out[i] = ids[i];
+    qc_clear(&t);
+    return count;
+}
+
+static void bench_cache(int n) {
+    static const int POWERS[] = { 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+                                  50, 50, 50, 50, 50, 50, 150, 150, 150, 350 };
+    static const struct { const char* rule; int rank; } Q[] = {
+        { "power >= 150 && slots >= 1",               QC_BY_PRICE },
+        { "power >= 150 && slots >= 1",               QC_BY_ID },
+        { "price < 30 && slots > 0",                  QC_BY_POWER },
+        { "id >= 1000 && id < 5000 && slots >= 2",    QC_BY_SLOTS },
+        { "power >= 50 && price <= 40",               QC_BY_PRICE },
+        { "slots >= 6",                               QC_BY_ID },
+        { "power == 350 || price < 22",               QC_BY_SLOTS },
+        { "id < 20000 && power >= 100",               QC_BY_POWER },
+        { "slots >= 1",                               QC_BY_ID },
+        { "power > 149 and slots > 0",                QC_BY_PRICE },   // même clé que la première
+    };
+    int n_q = (int)(sizeof Q / sizeof Q[0]);
+    int top = 10, rounds = 2000, events_per_round = 10, check_every = 100;
+
+    StationIndex idx;
+    si_init(&idx);
+    srand(11);
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { POWERS[rand() % 20], 20 + rand() % 60, rand() % 8, 0 };
+        si_add(&idx, i + 1, in);
+    }
+    RuleIndexes ri;
+    ri_init(&ri);
+    ri_refresh(&ri, &idx);
+    QueryCache qc;
+    if (!qc_init(&qc, &idx, &ri, 64)) { ri_clear(&ri); si_clear(&idx); return; }
+    Pipeline pl;
+    pl_init(&pl, &idx, NULL, 0, 0);
+    pl.cache = &qc;
+
+    int fresh[64];
+    const int* ids = NULL;
+    long long n_cached = 0, n_hit = 0, n_fresh = 0, mismatches = 0;
+    double t_cached = 0, t_hit = 0, t_fresh = 0, t_events = 0;
+    int ts = 0, next_id = n + 1;
+    for (int r = 0; r < rounds; r++) {
+        double t0 = now_sec();
+        for (int k = 0; k < events_per_round; k++) {
+            Event ev = { ++ts, 0, 1 + rand() % n, rand() & 1 };
+            pl_apply(&pl, &ev);
+        }
+        t_events += now_sec() - t0;
+        if (r % 250 == 249) {
+            // ajouts et retraits hors boucle d'événements : détectés par version de tranche
+            StationInfo in = { 350, 21, 4, ts };
+            if (next_id > n + 1) si_delete(&idx, next_id - 1);
+            si_add(&idx, next_id++, in);
+        }
+        for (int q = 0; q < n_q; q++) {
+            long long hits = qc.stats.hits;
+            t0 = now_sec();
+            int count = qc_query(&qc, Q[q].rule, Q[q].rank, top, &ids);
+            double dt = now_sec() - t0;
+            t_cached += dt;
+            n_cached++;
+            if (qc.stats.hits > hits) {
+                t_hit += dt;
+                n_hit++;
+            }
+            if (r % check_every) continue;
+            t0 = now_sec();
+            int fc = fresh_query(&idx, &ri, Q[q].rule, Q[q].rank, top, fresh);
+            t_fresh += now_sec() - t0;
+            n_fresh++;
+            if (fc != count || memcmp(fresh, ids, sizeof(int) * (size_t)(count > 0 ? count : 0)) != 0) mismatches++;
+        }
+    }
+    printf("[cache] %d stations, %d requêtes x %d tours, %d événements par tour\n", n, n_q, rounds, events_per_round);
+    printf("[cache] succès : %6.0f ns | moyenne avec échecs : %8.0f ns | recalcul : %10.0f ns | "
+           "événement (avec réparation) : %6.0f ns\n",
+           t_hit * 1e9 / (double)(n_hit ? n_hit : 1), t_cached * 1e9 / (double)n_cached, t_fresh * 1e9 / (double)(n_fresh ? n_fresh : 1),
+           t_events * 1e9 / ((double)rounds * events_per_round));
+    printf("[cache] contrôle sur %lld recalculs : %s\n", n_fresh, mismatches ? "DIFFERENT" : "identique");
+    qc_print_stats(&qc);
+    qc_clear(&qc);
+    ri_clear(&ri);
+    si_clear(&idx);
+}
+
+/* agrégats d'un département par parcours complet de l'index et des métadonnées */
+typedef struct GeoScan {
+    const StationMeta* meta;
+    const char* dept;
+    long long fast_free, slots_free;
+} GeoScan;
+
+static void geo_scan_rec(const StationNode* n, GeoScan* g) {
+    if (!n) return;
+    geo_scan_rec(n->left, g);
+    g->slots_free += n->info.slots_free;
+    const StationMetaRec* r = sm_find_rec(g->meta, n->station_id);
+    const char* insee = r ? sm_commune(g->meta, r->commune_id) : "";
+    if (n->info.power_kW >= GEO_FAST_KW && strncmp(insee, g->dept, 2) == 0 && strlen(insee) == 5)
+        g->fast_free += n->info.slots_free;
+    geo_scan_rec(n->right, g);
+}
+
+static void bench_geo(int n) {
+    const char* path = "/tmp/chargecraft_bench.csv";
+    if (!gen_csv(path, n)) { printf("[geo] impossible d'écrire %s\n", path); return; }
+
+    StationIndex plain, idx;
+    StationMeta meta;
+    GeoTree geo;
+    si_init(&plain);
+    si_init(&idx);
+    sm_init(&meta);
+    if (!geo_init(&geo)) { remove(path); return; }
+    idx.meta = &meta;
+    idx.geo = &geo;
+    double t0 = now_sec();
+    ds_load_stations_from_csv(path, &plain);
+    double t_plain = now_sec() - t0;
+    t0 = now_sec();
+    int rows = ds_load_stations_from_csv(path, &idx);
+    double t_geo = now_sec() - t0;
+    printf("[geo] %d lignes : chargement %8.2f ms, avec métadonnées + hiérarchie %8.2f ms (%d communes)\n",
+           rows, t_plain * 1e3, t_geo * 1e3, geo.commune_count);
+
+    // même flux d'événements sur les deux index
+    int n_events = 1000000;
+    Pipeline pp, pg;
+    pl_init(&pp, &plain, NULL, 0, 0);
+    pl_init(&pg, &idx, NULL, 0, 0);
+    double t_ev_plain = 0, t_ev_geo = 0;
+    srand(5);
+    for (int k = 0; k < n_events; k += 1000) {
+        Event batch[1000];
+        for (int j = 0; j < 1000; j++) {
+            Event e = { k + j, 0, 1000 + rand() % n, rand() & 1 };
+            batch[j] = e;
+        }
+        t0 = now_sec();
+        for (int j = 0; j < 1000; j++) pl_apply(&pp, &batch[j]);
+        t_ev_plain += now_sec() - t0;
+        t0 = now_sec();
+        for (int j = 0; j < 1000; j++) pl_apply(&pg, &batch[j]);
+        t_ev_geo += now_sec() - t0;
+    }
+    printf("[geo] %d événements : %6.0f ns/év sans hiérarchie, %6.0f ns/év avec agrégats\n",
+           n_events, t_ev_plain * 1e9 / n_events, t_ev_geo * 1e9 / n_events);
+
+    t0 = now_sec();
+    const NNode* d13 = geo_department(&geo, "13");
+    int fast = d13 ? d13->agg.fast_slots_free : 0;
+    double t_q = now_sec() - t0;
+    GeoScan scan = { &meta, "13", 0, 0 };
+    t0 = now_sec();
+    geo_scan_rec(idx.root, &scan);
+    double t_scan = now_sec() - t0;
+    printf("[geo] créneaux rapides libres, département 13 : %d en %.0f ns | parcours complet %lld en %.2f ms  %s\n",
+           fast, t_q * 1e9, scan.fast_free, t_scan * 1e3, fast == scan.fast_free ? "identique" : "DIFFERENT");
+    printf("[geo] créneaux libres France : racine %d | parcours %lld  %s\n", geo.root->agg.slots_free,
+           scan.slots_free, geo.root->agg.slots_free == scan.slots_free ? "identique" : "DIFFERENT");
+    if (n <= 100000) geo_print(&geo, GEO_REGION);
+
+    si_clear(&plain);
+    si_clear(&idx);
+    sm_clear(&meta);
+    geo_clear(&geo);
+    remove(path);
+}
+
+/* somme des créneaux libres des feuilles d'un sous-arbre, sans les agrégats tenus à jour */
+static long long leaf_slots_rec(const NNode* n) {
+    if (!n->child_count) return n->agg.slots_free;
+    long long s = 0;
+    for (int i = 0; i < n->child_count; i++) s += leaf_slots_rec(n->child[i]);
+    return s;
+}
+
+static int same_agg(const NAgg* a, const NAgg* b) {
+    return a->connectors == b->connectors && a->slots_free == b->slots_free &&
+           a->fast_slots_free == b->fast_slots_free && a->power_kw == b->power_kw;
+}
+
+/**
+ * Arbre figé contre arbre de pointeurs, à n noeuds : racine, 18 régions,
+ * 100 départements, n/30 communes puis des stations rattachées au hasard,
+ * comme lors d'un chargement.
+ */
+static void bench_flat(int n) {
+    int n_comm = n / 30 > 1 ? n / 30 : 1;
+    int n_leaves = n - 1 - 18 - 100 - n_comm;
+    if (n_leaves < 1) n_leaves = 1;
+    NNode* root = n_create(0);
+    NNode* regions[18];
+    NNode* depts[100];
+    NNode** comm = (NNode**)malloc(sizeof(NNode*) * n_comm);
+    NNode** leaves = (NNode**)malloc(sizeof(NNode*) * n_leaves);
+    if (!root || !comm || !leaves) { free(comm); free(leaves); n_clear(root); return; }
+    srand(11);
+    for (int r = 0; r < 18; r++) n_attach(root, regions[r] = n_create(r + 1));
+    for (int d = 0; d < 100; d++) n_attach(regions[d % 18], depts[d] = n_create(d + 1));
+    for (int c = 0; c < n_comm; c++) n_attach(depts[rand() % 100], comm[c] = n_create(c));
+    for (int k = 0; k < n_leaves; k++) {
+        NNode* leaf = leaves[k] = n_create(1000 + k);
+        int pdc = 1 + rand() % 4, kw = (rand() % 4) * 50;
+        NAgg d = { pdc, rand() % (pdc + 1), 0, (long long)kw * pdc };
+        if (kw >= GEO_FAST_KW) d.fast_slots_free = d.slots_free;
+        n_attach(comm[rand() % n_comm], leaf);
+        n_propagate(leaf, 1, &d);
+    }
+    int nodes = 1 + 18 + 100 + n_comm + n_leaves;
+
+    NFlat f;
+    double t0 = now_sec();
+    if (!nf_freeze(&f, root)) { printf("[flat] échec d'allocation\n"); free(comm); free(leaves); n_clear(root); return; }
+    double t_freeze = now_sec() - t0;
+    long long mem_ptr = 0;
+    for (int k = 0; k < n_comm; k++) mem_ptr += comm[k]->child_cap * (long long)sizeof(NNode*);
+    for (int d = 0; d < 100; d++) mem_ptr += depts[d]->child_cap * (long long)sizeof(NNode*);
+    mem_ptr += (long long)nodes * (sizeof(NNode) + 16);   // 16 : en-tête malloc estimé
+    long long mem_flat = (long long)f.count * (7 * sizeof(int) + 2 * sizeof(NAgg)) +
+                         (long long)f.src_cap * (sizeof(NNode*) + sizeof(int));
+    printf("[flat] %d noeuds figés en %.2f ms | mémoire pointeurs ~%.1f Mo, figé %.1f Mo (dont %.1f Mo de table noeud -> position)\n",
+           f.count, t_freeze * 1e3, mem_ptr / 1e6, mem_flat / 1e6, f.src_cap * (sizeof(NNode*) + sizeof(int)) / 1e6);
+
+    int rounds = 10;
+    // parcours en profondeur : pile explicite contre balayage linéaire
+    const NNode** stack = (const NNode**)malloc(sizeof(const NNode*) * nodes);
+    int* order = (int*)malloc(sizeof(int) * nodes);
+    NNode** queue = (NNode**)malloc(sizeof(NNode*) * nodes);
+    if (!stack || !order || !queue) { free(stack); free(order); free(queue); goto done; }
+    long long sum_ptr = 0, sum_flat = 0;
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        int top = 0;
+        stack[top++] = root;
+        while (top) {
+            const NNode* x = stack[--top];
+            if (!x->child_count) sum_ptr += x->agg.slots_free;
+            for (int i = x->child_count - 1; i >= 0; i--) stack[top++] = x->child[i];
+        }
+    }
+    double t_dfs_ptr = (now_sec() - t0) / rounds;
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++)
+        for (int p = 0; p < f.count; p++) sum_flat += f.own[p].slots_free;
+    double t_dfs_flat = (now_sec() - t0) / rounds;
+    printf("[flat] profondeur : pointeurs %7.2f ms, figé %7.2f ms (x%.1f)  %s\n", t_dfs_ptr * 1e3,
+           t_dfs_flat * 1e3, t_dfs_ptr / t_dfs_flat, sum_ptr == sum_flat ? "identique" : "DIFFERENT");
+
+    // parcours en largeur, même ordre attendu des deux côtés
+    unsigned long long h_ptr = 0, h_flat = 0;
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        int head = 0, tail = 0;
+        h_ptr = 0;
+        queue[tail++] = root;
+        while (head < tail) {
+            NNode* x = queue[head++];
+            h_ptr = h_ptr * 31 + (unsigned)x->id;
+            for (int i = 0; i < x->child_count; i++) queue[tail++] = x->child[i];
+        }
+    }
+    double t_bfs_ptr = (now_sec() - t0) / rounds;
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        nf_bfs(&f, order);
+        h_flat = 0;
+        for (int k = 0; k < f.count; k++) h_flat = h_flat * 31 + (unsigned)f.id[order[k]];
+    }
+    double t_bfs_flat = (now_sec() - t0) / rounds;
+    printf("[flat] largeur    : pointeurs %7.2f ms, figé %7.2f ms (x%.1f)  %s\n", t_bfs_ptr * 1e3,
+           t_bfs_flat * 1e3, t_bfs_ptr / t_bfs_flat, h_ptr == h_flat ? "identique" : "DIFFERENT");
+
+    // agrégats de chaque département recalculés depuis les feuilles contre requête de Fenwick
+    long long s_rec = 0, s_fen = 0;
+    t0 = now_sec();
+    for (int d = 0; d < 100; d++) s_rec += leaf_slots_rec(depts[d]);
+    double t_rec = now_sec() - t0;
+    int dpos[100];
+    for (int d = 0; d < 100; d++) dpos[d] = nf_position(&f, depts[d]);
+    t0 = now_sec();
+    for (int d = 0; d < 100; d++) {
+        NAgg a;
+        nf_subtree(&f, dpos[d], NULL, &a);
+        s_fen += a.slots_free;
+    }
+    double t_fen = now_sec() - t0;
+    printf("[flat] 100 sous-arbres : parcours %8.2f ms, Fenwick %8.2f us  %s\n", t_rec * 1e3, t_fen * 1e6,
+           s_rec == s_fen ? "identique" : "DIFFERENT");
+
+    // mises à jour ponctuelles : propagation vers les ancêtres contre Fenwick
+    int n_up = 1000000;
+    int* who = (int*)malloc(sizeof(int) * n_up);
+    if (who) {
+        for (int k = 0; k < n_up; k++) who[k] = rand() % n_leaves;
+        t0 = now_sec();
+        for (int k = 0; k < n_up; k++) {
+            NAgg d = { 0, (k & 1) ? 1 : -1, 0, 0 };
+            n_propagate(leaves[who[k]], 0, &d);
+        }
+        double t_up_ptr = now_sec() - t0;
+        t0 = now_sec();
+        for (int k = 0; k < n_up; k++) {
+            NAgg d = { 0, (k & 1) ? 1 : -1, 0, 0 };
+            nf_update(&f, nf_position(&f, leaves[who[k]]), 0, &d);
+        }
+        double t_up_flat = now_sec() - t0;
+        int bad = 0;
+        for (int d = 0; d < 100; d++) {
+            NAgg a;
+            int items;
+            nf_subtree(&f, dpos[d], &items, &a);
+            bad += !same_agg(&a, &depts[d]->agg) || items != depts[d]->items_count;
+        }
+        printf("[flat] %d mises à jour : n_propagate %5.0f ns, nf_update %5.0f ns  %s\n", n_up,
+               t_up_ptr * 1e9 / n_up, t_up_flat * 1e9 / n_up, bad ? "DIFFERENT" : "identique");
+        free(who);
+    }
+    free(stack);
+    free(order);
+    free(queue);
+done:
+    nf_clear(&f);
+    free(comm);
+    free(leaves);
+    n_clear(root);
+}
+
+/* temps moyen d'une recherche sur les identifiants de ids, dans l'ordre donné */
+static double time_si_find(StationIndex* idx, const int* ids, int q, long long* sum) {
+    double t0 = now_sec();
+    for (int k = 0; k < q; k++) {
+        StationNode* node = si_find(idx->root, ids[k]);
+        *sum += node ? node->info.slots_free : -1;
+    }
+    return (now_sec() - t0) / q;
+}
+
+static double time_sc_find(const CompactIndex* c, const int* ids, int q, long long* sum) {
+    double t0 = now_sec();
+    for (int k = 0; k < q; k++) {
+        uint32_t pos = sc_find(c, ids[k]);
+        *sum += pos != SC_NIL ? c->nodes[pos].slots_free : -1;
+    }
+    return (now_sec() - t0) / q;
+}
+
+static void bench_compact(int n) {
+    int q = 2000000;
+    int* ids = (int*)malloc(sizeof(int) * (size_t)n);
+    int* probes = (int*)malloc(sizeof(int) * (size_t)q);
+    if (!ids || !probes) { printf("[compact] échec d'allocation\n"); free(ids); free(probes); return; }
+    // identifiants pairs 2..2n insérés dans un ordre aléatoire
+    srand(17);
+    for (int i = 0; i < n; i++) ids[i] = 2 * i + 2;
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)(((unsigned)rand() << 15 ^ (unsigned)rand()) % (unsigned)(i + 1));
+        int t = ids[i]; ids[i] = ids[j]; ids[j] = t;
+    }
+    for (int k = 0; k < q; k++) probes[k] = ids[((unsigned)rand() << 15 ^ (unsigned)rand()) % (unsigned)n];
+
+    StationIndex idx;
+    CompactIndex inc, packed;
+    si_init(&idx);
+    sc_init(&inc, 0);
+    sc_init(&packed, 0);
+    double t0 = now_sec();
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { (int[]){ 7, 22, 50, 100, 150, 350 }[ids[i] % 6], 20 + ids[i] % 60, ids[i] % 8, 0 };
+        si_add(&idx, ids[i], in);
+    }
+    double t_ptr = now_sec() - t0;
+    t0 = now_sec();
+    int ok = sc_reserve(&inc, n);
+    for (int i = 0; ok && i < n; i++) {
+        StationInfo in = { (int[]){ 7, 22, 50, 100, 150, 350 }[ids[i] % 6], 20 + ids[i] % 60, ids[i] % 8, 0 };
+        ok = sc_add(&inc, ids[i], in) == 1;
+    }
+    double t_inc = now_sec() - t0;
+    t0 = now_sec();
+    ok = ok && sc_from_index(&packed, &idx) == n;
+    double t_packed = now_sec() - t0;
+    if (!ok || idx.size != n) { printf("[compact] échec d'allocation\n"); goto done; }
+
+    // l'en-tête malloc (16 octets estimés) s'ajoute à chaque StationNode
+    double mem_ptr = (double)n * (sizeof(StationNode) + 16);
+    printf("[compact] %d stations | construction : pointeurs %.0f ms, compact %.0f ms (ajouts), %.0f ms (copie équilibrée)\n",
+           n, t_ptr * 1e3, t_inc * 1e3, t_packed * 1e3);
+    printf("[compact] mémoire par station : pointeurs %.1f o (%zu + en-tête), compact %.1f o (ajouts, %zu par noeud), %.1f o (copie)\n",
+           mem_ptr / n, sizeof(StationNode), (double)sc_bytes(&inc) / n, sizeof(CompactNode), (double)sc_bytes(&packed) / n);
+
+    int bad = 0;
+    for (int i = 0; i < n && !bad; i++) {
+        StationInfo a, b;
+        StationNode* node = si_find(idx.root, ids[i]);
+        sc_info(&inc, sc_find(&inc, ids[i]), &a);
+        sc_info(&packed, sc_find(&packed, ids[i]), &b);
+        bad = !node || memcmp(&a, &node->info, sizeof a) != 0 || memcmp(&b, &node->info, sizeof b) != 0;
+    }
+    long long s_ptr = 0, s_inc = 0, s_packed = 0;
+    double f_ptr = time_si_find(&idx, probes, q, &s_ptr);
+    double f_inc = time_sc_find(&inc, probes, q, &s_inc);
+    double f_packed = time_sc_find(&packed, probes, q, &s_packed);
+    printf("[compact] recherche aléatoire : pointeurs %5.0f ns, compact %5.0f ns (x%.2f), copie %5.0f ns (x%.2f)  %s\n",
+           f_ptr * 1e9, f_inc * 1e9, f_ptr / f_inc, f_packed * 1e9, f_ptr / f_packed,
+           !bad && s_ptr == s_inc && s_ptr == s_packed ? "identique" : "DIFFERENT");
+
+    // recherches croissantes : même chemin d'une requête à l'autre, cache chaud
+    for (int k = 0; k < q; k++) probes[k] = 2 * (int)((long long)k * n / q) + 2;
+    s_ptr = s_inc = s_packed = 0;
+    f_ptr = time_si_find(&idx, probes, q, &s_ptr);
+    f_inc = time_sc_find(&inc, probes, q, &s_inc);
+    f_packed = time_sc_find(&packed, probes, q, &s_packed);
+    printf("[compact] recherche croissante : pointeurs %5.0f ns, compact %5.0f ns (x%.2f), copie %5.0f ns (x%.2f)  %s\n",
+           f_ptr * 1e9, f_inc * 1e9, f_ptr / f_inc, f_packed * 1e9, f_ptr / f_packed,
+           s_ptr == s_inc && s_ptr == s_packed ? "identique" : "DIFFERENT");
+done:
+    si_clear(&idx);
+    sc_clear(&inc);
+    sc_clear(&packed);
+    free(ids);
+    free(probes);
+}
+
+#define KEY_LEN 24
+
+/* temps moyen d'une résolution des chaînes probes[k] ; sum cumule les identifiants */
+static double time_resolve(const StationKeys* k, int (*fn)(const StationKeys*, const char*, int),
+                           const char (*names)[KEY_LEN], const int* probes, int q, long long* sum) {
+    double t0 = now_sec();
+    for (int i = 0; i < q; i++) {
+        const char* s = names[probes[i]];
+        *sum += fn(k, s, (int)strlen(s));
+    }
+    return (now_sec() - t0) / q;
+}
+
+static void bench_keys(int n) {
+    int q = 2000000;
+    // quatre opérateurs qui partagent leurs numéros : deux de forme exacte, deux hachés
+    char (*names)[KEY_LEN] = (char (*)[KEY_LEN])malloc(sizeof *names * (size_t)n);
+    int* ids = (int*)malloc(sizeof(int) * (size_t)n);
+    int* probes = (int*)malloc(sizeof(int) * (size_t)q);
+    StationKeys k;
+    sk_init(&k);
+    if (!names || !ids || !probes) { printf("[keys] échec d'allocation\n"); goto done; }
+    static const char* const FORMS[] = { "FRIZI_%d", "FRTSL_%d", "FRS35PSDEV%07d", "FR*ABC*P_%d" };
+    for (int i = 0; i < n; i++) snprintf(names[i], KEY_LEN, FORMS[i % 4], 1000 + i / 4);
+    srand(23);
+    for (int i = 0; i < q; i++) probes[i] = (int)(((unsigned)rand() << 15 ^ (unsigned)rand()) % (unsigned)n);
+
+    double t0 = now_sec();
+    int ok = 1;
+    for (int i = 0; ok && i < n; i++) {
+        const char* us = strrchr(names[i], '_');
+        ids[i] = sk_add(&k, names[i], (int)strlen(names[i]), us ? atoi(us + 1) : -1);
+        ok = ids[i] >= 0;
+    }
+    double t_add = now_sec() - t0;
+    t0 = now_sec();
+    ok = ok && sk_build(&k);
+    double t_build = now_sec() - t0;
+    if (!ok || k.count != n) { printf("[keys] échec d'allocation\n"); goto done; }
+
+    int bad = 0;
+    for (int i = 0; i < n; i++) bad += sk_resolve(&k, names[i], (int)strlen(names[i])) != ids[i];
+    printf("[keys] %d identifiants (%d stations avec le seul nombre de fin) | enregistrement %.0f ns/clé, table parfaite %.0f ms (%.0f ns/clé), %.1f o/station\n",
+           n, (n + 3) / 4, t_add * 1e9 / n, t_build * 1e3, t_build * 1e9 / n, (double)sk_memory_bytes(&k) / n);
+    long long s_mph = 0, s_tab = 0;
+    double f_mph = time_resolve(&k, sk_resolve, (const char (*)[KEY_LEN])names, probes, q, &s_mph);
+    double f_tab = time_resolve(&k, sk_find, (const char (*)[KEY_LEN])names, probes, q, &s_tab);
+    printf("[keys] résolution aléatoire : table parfaite %5.0f ns, table ouverte + comparaison %5.0f ns (x%.2f)  %s\n",
+           f_mph * 1e9, f_tab * 1e9, f_tab / f_mph, !bad && s_mph == s_tab ? "identique" : "DIFFERENT");
+
+    // chaînes absentes : même forme, numéros hors du jeu
+    for (int i = 0; i < n; i++) snprintf(names[i], KEY_LEN, FORMS[i % 4], 1000 + n + i / 4);
+    s_mph = s_tab = 0;
+    f_mph = time_resolve(&k, sk_resolve, (const char (*)[KEY_LEN])names, probes, q, &s_mph);
+    f_tab = time_resolve(&k, sk_find, (const char (*)[KEY_LEN])names, probes, q, &s_tab);
+    printf("[keys] chaînes absentes : table parfaite %5.0f ns, table ouverte + comparaison %5.0f ns (x%.2f)  %s\n",
+           f_mph * 1e9, f_tab * 1e9, f_tab / f_mph, s_mph == -q && s_tab == -q ? "identique" : "DIFFERENT");
+done:
+    sk_clear(&k);
+    free(names);
+    free(ids);
+    free(probes);
+}
+
+/* top-N classés et postfixe, séquentiels puis sur 1 à 16 threads ; résultats comparés au cache sans pool */
+static void bench_par(int n) {
+    static const int POWERS[] = { 22, 22, 22, 22, 22, 22, 22, 22, 22, 22,
+                                  50, 50, 50, 50, 50, 50, 150, 150, 150, 350 };
+    static const struct { const char* rule; int rank; } Q[] = {
+        { "slots >= 1",                  QC_BY_PRICE },   // balayage complet
+        { "power >= 150 && slots >= 1",  QC_BY_PRICE },   // index power
+        { "price < 30 && slots > 0",     QC_BY_POWER },   // index price
+        { "power == 350 || price < 22",  QC_BY_SLOTS },   // balayage, filtre disjonctif
+    };
+    static const int THREADS[] = { 1, 2, 4, 8, 16 };
+    char* postfix[] = { "power", "350", ">=", "slots", "7", ">=", "&&", "price", "21", "<=", "&&" };
+    int n_q = (int)(sizeof Q / sizeof Q[0]), n_t = (int)(sizeof THREADS / sizeof THREADS[0]);
+    int top = 10, reps = 5, n_post = 1000;
+
+    StationIndex idx;
+    si_init(&idx);
+    srand(17);
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { POWERS[rand() % 20], 20 + rand() % 60, rand() % 8, 0 };
+        si_add(&idx, i + 1, in);
+    }
+    RuleIndexes ri;
+    ri_init(&ri);
+    ri_refresh(&ri, &idx);
+    RulePlan* plans = (RulePlan*)malloc(sizeof(RulePlan) * (size_t)n_q);
+    int* expect = (int*)malloc(sizeof(int) * (size_t)n_q * top);
+    int* got = (int*)malloc(sizeof(int) * (size_t)top);
+    StationNode** post_seq = (StationNode**)malloc(sizeof(StationNode*) * (size_t)n_post);
+    StationNode** post_par = (StationNode**)malloc(sizeof(StationNode*) * (size_t)n_post);
+    int n_expect[16];
+    if (!plans || !expect || !got || !post_seq || !post_par) goto done;
+
+    // référence : recalcul séquentiel du cache
+    double t0 = now_sec();
+    for (int q = 0; q < n_q; q++) {
+        rplan_build(&plans[q], Q[q].rule, &idx, &ri, NULL, 0);
+        n_expect[q] = fresh_query(&idx, &ri, Q[q].rule, Q[q].rank, top, expect + q * top);
+    }
+    double t_ref = (now_sec() - t0) / n_q;
+    t0 = now_sec();
+    int n_seq = rpar_first_n_postfix(&idx, NULL, postfix, 11, n_post, post_seq);
+    double t_post_ref = now_sec() - t0;
+    printf("[par] %d stations, %d requêtes top-%d, postfixe %d premières (%d trouvées)\n", n, n_q, top, n_post, n_seq);
+    printf("[par] séquentiel : top-N %8.2f ms/requête | postfixe %8.2f ms\n", t_ref * 1e3, t_post_ref * 1e3);
+
+    for (int k = 0; k < n_t; k++) {
+        ThreadPool pool;
+        if (!tp_init(&pool, THREADS[k])) break;
+        int mismatches = 0;
+        t0 = now_sec();
+        for (int r = 0; r < reps; r++)
+            for (int q = 0; q < n_q; q++) {
+                int c = rpar_top_n(&plans[q], &idx, &pool, Q[q].rank, top, got, NULL);
+                if (c != n_expect[q] || memcmp(got, expect + q * top, sizeof(int) * (size_t)(c > 0 ? c : 0)) != 0) mismatches++;
+            }
+        double t_top = (now_sec() - t0) / ((double)reps * n_q);
+        t0 = now_sec();
+        for (int r = 0; r < reps; r++) {
+            int c = rpar_first_n_postfix(&idx, &pool, postfix, 11, n_post, post_par);
+            if (c != n_seq || memcmp(post_par, post_seq, sizeof(StationNode*) * (size_t)(c > 0 ? c : 0)) != 0) mismatches++;
+        }
+        double t_post = (now_sec() - t0) / reps;
+        printf("[par] %2d threads : top-N %8.2f ms/requête (x%.2f) | postfixe %8.2f ms (x%.2f) | %lld vols | %s\n",
+               pool.nthreads, t_top * 1e3, t_ref / t_top, t_post * 1e3, t_post_ref / t_post,
+               (long long)atomic_load(&pool.steals), mismatches ? "DIFFERENT" : "identique");
+        tp_destroy(&pool);
+    }
+done:
+    free(plans);
+    free(expect);
+    free(got);
+    free(post_seq);
+    free(post_par);
+    ri_clear(&ri);
+    si_clear(&idx);
+}
+
+#define SNAP_VEHICLES 100000
+#define SNAP_MRU 5
+#define SNAP_SCENARIOS 16
+#define SNAP_EVENTS 100000
+
+/* un scénario « et si » : fermetures, bornes ajoutées ou demande doublée, puis ses événements */
+typedef struct SnapRun {
+    const StateSnapshot* snap;
+    int n_stations;
+    int owned, size;
+    size_t mru_bytes;
+    double ms;
+    unsigned long long digest;      /* empreinte de l'état final (stations puis historiques) */
+} SnapRun;
+
+static unsigned long long snap_digest(StationIndex* idx, const MruView* mv, const SList* mru, int n_vehicles) {
+    unsigned long long h = 1469598103934665603ull;
+    SiCursor c;
+    si_cursor_begin(&c, idx, INT_MIN, INT_MAX);
+    for (StationNode* s; (s = si_cursor_next(&c)) != NULL;)
+        h = (h ^ (unsigned)s->station_id ^ ((unsigned long long)s->info.slots_free << 32) ^ ((unsigned long long)s->info.price_cents << 40)) * 1099511628211ull;
+    for (int v = 0; v < n_vehicles; v++) {
+        int ids[SNAP_MRU], k = 0;
+        if (mv) k = mv_get(mv, v, ids, SNAP_MRU);
+        else for (const SNode* m = mru[v].head; m && k < SNAP_MRU; m = m->next) ids[k++] = m->value;
+        for (int i = 0; i < k; i++) h = (h ^ (unsigned)ids[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static void snap_scenario(int kind, unsigned seed, int n, StationIndex* idx, Pipeline* pl) {
+    if (kind == 0) {
+        for (int k = 0; k < n / 100; k++) si_delete(idx, 1 + (int)(rand_r(&seed) % (unsigned)n));
+    } else if (kind == 1) {
+        for (int k = 0; k < 100; k++) {
+            StationNode* s = si_find_mut(idx, 1 + (int)(rand_r(&seed) % (unsigned)n));
+            if (s) s->info.slots_free += 20;
+        }
+    }
+    int events = kind == 2 ? 2 * SNAP_EVENTS : SNAP_EVENTS;
+    for (int k = 0; k < events; k++) {
+        Event e = { 1000000 + k, (int)(rand_r(&seed) % SNAP_VEHICLES), 1 + (int)(rand_r(&seed) % (unsigned)n), (int)(rand_r(&seed) & 1) };
+        pl_apply(pl, &e);
+    }
+}
+
+static void snap_task(void* ctx, int task, int worker) {
+    (void)worker;
+    SnapRun* r = (SnapRun*)ctx + task;
+    double t0 = now_sec();
+    StationIndex idx;
+    MruView mv;
+    if (!ss_branch(r->snap, &idx, &mv)) return;
+    Pipeline pl;
+    pl_init(&pl, &idx, NULL, 0, SNAP_MRU);
+    pl.mru_view = &mv;
+    snap_scenario(task % 3, 7u + (unsigned)task, r->n_stations, &idx, &pl);
+    r->ms = (now_sec() - t0) * 1e3;
+    r->owned = si_owned_nodes(&idx);
+    r->size = idx.size;
+    r->mru_bytes = mv_memory_bytes(&mv);
+    r->digest = snap_digest(&idx, &mv, NULL, SNAP_VEHICLES);
+    si_clear(&idx);
+    mv_clear(&mv);
+}
+
+static void bench_snap(int n) {
+    StationIndex live;
+    si_init(&live);
+    srand(23);
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { 22 + rand() % 330, 20 + rand() % 60, 2 + rand() % 6, 0 };
+        si_add(&live, i + 1, in);
+    }
+    SList* mru = (SList*)calloc(SNAP_VEHICLES, sizeof(SList));
+    SnapRun* runs = (SnapRun*)calloc(SNAP_SCENARIOS, sizeof(SnapRun));
+    if (!mru || !runs) { free(mru); free(runs); si_clear(&live); return; }
+    Pipeline pl;
+    pl_init(&pl, &live, mru, SNAP_VEHICLES, SNAP_MRU);
+    for (int k = 0; k < 200000; k++) {
+        Event e = { k, rand() % SNAP_VEHICLES, 1 + rand() % n, rand() & 1 };
+        pl_apply(&pl, &e);
+    }
+
+    // référence : état recopié en entier, comme un rechargement suivi d'un rejeu
+    double t0 = now_sec();
+    StationIndex full;
+    si_init(&full);
+    SiCursor c;
+    si_cursor_begin(&c, &live, INT_MIN, INT_MAX);
+    for (StationNode* s; (s = si_cursor_next(&c)) != NULL;) si_add(&full, s->station_id, s->info);
+    SList* full_mru = (SList*)calloc(SNAP_VEHICLES, sizeof(SList));
+    for (int v = 0; full_mru && v < SNAP_VEHICLES; v++) {
+        int ids[SNAP_MRU], k = 0;
+        for (const SNode* m = mru[v].head; m && k < SNAP_MRU; m = m->next) ids[k++] = m->value;
+        while (k > 0) ds_slist_insert_head(&full_mru[v], ids[--k]);
+    }
+    double t_copy = now_sec() - t0;
+
+    t0 = now_sec();
+    StateSnapshot snap;
+    if (!full_mru || !ss_take(&snap, &live, mru, SNAP_VEHICLES, SNAP_MRU)) {
+        printf("[snap] échec d'allocation\n");
+        goto done;
+    }
+    double t_take = now_sec() - t0;
+    unsigned long long snap_before = snap_digest(&full, NULL, full_mru, SNAP_VEHICLES);
+
+    // le réseau vivant continue pendant les scénarios
+    for (int k = 0; k < 50000; k++) {
+        Event e = { 500000 + k, rand() % SNAP_VEHICLES, 1 + rand() % n, rand() & 1 };
+        pl_apply(&pl, &e);
+    }
+    ThreadPool pool;
+    int pooled = tp_init(&pool, 0);
+    for (int s = 0; s < SNAP_SCENARIOS; s++) {
+        runs[s].snap = &snap;
+        runs[s].n_stations = n;
+    }
+    t0 = now_sec();
+    if (pooled) tp_run(&pool, SNAP_SCENARIOS, snap_task, runs);
+    else for (int s = 0; s < SNAP_SCENARIOS; s++) snap_task(runs, s, 0);
+    double t_runs = now_sec() - t0;
+
+    // contrôle : le scénario 0 rejoué sur la copie complète
+    Pipeline pf;
+    pl_init(&pf, &full, full_mru, SNAP_VEHICLES, SNAP_MRU);
+    snap_scenario(0, 7u, n, &full, &pf);
+    int same = snap_digest(&full, NULL, full_mru, SNAP_VEHICLES) == runs[0].digest;
+    StationIndex again;
+    MruView mv_again;
+    ss_branch(&snap, &again, &mv_again);
+    int intact = snap_digest(&again, &mv_again, NULL, SNAP_VEHICLES) == snap_before;
+    si_clear(&again);
+    mv_clear(&mv_again);
+
+    printf("[snap] %d stations, %d véhicules (MRU %d), %d scénarios de %d événements sur %d threads\n",
+           n, SNAP_VEHICLES, SNAP_MRU, SNAP_SCENARIOS, SNAP_EVENTS, pooled ? pool.nthreads : 1);
+    printf("[snap] copie complète : %8.2f ms | instantané : %8.2f ms | scénarios : %8.2f ms au total\n",
+           t_copy * 1e3, t_take * 1e3, t_runs * 1e3);
+    const char* KINDS[] = { "fermetures 1 %", "+20 bornes x100", "demande x2" };
+    for (int s = 0; s < 3 && s < SNAP_SCENARIOS; s++)
+        printf("[snap] %-16s : %8.2f ms | %7d noeuds propres sur %d (%.1f %%) | MRU %zu o\n",
+               KINDS[s], runs[s].ms, runs[s].owned, runs[s].size, 100.0 * runs[s].owned / (runs[s].size ? runs[s].size : 1),
+               runs[s].mru_bytes);
+    printf("[snap] vivant : %d noeuds propres | scénario rejoué sur copie : %s | instantané après scénarios : %s\n",
+           si_owned_nodes(&live), same ? "identique" : "DIFFERENT", intact ? "intact" : "MODIFIE");
+    if (pooled) tp_destroy(&pool);
+    ss_release(&snap);
+done:
+    for (int v = 0; v < SNAP_VEHICLES; v++) {
+        ds_slist_clear(&mru[v]);
+        if (full_mru) ds_slist_clear(&full_mru[v]);
+    }
+    free(mru);
+    free(full_mru);
+    free(runs);
+    si_clear(&full);
+    si_clear(&live);
+}
+
+/**
+ * Journal (wal.h) : coût par événement selon la taille des groupes validés
+ * (un fdatasync par groupe), puis reprise après une panne simulée — point de
+ * reprise à mi-parcours, fin de journal déchirée — comparée à l'état vivant.
+ */
+#define WAL_VEHICLES 10000
+#define WAL_EVENTS 200000
+
+static void wal_state(int n, StationIndex* idx, SList* mru) {
+    si_init(idx);
+    unsigned seed = 31;
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { 22 + (int)(rand_r(&seed) % 330), 20 + (int)(rand_r(&seed) % 60), 2 + (int)(rand_r(&seed) % 6), 0 };
+        si_add(idx, i + 1, in);
+    }
+    for (int v = 0; v < WAL_VEHICLES; v++) ds_slist_init(&mru[v]);
+}
+
+static Event wal_event(unsigned* seed, int k, int n) {
+    Event e = { k, (int)(rand_r(seed) % WAL_VEHICLES), 1 + (int)(rand_r(seed) % (unsigned)n), (int)(rand_r(seed) & 1) };
+    return e;
+}
+
+static void wal_drop(StationIndex* idx, SList* mru) {
+    for (int v = 0; v < WAL_VEHICLES; v++) ds_slist_clear(&mru[v]);
+    si_clear(idx);
+}
+
+static void bench_wal(int n) {
+    const char* path = "/tmp/chargecraft_bench.wal";
+    const char* ckpt = "/tmp/chargecraft_bench.wal.ckpt";
+    SList* mru = (SList*)malloc(sizeof(SList) * WAL_VEHICLES);
+    SList* again_mru = (SList*)malloc(sizeof(SList) * WAL_VEHICLES);
+    if (!mru || !again_mru) { free(mru); free(again_mru); return; }
+    StationIndex live;
+    wal_state(n, &live, mru);
+    Pipeline pl;
+    pl_init(&pl, &live, mru, WAL_VEHICLES, SNAP_MRU);
+    unsigned seed = 5;
+
+    // validation groupée : 1 événement (fsync par événement) jusqu'au groupe par défaut
+    static const int GROUPS[] = { 1, 16, 256, WAL_GROUP_BYTES / WAL_RECORD };
+    printf("[wal] %d stations, %d véhicules\n", n, WAL_VEHICLES);
+    for (int g = 0; g < 4; g++) {
+        remove(path);
+        Wal w;
+        if (!wal_open(&w, path, (size_t)GROUPS[g] * WAL_RECORD, 0)) { printf("[wal] impossible d'ouvrir %s\n", path); goto done; }
+        pl.wal = &w;
+        int events = GROUPS[g] * 500 < WAL_EVENTS ? GROUPS[g] * 500 : WAL_EVENTS;
+        double t0 = now_sec();
+        for (int k = 0; k < events; k++) {
+            Event e = wal_event(&seed, k, n);
+            pl_apply(&pl, &e);
+        }
+        wal_commit(&w);
+        double t = now_sec() - t0;
+        printf("[wal] groupes de %5d : %8.2f µs par événement  (%lld validations, %d événements, %.0f événements/s)\n",
+               GROUPS[g], t * 1e6 / events, w.stats.commits, events, events / t);
+        pl.wal = NULL;
+        wal_close(&w);
+    }
+    wal_drop(&live, mru);
+
+    // panne simulée : point de reprise à mi-parcours, puis fin de journal déchirée
+    remove(path);
+    remove(ckpt);
+    wal_state(n, &live, mru);
+    pl_init(&pl, &live, mru, WAL_VEHICLES, SNAP_MRU);
+    Wal w;
+    if (!wal_open(&w, path, WAL_GROUP_BYTES, WAL_GROUP_US)) { printf("[wal] impossible d'ouvrir %s\n", path); goto done; }
+    pl.wal = &w;
+    double t0 = now_sec();
+    for (int k = 0; k < WAL_EVENTS; k++) {
+        Event e = wal_event(&seed, k, n);
+        pl_apply(&pl, &e);
+        if (k == WAL_EVENTS / 2 && !wal_checkpoint(&w, ckpt, &pl)) printf("[wal] point de reprise non écrit\n");
+    }
+    wal_commit(&w);
+    double t_run = now_sec() - t0;
+    unsigned long long live_digest = snap_digest(&live, NULL, mru, WAL_VEHICLES);
+    long long logged = w.stats.appends;
+    wal_close(&w);
+    // enregistrement à moitié écrit, puis un autre dont l'empreinte ne correspond plus
+    FILE* f = fopen(path, "ab");
+    unsigned char junk[WAL_RECORD + 13];
+    memset(junk, 0x5a, sizeof junk);
+    int torn_ok = f && fwrite(junk, 1, sizeof junk, f) == sizeof junk;
+    if (f) fclose(f);
+
+    StationIndex again;
+    wal_state(n, &again, again_mru);
+    Pipeline pa;
+    pl_init(&pa, &again, again_mru, WAL_VEHICLES, SNAP_MRU);
+    t0 = now_sec();
+    long long replayed = -1;
+    if (wal_open(&w, path, WAL_GROUP_BYTES, WAL_GROUP_US)) {
+        replayed = wal_recover(&w, ckpt, &pa);
+        printf("[wal] reprise : %8.2f ms (point de reprise + %lld événements rejoués, %lld octets coupés%s)\n",
+               (now_sec() - t0) * 1e3, replayed, w.stats.torn_bytes, torn_ok ? "" : " ; écriture déchirée non simulée");
+        wal_close(&w);
+    }
+    printf("[wal] %d événements en %.2f ms (%lld journalisés) | état repris : %s\n", WAL_EVENTS, t_run * 1e3, logged,
+           replayed >= 0 && snap_digest(&again, NULL, again_mru, WAL_VEHICLES) == live_digest ? "identique" : "DIFFERENT");
+    wal_drop(&again, again_mru);
+
+    // panne pendant un point de reprise : journal tronqué, en-tête resté à l'ancien LSN
+    remove(path);
+    remove(ckpt);
+    if (!wal_open(&w, path, WAL_GROUP_BYTES, WAL_GROUP_US)) goto done;
+    pl.wal = &w;
+    for (int k = 0; k < WAL_EVENTS / 10; k++) {
+        Event e = wal_event(&seed, k, n);
+        pl_apply(&pl, &e);
+    }
+    unsigned char old_head[WAL_HEADER];
+    f = fopen(path, "r+b");
+    int crash_ok = f && fread(old_head, 1, sizeof old_head, f) == sizeof old_head && wal_checkpoint(&w, ckpt, &pl) &&
+                   fseek(f, 0, SEEK_SET) == 0 && fwrite(old_head, 1, sizeof old_head, f) == sizeof old_head;
+    if (f) fclose(f);
+    pl.wal = NULL;
+    wal_close(&w);
+    // 1re reprise, puis de nouveaux événements validés sur l'état repris (et sur l'état vivant)
+    long long first = -1, second = -1, after = 0;
+    wal_state(n, &again, again_mru);
+    pl_init(&pa, &again, again_mru, WAL_VEHICLES, SNAP_MRU);
+    if (crash_ok && wal_open(&w, path, WAL_GROUP_BYTES, WAL_GROUP_US)) {
+        first = wal_recover(&w, ckpt, &pa);
+        pa.wal = first >= 0 ? &w : NULL;
+        for (int k = 0; first >= 0 && k < WAL_EVENTS / 10; k++) {
+            Event e = wal_event(&seed, WAL_EVENTS + k, n);
+            pl_apply(&pl, &e);
+            pl_apply(&pa, &e);
+        }
+        after = w.stats.appends;
+        if (!wal_close(&w)) first = -1;
+    }
+    wal_drop(&again, again_mru);
+    // 2e reprise : les événements validés après la 1re doivent tous être rejoués
+    wal_state(n, &again, again_mru);
+    pl_init(&pa, &again, again_mru, WAL_VEHICLES, SNAP_MRU);
+    if (first >= 0 && wal_open(&w, path, WAL_GROUP_BYTES, WAL_GROUP_US)) {
+        second = wal_recover(&w, ckpt, &pa);
+        wal_close(&w);
+    }
+    printf("[wal] panne entre troncature et en-tête : 1re reprise %lld rejoués, 2e reprise %lld rejoués (attendu %lld) | état repris : %s\n",
+           first, second, after,
+           second == after && snap_digest(&again, NULL, again_mru, WAL_VEHICLES) == snap_digest(&live, NULL, mru, WAL_VEHICLES)
+               ? "identique" : "DIFFERENT");
+    wal_drop(&again, again_mru);
+done:
+    wal_drop(&live, mru);
+    free(mru);
+    free(again_mru);
+    remove(path);
+    remove(ckpt);
+}
+
+/**
+ * Connecteurs (connector.h) : mêmes événements appliqués au compteur
+ * slots_free seul puis au suivi par bitset — débranchements d'un véhicule
+ * quelconque compris —, dérive du compteur au-delà de la capacité, puis
+ * comptes « au moins k connecteurs libres » par popcount contre un parcours de
+ * l'index.
+ */
+#define CONN_EVENTS 2000000
+#define CONN_VEHICLES 100000
+
+static void conn_state(int n, StationIndex* idx) {
+    si_init(idx);
+    unsigned seed = 17;
+    for (int i = 0; i < n; i++) {
+        // une station sur cent en parking de 80 points de charge : plusieurs mots par bitset
+        int pdc = i % 100 == 0 ? 80 : 1 + (int)(rand_r(&seed) % 8);
+        StationInfo in = { 22 + (int)(rand_r(&seed) % 330), 20 + (int)(rand_r(&seed) % 60), pdc, 0 };
+        si_add(idx, i + 1, in);
+    }
+}
+
+static double conn_run(int n, StationIndex* idx, ConnStore* conns, Pipeline* pl) {
+    pl_init(pl, idx, NULL, 0, 0);
+    idx->conns = conns;
+    unsigned seed = 99;
+    double t0 = now_sec();
+    for (int k = 0; k < CONN_EVENTS; k++) {
+        // débranchements plus fréquents que les branchements, par des véhicules au hasard
+        Event e = { k, (int)(rand_r(&seed) % CONN_VEHICLES), 1 + (int)(rand_r(&seed) % (unsigned)n), rand_r(&seed) % 5 < 2 };
+        pl_apply(pl, &e);
+    }
+    return now_sec() - t0;
+}
+
+static int count_free_scan(StationIndex* idx, int k) {
+    SiCursor c;
+    si_cursor_begin(&c, idx, INT_MIN, INT_MAX);
+    int count = 0;
+    for (StationNode* s; (s = si_cursor_next(&c)) != NULL;) count += s->info.slots_free >= k;
+    return count;
+}
+
+static void bench_conn(int n) {
+    StationIndex plain, tracked;
+    conn_state(n, &plain);
+    conn_state(n, &tracked);
+    ConnStore conns;
+    cn_init(&conns);
+    double t0 = now_sec();
+    if (cn_attach(&conns, &tracked) < 0) { printf("[conn] échec d'allocation\n"); goto done; }
+    double t_attach = now_sec() - t0;
+
+    Pipeline pp, pt;
+    double t_plain = conn_run(n, &plain, NULL, &pp);
+    double t_tracked = conn_run(n, &tracked, &conns, &pt);
+
+    // capacité : créneaux libres de la station au chargement
+    StationIndex fresh;
+    conn_state(n, &fresh);
+    int over = 0, mismatch = 0;
+    SiCursor c;
+    si_cursor_begin(&c, &fresh, INT_MIN, INT_MAX);
+    for (StationNode* s; (s = si_cursor_next(&c)) != NULL;) {
+        StationNode* a = si_find(plain.root, s->station_id);
+        StationNode* b = si_find(tracked.root, s->station_id);
+        over += a->info.slots_free > s->info.slots_free;
+        mismatch += b->info.slots_free > s->info.slots_free || b->info.slots_free != cn_free(&conns, s->station_id);
+    }
+    si_clear(&fresh);
+
+    printf("[conn] %d stations, %zu connecteurs, bitsets %.1f Ko (attachement %.2f ms)\n", n, conns.n_holders,
+           conns.n_words * sizeof(uint64_t) / 1024.0, t_attach * 1e3);
+    printf("[conn] compteur seul : %6.1f ns/événement | %lld branchements refusés | %d stations au-delà de leur capacité\n",
+           t_plain * 1e9 / CONN_EVENTS, pp.rejected, over);
+    printf("[conn] bitsets       : %6.1f ns/événement | %lld refusés, %lld débranchements ignorés | %d stations incohérentes\n",
+           t_tracked * 1e9 / CONN_EVENTS, pt.rejected, pt.stray, mismatch);
+    for (int k = 1; k <= 4; k++) {
+        t0 = now_sec();
+        int a = cn_count_free_at_least(&conns, k);
+        double t_pop = now_sec() - t0;
+        t0 = now_sec();
+        int b = count_free_scan(&tracked, k);
+        double t_scan = now_sec() - t0;
+        printf("[conn] au moins %d libres : %8d stations | popcount %7.3f ms | parcours de l'index %7.3f ms  %s\n",
+               k, a, t_pop * 1e3, t_scan * 1e3, a == b ? "identique" : "DIFFERENT");
+    }
+done:
+    cn_clear(&conns);
+    si_clear(&plain);
+    si_clear(&tracked);
+}
+
+/**
+ * Tarification dynamique (pricing.h) et règles planifiées : les prix changés
+ * sur place par les événements doivent invalider l'index secondaire des prix.
+ * Chaque règle est comptée par un plan construit avant les événements, par un
+ * plan reconstruit après, et par un balayage sans index secondaire.
+ */
+#define PRICE_EVENTS_PER_STATION 4
+
+static void bench_price(int n) {
+    StationIndex idx;
+    si_init(&idx);
+    unsigned seed = 23;
+    for (int i = 0; i < n; i++) {
+        StationInfo in = { 22 + (int)(rand_r(&seed) % 330), 200 + (int)(rand_r(&seed) % 100), 4, 0 };
+        si_add(&idx, i + 1, in);
+    }
+    static const char* Q[] = { "price >= 300", "price >= 250 && slots >= 2", "price < 200 && power >= 150" };
+    enum { NQ = sizeof Q / sizeof Q[0] };
+    PriceCurve curve;
+    PricingEngine pe;
+    RuleIndexes ri;
+    pr_default_curve(&curve);
+    memset(&pe, 0, sizeof pe);
+    ri_init(&ri);
+    RulePlan* before = (RulePlan*)malloc(sizeof(RulePlan) * NQ);
+    RulePlan* plan = (RulePlan*)malloc(sizeof(RulePlan));
+    if (!before || !plan || !pr_init(&pe, &curve, NULL, NULL) || pr_attach(&pe, &idx, 0) < 0) {
+        printf("[price] échec d'allocation\n");
+        goto done;
+    }
+    // plans et index secondaires construits avant les événements, comme un serveur déjà en service
+    for (int q = 0; q < NQ; q++) rplan_build(&before[q], Q[q], &idx, &ri, NULL, 0);
+
+    Pipeline pl;
+    pl_init(&pl, &idx, NULL, 0, 0);
+    pl.pricing = &pe;
+    int events = PRICE_EVENTS_PER_STATION * n;
+    double t0 = now_sec();
+    for (int k = 0; k < events; k++) {
+        // trois branchements pour un débranchement : les stations montent de palier
+        Event e = { k / 100, -1, 1 + (int)(rand_r(&seed) % (unsigned)n), rand_r(&seed) % 4 != 0 };
+        pl_apply(&pl, &e);
+    }
+    double t_apply = now_sec() - t0;
+    printf("[price] %d stations, %d événements : %6.1f ns/événement, %lld changements de prix\n",
+           n, events, t_apply * 1e9 / events, pe.stats.changes);
+
+    for (int q = 0; q < NQ; q++) {
+        int stale = 0, fresh = 0, truth = 0;
+        rplan_execute(&before[q], &idx, count_match, &stale);
+        t0 = now_sec();
+        rplan_build(plan, Q[q], &idx, &ri, NULL, 0);
+        rplan_execute(plan, &idx, count_match, &fresh);
+        double t_plan = now_sec() - t0;
+        int access = plan->access, attr = plan->attr;
+        rplan_build(plan, Q[q], &idx, NULL, NULL, 0);
+        rplan_execute(plan, &idx, count_match, &truth);
+        printf("[price] %-28s plan antérieur %7d | replanifiée %7d (%s %s, %8.2f ms) | balayage %7d  %s\n",
+               Q[q], stale, fresh, access == PA_RANGE ? "index" : "balayage",
+               access == PA_RANGE ? rule_attr_name(attr) : "", t_plan * 1e3, truth,
+               stale == truth && fresh == truth ? "identique" : "DIFFERENT");
+    }
+done:
+    free(before);
+    free(plan);
+    pr_clear(&pe);
+    ri_clear(&ri);
+    si_clear(&idx);
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* position tirée autour de grandes villes (70 %) ou uniformément sur la métropole */
+static void rand_position(unsigned* seed, int* lat_e6, int* lon_e6) {
+    static const double CITIES[][2] = {
+        {48.857, 2.352}, {45.764, 4.836}, {43.297, 5.370}, {43.605, 1.444}, {43.710, 7.262},
+        {47.218, -1.554}, {48.573, 7.752}, {43.611, 3.877}, {44.838, -0.579}, {50.629, 3.057},
+        {48.117, -1.678}, {49.258, 4.032}, {45.440, 4.387}, {43.125, 5.930}, {45.188, 5.724},
+        {47.322, 5.041}, {47.478, -0.563}, {49.494, 0.107}, {45.778, 3.087}, {47.394, 0.685},
+    };
+    *seed = *seed * 1103515245u + 12345u;
+    double u = ((*seed >> 8) & 0xffff) / 65536.0;
+    *seed = *seed * 1103515245u + 12345u;
+    double v = ((*seed >> 8) & 0xffff) / 65536.0;
+    *seed = *seed * 1103515245u + 12345u;
+    unsigned pick = (*seed >> 8) % 100;
+    double lat, lon;
+    if (pick < 70) {
+        // Box-Muller, écart-type ~0,15° autour de la ville
+        double g1 = sqrt(-2.0 * log(u + 1e-9)) * cos(6.283185307 * v);
+        double g2 = sqrt(-2.0 * log(u + 1e-9)) * sin(6.283185307 * v);
+        lat = CITIES[pick % 20][0] + 0.15 * g1;
+        lon = CITIES[pick % 20][1] + 0.2 * g2;
+    } else {
+        lat = 42.5 + 8.5 * u;
+        lon = -4.5 + 12.0 * v;
+    }
+    *lat_e6 = (int)(lat * 1e6);
+    *lon_e6 = (int)(lon * 1e6);
+}
+
+typedef struct RecJob {
+    const StationIndex* idx;
+    const SpatialIndex* sp;
+    const SList* fleet;
+    int n_fleet, n_queries, k;
+    unsigned seed;
+    double* lat_ns;                 /* latence de chaque requête */
+    double* cpu_ns;                 /* temps processeur du thread pour chaque requête */
+    long long candidates, cells;
+} RecJob;
+
+static void* rec_worker(void* arg) {
+    RecJob* j = (RecJob*)arg;
+    RecResult out[16];
+    for (int q = 0; q < j->n_queries; q++) {
+        int lat, lon;
+        rand_position(&j->seed, &lat, &lon);
+        const SList* h = &j->fleet[q % j->n_fleet];
+        RecStats st;
+        struct timespec c0, c1;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &c0);
+        double t0 = now_sec();
+        rec_top_k(j->idx, j->sp, h, lat, lon, j->k, NULL, out, &st);
+        j->lat_ns[q] = (now_sec() - t0) * 1e9;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &c1);
+        j->cpu_ns[q] = (c1.tv_sec - c0.tv_sec) * 1e9 + (c1.tv_nsec - c0.tv_nsec);
+        j->candidates += st.candidates;
+        j->cells += st.cells;
+    }
+    return NULL;
+}
+
+/* k meilleures stations pour des véhicules répartis sur la métropole, seul puis en parallèle */
+static void bench_recommend(int n) {
+    StationIndex idx;
+    SpatialIndex sp, whole;
+    si_init(&idx);
+    if (!sp_init(&sp, 0)) return;
+    if (!sp_init(&whole, 360.0)) { sp_clear(&sp); return; }  // une seule cellule : contrôle exhaustif
+    idx.spatial = &sp;
+    unsigned seed = 77;
+    static const int powers[] = {7, 22, 50, 100, 150, 350};
+    double t0 = now_sec();
+    for (int i = 0; i < n; i++) {
+        int lat, lon;
+        rand_position(&seed, &lat, &lon);
+        seed = seed * 1103515245u + 12345u;
+        StationInfo in = { powers[(seed >> 8) % 6], 20 + (int)((seed >> 12) % 60), (int)((seed >> 4) % 5), 0 };
+        si_add(&idx, 1000 + i, in);
+        sp_set(&sp, 1000 + i, lat, lon);
+        sp_set(&whole, 1000 + i, lat, lon);
+    }
+    printf("[recommend] %d stations placées en %.2f ms (%d cellules de %.2f°)\n", n, (now_sec() - t0) * 1e3,
+           sp.cell_used, sp.cell_e6 / 1e6);
+
+    // historiques MRU : 5 stations proches d'un point de départ
+    int n_fleet = 10000, k = 10;
+    SList* fleet = (SList*)malloc(sizeof(SList) * n_fleet);
+    if (!fleet) goto done;
+    for (int v = 0; v < n_fleet; v++) {
+        ds_slist_init(&fleet[v]);
+        int lat, lon;
+        rand_position(&seed, &lat, &lon);
+        RecResult near[5];
+        int m = rec_top_k(&idx, &sp, NULL, lat, lon, 5, NULL, near, NULL);
+        for (int i = m - 1; i >= 0; i--) ds_slist_update_mru(&fleet[v], near[i].station_id, 5);
+    }
+
+    // contrôle : même classement que la grille à cellule unique
+    int mismatches = 0, checks = 500;
+    for (int q = 0; q < checks; q++) {
+        int lat, lon;
+        rand_position(&seed, &lat, &lon);
+        RecResult a[16], b[16];
+        int na = rec_top_k(&idx, &sp, &fleet[q % n_fleet], lat, lon, k, NULL, a, NULL);
+        int nb = rec_top_k(&idx, &whole, &fleet[q % n_fleet], lat, lon, k, NULL, b, NULL);
+        if (na != nb) { mismatches++; continue; }
+        for (int i = 0; i < na; i++)
+            if (a[i].station_id != b[i].station_id) { mismatches++; break; }
+    }
+
+    for (int threads = 1; threads <= 4; threads *= 4) {
+        int per = 200000 / threads;
+        RecJob jobs[4];
+        pthread_t tid[4];
+        double* lat_ns = (double*)malloc(sizeof(double) * per * threads);
+        double* cpu_ns = (double*)malloc(sizeof(double) * per * threads);
+        if (!lat_ns || !cpu_ns) { free(lat_ns); free(cpu_ns); break; }
+        t0 = now_sec();
+        for (int t = 0; t < threads; t++) {
+            RecJob j = { &idx, &sp, fleet, n_fleet, per, k, 1000u + (unsigned)t, lat_ns + (size_t)per * t,
+                         cpu_ns + (size_t)per * t, 0, 0 };
+            jobs[t] = j;
+            if (threads == 1) rec_worker(&jobs[t]);
+            else pthread_create(&tid[t], NULL, rec_worker, &jobs[t]);
+        }
+        for (int t = 0; threads > 1 && t < threads; t++) pthread_join(tid[t], NULL);
+        double wall = now_sec() - t0;
+        long long cand = 0, cells = 0;
+        for (int t = 0; t < threads; t++) { cand += jobs[t].candidates; cells += jobs[t].cells; }
+        int total = per * threads;
+        qsort(lat_ns, total, sizeof(double), cmp_double);
+        qsort(cpu_ns, total, sizeof(double), cmp_double);
+        printf("[recommend] %d thread(s), %d requêtes top-%d : %.0f req/s | p50 %6.1f us  p99 %6.1f us  max %7.1f us"
+               " | p99 processeur %6.1f us | %.1f cellules, %.1f stations évaluées par requête\n",
+               threads, total, k, total / wall, lat_ns[total / 2] / 1e3, lat_ns[(int)(total * 0.99)] / 1e3,
+               lat_ns[total - 1] / 1e3, cpu_ns[(int)(total * 0.99)] / 1e3, (double)cells / total, (double)cand / total);
+        free(lat_ns);
+        free(cpu_ns);
+    }
+    printf("[recommend] contrôle exhaustif sur %d requêtes : %s\n", checks, mismatches ? "DIFFERENT" : "identique");
+
+    t0 = now_sec();
+    RecResult all[16];
+    int reps = 200;
+    for (int q = 0; q < reps; q++) {
+        int lat, lon;
+        rand_position(&seed, &lat, &lon);
+        rec_top_k(&idx, &whole, &fleet[q % n_fleet], lat, lon, k, NULL, all, NULL);
+    }
+    printf("[recommend] sans élagage spatial (cellule unique) : %.1f us par requête\n", (now_sec() - t0) * 1e6 / reps);
+
+    for (int v = 0; v < n_fleet; v++) ds_slist_clear(&fleet[v]);
+    free(fleet);
+done:
+    si_clear(&idx);
+    sp_clear(&sp);
+    sp_clear(&whole);
+}
+
+int main(int argc, char** argv) {
+    const char* scenario = argc > 1 ? argv[1] : "csv";
+    if (strcmp(scenario, "suite") == 0) return bench_suite(argc - 1, argv + 1);
+    int n = argc > 2 ? atoi(argv[2]) : 1000000;
+    if (n <= 0) n = 1000000;
+
+    if (strcmp(scenario, "csv") == 0) bench_csv(n);
+    else if (strcmp(scenario, "json") == 0) bench_json(n);
+    else if (strcmp(scenario, "meta") == 0) bench_meta(n);
+    else if (strcmp(scenario, "reload") == 0) bench_reload(n);
+    else if (strcmp(scenario, "dataset") == 0) bench_dataset(n);
+    else if (strcmp(scenario, "rules") == 0) bench_rules(n);
+    else if (strcmp(scenario, "subs") == 0) bench_subs(n);
+    else if (strcmp(scenario, "cache") == 0) bench_cache(n);
+    else if (strcmp(scenario, "geo") == 0) bench_geo(n);
+    else if (strcmp(scenario, "flat") == 0) bench_flat(n);
+    else if (strcmp(scenario, "compact") == 0) bench_compact(n);
+    else if (strcmp(scenario, "keys") == 0) bench_keys(n);
+    else if (strcmp(scenario, "par") == 0) bench_par(n);
+    else if (strcmp(scenario, "snap") == 0) bench_snap(n);
+    else if (strcmp(scenario, "wal") == 0) bench_wal(n);
+    else if (strcmp(scenario, "conn") == 0) bench_conn(n);
+    else if (strcmp(scenario, "price") == 0) bench_price(n);
+    else if (strcmp(scenario, "recommend") == 0) bench_recommend(n);
+    else { fprintf(stderr, "scénario inconnu : %s\n", scenario); return 1; }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef DS_BENCH_H
+#define DS_BENCH_H
+
+/**
+ * @brief Outils partagés par les scénarios de bench.c et la suite de bench_suite.c.
+ */
+
+double now_sec(void);                                  /* horloge monotone, en secondes */
+
+/* CSV IRVE synthétique de n lignes (1 % d'identifiants répétés) */
+int gen_csv(const char* path, int n);
+
+/* équivalent JSON de gen_csv ; nested ajoute des objets et tableaux imbriqués */
+int gen_json(const char* path, int n, int nested);
+
+#define SUITE_MAX_RUNS 32
+#define SUITE_MAX_SIZES 8
+
+/* un cas de la suite, agrégé sur toutes les passes */
+typedef struct SuiteResult {
+    char name[32];
+    int n;                  /* taille du jeu (stations) */
+    int ops;                /* opérations par échantillon */
+    int samples;            /* échantillons de la dernière passe */
+    int runs;               /* passes mesurées */
+    double run_median[SUITE_MAX_RUNS];  /* médiane de chaque passe, ns/op */
+    double run_p99[SUITE_MAX_RUNS];
+    double median_ns;       /* médiane des médianes de passe */
+    double p99_ns;          /* médiane des p99 de passe */
+    double min_ns;
+    double mean_ns;         /* moyenne de tous les échantillons */
+    double ci_low, ci_high; /* IC à 95 % de la moyenne des médianes de passe */
+    double sample_sum;      /* cumul pour mean_ns, non écrit */
+    long sample_count;
+} SuiteResult;
+
+/* paramètres et résultats d'une exécution de la suite, tels qu'écrits en JSON */
+typedef struct BenchRun {
+    int sizes[SUITE_MAX_SIZES];
+    int n_sizes;
+    double budget_s;        /* temps visé par cas et par passe */
+    int warmup;
+    unsigned seed;
+    int repeat;             /* passes complètes de la suite */
+    SuiteResult* res;
+    int count, cap;
+} BenchRun;
+
+/* quantile à 97,5 % de la loi de Student à df degrés de liberté (IC bilatéral à 95 %) */
+double t_crit95(int df);
+
+/**
+ * Relit un rapport JSON de la suite (format 1 ou 2).
+ *
+ * @param path Chemin du rapport.
+ * @param out Exécution relue ; out->res est alloué, à libérer par l'appelant.
+ * @return 1 si succès, 0 si le fichier est illisible ou mal formé.
+ */
+int gate_read(const char* path, BenchRun* out);                         /* O(taille du fichier) */
+
+/**
+ * Compare une exécution à une référence, cas par cas, et affiche l'écart.
+ *
+ * @param base Référence.
+ * @param cur Exécution courante.
+ * @param threshold Ralentissement toléré sur la médiane (0.10 pour 10 %).
+ * @param p99_threshold Idem pour le p99, 0 pour ne pas le suivre.
+ * @return Nombre de régressions.
+ */
+int gate_compare(const BenchRun* base, const BenchRun* cur, double threshold, double p99_threshold);
+
+/**
+ * Suite de micro-benchmarks répétables (./bench suite).
+ *
+ * @param argc Nombre d'arguments, "suite" compris.
+ * @param argv Arguments, argv[0] == "suite".
+ * @return Code de sortie du programme.
+ */
+int bench_suite(int argc, char** argv);
+
+#endif
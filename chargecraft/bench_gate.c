@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bench.h"
+
+/**
+ * @brief Garde-fou de performance : relecture d'un rapport de la suite et
+ * comparaison à une référence.
+ *
+ * La statistique comparée est, pour chaque cas, la moyenne des médianes de
+ * passe (une passe = une exécution complète de la suite). L'écart entre
+ * référence et exécution courante est testé par un t de Welch : un cas régresse
+ * si son ralentissement dépasse le seuil ET si l'intervalle de confiance à 95 %
+ * de l'écart exclut zéro. Un écart au-delà du seuil mais non significatif est
+ * signalé « incertain » sans faire échouer. Avec une seule passe d'un côté, il
+ * n'y a pas de variance : seul le seuil s'applique.
+ */
+
+double t_crit95(int df) {
+    static const double T[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (df < 1) return INFINITY;
+    return df <= 30 ? T[df - 1] : 1.96;
+}
+
+/* ---------- lecture du rapport JSON (celui qu'écrit write_json, pas du JSON quelconque) ---------- */
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    char* buf = NULL;
+    long len = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    if (len >= 0 && fseek(f, 0, SEEK_SET) == 0 && (buf = (char*)malloc((size_t)len + 1)) != NULL) {
+        if (fread(buf, 1, (size_t)len, f) != (size_t)len) { free(buf); buf = NULL; }
+        else buf[len] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+/* position de la valeur associée à "key" dans [p, end), NULL si absente */
+static const char* find_value(const char* p, const char* end, const char* key) {
+    size_t k = strlen(key);
+    for (const char* q = p; q && q + k + 2 < end; q = strchr(q + 1, '"')) {
+        if (*q != '"' || strncmp(q + 1, key, k) != 0 || q[k + 1] != '"') continue;
+        q += k + 2;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\n' || *q == '\r')) q++;
+        if (q < end && *q == ':') {
+            q++;
+            while (q < end && (*q == ' ' || *q == '\t' || *q == '\n' || *q == '\r')) q++;
+            return q;
+        }
+    }
+    return NULL;
+}
+
+static double num_value(const char* p, const char* end, const char* key, double fallback) {
+    const char* v = find_value(p, end, key);
+    return v ? strtod(v, NULL) : fallback;
+}
+
+/* tableau de nombres "[a, b, ...]" ; renvoie le nombre de valeurs lues (au plus cap) */
+static int num_array(const char* p, const char* end, const char* key, double* out, int cap) {
+    const char* v = find_value(p, end, key);
+    if (!v || *v != '[') return 0;
+    int k = 0;
+    for (v++; v < end && *v != ']' && k < cap;) {
+        char* next;
+        double x = strtod(v, &next);
+        if (next == v) break;
+        out[k++] = x;
+        v = next;
+        while (v < end && (*v == ',' || *v == ' ' || *v == '\n')) v++;
+    }
+    return k;
+}
+
+/* un objet de "results" : {"name": ..., "n": ..., ...}, sans objet imbriqué */
+static int read_result(const char* p, const char* end, SuiteResult* r) {
+    memset(r, 0, sizeof *r);
+    const char* name = find_value(p, end, "name");
+    if (!name || *name != '"') return 0;
+    const char* close = memchr(name + 1, '"', (size_t)(end - name - 1));
+    if (!close || close - name - 1 >= (long)sizeof r->name) return 0;
+    memcpy(r->name, name + 1, (size_t)(close - name - 1));
+    r->n = (int)num_value(p, end, "n", 0);
+    r->ops = (int)num_value(p, end, "ops", 0);
+    r->samples = (int)num_value(p, end, "samples", 0);
+    r->median_ns = num_value(p, end, "median_ns", -1);
+    r->p99_ns = num_value(p, end, "p99_ns", -1);
+    r->min_ns = num_value(p, end, "min_ns", 0);
+    r->mean_ns = num_value(p, end, "mean_ns", 0);
+    if (r->n <= 0 || r->median_ns < 0 || r->p99_ns < 0) return 0;
+    // format 1 : une seule passe, sans le détail
+    r->runs = num_array(p, end, "runs", r->run_median, SUITE_MAX_RUNS);
+    if (r->runs == 0 || num_array(p, end, "runs_p99", r->run_p99, SUITE_MAX_RUNS) != r->runs) {
+        r->runs = 1;
+        r->run_median[0] = r->median_ns;
+        r->run_p99[0] = r->p99_ns;
+    }
+    r->ci_low = num_value(p, end, "ci_low", r->median_ns);
+    r->ci_high = num_value(p, end, "ci_high", r->median_ns);
+    return 1;
+}
+
+int gate_read(const char* path, BenchRun* out) {
+    memset(out, 0, sizeof *out);
+    char* buf = read_file(path);
+    if (!buf) return 0;
+    const char* end = buf + strlen(buf);
+    const char* results = find_value(buf, end, "results");
+    int ok = results && *results == '[' && find_value(buf, results, "suite");
+    if (ok) {
+        double sizes[SUITE_MAX_SIZES];
+        out->n_sizes = num_array(buf, results, "sizes", sizes, SUITE_MAX_SIZES);
+        for (int k = 0; k < out->n_sizes; k++) out->sizes[k] = (int)sizes[k];
+        out->budget_s = num_value(buf, results, "time_s", 0.25);
+        out->warmup = (int)num_value(buf, results, "warmup", 3);
+        out->seed = (unsigned)num_value(buf, results, "seed", 42);
+        out->repeat = (int)num_value(buf, results, "repeat", 1);
+    }
+    for (const char* p = ok ? strchr(results, '{') : NULL; p; p = strchr(p, '{')) {
+        const char* close = strchr(p, '}');
+        if (!close) { ok = 0; break; }
+        if (out->count == out->cap) {
+            int cap = out->cap ? 2 * out->cap : 64;
+            SuiteResult* r = (SuiteResult*)realloc(out->res, sizeof(SuiteResult) * (size_t)cap);
+            if (!r) { ok = 0; break; }
+            out->res = r;
+            out->cap = cap;
+        }
+        if (!read_result(p, close, &out->res[out->count])) { ok = 0; break; }
+        out->count++;
+        p = close;
+    }
+    // format 1 : tailles déduites des résultats
+    for (int i = 0; ok && out->n_sizes == 0 && i < out->count; i++) {
+        int seen = 0;
+        for (int k = 0; k < out->n_sizes; k++) seen |= out->sizes[k] == out->res[i].n;
+        if (!seen && out->n_sizes < SUITE_MAX_SIZES) out->sizes[out->n_sizes++] = out->res[i].n;
+    }
+    free(buf);
+    if (!ok || out->count == 0) {
+        free(out->res);
+        memset(out, 0, sizeof *out);
+        return 0;
+    }
+    return 1;
+}
+
+/* ---------- comparaison ---------- */
+
+typedef enum Verdict { V_OK, V_FASTER, V_UNCERTAIN, V_REGRESSION } Verdict;
+
+static const char* VERDICTS[] = { "ok", "plus rapide", "incertain", "RÉGRESSION" };
+
+typedef struct Diff {
+    double base, cur;           /* moyennes des passes, ns/op */
+    double rel;                 /* cur / base - 1 */
+    double rel_lo, rel_hi;      /* IC à 95 % de rel ; égal à rel sans variance */
+    int has_ci;
+} Diff;
+
+static void mean_var(const double* x, int k, double* mean, double* var) {
+    double m = 0, v = 0;
+    for (int i = 0; i < k; i++) m += x[i];
+    m /= k;
+    for (int i = 0; i < k; i++) v += (x[i] - m) * (x[i] - m);
+    *mean = m;
+    *var = k > 1 ? v / (k - 1) : 0;
+}
+
+/* t de Welch sur les passes de chaque côté, écart rapporté à la référence */
+static Diff diff_runs(const double* a, int na, const double* b, int nb) {
+    Diff d;
+    double va, vb;
+    mean_var(a, na, &d.base, &va);
+    mean_var(b, nb, &d.cur, &vb);
+    d.rel = d.base > 0 ? d.cur / d.base - 1 : 0;
+    d.rel_lo = d.rel_hi = d.rel;
+    d.has_ci = na > 1 && nb > 1 && d.base > 0;
+    if (d.has_ci) {
+        double sa = va / na, sb = vb / nb, se = sqrt(sa + sb);
+        // degrés de liberté de Welch-Satterthwaite
+        double df = se > 0 ? (sa + sb) * (sa + sb) / (sa * sa / (na - 1) + sb * sb / (nb - 1)) : na + nb - 2;
+        double half = t_crit95((int)df) * se / d.base;
+        d.rel_lo = d.rel - half;
+        d.rel_hi = d.rel + half;
+    }
+    return d;
+}
+
+static Verdict judge(const Diff* d, double threshold) {
+    if (d->rel > threshold) return !d->has_ci || d->rel_lo > 0 ? V_REGRESSION : V_UNCERTAIN;
+    if (d->rel < -threshold && (!d->has_ci || d->rel_hi < 0)) return V_FASTER;
+    return V_OK;
+}
+
+static const SuiteResult* find_case(const BenchRun* run, const char* name, int n) {
+    for (int i = 0; i < run->count; i++)
+        if (run->res[i].n == n && strcmp(run->res[i].name, name) == 0) return &run->res[i];
+    return NULL;
+}
+
+static void print_diff(const char* name, int n, const char* metric, const Diff* d, Verdict v) {
+    printf("[gate] %-18s %-9d %-6s %11.1f %11.1f %+8.1f%%  ", name, n, metric, d->base, d->cur, 100 * d->rel);
+    if (d->has_ci) printf("[%+6.1f%%, %+6.1f%%]", 100 * d->rel_lo, 100 * d->rel_hi);
+    else printf("%-18s", "(sans IC)");
+    printf("  %s\n", VERDICTS[v]);
+}
+
+int gate_compare(const BenchRun* base, const BenchRun* cur, double threshold, double p99_threshold) {
+    int regressions = 0, uncertain = 0, faster = 0, compared = 0, fresh = 0;
+    printf("[gate] seuil %.1f %% sur la médiane", 100 * threshold);
+    if (p99_threshold > 0) printf(", %.1f %% sur le p99", 100 * p99_threshold);
+    printf(" ; %d passe(s) de référence, %d courante(s)\n", base->repeat, cur->repeat);
+    printf("[gate] %-18s %-9s %-6s %11s %11s %9s  %-18s  %s\n", "cas", "n", "mesure", "référence", "actuel",
+           "écart", "IC 95 % écart", "verdict");
+    for (int i = 0; i < cur->count; i++) {
+        const SuiteResult* c = &cur->res[i];
+        const SuiteResult* b = find_case(base, c->name, c->n);
+        if (!b) { fresh++; continue; }
+        compared++;
+        Diff d = diff_runs(b->run_median, b->runs, c->run_median, c->runs);
+        Verdict v = judge(&d, threshold);
+        print_diff(c->name, c->n, "médian", &d, v);
+        regressions += v == V_REGRESSION;
+        uncertain += v == V_UNCERTAIN;
+        faster += v == V_FASTER;
+        if (p99_threshold > 0) {
+            d = diff_runs(b->run_p99, b->runs, c->run_p99, c->runs);
+            v = judge(&d, p99_threshold);
+            print_diff(c->name, c->n, "p99", &d, v);
+            regressions += v == V_REGRESSION;
+            uncertain += v == V_UNCERTAIN;
+        }
+    }
+    printf("[gate] %d cas comparés, %d régression(s), %d incertain(s), %d plus rapide(s)", compared, regressions,
+           uncertain, faster);
+    if (fresh) printf(", %d cas absents de la référence", fresh);
+    printf(" : %s\n", regressions ? "ÉCHEC" : "OK");
+    return regressions;
+}
@@ -0,0 +1,688 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "station_index.h"
+#include "station_compact.h"
+#include "queue.h"
+#include "slist.h"
+#include "rules.h"
+#include "csv_loader.h"
+#include "json_loader.h"
+#include "pipeline.h"
+#include "pricing.h"
+#include "bench.h"
+
+/**
+ * @brief Suite de micro-benchmarks répétables.
+ *
+ * Usage : ./bench suite [--sizes 1000,100000,1000000] [--json fichier|-] [--filter texte]
+ *                       [--time s] [--warmup k] [--seed s] [--repeat r]
+ *                       [--baseline fichier [--threshold pct] [--p99-threshold pct]]
+ *
+ * Chaque cas est mesuré par échantillons : un échantillon chronomètre un lot
+ * d'opérations (jusqu'à SUITE_BATCH opérations unitaires, un appel complet
+ * pour rules_top_n_print, un fichier entier pour les chargeurs) et en tire un
+ * temps par opération. Les --warmup premiers échantillons sont écartés et
+ * servent à estimer le nombre d'échantillons tenant dans --time secondes
+ * (borné à [SUITE_MIN_SAMPLES, SUITE_MAX_SAMPLES]). Le rapport donne la
+ * médiane et le 99e centile (rang le plus proche) de ces temps.
+ *
+ * --repeat r enchaîne r passes complètes de la suite : chaque cas garde la
+ * médiane de chaque passe, le rapport donne leur médiane et l'intervalle de
+ * confiance à 95 % de leur moyenne. Avec --baseline, l'exécution reprend les
+ * paramètres de la référence (sauf option explicite), puis est comparée à
+ * celle-ci par bench_gate.c ; le code de sortie vaut 1 en cas de régression.
+ *
+ * Clés, tirages et fichiers synthétiques ne dépendent que de la graine et de
+ * la taille : deux exécutions mesurent exactement les mêmes opérations.
+ */
+
+#define SUITE_BATCH 1000
+#define SUITE_MIN_SAMPLES 5
+#define SUITE_MAX_SAMPLES 2000
+#define SUITE_MRU_CAPACITY 5
+#define SUITE_PAIRS 65536          /* tirages (véhicule, station) précalculés pour le MRU */
+
+typedef struct Suite {
+    BenchRun run;           /* paramètres et résultats */
+    const char* filter;     /* sous-chaîne du nom des cas retenus, NULL pour tous */
+    int pass;               /* passe en cours, à partir de 0 */
+} Suite;
+
+/* chronomètre un échantillon et renvoie sa durée totale en ns */
+typedef double (*SampleFn)(void* ctx);
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* xorshift32 : suffisant pour tirer des clés, jamais nul si la graine ne l'est pas */
+static unsigned rnd(unsigned* s) {
+    unsigned x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+/* permutation aléatoire de 0..n-1 (Fisher-Yates) */
+static int* make_perm(int n, unsigned seed) {
+    int* p = (int*)malloc(sizeof(int) * (size_t)n);
+    if (!p) return NULL;
+    for (int i = 0; i < n; i++) p[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)(rnd(&seed) % (unsigned)(i + 1));
+        int t = p[i]; p[i] = p[j]; p[j] = t;
+    }
+    return p;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int selected(const Suite* s, const char* name) {
+    return !s->filter || strstr(name, s->filter) != NULL;
+}
+
+/* résultat du cas (name, n), créé à la première passe */
+static SuiteResult* result_slot(BenchRun* run, const char* name, int n) {
+    for (int i = 0; i < run->count; i++)
+        if (run->res[i].n == n && strcmp(run->res[i].name, name) == 0) return &run->res[i];
+    if (run->count == run->cap) {
+        int cap = run->cap ? 2 * run->cap : 64;
+        SuiteResult* r = (SuiteResult*)realloc(run->res, sizeof(SuiteResult) * (size_t)cap);
+        if (!r) return NULL;
+        run->res = r;
+        run->cap = cap;
+    }
+    SuiteResult* r = &run->res[run->count++];
+    memset(r, 0, sizeof *r);
+    snprintf(r->name, sizeof r->name, "%s", name);
+    r->n = n;
+    return r;
+}
+
+static double median_of(const double* x, int k) {
+    double v[SUITE_MAX_RUNS];
+    memcpy(v, x, sizeof(double) * (size_t)k);
+    qsort(v, (size_t)k, sizeof(double), cmp_double);
+    return k % 2 ? v[k / 2] : (v[k / 2 - 1] + v[k / 2]) / 2;
+}
+
+/* médianes, moyenne et intervalle de confiance sur les passes mesurées */
+static void finish_result(SuiteResult* r) {
+    int k = r->runs;
+    double mean = 0, var = 0;
+    for (int i = 0; i < k; i++) mean += r->run_median[i];
+    mean /= k;
+    for (int i = 0; i < k; i++) var += (r->run_median[i] - mean) * (r->run_median[i] - mean);
+    double half = k > 1 ? t_crit95(k - 1) * sqrt(var / (k - 1) / k) : 0;
+    r->median_ns = median_of(r->run_median, k);
+    r->p99_ns = median_of(r->run_p99, k);
+    r->mean_ns = r->sample_sum / r->sample_count;
+    r->ci_low = mean - half;
+    r->ci_high = mean + half;
+}
+
+/**
+ * Mesure un cas pour la passe en cours : échauffement, puis échantillons chronométrés.
+ *
+ * @param s Suite recevant le résultat.
+ * @param name Nom du cas.
+ * @param n Taille du jeu.
+ * @param ops Opérations par échantillon.
+ * @param fn Fonction d'échantillon.
+ * @param ctx Contexte passé à fn.
+ * @return Résultat cumulé du cas, NULL en cas d'échec d'allocation.
+ */
+static const SuiteResult* measure(Suite* s, const char* name, int n, int ops, SampleFn fn, void* ctx) {
+    double warm = 0;
+    for (int i = 0; i < s->run.warmup; i++) warm += fn(ctx);
+    double est = warm / s->run.warmup;
+    int count = est > 0 ? (int)(s->run.budget_s * 1e9 / est) : SUITE_MAX_SAMPLES;
+    if (count < SUITE_MIN_SAMPLES) count = SUITE_MIN_SAMPLES;
+    if (count > SUITE_MAX_SAMPLES) count = SUITE_MAX_SAMPLES;
+
+    SuiteResult* r = result_slot(&s->run, name, n);
+    double* v = r ? (double*)malloc(sizeof(double) * (size_t)count) : NULL;
+    if (!v) return NULL;
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        v[i] = fn(ctx) / ops;
+        sum += v[i];
+    }
+    qsort(v, (size_t)count, sizeof(double), cmp_double);
+
+    r->ops = ops;
+    r->samples = count;
+    // rang le plus proche : ceil(p * count) - 1
+    r->run_median[r->runs] = v[(count + 1) / 2 - 1];
+    r->run_p99[r->runs] = v[(99 * count + 99) / 100 - 1];
+    if (r->runs == 0 || v[0] < r->min_ns) r->min_ns = v[0];
+    r->runs++;
+    r->sample_sum += sum;
+    r->sample_count += count;
+    free(v);
+    finish_result(r);
+    return r;
+}
+
+/* une ligne par cas si la suite ne fait qu'une passe ; sinon le tableau final suffit */
+static void print_result(const Suite* s, const SuiteResult* r) {
+    if (!r) { printf("[suite] échec d'allocation\n"); return; }
+    if (s->run.repeat > 1) return;
+    printf("[suite] %-18s n=%-8d médiane %11.1f ns/op  p99 %11.1f ns/op  (%d x %d op)\n",
+           r->name, r->n, r->median_ns, r->p99_ns, r->samples, r->ops);
+}
+
+/* ---------- index AVL : stations de clé paire, insertions de clés impaires ---------- */
+
+typedef struct IndexCtx {
+    StationIndex idx;
+    CompactIndex compact;   /* copie équilibrée de idx (station_compact.h) */
+    int n;
+    int* perm;              /* ordre aléatoire des emplacements 0..n-1 */
+    int random;             /* 1 : emplacements dans l'ordre de perm, 0 : croissants */
+    int pos;
+    int batch;
+    int* slots;             /* emplacements du lot en cours */
+    long long sink;
+} IndexCtx;
+
+/* l'emplacement i porte la station 2i + 2 ; 2i + 1 reste libre pour les insertions */
+static StationInfo info_of(int i) {
+    static const int powers[] = {7, 22, 50, 100, 150, 350};
+    unsigned h = (unsigned)i * 2654435761u;
+    StationInfo in = { powers[(h >> 8) % 6], 20 + (int)((h >> 12) % 60), (int)((h >> 4) % 8), 0 };
+    return in;
+}
+
+static void next_batch(IndexCtx* c) {
+    for (int b = 0; b < c->batch; b++) {
+        c->slots[b] = c->random ? c->perm[c->pos] : c->pos;
+        if (++c->pos == c->n) c->pos = 0;
+    }
+}
+
+static double sample_find(void* ctx) {
+    IndexCtx* c = (IndexCtx*)ctx;
+    next_batch(c);
+    double t0 = now_ns();
+    for (int b = 0; b < c->batch; b++)
+        c->sink += si_find(c->idx.root, 2 * c->slots[b] + 2) != NULL;
+    return now_ns() - t0;
+}
+
+static double sample_sc_find(void* ctx) {
+    IndexCtx* c = (IndexCtx*)ctx;
+    next_batch(c);
+    double t0 = now_ns();
+    for (int b = 0; b < c->batch; b++)
+        c->sink += sc_find(&c->compact, 2 * c->slots[b] + 2) != SC_NIL;
+    return now_ns() - t0;
+}
+
+static double sample_add(void* ctx) {
+    IndexCtx* c = (IndexCtx*)ctx;
+    next_batch(c);
+    double t0 = now_ns();
+    for (int b = 0; b < c->batch; b++) si_add(&c->idx, 2 * c->slots[b] + 1, info_of(c->slots[b]));
+    double t = now_ns() - t0;
+    // retour à la taille n, hors chronomètre
+    for (int b = 0; b < c->batch; b++) si_delete(&c->idx, 2 * c->slots[b] + 1);
+    return t;
+}
+
+static double sample_delete(void* ctx) {
+    IndexCtx* c = (IndexCtx*)ctx;
+    next_batch(c);
+    double t0 = now_ns();
+    for (int b = 0; b < c->batch; b++) c->sink += si_delete(&c->idx, 2 * c->slots[b] + 2);
+    double t = now_ns() - t0;
+    for (int b = 0; b < c->batch; b++) si_add(&c->idx, 2 * c->slots[b] + 2, info_of(c->slots[b]));
+    return t;
+}
+
+static void suite_index(Suite* s, int n) {
+    static const struct { const char* name; SampleFn fn; int random; } CASES[] = {
+        { "si_add_seq", sample_add, 0 },       { "si_add_rand", sample_add, 1 },
+        { "si_find_seq", sample_find, 0 },     { "si_find_rand", sample_find, 1 },
+        { "si_delete_seq", sample_delete, 0 }, { "si_delete_rand", sample_delete, 1 },
+        { "sc_find_seq", sample_sc_find, 0 },  { "sc_find_rand", sample_sc_find, 1 },
+    };
+    int any = 0;
+    for (size_t k = 0; k < sizeof CASES / sizeof CASES[0]; k++) any |= selected(s, CASES[k].name);
+    if (!any) return;
+
+    IndexCtx c;
+    memset(&c, 0, sizeof c);
+    c.n = n;
+    // lots plus petits que n : une suppression ne vide jamais l'arbre
+    c.batch = n / 10 < SUITE_BATCH ? (n / 10 > 0 ? n / 10 : 1) : SUITE_BATCH;
+    c.perm = make_perm(n, s->run.seed);
+    c.slots = (int*)malloc(sizeof(int) * (size_t)c.batch);
+    if (!c.perm || !c.slots) { printf("[suite] échec d'allocation\n"); goto done; }
+    si_init(&c.idx);
+    for (int i = 0; i < n; i++) si_add(&c.idx, 2 * c.perm[i] + 2, info_of(c.perm[i]));
+    sc_init(&c.compact, 0);
+    if ((selected(s, "sc_find_seq") || selected(s, "sc_find_rand")) && sc_from_index(&c.compact, &c.idx) < 0) {
+        printf("[suite] échec d'allocation\n");
+        si_clear(&c.idx);
+        goto done;
+    }
+
+    for (size_t k = 0; k < sizeof CASES / sizeof CASES[0]; k++) {
+        if (!selected(s, CASES[k].name)) continue;
+        c.random = CASES[k].random;
+        c.pos = 0;
+        print_result(s, measure(s, CASES[k].name, n, c.batch, CASES[k].fn, &c));
+    }
+    si_clear(&c.idx);
+    sc_clear(&c.compact);
+done:
+    free(c.perm);
+    free(c.slots);
+}
+
+/* ---------- file d'événements : maintenue à n éléments ---------- */
+
+typedef struct QueueCtx {
+    Queue q;
+    int ts;
+    long long sink;
+} QueueCtx;
+
+static double sample_enqueue(void* ctx) {
+    QueueCtx* c = (QueueCtx*)ctx;
+    Event e;
+    double t0 = now_ns();
+    for (int b = 0; b < SUITE_BATCH; b++) {
+        Event in = { c->ts++, b, b, 1 };
+        c->sink += q_enqueue(&c->q, in);
+    }
+    double t = now_ns() - t0;
+    for (int b = 0; b < SUITE_BATCH; b++) q_dequeue(&c->q, &e);
+    return t;
+}
+
+static double sample_dequeue(void* ctx) {
+    QueueCtx* c = (QueueCtx*)ctx;
+    Event e;
+    for (int b = 0; b < SUITE_BATCH; b++) {
+        Event in = { c->ts++, b, b, 1 };
+        q_enqueue(&c->q, in);
+    }
+    double t0 = now_ns();
+    for (int b = 0; b < SUITE_BATCH; b++) c->sink += q_dequeue(&c->q, &e) ? e.ts : 0;
+    return now_ns() - t0;
+}
+
+static void suite_queue(Suite* s, int n) {
+    if (!selected(s, "q_enqueue") && !selected(s, "q_dequeue")) return;
+    QueueCtx c;
+    memset(&c, 0, sizeof c);
+    q_init(&c.q);
+    for (int i = 0; i < n; i++) {
+        Event in = { c.ts++, i, i, 1 };
+        if (!q_enqueue(&c.q, in)) { printf("[suite] échec d'allocation\n"); q_clear(&c.q); return; }
+    }
+    if (selected(s, "q_enqueue")) print_result(s, measure(s, "q_enqueue", n, SUITE_BATCH, sample_enqueue, &c));
+    if (selected(s, "q_dequeue")) print_result(s, measure(s, "q_dequeue", n, SUITE_BATCH, sample_dequeue, &c));
+    q_clear(&c.q);
+}
+
+/* ---------- historiques MRU : n / 10 véhicules, capacité 5 ---------- */
+
+typedef struct MruCtx {
+    SList* lists;
+    int* vehicle;
+    int* station;
+    int pos;
+} MruCtx;
+
+static double sample_mru(void* ctx) {
+    MruCtx* c = (MruCtx*)ctx;
+    double t0 = now_ns();
+    for (int b = 0; b < SUITE_BATCH; b++) {
+        ds_slist_update_mru(&c->lists[c->vehicle[c->pos]], c->station[c->pos], SUITE_MRU_CAPACITY);
+        c->pos = (c->pos + 1) & (SUITE_PAIRS - 1);
+    }
+    return now_ns() - t0;
+}
+
+static void suite_mru(Suite* s, int n) {
+    if (!selected(s, "slist_update_mru")) return;
+    MruCtx c;
+    memset(&c, 0, sizeof c);
+    int nv = n / 10 > 0 ? n / 10 : 1;
+    c.lists = (SList*)malloc(sizeof(SList) * (size_t)nv);
+    c.vehicle = (int*)malloc(sizeof(int) * SUITE_PAIRS);
+    c.station = (int*)malloc(sizeof(int) * SUITE_PAIRS);
+    if (c.lists && c.vehicle && c.station) {
+        for (int v = 0; v < nv; v++) ds_slist_init(&c.lists[v]);
+        // chaque véhicule revient surtout vers 8 stations habituelles : tête, milieu et absences
+        unsigned seed = s->run.seed;
+        for (int i = 0; i < SUITE_PAIRS; i++) {
+            c.vehicle[i] = (int)(rnd(&seed) % (unsigned)nv);
+            c.station[i] = (c.vehicle[i] * 7 + (int)(rnd(&seed) % 8u)) % n;
+        }
+        print_result(s, measure(s, "slist_update_mru", n, SUITE_BATCH, sample_mru, &c));
+        for (int v = 0; v < nv; v++) ds_slist_clear(&c.lists[v]);
+    } else {
+        printf("[suite] échec d'allocation\n");
+    }
+    free(c.lists);
+    free(c.vehicle);
+    free(c.station);
+}
+
+/* ---------- pipeline : branchement puis débranchement sur la même station ---------- */
+
+typedef struct ApplyCtx {
+    Pipeline pl;
+    Event* events;
+    int pos;
+} ApplyCtx;
+
+static double sample_apply(void* ctx) {
+    ApplyCtx* c = (ApplyCtx*)ctx;
+    double t0 = now_ns();
+    for (int b = 0; b < SUITE_BATCH; b++) {
+        pl_apply(&c->pl, &c->events[c->pos]);
+        c->pos = (c->pos + 1) & (SUITE_PAIRS - 1);
+    }
+    return now_ns() - t0;
+}
+
+static void suite_apply(Suite* s, int n) {
+    if (!selected(s, "pl_apply") && !selected(s, "pl_apply_priced")) return;
+    ApplyCtx c;
+    memset(&c, 0, sizeof c);
+    StationIndex idx;
+    si_init(&idx);
+    int nv = n / 10 > 0 ? n / 10 : 1;
+    SList* mru = (SList*)malloc(sizeof(SList) * (size_t)nv);
+    c.events = (Event*)malloc(sizeof(Event) * SUITE_PAIRS);
+    if (mru && c.events) {
+        for (int i = 0; i < n; i++) si_add(&idx, i + 1, info_of(i));
+        for (int v = 0; v < nv; v++) ds_slist_init(&mru[v]);
+        unsigned seed = s->run.seed;
+        for (int i = 0; i < SUITE_PAIRS; i += 2) {
+            int v = (int)(rnd(&seed) % (unsigned)nv), st = 1 + (int)(rnd(&seed) % (unsigned)n);
+            Event plug = { i, v, st, 1 }, unplug = { i + 1, v, st, 0 };
+            c.events[i] = plug;
+            c.events[i + 1] = unplug;
+        }
+        pl_init(&c.pl, &idx, mru, nv, SUITE_MRU_CAPACITY);
+        if (selected(s, "pl_apply")) print_result(s, measure(s, "pl_apply", n, SUITE_BATCH, sample_apply, &c));
+        // mêmes événements, tarification dynamique (courbe par défaut) attachée
+        PriceCurve curve;
+        PricingEngine pe;
+        pr_default_curve(&curve);
+        if (selected(s, "pl_apply_priced") && pr_init(&pe, &curve, NULL, NULL) && pr_attach(&pe, &idx, 0) >= 0) {
+            c.pl.pricing = &pe;
+            print_result(s, measure(s, "pl_apply_priced", n, SUITE_BATCH, sample_apply, &c));
+            c.pl.pricing = NULL;
+        }
+        pr_clear(&pe);
+        for (int v = 0; v < nv; v++) ds_slist_clear(&mru[v]);
+    } else {
+        printf("[suite] échec d'allocation\n");
+    }
+    si_clear(&idx);
+    free(mru);
+    free(c.events);
+}
+
+/* ---------- règles postfixées ---------- */
+
+typedef struct RuleCtx {
+    StationIndex idx;
+    StationInfo* infos;     /* copie des infos, parcourue en boucle par eval_rule_postfix */
+    int n;
+    int pos;
+    char** toks;
+    int n_toks;
+    long long sink;
+} RuleCtx;
+
+static double sample_postfix(void* ctx) {
+    RuleCtx* c = (RuleCtx*)ctx;
+    double t0 = now_ns();
+    for (int b = 0; b < SUITE_BATCH; b++) {
+        c->sink += eval_rule_postfix(c->toks, c->n_toks, &c->infos[c->pos]);
+        if (++c->pos == c->n) c->pos = 0;
+    }
+    return now_ns() - t0;
+}
+
+static double sample_top_n(void* ctx) {
+    RuleCtx* c = (RuleCtx*)ctx;
+    double t0 = now_ns();
+    rules_top_n_print(&c->idx, c->toks, c->n_toks, 10, NULL);
+    return now_ns() - t0;
+}
+
+static void suite_rules(Suite* s, int n) {
+    if (!selected(s, "eval_rule_postfix") && !selected(s, "rules_top_n_print")) return;
+    // règle sélective : 350 kW et au moins 4 créneaux libres
+    static char* RULE[] = { "power", "350", ">=", "slots", "4", ">=", "&&" };
+    RuleCtx c;
+    memset(&c, 0, sizeof c);
+    c.n = n;
+    c.toks = RULE;
+    c.n_toks = 7;
+    c.infos = (StationInfo*)malloc(sizeof(StationInfo) * (size_t)n);
+    if (!c.infos) { printf("[suite] échec d'allocation\n"); return; }
+    si_init(&c.idx);
+    for (int i = 0; i < n; i++) {
+        c.infos[i] = info_of(i);
+        si_add(&c.idx, i + 1, c.infos[i]);
+    }
+    if (selected(s, "eval_rule_postfix"))
+        print_result(s, measure(s, "eval_rule_postfix", n, SUITE_BATCH, sample_postfix, &c));
+    if (selected(s, "rules_top_n_print")) {
+        // l'affichage part vers /dev/null pendant la mesure
+        fflush(stdout);
+        int saved = dup(STDOUT_FILENO), null_fd = open("/dev/null", O_WRONLY);
+        if (saved >= 0 && null_fd >= 0) dup2(null_fd, STDOUT_FILENO);
+        const SuiteResult* r = measure(s, "rules_top_n_print", n, 1, sample_top_n, &c);
+        fflush(stdout);
+        if (saved >= 0 && null_fd >= 0) dup2(saved, STDOUT_FILENO);
+        if (saved >= 0) close(saved);
+        if (null_fd >= 0) close(null_fd);
+        print_result(s, r);
+    }
+    si_clear(&c.idx);
+    free(c.infos);
+}
+
+/* ---------- chargeurs : un échantillon = un fichier complet, temps par ligne ---------- */
+
+typedef struct LoadCtx {
+    const char* path;
+    int json;
+    int rows;
+} LoadCtx;
+
+static double sample_load(void* ctx) {
+    LoadCtx* c = (LoadCtx*)ctx;
+    StationIndex idx;
+    si_init(&idx);
+    double t0 = now_ns();
+    c->rows = c->json ? ds_load_stations_from_json(c->path, &idx) : ds_load_stations_from_csv(c->path, &idx);
+    double t = now_ns() - t0;
+    si_clear(&idx);
+    return t;
+}
+
+static void suite_loaders(Suite* s, int n) {
+    static const struct { const char* name; const char* path; int json; } CASES[] = {
+        { "load_csv", "/tmp/chargecraft_suite.csv", 0 },
+        { "load_json", "/tmp/chargecraft_suite.json", 1 },
+    };
+    for (size_t k = 0; k < sizeof CASES / sizeof CASES[0]; k++) {
+        if (!selected(s, CASES[k].name)) continue;
+        LoadCtx c = { CASES[k].path, CASES[k].json, 0 };
+        int ok = c.json ? gen_json(c.path, n, 0) : gen_csv(c.path, n);
+        if (!ok) { printf("[suite] impossible d'écrire %s\n", c.path); continue; }
+        print_result(s, measure(s, CASES[k].name, n, n, sample_load, &c));
+        if (c.rows != n) printf("[suite] %s : %d lignes lues sur %d\n", CASES[k].name, c.rows, n);
+        remove(c.path);
+    }
+}
+
+/* ---------- rapport JSON ---------- */
+
+static void write_array(FILE* f, const double* x, int k) {
+    fputc('[', f);
+    for (int i = 0; i < k; i++) fprintf(f, "%s%.2f", i ? ", " : "", x[i]);
+    fputc(']', f);
+}
+
+static int write_json(const BenchRun* run, const char* path) {
+    FILE* f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "{\n  \"suite\": \"chargecraft\",\n  \"format\": 2,\n  \"sizes\": [");
+    for (int k = 0; k < run->n_sizes; k++) fprintf(f, "%s%d", k ? ", " : "", run->sizes[k]);
+    fprintf(f, "],\n  \"repeat\": %d,\n  \"warmup\": %d,\n  \"time_s\": %g,\n  \"seed\": %u,\n  \"results\": [\n",
+            run->repeat, run->warmup, run->budget_s, run->seed);
+    for (int i = 0; i < run->count; i++) {
+        const SuiteResult* r = &run->res[i];
+        fprintf(f, "    {\"name\": \"%s\", \"n\": %d, \"ops\": %d, \"samples\": %d, "
+                   "\"median_ns\": %.2f, \"p99_ns\": %.2f, \"min_ns\": %.2f, \"mean_ns\": %.2f, "
+                   "\"ci_low\": %.2f, \"ci_high\": %.2f, \"runs\": ",
+                r->name, r->n, r->ops, r->samples, r->median_ns, r->p99_ns, r->min_ns, r->mean_ns,
+                r->ci_low, r->ci_high);
+        write_array(f, r->run_median, r->runs);
+        fprintf(f, ", \"runs_p99\": ");
+        write_array(f, r->run_p99, r->runs);
+        fprintf(f, "}%s\n", i + 1 < run->count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return f == stdout ? fflush(f) == 0 : fclose(f) == 0;
+}
+
+/* "1000,100000" -> tailles strictement positives, au plus cap */
+static int parse_sizes(const char* text, int* sizes, int cap) {
+    int count = 0;
+    for (const char* p = text; *p && count < cap;) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0 || v > 100000000L) return 0;
+        sizes[count++] = (int)v;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return count;
+}
+
+/* "10" ou "10%" -> 0.10 ; négatif si invalide */
+static double parse_percent(const char* text) {
+    char* end;
+    double v = strtod(text, &end);
+    if (end == text || (*end && strcmp(end, "%") != 0) || v < 0) return -1;
+    return v / 100;
+}
+
+static void print_summary(const BenchRun* run) {
+    printf("[suite] %-18s %-9s %12s %9s %12s  passes\n", "cas", "n", "médiane", "IC 95 %", "p99");
+    for (int i = 0; i < run->count; i++) {
+        const SuiteResult* r = &run->res[i];
+        double mean = (r->ci_low + r->ci_high) / 2;
+        printf("[suite] %-18s %-9d %12.1f %8.1f%% %12.1f  %d\n", r->name, r->n, r->median_ns,
+               mean > 0 ? 100 * (r->ci_high - mean) / mean : 0.0, r->p99_ns, r->runs);
+    }
+}
+
+int bench_suite(int argc, char** argv) {
+    Suite s;
+    memset(&s, 0, sizeof s);
+    BenchRun* run = &s.run;
+    run->budget_s = 0.25;
+    run->warmup = 3;
+    run->seed = 42;
+    run->repeat = 1;
+    run->n_sizes = 3;
+    run->sizes[0] = 1000; run->sizes[1] = 100000; run->sizes[2] = 1000000;
+    const char* json = "bench_results.json";
+    const char* baseline = NULL;
+    double threshold = 0.10, p99_threshold = 0;
+    // options explicites : elles priment sur celles de la référence
+    int set_sizes = 0, set_time = 0, set_warmup = 0, set_seed = 0, set_repeat = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!v) { fprintf(stderr, "option %s : valeur manquante\n", a); return 2; }
+        i++;
+        if (strcmp(a, "--sizes") == 0) { run->n_sizes = parse_sizes(v, run->sizes, SUITE_MAX_SIZES); set_sizes = 1; }
+        else if (strcmp(a, "--json") == 0) json = v;
+        else if (strcmp(a, "--filter") == 0) s.filter = v;
+        else if (strcmp(a, "--time") == 0) { run->budget_s = atof(v); set_time = 1; }
+        else if (strcmp(a, "--warmup") == 0) { run->warmup = atoi(v); set_warmup = 1; }
+        else if (strcmp(a, "--seed") == 0) { run->seed = (unsigned)strtoul(v, NULL, 10); set_seed = 1; }
+        else if (strcmp(a, "--repeat") == 0) { run->repeat = atoi(v); set_repeat = 1; }
+        else if (strcmp(a, "--baseline") == 0) baseline = v;
+        else if (strcmp(a, "--threshold") == 0) threshold = parse_percent(v);
+        else if (strcmp(a, "--p99-threshold") == 0) p99_threshold = parse_percent(v);
+        else { fprintf(stderr, "option inconnue : %s\n", a); return 2; }
+    }
+
+    BenchRun base;
+    memset(&base, 0, sizeof base);
+    if (baseline) {
+        if (!gate_read(baseline, &base)) {
+            fprintf(stderr, "[gate] référence illisible : %s (créer avec make bench-baseline)\n", baseline);
+            return 2;
+        }
+        // mêmes opérations que la référence, sauf option contraire
+        if (!set_sizes) { memcpy(run->sizes, base.sizes, sizeof run->sizes); run->n_sizes = base.n_sizes; }
+        if (!set_time) run->budget_s = base.budget_s;
+        if (!set_warmup) run->warmup = base.warmup;
+        if (!set_seed) run->seed = base.seed;
+        if (!set_repeat) run->repeat = base.repeat;
+        if (run->seed != base.seed)
+            fprintf(stderr, "[gate] graine %u différente de la référence (%u) : opérations non comparables\n",
+                    run->seed, base.seed);
+    }
+    if (run->n_sizes <= 0 || run->budget_s <= 0 || run->warmup < 1 || run->seed == 0 ||
+        run->repeat < 1 || run->repeat > SUITE_MAX_RUNS || threshold < 0 || p99_threshold < 0) {
+        fprintf(stderr, "paramètres invalides (tailles > 0, --time > 0, --warmup >= 1, --seed != 0, "
+                        "--repeat 1..%d, seuils >= 0)\n", SUITE_MAX_RUNS);
+        free(base.res);
+        return 2;
+    }
+
+    // passes complètes plutôt que répétitions cas par cas : une dérive de la
+    // machine (fréquence, voisins) se répartit sur tous les cas
+    for (s.pass = 0; s.pass < run->repeat; s.pass++) {
+        if (run->repeat > 1) { printf("[suite] passe %d/%d\n", s.pass + 1, run->repeat); fflush(stdout); }
+        for (int k = 0; k < run->n_sizes; k++) {
+            suite_index(&s, run->sizes[k]);
+            suite_queue(&s, run->sizes[k]);
+            suite_mru(&s, run->sizes[k]);
+            suite_apply(&s, run->sizes[k]);
+            suite_rules(&s, run->sizes[k]);
+            suite_loaders(&s, run->sizes[k]);
+        }
+    }
+    if (run->repeat > 1) print_summary(run);
+
+    int ok = write_json(run, json);
+    if (!ok) fprintf(stderr, "[suite] impossible d'écrire %s\n", json);
+    else if (strcmp(json, "-") != 0) printf("[suite] %d résultats -> %s\n", run->count, json);
+    int regressions = baseline ? gate_compare(&base, run, threshold, p99_threshold) : 0;
+    free(base.res);
+    free(run->res);
+    return ok && regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+#include "connector.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+void cn_init(ConnStore* c) {
+    memset(c, 0, sizeof *c);
+}
+
+/* case de id dans la table, ou case libre où l'insérer */
+static int* slot_of(const ConnStore* c, int id) {
+    int mask = c->n_slots - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)id) & (uint64_t)mask);
+    while (c->slots[i] >= 0 && c->st[c->slots[i]].station_id != id) i = (i + 1) & mask;
+    return &c->slots[i];
+}
+
+static CnStation* find(const ConnStore* c, int id) {
+    if (c->count == 0) return NULL;
+    int r = *slot_of(c, id);
+    return r >= 0 ? &c->st[r] : NULL;
+}
+
+static int grow_slots(ConnStore* c) {
+    // table au plus à moitié pleine : sondages courts
+    if ((c->count + 1) * 2 <= c->n_slots) return 1;
+    int n = c->n_slots ? 2 * c->n_slots : 2048;
+    int* slots = (int*)malloc(sizeof(int) * (size_t)n);
+    if (!slots) return 0;
+    memset(slots, 0xff, sizeof(int) * (size_t)n);
+    free(c->slots);
+    c->slots = slots;
+    c->n_slots = n;
+    for (int r = 0; r < c->count; r++) *slot_of(c, c->st[r].station_id) = r;
+    return 1;
+}
+
+static int reserve(void** p, size_t* cap, size_t need, size_t elem) {
+    if (need <= *cap) return 1;
+    size_t n = *cap ? *cap : 1024;
+    while (n < need) n *= 2;
+    void* q = realloc(*p, n * elem);
+    if (!q) return 0;
+    *p = q;
+    *cap = n;
+    return 1;
+}
+
+static int free_of(const ConnStore* c, const CnStation* s) {
+    int busy = 0;
+    for (int w = 0; w < s->n_words; w++) busy += __builtin_popcountll(c->bits[s->word + w]);
+    return 64 * s->n_words - busy;
+}
+
+/* mot et bit du connecteur k */
+#define CN_WORD(s, k) ((s)->word + (uint32_t)(k) / 64)
+#define CN_BIT(k) (1ull << ((k) & 63))
+
+int cn_add(ConnStore* c, int station_id, int capacity) {
+    if (find(c, station_id)) return 1;
+    if (capacity < 0) capacity = 0;
+    if (capacity > CN_MAX_CONNECTORS) capacity = CN_MAX_CONNECTORS;
+    int n_words = (capacity + 63) / 64;
+    size_t cap_st = (size_t)c->cap_st;
+    if (!grow_slots(c) || !reserve((void**)&c->st, &cap_st, (size_t)c->count + 1, sizeof(CnStation)) ||
+        !reserve((void**)&c->bits, &c->cap_words, c->n_words + (size_t)n_words, sizeof(uint64_t)) ||
+        !reserve((void**)&c->holders, &c->cap_holders, c->n_holders + (size_t)capacity, sizeof(int)))
+        return 0;
+    c->cap_st = (int)cap_st;
+    if (c->n_words + (size_t)n_words > UINT32_MAX || c->n_holders + (size_t)capacity > UINT32_MAX) return 0;
+
+    CnStation* s = &c->st[c->count];
+    s->station_id = station_id;
+    s->capacity = (uint16_t)capacity;
+    s->n_words = (uint16_t)n_words;
+    s->word = (uint32_t)c->n_words;
+    s->holder = (uint32_t)c->n_holders;
+    memset(c->bits + c->n_words, 0, sizeof(uint64_t) * (size_t)n_words);
+    // bits au-delà de la capacité : occupés pour toujours
+    if (capacity % 64) c->bits[c->n_words + (size_t)n_words - 1] = ~0ull << (capacity % 64);
+    for (int k = 0; k < capacity; k++) c->holders[c->n_holders + (size_t)k] = CN_UNKNOWN;
+    c->n_words += (size_t)n_words;
+    c->n_holders += (size_t)capacity;
+    *slot_of(c, station_id) = c->count++;
+    return 1;
+}
+
+/* bitsets et occupants rangés de nouveau bout à bout, dans l'ordre des stations */
+static void compact(ConnStore* c) {
+    size_t n_words = c->n_words - c->dead_words, n_holders = c->n_holders - c->dead_holders;
+    uint64_t* bits = (uint64_t*)malloc(sizeof(uint64_t) * (n_words + 1));
+    int* holders = (int*)malloc(sizeof(int) * (n_holders + 1));
+    if (!bits || !holders) {
+        // sans mémoire, les trous restent : rien n'est perdu
+        free(bits);
+        free(holders);
+        return;
+    }
+    size_t w = 0, h = 0;
+    for (int r = 0; r < c->count; r++) {
+        CnStation* s = &c->st[r];
+        memcpy(bits + w, c->bits + s->word, sizeof(uint64_t) * s->n_words);
+        memcpy(holders + h, c->holders + s->holder, sizeof(int) * s->capacity);
+        s->word = (uint32_t)w;
+        s->holder = (uint32_t)h;
+        w += s->n_words;
+        h += s->capacity;
+    }
+    free(c->bits);
+    free(c->holders);
+    c->bits = bits;
+    c->holders = holders;
+    c->n_words = c->cap_words = w;
+    c->n_holders = c->cap_holders = h;
+    c->dead_words = c->dead_holders = 0;
+}
+
+static void maybe_compact(ConnStore* c) {
+    if (c->dead_words * 2 > c->n_words || c->dead_holders * 2 > c->n_holders) compact(c);
+}
+
+int cn_resize(ConnStore* c, int station_id, int capacity) {
+    CnStation* s = find(c, station_id);
+    if (!s) return cn_add(c, station_id, capacity);
+    if (capacity < 0) capacity = 0;
+    if (capacity > CN_MAX_CONNECTORS) capacity = CN_MAX_CONNECTORS;
+    if (capacity == s->capacity) return 1;
+    int n_words = (capacity + 63) / 64;
+    int keep = capacity < s->capacity ? capacity : s->capacity;
+    uint32_t word = s->word, holder = s->holder;
+    if (capacity > s->capacity) {
+        // plus de connecteurs : bitset et occupants déplacés en fin de tableau
+        if (!reserve((void**)&c->bits, &c->cap_words, c->n_words + (size_t)n_words, sizeof(uint64_t)) ||
+            !reserve((void**)&c->holders, &c->cap_holders, c->n_holders + (size_t)capacity, sizeof(int)))
+            return 0;
+        if (c->n_words + (size_t)n_words > UINT32_MAX || c->n_holders + (size_t)capacity > UINT32_MAX) return 0;
+        word = (uint32_t)c->n_words;
+        holder = (uint32_t)c->n_holders;
+        memcpy(c->bits + word, c->bits + s->word, sizeof(uint64_t) * s->n_words);
+        memset(c->bits + word + s->n_words, 0, sizeof(uint64_t) * (size_t)(n_words - s->n_words));
+        memcpy(c->holders + holder, c->holders + s->holder, sizeof(int) * s->capacity);
+        for (int k = keep; k < capacity; k++) c->holders[holder + (uint32_t)k] = CN_UNKNOWN;
+        c->n_words += (size_t)n_words;
+        c->n_holders += (size_t)capacity;
+        c->dead_words += s->n_words;
+        c->dead_holders += s->capacity;
+    } else {
+        // moins de connecteurs : la fin du bitset et des occupants est abandonnée sur place
+        c->dead_words += (size_t)(s->n_words - n_words);
+        c->dead_holders += (size_t)(s->capacity - capacity);
+    }
+    // bits des connecteurs conservés, bourrage à 1 au-delà de la capacité
+    for (int w = 0; w < n_words; w++) {
+        int lo = 64 * w;
+        uint64_t kept = keep >= lo + 64 ? ~0ull : keep > lo ? ~0ull >> (64 - (keep - lo)) : 0;
+        uint64_t v = c->bits[word + (uint32_t)w] & kept;
+        if (capacity < lo + 64) v |= ~0ull << (capacity - lo);
+        c->bits[word + (uint32_t)w] = v;
+    }
+    s->capacity = (uint16_t)capacity;
+    s->n_words = (uint16_t)n_words;
+    s->word = word;
+    s->holder = holder;
+    maybe_compact(c);
+    return 1;
+}
+
+int cn_remove(ConnStore* c, int station_id) {
+    if (c->count == 0) return 0;
+    int* slot = slot_of(c, station_id);
+    int r = *slot;
+    if (r < 0) return 0;
+    c->dead_words += c->st[r].n_words;
+    c->dead_holders += c->st[r].capacity;
+    // suppression par recul : les suivants de la grappe qui le peuvent remontent dans le trou
+    int mask = c->n_slots - 1;
+    int i = (int)(slot - c->slots);
+    for (int j = (i + 1) & mask; c->slots[j] >= 0; j = (j + 1) & mask) {
+        int home = (int)(ds_hash_mix((uint64_t)(uint32_t)c->st[c->slots[j]].station_id) & (uint64_t)mask);
+        // home hors de ]i, j] (circulairement) : la case j peut descendre en i
+        int between = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!between) {
+            c->slots[i] = c->slots[j];
+            i = j;
+        }
+    }
+    c->slots[i] = -1;
+    // la dernière station prend le rang libéré
+    int last = --c->count;
+    if (r != last) {
+        c->st[r] = c->st[last];
+        *slot_of(c, c->st[r].station_id) = r;
+    }
+    maybe_compact(c);
+    return 1;
+}
+
+void cn_reset(ConnStore* c) {
+    if (c->slots) memset(c->slots, 0xff, sizeof(int) * (size_t)c->n_slots);
+    c->count = 0;
+    c->n_words = c->n_holders = 0;
+    c->dead_words = c->dead_holders = 0;
+}
+
+int cn_attach(ConnStore* c, const StationIndex* idx) {
+    SiCursor cur;
+    int count = 0;
+    si_cursor_begin(&cur, idx, INT_MIN, INT_MAX);
+    for (StationNode* n; (n = si_cursor_next(&cur)) != NULL; count++)
+        if (!cn_add(c, n->station_id, n->info.slots_free)) return -1;
+    return count;
+}
+
+int cn_claim(ConnStore* c, int station_id, int vehicle_id, int connector, int* free_after) {
+    CnStation* s = find(c, station_id);
+    if (!s) return CN_UNTRACKED;
+    int k = CN_NONE;
+    if (connector >= 0) {
+        if (connector < s->capacity && !(c->bits[CN_WORD(s, connector)] & CN_BIT(connector))) k = connector;
+    } else {
+        // premier bit à 0 ; les bits de bourrage sont à 1
+        for (int w = 0; w < s->n_words; w++) {
+            uint64_t open = ~c->bits[s->word + w];
+            if (open) { k = 64 * w + __builtin_ctzll(open); break; }
+        }
+    }
+    if (k == CN_NONE) {
+        c->stats.full++;
+        return CN_NONE;
+    }
+    c->bits[CN_WORD(s, k)] |= CN_BIT(k);
+    c->holders[s->holder + (uint32_t)k] = vehicle_id >= 0 ? vehicle_id : CN_UNKNOWN;
+    c->stats.claims++;
+    if (free_after) *free_after = free_of(c, s);
+    return k;
+}
+
+int cn_release(ConnStore* c, int station_id, int vehicle_id, int* free_after) {
+    CnStation* s = find(c, station_id);
+    if (!s) return CN_UNTRACKED;
+    const int* holders = c->holders + s->holder;
+    int k = CN_NONE, unknown = CN_NONE;
+    for (int i = 0; i < s->capacity; i++) {
+        if (!(c->bits[CN_WORD(s, i)] & CN_BIT(i))) continue;
+        if (vehicle_id >= 0 && holders[i] == vehicle_id) { k = i; break; }
+        if (unknown == CN_NONE && holders[i] == CN_UNKNOWN) unknown = i;
+    }
+    if (k == CN_NONE) k = unknown;
+    if (k == CN_NONE) {
+        c->stats.stray++;
+        return CN_NONE;
+    }
+    c->bits[CN_WORD(s, k)] &= ~CN_BIT(k);
+    c->holders[s->holder + (uint32_t)k] = CN_UNKNOWN;
+    c->stats.releases++;
+    if (free_after) *free_after = free_of(c, s);
+    return k;
+}
+
+int cn_free(const ConnStore* c, int station_id) {
+    const CnStation* s = find(c, station_id);
+    return s ? free_of(c, s) : CN_UNTRACKED;
+}
+
+int cn_set_free(ConnStore* c, int station_id, int slots_free) {
+    CnStation* s = find(c, station_id);
+    if (!s) return 0;
+    int busy = s->capacity - (slots_free < 0 ? 0 : slots_free);
+    if (busy < 0) busy = 0;
+    for (int w = 0; w < s->n_words; w++) {
+        // bourrage compris : bits [64w, 64w + 64) occupés s'ils sont sous busy ou hors capacité
+        int lo = 64 * w, hi = lo + 64;
+        uint64_t word = busy >= hi ? ~0ull : busy > lo ? ~0ull >> (64 - (busy - lo)) : 0;
+        if (s->capacity < hi) word |= ~0ull << (s->capacity - lo);
+        c->bits[s->word + w] = word;
+    }
+    for (int k = 0; k < s->capacity; k++) c->holders[s->holder + (uint32_t)k] = CN_UNKNOWN;
+    return 1;
+}
+
+int cn_count_free_at_least(const ConnStore* c, int k) {
+    int count = 0;
+    const uint64_t* bits = c->bits;
+    for (int r = 0; r < c->count; r++) {
+        const CnStation* s = &c->st[r];
+        // cas courant : un seul mot, lu dans l'ordre de la mémoire
+        int free = s->n_words == 1 ? 64 - __builtin_popcountll(bits[s->word]) : free_of(c, s);
+        count += free >= k;
+    }
+    return count;
+}
+
+void cn_print_stats(const ConnStore* c) {
+    printf("[CONN] %d stations, %zu connecteurs (%.1f Ko de bitsets) | %lld pris, %lld libérés, "
+           "%lld branchements sans connecteur libre, %lld débranchements sans connecteur à libérer\n",
+           c->count, c->n_holders - c->dead_holders, (c->n_words - c->dead_words) * sizeof(uint64_t) / 1024.0,
+           c->stats.claims, c->stats.releases, c->stats.full, c->stats.stray);
+}
+
+void cn_clear(ConnStore* c) {
+    free(c->st);
+    free(c->slots);
+    free(c->bits);
+    free(c->holders);
+    memset(c, 0, sizeof *c);
+}
@@ -0,0 +1,136 @@
+#ifndef DS_CONNECTOR_H
+#define DS_CONNECTOR_H
+#include <stddef.h>
+#include <stdint.h>
+#include "station_index.h"
+
+/**
+ * @brief Occupation de chaque point de charge (connecteur) des stations.
+ *
+ * Chaque station suivie possède un bitset d'un bit par connecteur (1 :
+ * occupé) et, pour chacun, le véhicule qui l'occupe. Les bitsets sont rangés
+ * bout à bout dans un seul tableau de mots de 64 bits, dans l'ordre d'ajout
+ * des stations ; les bits au-delà de la capacité, dans le dernier mot, restent
+ * à 1. Les connecteurs libres d'une station valent donc toujours
+ * 64 x mots - popcount(mots) : le compte ne dérive pas, quelle que soit la
+ * suite d'événements, et ne dépasse jamais la capacité.
+ *
+ * Un branchement prend un connecteur donné ou le premier libre (premier bit à
+ * 0 : ctz du complément). Un débranchement libère le connecteur du véhicule
+ * ou, à défaut, un connecteur d'occupant inconnu (état chargé ou repris sans
+ * ses occupants) ; sinon il n'a aucun effet.
+ *
+ * Une table ouverte (au plus à moitié pleine) associe l'identifiant au rang
+ * de la station. Les comptes sur toute la flotte (cn_count_free_at_least)
+ * parcourent les bitsets dans l'ordre de la mémoire.
+ *
+ * Attaché à l'index (idx->conns), le magasin suit le jeu de stations : une
+ * ligne insérée ou rechargée fixe la capacité (cn_resize), une suppression
+ * retire la station (cn_remove). Les mots et occupants abandonnés par un
+ * redimensionnement ou une suppression sont comptés et récupérés par
+ * compactage quand ils dépassent la moitié du tableau.
+ */
+
+#define CN_MAX_CONNECTORS 4096  /* capacité bornée par station */
+#define CN_UNKNOWN (-1)         /* occupant inconnu */
+#define CN_NONE (-1)            /* aucun connecteur libre, ou rien à libérer */
+#define CN_UNTRACKED (-2)       /* station absente */
+
+typedef struct CnStation {
+    int station_id;
+    uint16_t capacity;
+    uint16_t n_words;
+    uint32_t word;              /* premier mot dans bits */
+    uint32_t holder;            /* premier occupant dans holders */
+} CnStation;
+
+typedef struct CnStats {
+    long long claims;           /* connecteurs pris */
+    long long releases;         /* connecteurs libérés */
+    long long full;             /* branchements sans connecteur libre */
+    long long stray;            /* débranchements sans connecteur à libérer */
+} CnStats;
+
+typedef struct ConnStore {
+    CnStation* st;              /* stations dans l'ordre d'ajout */
+    int count, cap_st;
+    int* slots;                 /* table ouverte (sondage linéaire) : rang dans st, -1 si libre */
+    int n_slots;                /* puissance de deux */
+    uint64_t* bits;             /* bitsets bout à bout */
+    size_t n_words, cap_words;
+    int* holders;               /* véhicule de chaque connecteur, CN_UNKNOWN si inconnu */
+    size_t n_holders, cap_holders;
+    size_t dead_words, dead_holders;    /* abandonnés, récupérés au compactage */
+    CnStats stats;
+} ConnStore;
+
+void cn_init(ConnStore* c);                                            /* O(1) */
+
+/**
+ * Suit une station, tous ses connecteurs libres. Une station déjà suivie
+ * garde ses connecteurs et leur occupation.
+ *
+ * @param capacity Connecteurs, bornés à CN_MAX_CONNECTORS.
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  cn_add(ConnStore* c, int station_id, int capacity);               /* O(capacity) amorti */
+
+/**
+ * Fixe la capacité d'une station, suivie ou non (rechargement du jeu). Les
+ * connecteurs sous la nouvelle capacité gardent leur occupation ; ceux
+ * au-delà disparaissent avec leur occupant.
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation (suivi inchangé).
+ */
+int  cn_resize(ConnStore* c, int station_id, int capacity);            /* O(capacity) amorti */
+
+/* cesse de suivre la station ; 1 si elle l'était */
+int  cn_remove(ConnStore* c, int station_id);                          /* O(1) amorti */
+
+/* cesse de suivre toutes les stations, mémoire conservée */
+void cn_reset(ConnStore* c);                                           /* O(table) */
+
+/**
+ * Suit toutes les stations de l'index, juste après leur chargement : la
+ * capacité est le nombre de créneaux libres courant (nbre_pdc du jeu).
+ *
+ * @return Nombre de stations suivies, -1 en cas d'échec d'allocation.
+ */
+int  cn_attach(ConnStore* c, const StationIndex* idx);                 /* O(n + connecteurs) */
+
+/**
+ * Branche un véhicule.
+ *
+ * @param connector Connecteur voulu, ou -1 pour le premier libre.
+ * @param free_after Reçoit les connecteurs libres après le branchement, ou NULL.
+ * @return Connecteur pris, CN_NONE s'il n'y en a pas de libre (ou si le
+ *         connecteur voulu est occupé), CN_UNTRACKED si la station est absente.
+ */
+int  cn_claim(ConnStore* c, int station_id, int vehicle_id, int connector, int* free_after);  /* O(capacity / 64) */
+
+/**
+ * Débranche un véhicule : libère son connecteur, sinon un connecteur d'occupant inconnu.
+ *
+ * @param free_after Reçoit les connecteurs libres après le débranchement, ou NULL.
+ * @return Connecteur libéré, CN_NONE si rien n'est à libérer, CN_UNTRACKED si la station est absente.
+ */
+int  cn_release(ConnStore* c, int station_id, int vehicle_id, int* free_after);  /* O(capacity) */
+
+/* connecteurs libres de la station, CN_UNTRACKED si elle est absente */
+int  cn_free(const ConnStore* c, int station_id);                      /* O(capacity / 64) */
+
+/**
+ * Remplace l'occupation de la station : les capacity - slots_free premiers
+ * connecteurs sont occupés, par des occupants inconnus.
+ *
+ * @return 1 si succès, 0 si la station est absente.
+ */
+int  cn_set_free(ConnStore* c, int station_id, int slots_free);        /* O(capacity) */
+
+/* stations ayant au moins k connecteurs libres */
+int  cn_count_free_at_least(const ConnStore* c, int k);                /* O(n + connecteurs / 64) */
+
+void cn_print_stats(const ConnStore* c);
+void cn_clear(ConnStore* c);
+
+#endif
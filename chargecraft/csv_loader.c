@@ -1,53 +1,341 @@
+#define _POSIX_C_SOURCE 200809L
 #include "csv_loader.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static int parse_station_id(const char* s){
-    if(!s) return -1;
-    const char* p = strrchr(s, '_');
-    if(!p || !*(p+1)) return -1;
-    return atoi(p+1);
+#define CSV_MAX_COLS 16
+#define CSV_MAX_THREADS 64
+#define CSV_MIN_CHUNK 4096
+
+typedef struct CsvField { const char* p; int len; } CsvField;
+typedef struct CsvRow {
+    int station_id;
+    StationInfo info;
+    CsvField text[6]; /* opérateur, nom, adresse, INSEE, accès, identifiant (bruts, dans le fichier projeté) */
+    int lat_e6, lon_e6;
+} CsvRow;
+
+/* puits de lignes : fn reçoit chaque StationRow, dans l'ordre du fichier ; text reçoit les champs déséchappés */
+typedef struct RowOut { StationRowFn fn; void* ctx; char* text; size_t text_cap; int failed; } RowOut;
+typedef struct RowBuf { CsvRow* rows; int count; int cap; int failed; } RowBuf;
+
+typedef void (*RowSink)(void* ctx, const CsvRow* row);
+
+/* entier signé lu dans un champ non terminé par '\0' */
+static int field_int(const char* p, int len){
+    int i = 0, neg = 0, v = 0;
+    while(i < len && (p[i] == ' ' || p[i] == '"')) i++;
+    if(i < len && (p[i] == '-' || p[i] == '+')){ neg = p[i] == '-'; i++; }
+    while(i < len && p[i] >= '0' && p[i] <= '9'){ v = v*10 + (p[i] - '0'); i++; }
+    return neg ? -v : v;
 }
 
-static int split_csv_line(char* line, char* out[], int max_cols){
+/* nombre après le dernier '_' de id_station_itinerance, -1 s'il n'y en a pas */
+static int parse_station_id(const CsvField* f){
+    int us = -1;
+    for(int i = 0; i < f->len; i++) if(f->p[i] == '_') us = i;
+    if(us < 0 || us + 1 >= f->len) return -1;
+    return field_int(f->p + us + 1, f->len - us - 1);
+}
+
+/**
+ * Découpe un enregistrement CSV commençant en p (RFC 4180 : les champs entre
+ * guillemets peuvent contenir ',' , '\n' et "" échappés).
+ * Retourne le début de l'enregistrement suivant.
+ */
+static const char* split_csv_record(const char* p, const char* end, CsvField out[], int max_cols, int* ncols){
     int n = 0;
-    char* tok = strtok(line, ",");
-    while(tok && n < max_cols){
-        char* end = tok + strlen(tok) - 1;
-        while(end >= tok && (*end == '\n' || *end == '\r')) { *end = '\0'; end--; }
-        out[n++] = tok;
-        tok = strtok(NULL, ",");
+    for(;;){
+        const char* start = p;
+        if(p < end && *p == '"'){
+            p++;
+            while(p < end){
+                if(*p == '"'){
+                    if(p + 1 < end && p[1] == '"'){ p += 2; continue; }
+                    break;
+                }
+                p++;
+            }
+            if(p < end) p++; // guillemet fermant
+        }
+        while(p < end && *p != ',' && *p != '\n') p++;
+
+        const char* fend = p;
+        while(fend > start && fend[-1] == '\r') fend--;
+        if(n < max_cols){ out[n].p = start; out[n].len = (int)(fend - start); n++; }
+
+        if(p >= end){ *ncols = n; return end; }
+        if(*p == '\n'){ *ncols = n; return p + 1; }
+        p++; // ','
+    }
+}
+
+static int row_from_fields(const CsvField* cols, int n, CsvRow* row){
+    if(n < 10) return 0;
+    // identifiant vide (ou réduit à ses guillemets) : ligne ignorée
+    if(cols[0].len == 0 || (cols[0].len == 2 && cols[0].p[0] == '"')) return 0;
+    row->station_id = parse_station_id(&cols[0]);
+    row->info.power_kW    = field_int(cols[5].p, cols[5].len);
+    row->info.price_cents = 300;
+    row->info.slots_free  = field_int(cols[6].p, cols[6].len);
+    row->info.last_ts     = 0;
+    row->text[0] = cols[1];
+    row->text[1] = cols[2];
+    row->text[2] = cols[3];
+    row->text[3] = cols[4];
+    row->text[4] = cols[7];
+    row->text[5] = cols[0];
+    row->lat_e6 = sp_parse_coord(cols[8].p, cols[8].len);
+    row->lon_e6 = sp_parse_coord(cols[9].p, cols[9].len);
+    if(row->lat_e6 == SP_NO_POS) row->lon_e6 = SP_NO_POS;
+    if(row->lon_e6 == SP_NO_POS) row->lat_e6 = SP_NO_POS;
+    return 1;
+}
+
+/*
+ * Texte d'un champ sans ses guillemets. Sans "" échappé, il se lit en place dans
+ * le fichier projeté ; sinon il est réduit dans *buf (au plus f->len octets),
+ * qui avance d'autant.
+ */
+static MetaText csv_text(const CsvField* f, char** buf){
+    MetaText t = { f->p, f->len };
+    if(f->len < 2 || f->p[0] != '"') return t;
+    t.p = f->p + 1;
+    t.len = f->len - 2;
+    if(!memchr(t.p, '"', (size_t)t.len)) return t;
+    char* out = *buf;
+    int n = 0;
+    for(int i = 1; i < f->len - 1; i++){
+        out[n++] = f->p[i];
+        if(f->p[i] == '"' && f->p[i + 1] == '"') i++;
+    }
+    t.p = out;
+    t.len = n;
+    *buf += n;
+    return t;
+}
+
+/* convertit une ligne brute et la transmet au puits final ; 0 en cas d'échec d'allocation */
+static int emit_row(RowOut* out, const CsvRow* raw){
+    // les textes réduits tiennent dans la longueur des champs bruts : aucun n'est tronqué
+    size_t need = 0;
+    for(int k = 0; k < 6; k++) need += (size_t)raw->text[k].len;
+    if(need > out->text_cap){
+        size_t nc = out->text_cap ? out->text_cap : 1024;
+        while(nc < need) nc *= 2;
+        char* t = (char*)realloc(out->text, nc);
+        if(!t){ out->failed = 1; return 0; }
+        out->text = t;
+        out->text_cap = nc;
+    }
+    char* buf = out->text;
+    StationRow row;
+    row.station_id = raw->station_id;
+    row.itinerance = csv_text(&raw->text[5], &buf);
+    row.nbre_pdc   = raw->info.slots_free;
+    row.info       = raw->info;
+    row.lat_e6     = raw->lat_e6;
+    row.lon_e6     = raw->lon_e6;
+    row.text.operator_name = csv_text(&raw->text[0], &buf);
+    row.text.name          = csv_text(&raw->text[1], &buf);
+    row.text.address       = csv_text(&raw->text[2], &buf);
+    row.text.insee         = csv_text(&raw->text[3], &buf);
+    row.text.access        = csv_text(&raw->text[4], &buf);
+    out->fn(out->ctx, &row);
+    return 1;
+}
+
+/* parse tous les enregistrements de [p, end) et les transmet au puits dans l'ordre */
+static int parse_range(const char* p, const char* end, RowSink sink, void* ctx){
+    int rows = 0;
+    while(p < end){
+        CsvField cols[CSV_MAX_COLS];
+        int n = 0;
+        p = split_csv_record(p, end, cols, CSV_MAX_COLS, &n);
+        CsvRow row;
+        if(row_from_fields(cols, n, &row)){
+            sink(ctx, &row);
+            rows++;
+        }
+    }
+    return rows;
+}
+
+static void sink_emit(void* ctx, const CsvRow* row){
+    RowOut* out = (RowOut*)ctx;
+    if(!out->failed) emit_row(out, row);
+}
+
+static void sink_buffer(void* ctx, const CsvRow* row){
+    RowBuf* b = (RowBuf*)ctx;
+    if(b->failed) return;
+    if(b->count == b->cap){
+        int nc = b->cap ? b->cap * 2 : 256;
+        CsvRow* nr = (CsvRow*)realloc(b->rows, sizeof(CsvRow) * nc);
+        if(!nr){ b->failed = 1; return; }
+        b->rows = nr; b->cap = nc;
     }
-    return n;
+    b->rows[b->count++] = *row;
+}
+
+/* projection en lecture seule du fichier ; data == NULL si vide ou illisible */
+static int map_file(const char* path, const char** data, size_t* size){
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return 0;
+    struct stat st;
+    if(fstat(fd, &st) != 0){ close(fd); return 0; }
+    *size = (size_t)st.st_size;
+    *data = NULL;
+    if(*size > 0){
+        void* m = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m == MAP_FAILED){ close(fd); return 0; }
+        *data = (const char*)m;
+    }
+    close(fd);
+    return 1;
+}
+
+/* saute la ligne d'en-tête ; NULL si le fichier n'en a pas */
+static const char* skip_header(const char* data, size_t size){
+    if(!data || size == 0) return NULL;
+    CsvField cols[CSV_MAX_COLS];
+    int n = 0;
+    return split_csv_record(data, data + size, cols, CSV_MAX_COLS, &n);
+}
+
+int ds_scan_stations_from_csv(const char* path, StationRowFn fn, void* ctx){
+    METRIC_TIMER(t0);
+    const char* data; size_t size;
+    if(!map_file(path, &data, &size)) return -1;
+    const char* body = skip_header(data, size);
+    if(!body){ if(data) munmap((void*)data, size); return -1; }
+
+    RowOut out = { fn, ctx, NULL, 0, 0 };
+    int rows = parse_range(body, data + size, sink_emit, &out);
+    free(out.text);
+    munmap((void*)data, size);
+    if(out.failed) return -1;
+    METRIC_INC(MC_LOADS);
+    METRIC_ADD(MC_ROWS_LOADED, rows);
+    METRIC_TIMER_STOP(MH_LOAD_NS, t0);
+    return rows;
 }
 
 int ds_load_stations_from_csv(const char* path, StationIndex* idx){
-    FILE* f = fopen(path, "r");
-    if(!f) return -1;
+    return ds_scan_stations_from_csv(path, ds_row_insert, idx);
+}
 
-    char buf[2048];
-    if(!fgets(buf, sizeof buf, f)){ fclose(f); return -1; }
+/* ---------- chargement parallèle ---------- */
 
-    int inserted = 0;
-    while(fgets(buf, sizeof buf, f)){
-        char* cols[16];
-        int n = split_csv_line(buf, cols, 16);
-        if(n < 10) continue;
+typedef struct CsvTask {
+    const char* begin;
+    const char* end;
+    size_t quotes;   /* phase 1 : guillemets dans la tranche brute */
+    RowBuf out;      /* phase 2 : lignes parsées de la tranche alignée */
+} CsvTask;
 
-        int station_id = parse_station_id(cols[0]);
-        if(station_id < 0) continue;
+static void* count_quotes_worker(void* arg){
+    CsvTask* t = (CsvTask*)arg;
+    size_t q = 0;
+    for(const char* p = t->begin; p < t->end; p++) q += (*p == '"');
+    t->quotes = q;
+    return NULL;
+}
 
-        StationInfo info;
-        info.power_kW    = atoi(cols[5]);
-        info.price_cents = 300;
-        info.slots_free  = atoi(cols[6]);
-        info.last_ts     = 0;
+static void* parse_worker(void* arg){
+    CsvTask* t = (CsvTask*)arg;
+    parse_range(t->begin, t->end, sink_buffer, &t->out);
+    return NULL;
+}
 
-        si_add(idx, station_id, info);
-        inserted++;
+/* lance fn sur chaque tâche ; la tâche 0 tourne dans le thread appelant */
+static void run_tasks(CsvTask* tasks, int n, void* (*fn)(void*)){
+    pthread_t th[CSV_MAX_THREADS];
+    int started[CSV_MAX_THREADS] = {0};
+    for(int i = 1; i < n; i++)
+        started[i] = pthread_create(&th[i], NULL, fn, &tasks[i]) == 0;
+    fn(&tasks[0]);
+    for(int i = 1; i < n; i++){
+        if(started[i]) pthread_join(th[i], NULL);
+        else fn(&tasks[i]); // pas de thread disponible : exécution locale
     }
-    fclose(f);
-    return inserted;
 }
 
+int ds_load_stations_from_csv_parallel(const char* path, StationIndex* idx, int nthreads){
+    METRIC_TIMER(t0);
+    if(nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(nthreads < 1) nthreads = 1;
+    if(nthreads > CSV_MAX_THREADS) nthreads = CSV_MAX_THREADS;
+
+    const char* data; size_t size;
+    if(!map_file(path, &data, &size)) return -1;
+    const char* body = skip_header(data, size);
+    if(!body){ if(data) munmap((void*)data, size); return -1; }
+    const char* end = data + size;
+
+    size_t body_len = (size_t)(end - body);
+    if((size_t)nthreads > body_len / CSV_MIN_CHUNK + 1) nthreads = (int)(body_len / CSV_MIN_CHUNK + 1);
+
+    CsvTask tasks[CSV_MAX_THREADS];
+    memset(tasks, 0, sizeof tasks);
+
+    // phase 1 : parité des guillemets par tranche brute, pour connaître l'état
+    // "dans une chaîne" à chaque point de coupe sans relire le début du fichier
+    for(int i = 0; i < nthreads; i++){
+        tasks[i].begin = body + body_len * i / nthreads;
+        tasks[i].end   = body + body_len * (i + 1) / nthreads;
+    }
+    if(nthreads > 1) run_tasks(tasks, nthreads, count_quotes_worker);
+
+    // alignement de chaque coupe sur la première fin de ligne hors guillemets
+    const char* cut[CSV_MAX_THREADS + 1];
+    cut[0] = body;
+    cut[nthreads] = end;
+    int in_quotes = 0;
+    for(int i = 1; i < nthreads; i++){
+        in_quotes ^= (int)(tasks[i - 1].quotes & 1);
+        int q = in_quotes;
+        const char* p = tasks[i].begin;
+        while(p < end && (q || *p != '\n')){
+            if(*p == '"') q ^= 1;
+            p++;
+        }
+        if(p < end) p++;
+        cut[i] = p < cut[i - 1] ? cut[i - 1] : p;
+    }
+
+    // phase 2 : parse de chaque plage alignée dans un tampon local
+    for(int i = 0; i < nthreads; i++){
+        tasks[i].begin = cut[i];
+        tasks[i].end   = cut[i + 1];
+        tasks[i].out.rows = NULL;
+        tasks[i].out.count = tasks[i].out.cap = tasks[i].out.failed = 0;
+    }
+    run_tasks(tasks, nthreads, parse_worker);
+
+    // phase 3 : fusion dans l'ordre du fichier (dernier écrivain gagnant) ;
+    // les champs texte pointent encore dans le fichier projeté, d'où le munmap après
+    RowOut out = { ds_row_insert, idx, NULL, 0, 0 };
+    int inserted = 0, failed = 0;
+    for(int i = 0; i < nthreads; i++) failed |= tasks[i].out.failed;
+    for(int i = 0; i < nthreads && !failed; i++){
+        for(int k = 0; k < tasks[i].out.count && !out.failed; k++)
+            emit_row(&out, &tasks[i].out.rows[k]);
+        inserted += tasks[i].out.count;
+        failed = out.failed;
+    }
+    free(out.text);
+    for(int i = 0; i < nthreads; i++) free(tasks[i].out.rows);
+    munmap((void*)data, size);
+    METRIC_INC(MC_LOADS);
+    METRIC_ADD(MC_ROWS_LOADED, failed ? 0 : inserted);
+    METRIC_TIMER_STOP(MH_LOAD_NS, t0);
+    return failed ? -1 : inserted;
+}
@@ -1,7 +1,40 @@
 #ifndef DS_CSV_LOADER_H
 #define DS_CSV_LOADER_H
 #include "station_index.h"
+#include "station_row.h"
 
+/**
+ * Charge les stations d'un fichier CSV IRVE dans l'index (lecture séquentielle).
+ * Les champs entre guillemets (virgules, retours à la ligne, "" échappés) sont gérés,
+ * quelle que soit leur longueur.
+ *
+ * @param path Chemin du fichier CSV (ligne d'en-tête obligatoire).
+ * @param idx Index de destination (identifiants : voir ds_row_resolve).
+ * @return Nombre de lignes lues, -1 si le fichier est illisible ou en cas d'échec d'allocation.
+ */
 int ds_load_stations_from_csv(const char* path, StationIndex* idx);
 
+/**
+ * Parcourt les lignes valides du CSV sans toucher à aucun index.
+ *
+ * @param path Chemin du fichier CSV.
+ * @param fn Fonction appelée pour chaque ligne, dans l'ordre du fichier.
+ * @param ctx Contexte transmis à fn.
+ * @return Nombre de lignes transmises, -1 si le fichier est illisible ou en cas d'échec d'allocation.
+ */
+int ds_scan_stations_from_csv(const char* path, StationRowFn fn, void* ctx);
+
+/**
+ * Variante parallèle : le fichier est découpé en plages d'octets alignées sur les
+ * fins d'enregistrement (hors guillemets), chaque thread parse sa plage dans un
+ * tampon local, puis les tampons sont fusionnés dans l'ordre du fichier.
+ * Le résultat est identique au chargement séquentiel (dernier écrivain gagnant).
+ *
+ * @param path Chemin du fichier CSV.
+ * @param idx Index de destination.
+ * @param nthreads Nombre de threads (<= 0 : nombre de coeurs en ligne).
+ * @return Nombre de lignes insérées, -1 en cas d'erreur.
+ */
+int ds_load_stations_from_csv_parallel(const char* path, StationIndex* idx, int nthreads);
+
 #endif
@@ -0,0 +1,300 @@
+#define _POSIX_C_SOURCE 200809L
+#include "dataset.h"
+#include "csv_loader.h"
+#include "json_loader.h"
+#include "geo.h"
+#include "spatial.h"
+#include "station_key.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t align8(uint64_t x) {
+    return (x + 7) & ~(uint64_t)7;
+}
+
+static int ends_with(const char* s, const char* suffix) {
+    size_t n = strlen(s), k = strlen(suffix);
+    return n >= k && strcmp(s + n - k, suffix) == 0;
+}
+
+typedef struct PowerKey { int power; int id; uint32_t i; } PowerKey;
+
+/* puissance décroissante, puis identifiant croissant */
+static int cmp_power(const void* a, const void* b) {
+    const PowerKey* x = (const PowerKey*)a;
+    const PowerKey* y = (const PowerKey*)b;
+    if (x->power != y->power) return x->power > y->power ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/* offsets d'un pool interné ; un pool vide s'écrit comme la seule chaîne vide */
+static uint32_t pool_len(const InternPool* p) {
+    return p->count ? (uint32_t)p->count : 1u;
+}
+
+static void pool_write(char* dst, const InternPool* p) {
+    if (p->count) memcpy(dst, p->offs, sizeof(uint32_t) * (size_t)p->count);
+    else memset(dst, 0, sizeof(uint32_t));
+}
+
+int dset_compile(const char* in, const char* out) {
+    StationIndex idx;
+    StationMeta meta;
+    SpatialIndex spatial;
+    StationKeys itinerance;
+    si_init(&idx);
+    sm_init(&meta);
+    sk_init(&itinerance);
+    if (!sp_init(&spatial, 0)) return -1;
+    idx.meta = &meta;
+    idx.spatial = &spatial;
+    // identifiants uniques même quand plusieurs opérateurs partagent un nombre
+    idx.keys = &itinerance;
+    int rows = ends_with(in, ".json") ? ds_load_stations_from_json(in, &idx)
+                                      : ds_load_stations_from_csv(in, &idx);
+    if (rows < 0) { si_clear(&idx); sp_clear(&spatial); sk_clear(&itinerance); return -1; }
+
+    uint32_t n = (uint32_t)meta.count;
+    DatasetHeader h;
+    memset(&h, 0, sizeof h);
+    h.magic = DSET_MAGIC;
+    h.version = DSET_VERSION;
+    h.count = n;
+    h.n_operators = pool_len(&meta.operators);
+    h.n_access    = pool_len(&meta.access);
+    h.n_communes  = pool_len(&meta.communes);
+    h.arena_len   = meta.arena_len ? meta.arena_len : 1;
+
+    h.off_ids       = align8(sizeof h);
+    h.off_recs      = align8(h.off_ids + sizeof(int32_t) * n);
+    h.off_meta      = align8(h.off_recs + sizeof(DatasetRecord) * n);
+    h.off_by_power  = align8(h.off_meta + sizeof(StationMetaRec) * n);
+    h.off_operators = align8(h.off_by_power + sizeof(uint32_t) * n);
+    h.off_access    = align8(h.off_operators + sizeof(uint32_t) * h.n_operators);
+    h.off_communes  = align8(h.off_access + sizeof(uint32_t) * h.n_access);
+    h.off_arena     = align8(h.off_communes + sizeof(uint32_t) * h.n_communes);
+    h.key_arena_len = itinerance.arena_len ? itinerance.arena_len : 1;
+    h.off_keys      = align8(h.off_arena + h.arena_len);
+    h.off_key_arena = align8(h.off_keys + sizeof(DatasetKey) * n);
+    h.file_size     = align8(h.off_key_arena + h.key_arena_len);
+
+    char* buf = (char*)calloc(1, (size_t)h.file_size);
+    PowerKey* keys = (PowerKey*)malloc(sizeof(PowerKey) * (n ? n : 1));
+    int ok = buf && keys;
+
+    // stations dans l'ordre des identifiants, directement depuis l'arbre
+    SiCursor cur;
+    si_cursor_begin(&cur, &idx, INT_MIN, INT_MAX);
+    uint32_t pos = 0;
+    for (StationNode* node; ok && (node = si_cursor_next(&cur)) != NULL; pos++) {
+        int id = node->station_id;
+        const StationMetaRec* mr = sm_find_rec(&meta, id);
+        if (pos >= n || !mr) { ok = 0; break; }
+        DatasetRecord r = { id, node->info.slots_free, node->info, SP_NO_POS, SP_NO_POS };
+        if (!sp_get(&spatial, id, &r.lat_e6, &r.lon_e6)) r.lat_e6 = r.lon_e6 = SP_NO_POS;
+        ((int32_t*)(buf + h.off_ids))[pos] = id;
+        memcpy(buf + h.off_recs + sizeof(DatasetRecord) * pos, &r, sizeof r);
+        memcpy(buf + h.off_meta + sizeof(StationMetaRec) * pos, mr, sizeof *mr);
+        // chaîne d'itinérance : offset dans l'arène du registre, recopiée telle quelle
+        const char* name = sk_name(&itinerance, id, NULL);
+        DatasetKey key = { 0, 0 };
+        if (name) {
+            key.off = (uint32_t)(name - itinerance.arena);
+            key.len = (uint32_t)strlen(name);
+        }
+        memcpy(buf + h.off_keys + sizeof(DatasetKey) * pos, &key, sizeof key);
+        keys[pos].power = node->info.power_kW;
+        keys[pos].id = id;
+        keys[pos].i = pos;
+    }
+    if (pos != n) ok = 0;
+    if (ok) {
+        qsort(keys, n, sizeof(PowerKey), cmp_power);
+        for (uint32_t i = 0; i < n; i++) ((uint32_t*)(buf + h.off_by_power))[i] = keys[i].i;
+        pool_write(buf + h.off_operators, &meta.operators);
+        pool_write(buf + h.off_access, &meta.access);
+        pool_write(buf + h.off_communes, &meta.communes);
+        if (meta.arena_len) memcpy(buf + h.off_arena, meta.arena, meta.arena_len);
+        if (itinerance.arena_len) memcpy(buf + h.off_key_arena, itinerance.arena, itinerance.arena_len);
+
+        h.checksum = ds_hash_bytes(buf + sizeof h, (size_t)(h.file_size - sizeof h), DS_HASH_SEED);
+        memcpy(buf, &h, sizeof h);
+
+        FILE* f = fopen(out, "wb");
+        ok = f && fwrite(buf, 1, (size_t)h.file_size, f) == (size_t)h.file_size;
+        if (f && fclose(f) != 0) ok = 0;
+    }
+
+    free(buf);
+    free(keys);
+    si_clear(&idx);
+    sp_clear(&spatial);
+    sk_clear(&itinerance);
+    return ok ? (int)n : -1;
+}
+
+/* une section [off, off + len) doit tenir dans le fichier et être alignée */
+static int section_ok(const DatasetHeader* h, uint64_t off, uint64_t len) {
+    return off % 8 == 0 && off >= sizeof *h && off <= h->file_size && len <= h->file_size - off;
+}
+
+static int header_ok(const DatasetHeader* h, size_t size) {
+    if (size < sizeof *h || h->magic != DSET_MAGIC || h->version != DSET_VERSION) return 0;
+    if (h->file_size != size || h->n_operators == 0 || h->n_access == 0 || h->n_communes == 0) return 0;
+    if (h->arena_len == 0 || h->key_arena_len == 0) return 0;
+    return section_ok(h, h->off_ids, sizeof(int32_t) * (uint64_t)h->count)
+        && section_ok(h, h->off_recs, sizeof(DatasetRecord) * (uint64_t)h->count)
+        && section_ok(h, h->off_meta, sizeof(StationMetaRec) * (uint64_t)h->count)
+        && section_ok(h, h->off_by_power, sizeof(uint32_t) * (uint64_t)h->count)
+        && section_ok(h, h->off_operators, sizeof(uint32_t) * (uint64_t)h->n_operators)
+        && section_ok(h, h->off_access, sizeof(uint32_t) * (uint64_t)h->n_access)
+        && section_ok(h, h->off_communes, sizeof(uint32_t) * (uint64_t)h->n_communes)
+        && section_ok(h, h->off_arena, h->arena_len)
+        && section_ok(h, h->off_keys, sizeof(DatasetKey) * (uint64_t)h->count)
+        && section_ok(h, h->off_key_arena, h->key_arena_len);
+}
+
+int dset_open(const char* path, StationDataset* ds, int flags) {
+    memset(ds, 0, sizeof *ds);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DatasetHeader)) { close(fd); return 0; }
+    size_t size = (size_t)st.st_size;
+    // projection privée : les mises à jour d'occupation restent en mémoire
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+
+    const DatasetHeader* h = (const DatasetHeader*)base;
+    const char* b = (const char*)base;
+    int ok = header_ok(h, size);
+    if (ok && (flags & DSET_OPEN_VERIFY))
+        ok = ds_hash_bytes(b + sizeof *h, size - sizeof *h, DS_HASH_SEED) == h->checksum;
+    if (!ok) { munmap(base, size); return 0; }
+
+    ds->base      = base;
+    ds->size      = size;
+    ds->hdr       = h;
+    ds->ids       = (const int32_t*)(b + h->off_ids);
+    ds->recs      = (DatasetRecord*)((char*)base + h->off_recs);
+    ds->meta      = (const StationMetaRec*)(b + h->off_meta);
+    ds->by_power  = (const uint32_t*)(b + h->off_by_power);
+    ds->operators = (const uint32_t*)(b + h->off_operators);
+    ds->access    = (const uint32_t*)(b + h->off_access);
+    ds->communes  = (const uint32_t*)(b + h->off_communes);
+    ds->arena     = b + h->off_arena;
+    ds->keys      = (const DatasetKey*)(b + h->off_keys);
+    ds->key_arena = b + h->off_key_arena;
+    return 1;
+}
+
+DatasetRecord* dset_find(const StationDataset* ds, int station_id) {
+    if (!ds || !ds->hdr || ds->hdr->count == 0) return NULL;
+    // borne inférieure sans branche dans la boucle
+    const int32_t* base = ds->ids;
+    uint32_t len = ds->hdr->count;
+    while (len > 1) {
+        uint32_t half = len / 2;
+        base = (base[half - 1] < station_id) ? base + half : base;
+        len -= half;
+    }
+    if (*base != station_id) return NULL;
+    return &ds->recs[base - ds->ids];
+}
+
+/* chaîne d'arène bornée au contenu réel */
+static const char* arena_str(const StationDataset* ds, uint32_t off) {
+    return off < ds->hdr->arena_len ? ds->arena + off : "";
+}
+
+static const char* pool_lookup(const StationDataset* ds, const uint32_t* offs, uint32_t n, uint32_t id) {
+    return id < n ? arena_str(ds, offs[id]) : "";
+}
+
+void dset_meta(const StationDataset* ds, uint32_t i, StationMetaView* out) {
+    const StationMetaRec* m = &ds->meta[i];
+    out->operator_name = pool_lookup(ds, ds->operators, ds->hdr->n_operators, m->operator_id);
+    out->access        = pool_lookup(ds, ds->access, ds->hdr->n_access, m->access_id);
+    out->insee         = pool_lookup(ds, ds->communes, ds->hdr->n_communes, m->commune_id);
+    out->name          = arena_str(ds, m->name_off);
+    out->address       = arena_str(ds, m->address_off);
+    out->commune_id    = m->commune_id;
+}
+
+static MetaText text_of(const char* s) {
+    MetaText t = { s, (int)strlen(s) };
+    return t;
+}
+
+const char* dset_key(const StationDataset* ds, uint32_t i, int* len) {
+    const DatasetKey* k = &ds->keys[i];
+    // bornée au contenu réel : la chaîne et son '\0' dans l'arène
+    if (k->len == 0 || k->len > INT_MAX || (uint64_t)k->off + k->len >= ds->hdr->key_arena_len ||
+        ds->key_arena[k->off + k->len] != '\0')
+        return NULL;
+    *len = (int)k->len;
+    return ds->key_arena + k->off;
+}
+
+/* réenregistre les identifiants d'itinérance : chacun doit retrouver son identifiant de station */
+static int restore_keys(const StationDataset* ds, StationKeys* keys) {
+    for (uint32_t i = 0; i < ds->hdr->count; i++) {
+        int len;
+        const char* s = dset_key(ds, i, &len);
+        if (s && sk_add(keys, s, len, ds->ids[i]) != ds->ids[i]) return 0;
+    }
+    return 1;
+}
+
+/* magasin de métadonnées repris tel quel du fichier : arène lue dans la projection */
+static int adopt_meta(const StationDataset* ds, StationMeta* meta) {
+    const DatasetHeader* h = ds->hdr;
+    if (h->count > INT_MAX || h->n_operators > INT_MAX || h->n_access > INT_MAX || h->n_communes > INT_MAX) return 0;
+    StationMetaImage img = { ds->arena, (size_t)h->arena_len, ds->meta, (int)h->count,
+                             { ds->operators, ds->access, ds->communes },
+                             { (int)h->n_operators, (int)h->n_access, (int)h->n_communes } };
+    return sm_adopt(meta, &img);
+}
+
+int dset_to_index(const StationDataset* ds, StationIndex* idx) {
+    if (!ds || !ds->hdr || !idx) return 0;
+    uint32_t n = ds->hdr->count;
+    if (idx->keys && !restore_keys(ds, idx->keys)) return -1;
+    // index vide : arbre construit d'un bloc depuis ids[] trié, métadonnées reprises sans recopie
+    StationNode* nodes = NULL;
+    int bulk = !idx->root && !idx->base && n <= INT_MAX && (!idx->meta || (idx->meta->count == 0 && adopt_meta(ds, idx->meta)));
+    if (bulk && !si_build_sorted(idx, ds->ids, (int)n, &nodes)) {
+        if (idx->meta) sm_clear(idx->meta);
+        bulk = 0;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        StationMetaView v;
+        if ((idx->meta && !bulk) || idx->geo) dset_meta(ds, i, &v);
+        if (idx->geo)
+            geo_add(idx->geo, ds->recs[i].station_id, v.insee, (int)strlen(v.insee), ds->recs[i].nbre_pdc,
+                    &ds->recs[i].info);
+        if (bulk) nodes[i].info = ds->recs[i].info;
+        else si_add(idx, ds->recs[i].station_id, ds->recs[i].info);
+        if (idx->spatial) sp_set(idx->spatial, ds->recs[i].station_id, ds->recs[i].lat_e6, ds->recs[i].lon_e6);
+        if (idx->meta && !bulk) {
+            StationMetaInput in = { text_of(v.operator_name), text_of(v.name), text_of(v.address),
+                                    text_of(v.insee), text_of(v.access) };
+            if (!sm_set(idx->meta, ds->recs[i].station_id, &in)) return -1;
+        }
+    }
+    return (int)ds->hdr->count;
+}
+
+void dset_close(StationDataset* ds) {
+    if (!ds) return;
+    if (ds->base) munmap(ds->base, ds->size);
+    memset(ds, 0, sizeof *ds);
+}
@@ -0,0 +1,132 @@
+#ifndef DS_DATASET_H
+#define DS_DATASET_H
+#include <stddef.h>
+#include <stdint.h>
+#include "station_index.h"
+#include "station_meta.h"
+
+/**
+ * @brief Jeu de stations précompilé (.ccds), ouvert par mmap sans parsing.
+ *
+ * Disposition du fichier (entiers natifs, sections alignées sur 8 octets) :
+ *   en-tête | ids[n] triés | enregistrements[n] | méta[n] | by_power[n]
+ *           | offsets opérateurs | offsets accès | offsets communes | arène texte
+ *           | clés[n] | arène des identifiants d'itinérance
+ * L'empreinte couvre tout ce qui suit l'en-tête.
+ *
+ * Les identifiants de station attribués par le registre d'itinérance
+ * (station_key.h) à la compilation sont gardés avec leur chaîne d'origine :
+ * dset_to_index les réenregistre dans le registre attaché à l'index.
+ */
+
+#define DSET_MAGIC   0x53444343u /* "CCDS" */
+#define DSET_VERSION 3u /* 2 : positions dans les enregistrements ; 3 : identifiants d'itinérance */
+
+typedef struct DatasetHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;          /* nombre de stations */
+    uint32_t n_operators, n_access, n_communes;
+    uint64_t off_ids, off_recs, off_meta, off_by_power;
+    uint64_t off_operators, off_access, off_communes;
+    uint64_t off_arena, arena_len;
+    uint64_t off_keys, off_key_arena, key_arena_len;
+    uint64_t file_size;
+    uint64_t checksum;
+} DatasetHeader;
+
+/* enregistrement chaud, modifiable en place (projection privée) */
+typedef struct DatasetRecord {
+    int station_id;
+    int nbre_pdc;
+    StationInfo info;
+    int lat_e6, lon_e6;  /* microdegrés, SP_NO_POS si absents */
+} DatasetRecord;
+
+/* identifiant d'itinérance d'un enregistrement, dans l'arène des identifiants */
+typedef struct DatasetKey {
+    uint32_t off;
+    uint32_t len;        /* 0 : aucun (jeu compilé sans identifiant) */
+} DatasetKey;
+
+typedef struct StationDataset {
+    void* base;
+    size_t size;
+    const DatasetHeader* hdr;
+    const int32_t* ids;            /* identifiants triés, pour la recherche */
+    DatasetRecord* recs;           /* même ordre que ids */
+    const StationMetaRec* meta;    /* même ordre que ids */
+    const uint32_t* by_power;      /* indices triés par puissance décroissante */
+    const uint32_t* operators;     /* id interné -> offset dans l'arène */
+    const uint32_t* access;
+    const uint32_t* communes;
+    const char* arena;
+    const DatasetKey* keys;        /* même ordre que ids */
+    const char* key_arena;
+} StationDataset;
+
+#define DSET_OPEN_VERIFY 1 /* recalcule l'empreinte à l'ouverture */
+
+/**
+ * Compile un export IRVE (CSV, ou JSON si le chemin finit par .json) en fichier .ccds.
+ *
+ * @param in Chemin de l'export source.
+ * @param out Chemin du fichier binaire à écrire.
+ * @return Nombre de stations écrites, -1 en cas d'erreur.
+ */
+int dset_compile(const char* in, const char* out);
+
+/**
+ * Projette un fichier .ccds en mémoire. Aucune allocation par station :
+ * les tableaux pointent directement dans la projection. Les enregistrements
+ * sont modifiables (copie à l'écriture), le fichier n'est jamais modifié.
+ *
+ * @param path Chemin du fichier .ccds.
+ * @param ds Jeu à initialiser.
+ * @param flags 0 ou DSET_OPEN_VERIFY.
+ * @return 1 si succès, 0 si le fichier est absent, tronqué, d'une autre version
+ *         ou corrompu.
+ */
+int dset_open(const char* path, StationDataset* ds, int flags);
+
+/**
+ * Recherche dichotomique d'une station.
+ *
+ * @return Enregistrement trouvé, ou NULL.
+ */
+DatasetRecord* dset_find(const StationDataset* ds, int station_id);   /* O(log n) */
+
+/**
+ * Métadonnées de l'enregistrement d'indice i (ordre des identifiants).
+ */
+void dset_meta(const StationDataset* ds, uint32_t i, StationMetaView* out); /* O(1) */
+
+/**
+ * Identifiant d'itinérance de l'enregistrement d'indice i.
+ *
+ * @param len Reçoit sa longueur.
+ * @return Chaîne terminée par '\0', NULL si l'enregistrement n'en a pas.
+ */
+const char* dset_key(const StationDataset* ds, uint32_t i, int* len);  /* O(1) */
+
+/**
+ * Copie le jeu dans un StationIndex classique (et son magasin de métadonnées
+ * s'il est attaché), pour les modules qui travaillent sur l'AVL.
+ *
+ * Dans un index vide, l'arbre est construit d'un bloc depuis ids[] (O(n)) et
+ * le magasin de métadonnées vide reprend celui du fichier sans recopier son
+ * texte (sm_adopt) : ds doit alors rester ouvert tant que le magasin sert,
+ * jusqu'au premier sm_set ou à sm_clear. Sinon, les stations sont ajoutées
+ * une à une.
+ *
+ * Avec un registre d'itinérance attaché (idx->keys), chaque identifiant du
+ * fichier y est réenregistré sous le même identifiant de station.
+ *
+ * @return Nombre de stations insérées, -1 si les métadonnées n'ont pu être
+ *         copiées ou si le registre attribue un autre identifiant qu'à la compilation.
+ */
+int dset_to_index(const StationDataset* ds, StationIndex* idx);       /* O(n) dans un index vide, sinon O(n log n) */
+
+void dset_close(StationDataset* ds);
+
+#endif
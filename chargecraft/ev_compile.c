@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include "dataset.h"
+
+/**
+ * @brief Compile un export IRVE (CSV ou JSON) en jeu binaire .ccds.
+ *
+ * Usage : ./ev_compile <entrée.csv|entrée.json> <sortie.ccds>
+ */
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage : %s <entrée.csv|entrée.json> <sortie.ccds>\n", argv[0]);
+        return 2;
+    }
+    int n = dset_compile(argv[1], argv[2]);
+    if (n < 0) {
+        fprintf(stderr, "[COMPILE] échec : %s -> %s\n", argv[1], argv[2]);
+        return 1;
+    }
+
+    StationDataset ds;
+    if (!dset_open(argv[2], &ds, DSET_OPEN_VERIFY)) {
+        fprintf(stderr, "[COMPILE] %s illisible après écriture\n", argv[2]);
+        return 1;
+    }
+    printf("[COMPILE] %s -> %s : %d stations, %zu octets (format v%u)\n",
+           argv[1], argv[2], n, ds.size, ds.hdr->version);
+    dset_close(&ds);
+    return 0;
+}
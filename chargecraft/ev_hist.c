@@ -0,0 +1,113 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "history.h"
+
+/**
+ * @brief Lecture d'un historique d'occupation (voir history.h).
+ *
+ * Usage : ./ev_hist <fichier> [id] [options]
+ *   sans id           statistiques du fichier et stations les plus échantillonnées
+ *   --from T          début de l'intervalle (défaut : tout)
+ *   --to T            fin de l'intervalle, incluse
+ *   --step S          min / moyenne / max par intervalle de S secondes au lieu des échantillons
+ */
+
+#define HIST_TOP 10
+
+static long long series_samples(const HsSeries* s) {
+    long long n = s->head_count;
+    for (int b = 0; b < s->n_blocks; b++) n += s->blocks[b].count;
+    return n;
+}
+
+static void print_summary(HistStore* h) {
+    const HsSeries* top[HIST_TOP];
+    int n_top = 0;
+    for (int i = 0; i < h->cap; i++) {
+        const HsSeries* s = &h->series[i];
+        if (s->station_id == HS_EMPTY) continue;
+        // insertion dans les HIST_TOP plus grandes séries
+        int k = n_top < HIST_TOP ? n_top++ : HIST_TOP;
+        while (k > 0 && series_samples(top[k - 1]) < series_samples(s)) {
+            if (k < HIST_TOP) top[k] = top[k - 1];
+            k--;
+        }
+        if (k < HIST_TOP) top[k] = s;
+    }
+    long long samples = 0, blocks = 0;
+    for (int i = 0; i < h->cap; i++) {
+        if (h->series[i].station_id == HS_EMPTY) continue;
+        samples += series_samples(&h->series[i]);
+        blocks += h->series[i].n_blocks;
+    }
+    printf("[HIST] %d stations, %lld échantillons en %lld blocs, %llu octets (%.2f octets par échantillon)\n",
+           h->count, samples, blocks, (unsigned long long)h->file_end,
+           samples ? (double)h->file_end / samples : 0.0);
+    for (int k = 0; k < n_top; k++) {
+        const HsSeries* s = top[k];
+        int t_first = s->n_blocks ? s->blocks[0].t_first : s->head[0].ts;
+        printf("  station %-10d %8lld échantillons, %d -> %d\n", s->station_id, series_samples(s), t_first, s->last_ts);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage : %s <fichier> [id] [--from T] [--to T] [--step S]\n", argv[0]);
+        return 2;
+    }
+    const char* path = argv[1];
+    int has_id = 0, id = 0;
+    long from = INT_MIN, to = INT_MAX, step = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] != '-' || (a[1] >= '0' && a[1] <= '9')) {
+            if (has_id) { fprintf(stderr, "[HIST] argument en trop : %s\n", a); return 2; }
+            has_id = 1;
+            id = atoi(a);
+            continue;
+        }
+        if (i + 1 >= argc) { fprintf(stderr, "[HIST] valeur manquante pour %s\n", a); return 2; }
+        long v = strtol(argv[++i], NULL, 10);
+        if (strcmp(a, "--from") == 0) from = v;
+        else if (strcmp(a, "--to") == 0) to = v;
+        else if (strcmp(a, "--step") == 0) step = v;
+        else { fprintf(stderr, "[HIST] option inconnue : %s\n", a); return 2; }
+    }
+    if (from > to || step < 0 || (step > 0 && (from == INT_MIN || to == INT_MAX))) {
+        fprintf(stderr, "[HIST] intervalle invalide (--step demande --from et --to)\n");
+        return 2;
+    }
+
+    // hs_open crée le fichier s'il manque : ici on ne fait que lire
+    if (access(path, R_OK) != 0) { fprintf(stderr, "[HIST] %s introuvable\n", path); return 1; }
+    HistStore h;
+    if (!hs_open(&h, path, 0)) { fprintf(stderr, "[HIST] %s illisible\n", path); return 1; }
+
+    int rc = 0;
+    if (!has_id) {
+        print_summary(&h);
+    } else if (step > 0) {
+        long n = (to - from) / step + 1;
+        HsBucket* bk = (HsBucket*)malloc(sizeof(HsBucket) * (size_t)n);
+        int nb = bk ? hs_downsample(&h, id, (int)from, (int)to, (int)step, bk, (int)n) : -1;
+        if (nb < 0) { fprintf(stderr, "[HIST] lecture impossible (bloc corrompu ou mémoire)\n"); rc = 1; }
+        for (int k = 0; k < nb; k++) {
+            if (bk[k].count) printf("%d\t%d\t%d\t%.2f\t%d\n", bk[k].start, bk[k].count, bk[k].min, bk[k].avg, bk[k].max);
+            else printf("%d\t0\t-\t-\t-\n", bk[k].start);
+        }
+        free(bk);
+    } else {
+        int total = hs_range(&h, id, (int)from, (int)to, NULL, 0);
+        HsSample* out = total > 0 ? (HsSample*)malloc(sizeof(HsSample) * (size_t)total) : NULL;
+        if (total > 0 && out) total = hs_range(&h, id, (int)from, (int)to, out, total);
+        if (total < 0 || (total > 0 && !out)) { fprintf(stderr, "[HIST] lecture impossible (bloc corrompu ou mémoire)\n"); rc = 1; }
+        for (int k = 0; rc == 0 && k < total; k++) printf("%d\t%d\n", out[k].ts, out[k].slots_free);
+        free(out);
+    }
+    hs_close(&h);
+    return rc;
+}
@@ -0,0 +1,412 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "events.h"
+#include "station_index.h"
+#include "query_cache.h"
+#include "proto.h"
+
+/**
+ * @brief Générateur de charge pour ev_server : débit et latences.
+ *
+ * Usage : ./ev_load [options]
+ *   --connect A       adresse du serveur, comme ev_server --listen (défaut unix:chargecraft.sock)
+ *   --conns C         connexions (défaut 4)
+ *   --depth D         requêtes en vol par connexion (pipelining, défaut 16)
+ *   --duration S      secondes d'envoi (défaut 5)
+ *   --mix L:E:T       proportions consultation:événement:top-N (défaut 80:15:5)
+ *   --ids A:B         identifiants de station tirés dans [A, B] (défaut 1000:100999)
+ *   --keys F          stations désignées par leur identifiant d'itinérance, formé
+ *                     de F et du numéro tiré (ex. FRIZI_%d) : P_LOOKUP_KEY, P_EVENT_KEY
+ *   --vehicles N      véhicules 0..N-1 (défaut 100000)
+ *   --rule R          règle des requêtes top-N (défaut "power >= 50 && slots >= 1")
+ *   --top N           taille des top-N (défaut 10)
+ *   --seed S          graine (défaut 42)
+ *
+ * Chaque connexion garde D requêtes en vol ; la latence d'une requête va de
+ * son écriture dans le tampon d'envoi à la lecture de sa réponse. Un véhicule
+ * branché se débranche à sa requête suivante, de sorte que les créneaux libres
+ * restent stables sur la durée du test.
+ */
+
+typedef struct LoadConn {
+    int fd;
+    char* out; size_t out_off, out_len, out_cap;
+    char* in; size_t in_len, in_cap;
+    double* sent_ns;            /* file circulaire des requêtes en vol : instant d'envoi */
+    unsigned char* sent_type;
+    int* sent_vehicle;          /* branchement en vol : véhicule et station, -1 sinon */
+    int* sent_station;
+    int head, inflight;
+    uint32_t next_tag, expect_tag;
+    int dead;
+} LoadConn;
+
+typedef struct LoadStats {
+    float* lat_us[P_EVENT_KEY + 1];     /* latences par type de requête */
+    long long n[P_EVENT_KEY + 1], cap[P_EVENT_KEY + 1];
+    long long status[4];
+    long long mismatched;           /* réponse hors d'ordre ou de type inattendu */
+} LoadStats;
+
+typedef struct LoadConfig {
+    int conns, depth;
+    double duration_s;
+    int mix[3];
+    int id_lo, id_hi;
+    const char* keys;           /* format de l'identifiant d'itinérance, NULL : identifiants entiers */
+    int vehicles;
+    const char* rule;
+    int top;
+    unsigned seed;
+} LoadConfig;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* xorshift32, comme la suite de bench */
+static unsigned rnd(unsigned* s) {
+    unsigned x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+static int connect_addr(const char* addr) {
+    int fd;
+    if (strncmp(addr, "unix:", 5) == 0 || strchr(addr, '/')) {
+        const char* path = strncmp(addr, "unix:", 5) == 0 ? addr + 5 : addr;
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof sa.sun_path) return -1;
+        strcpy(sa.sun_path, path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&sa, sizeof sa) != 0) { close(fd); fd = -1; }
+    } else {
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons((uint16_t)atoi(addr));
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&sa, sizeof sa) != 0) { close(fd); fd = -1; }
+        int one = 1;
+        if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    }
+    return fd;
+}
+
+static int reserve(char** buf, size_t* cap, size_t need) {
+    if (need <= *cap) return 1;
+    size_t c = *cap ? *cap : 4096;
+    while (c < need) c *= 2;
+    char* b = (char*)realloc(*buf, c);
+    if (!b) return 0;
+    *buf = b;
+    *cap = c;
+    return 1;
+}
+
+static void push_request(LoadConn* c, int type, const void* body, size_t len, int depth, int vehicle, int station) {
+    if (c->out_off == c->out_len) c->out_off = c->out_len = 0;
+    if (!reserve(&c->out, &c->out_cap, c->out_len + PROTO_HEADER + len)) { c->dead = 1; return; }
+    c->out_len += proto_put_header(c->out + c->out_len, (uint32_t)len, type, 0, c->next_tag++);
+    memcpy(c->out + c->out_len, body, len);
+    c->out_len += len;
+    int slot = (c->head + c->inflight) % depth;
+    c->sent_ns[slot] = now_ns();
+    c->sent_type[slot] = (unsigned char)type;
+    c->sent_vehicle[slot] = vehicle;
+    c->sent_station[slot] = station;
+    c->inflight++;
+}
+
+static void next_request(LoadConn* c, const LoadConfig* cfg, unsigned* seed, int* plugged, char* topn, size_t topn_len) {
+    unsigned r = rnd(seed) % (unsigned)(cfg->mix[0] + cfg->mix[1] + cfg->mix[2]);
+    int id = cfg->id_lo + (int)(rnd(seed) % (unsigned)(cfg->id_hi - cfg->id_lo + 1));
+    // avec --keys : mêmes stations, désignées par leur chaîne après trois int32 éventuels (ts, véhicule, action)
+    char key[3 * sizeof(int32_t) + PROTO_MAX_KEY + 1];
+    if (r < (unsigned)cfg->mix[0]) {
+        if (cfg->keys) {
+            int len = snprintf(key, PROTO_MAX_KEY + 1, cfg->keys, id);
+            push_request(c, P_LOOKUP_KEY, key, (size_t)len, cfg->depth, -1, -1);
+        } else {
+            push_request(c, P_LOOKUP, &id, sizeof id, cfg->depth, -1, -1);
+        }
+    } else if (r < (unsigned)(cfg->mix[0] + cfg->mix[1])) {
+        int v = (int)(rnd(seed) % (unsigned)cfg->vehicles);
+        Event e = { (int)time(NULL), v, plugged[v] >= 0 ? plugged[v] : id, plugged[v] >= 0 ? 0 : 1 };
+        plugged[v] = plugged[v] >= 0 ? -1 : id;
+        if (cfg->keys) {
+            int32_t f[3] = { e.ts, e.vehicle_id, e.action };
+            memcpy(key, f, sizeof f);
+            int len = snprintf(key + sizeof f, PROTO_MAX_KEY + 1, cfg->keys, e.station_id);
+            push_request(c, P_EVENT_KEY, key, sizeof f + (size_t)len, cfg->depth, e.action ? v : -1, id);
+        } else {
+            push_request(c, P_EVENT, &e, sizeof e, cfg->depth, e.action ? v : -1, id);
+        }
+    } else {
+        push_request(c, P_TOPN, topn, topn_len, cfg->depth, -1, -1);
+    }
+}
+
+static void record(LoadStats* st, int type, double us) {
+    if (st->n[type] == st->cap[type]) {
+        long long cap = st->cap[type] ? 2 * st->cap[type] : 1 << 16;
+        float* a = (float*)realloc(st->lat_us[type], sizeof(float) * (size_t)cap);
+        if (!a) return;
+        st->lat_us[type] = a;
+        st->cap[type] = cap;
+    }
+    st->lat_us[type][st->n[type]++] = (float)us;
+}
+
+/* réponses complètes reçues sur c */
+static void read_responses(LoadConn* c, LoadStats* st, int depth, int* plugged) {
+    for (;;) {
+        if (!reserve(&c->in, &c->in_cap, c->in_len + 65536)) { c->dead = 1; return; }
+        ssize_t n = read(c->fd, c->in + c->in_len, 65536);
+        if (n > 0) { c->in_len += (size_t)n; continue; }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) c->dead = 1;
+        break;
+    }
+    double now = now_ns();
+    size_t off = 0;
+    ProtoHeader h;
+    int r;
+    while ((r = proto_get_header(c->in + off, c->in_len - off, &h)) > 0) {
+        off += PROTO_HEADER + h.len;
+        if (c->inflight == 0 || h.tag != c->expect_tag || h.type != c->sent_type[c->head]) {
+            st->mismatched++;
+            c->dead = 1;
+            break;
+        }
+        record(st, h.type, (now - c->sent_ns[c->head]) / 1e3);
+        if (h.status < 4) st->status[h.status]++;
+        // branchement refusé : le véhicule n'est pas branché
+        int v = c->sent_vehicle[c->head];
+        if (h.status != P_OK && v >= 0 && plugged[v] == c->sent_station[c->head]) plugged[v] = -1;
+        c->expect_tag++;
+        c->head = (c->head + 1) % depth;
+        c->inflight--;
+    }
+    if (r < 0) c->dead = 1;
+    memmove(c->in, c->in + off, c->in_len - off);
+    c->in_len -= off;
+}
+
+static void flush_requests(LoadConn* c) {
+    while (!c->dead && c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n > 0) c->out_off += (size_t)n;
+        else if (n < 0 && errno == EINTR) continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        else c->dead = 1;
+    }
+}
+
+static int cmp_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/* rang le plus proche sur un tableau trié, comme la suite de bench */
+static double quantile(const float* v, long long n, int permille) {
+    long long rank = (permille * n + 999) / 1000;
+    return v[rank > 0 ? rank - 1 : 0];
+}
+
+static void print_latency(const char* name, float* v, long long n, double elapsed) {
+    if (n == 0) return;
+    qsort(v, (size_t)n, sizeof(float), cmp_float);
+    printf("[LOAD] %-8s %10lld req  %10.0f req/s  p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  p99.9 %8.1f us  max %8.1f us\n",
+           name, n, n / elapsed, quantile(v, n, 500), quantile(v, n, 900), quantile(v, n, 990), quantile(v, n, 999),
+           (double)v[n - 1]);
+}
+
+/* requête P_STATS bloquante sur une nouvelle connexion */
+static int fetch_stats(const char* addr, ProtoStats* out) {
+    int fd = connect_addr(addr);
+    if (fd < 0) return 0;
+    char buf[PROTO_HEADER + sizeof(ProtoStats)];
+    proto_put_header(buf, 0, P_STATS, 0, 0);
+    size_t got = 0;
+    int ok = write(fd, buf, PROTO_HEADER) == PROTO_HEADER;
+    while (ok && got < sizeof buf) {
+        ssize_t n = read(fd, buf + got, sizeof buf - got);
+        if (n <= 0) ok = 0;
+        else got += (size_t)n;
+    }
+    close(fd);
+    ProtoHeader h;
+    if (!ok || proto_get_header(buf, got, &h) <= 0 || h.status != P_OK || h.len != sizeof(ProtoStats)) return 0;
+    memcpy(out, buf + PROTO_HEADER, sizeof *out);
+    return 1;
+}
+
+/* format de --keys : un seul %d, aucune autre conversion, chaîne d'au plus PROTO_MAX_KEY octets */
+static int key_format_ok(const char* f) {
+    const char* d = strstr(f, "%d");
+    return d && strchr(f, '%') == d && !strchr(d + 2, '%') && strlen(f) + 9 <= PROTO_MAX_KEY;
+}
+
+int main(int argc, char** argv) {
+    LoadConfig cfg = { 4, 16, 5.0, {80, 15, 5}, 1000, 100999, NULL, 100000, "power >= 50 && slots >= 1", 10, 42 };
+    const char* addr = "unix:chargecraft.sock";
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!v) { fprintf(stderr, "option %s : valeur manquante\n", a); return 2; }
+        i++;
+        if (strcmp(a, "--connect") == 0) addr = v;
+        else if (strcmp(a, "--conns") == 0) cfg.conns = atoi(v);
+        else if (strcmp(a, "--depth") == 0) cfg.depth = atoi(v);
+        else if (strcmp(a, "--duration") == 0) cfg.duration_s = atof(v);
+        else if (strcmp(a, "--mix") == 0) {
+            if (sscanf(v, "%d:%d:%d", &cfg.mix[0], &cfg.mix[1], &cfg.mix[2]) != 3) cfg.mix[0] = -1;
+        }
+        else if (strcmp(a, "--ids") == 0) {
+            if (sscanf(v, "%d:%d", &cfg.id_lo, &cfg.id_hi) != 2) cfg.id_hi = cfg.id_lo - 1;
+        }
+        else if (strcmp(a, "--keys") == 0) cfg.keys = v;
+        else if (strcmp(a, "--vehicles") == 0) cfg.vehicles = atoi(v);
+        else if (strcmp(a, "--rule") == 0) cfg.rule = v;
+        else if (strcmp(a, "--top") == 0) cfg.top = atoi(v);
+        else if (strcmp(a, "--seed") == 0) cfg.seed = (unsigned)strtoul(v, NULL, 10);
+        else { fprintf(stderr, "option inconnue : %s\n", a); return 2; }
+    }
+    if (cfg.conns <= 0 || cfg.depth <= 0 || cfg.duration_s <= 0 || cfg.mix[0] < 0 || cfg.mix[1] < 0 ||
+        cfg.mix[2] < 0 || cfg.mix[0] + cfg.mix[1] + cfg.mix[2] == 0 || cfg.id_hi < cfg.id_lo ||
+        cfg.vehicles <= 0 || cfg.top <= 0 || cfg.top > PROTO_MAX_TOPN || cfg.seed == 0 ||
+        (cfg.keys && !key_format_ok(cfg.keys))) {
+        fprintf(stderr, "paramètres invalides\n");
+        return 2;
+    }
+
+    // corps de la requête top-N, identique pour toutes
+    size_t rule_len = strlen(cfg.rule), topn_len = 4 + rule_len;
+    char* topn = (char*)malloc(topn_len);
+    int* plugged = (int*)malloc(sizeof(int) * (size_t)cfg.vehicles);
+    LoadConn* conns = (LoadConn*)calloc((size_t)cfg.conns, sizeof(LoadConn));
+    int ep = epoll_create1(0);
+    if (!topn || !plugged || !conns || ep < 0) { fprintf(stderr, "[LOAD] échec d'allocation\n"); return 1; }
+    uint16_t top = (uint16_t)cfg.top;
+    topn[0] = QC_BY_SLOTS;
+    topn[1] = 0;
+    memcpy(topn + 2, &top, 2);
+    memcpy(topn + 4, cfg.rule, rule_len);
+    for (int v = 0; v < cfg.vehicles; v++) plugged[v] = -1;
+
+    for (int k = 0; k < cfg.conns; k++) {
+        LoadConn* c = &conns[k];
+        c->fd = connect_addr(addr);
+        c->sent_ns = (double*)malloc(sizeof(double) * (size_t)cfg.depth);
+        c->sent_type = (unsigned char*)malloc((size_t)cfg.depth);
+        c->sent_vehicle = (int*)malloc(sizeof(int) * (size_t)cfg.depth);
+        c->sent_station = (int*)malloc(sizeof(int) * (size_t)cfg.depth);
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (c->fd < 0 || !c->sent_ns || !c->sent_type || !c->sent_vehicle || !c->sent_station || fcntl(c->fd, F_SETFL, O_NONBLOCK) != 0 ||
+            epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev) != 0) {
+            fprintf(stderr, "[LOAD] connexion à %s impossible : %s\n", addr, strerror(errno));
+            return 1;
+        }
+    }
+
+    LoadStats st;
+    memset(&st, 0, sizeof st);
+    unsigned seed = cfg.seed;
+    double start = now_ns(), end_send = start + cfg.duration_s * 1e9, deadline = end_send + 5e9;
+    int live;
+    for (;;) {
+        double now = now_ns();
+        int sending = now < end_send;
+        int waiting = 0;
+        live = 0;
+        for (int k = 0; k < cfg.conns; k++) {
+            LoadConn* c = &conns[k];
+            if (c->dead) continue;
+            while (sending && c->inflight < cfg.depth && !c->dead) next_request(c, &cfg, &seed, plugged, topn, topn_len);
+            flush_requests(c);
+            if (c->dead) { epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL); continue; }
+            live++;
+            waiting += c->inflight;
+            struct epoll_event ev = { .events = EPOLLIN | (c->out_off < c->out_len ? EPOLLOUT : 0), .data.ptr = c };
+            epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+        }
+        if ((!sending && waiting == 0) || now > deadline || live == 0) break;
+        struct epoll_event evs[64];
+        int n = epoll_wait(ep, evs, 64, 100);
+        for (int i = 0; i < n; i++) {
+            LoadConn* c = (LoadConn*)evs[i].data.ptr;
+            if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) read_responses(c, &st, cfg.depth, plugged);
+            if (c->dead) epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+        }
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    static const char* NAMES[] = { "", "lookup", "event", "topn", "stats", "lookup-k", "event-k" };
+    long long total = 0, lost = 0;
+    for (int t = P_LOOKUP; t <= P_EVENT_KEY; t++) total += st.n[t];
+    int dead = 0;
+    for (int k = 0; k < cfg.conns; k++) {
+        lost += conns[k].inflight;
+        dead += conns[k].dead;
+    }
+    printf("[LOAD] %s, %d connexion(s) x %d en vol, %.2f s : %lld réponses, %.0f req/s\n", addr, cfg.conns, cfg.depth,
+           elapsed, total, total / elapsed);
+    // toutes les latences ensemble, puis par type
+    float* all = (float*)malloc(sizeof(float) * (size_t)(total ? total : 1));
+    if (all) {
+        long long at = 0;
+        for (int t = P_LOOKUP; t <= P_EVENT_KEY; t++) {
+            if (st.n[t]) memcpy(all + at, st.lat_us[t], sizeof(float) * (size_t)st.n[t]);
+            at += st.n[t];
+        }
+        print_latency("total", all, total, elapsed);
+        free(all);
+    }
+    for (int t = P_LOOKUP; t <= P_EVENT_KEY; t++) print_latency(NAMES[t], st.lat_us[t], st.n[t], elapsed);
+    printf("[LOAD] statuts : ok %lld, introuvable %lld, refusé %lld, invalide %lld", st.status[P_OK],
+           st.status[P_NOT_FOUND], st.status[P_REJECTED], st.status[P_INVALID]);
+    if (lost || st.mismatched || dead)
+        printf(" ; sans réponse %lld, hors d'ordre %lld, connexions perdues %d", lost, st.mismatched, dead);
+    printf("\n");
+    ProtoStats ps;
+    if (fetch_stats(addr, &ps))
+        printf("[LOAD] serveur : %lld stations, %lld requêtes en %lld lots (moyenne %.1f) | %lld appliqués, "
+               "%lld refusés, %lld débranchements sans connecteur\n", (long long)ps.stations,
+               (long long)ps.requests, (long long)ps.batches, ps.batches ? (double)ps.requests / ps.batches : 0.0,
+               (long long)ps.applied, (long long)ps.rejected, (long long)ps.stray);
+
+    for (int k = 0; k < cfg.conns; k++) {
+        if (conns[k].fd >= 0) close(conns[k].fd);
+        free(conns[k].out);
+        free(conns[k].in);
+        free(conns[k].sent_ns);
+        free(conns[k].sent_type);
+        free(conns[k].sent_vehicle);
+        free(conns[k].sent_station);
+    }
+    for (int t = P_LOOKUP; t <= P_EVENT_KEY; t++) free(st.lat_us[t]);
+    free(conns);
+    free(plugged);
+    free(topn);
+    close(ep);
+    return lost || st.mismatched || dead ? 1 : 0;
+}
@@ -0,0 +1,216 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "station_index.h"
+#include "csv_loader.h"
+#include "json_loader.h"
+#include "dataset.h"
+#include "pipeline.h"
+#include "query_cache.h"
+#include "rule_plan.h"
+#include "server.h"
+#include "pricing.h"
+#include "station_key.h"
+#include "pool.h"
+#include "wal.h"
+#include "connector.h"
+#include "metrics.h"
+
+#define SRV_MRU_CAPACITY 5
+
+/**
+ * @brief Service de consultation et d'ingestion d'événements (voir server.h).
+ *
+ * Usage : ./ev_server [options]
+ *   --listen A        "unix:chemin", chemin, ou port TCP sur 127.0.0.1 (défaut unix:chargecraft.sock)
+ *   --dataset F       stations : .csv, .json ou .ccds (sinon --stations)
+ *   --stations N      stations synthétiques 1000..1000+N-1 si pas de jeu (défaut 100000)
+ *   --vehicles N      historiques MRU pour les véhicules 0..N-1 (défaut 100000, 0 : aucun)
+ *   --cache N         entrées du cache top-N (défaut 64)
+ *   --pricing C       tarification dynamique : "default" ou courbe "occ%:mult%,..." (voir pricing.h)
+ *   --metrics F       vide les métriques dans F à l'arrêt (.json : JSON, sinon texte)
+ *   --threads N       recalculs top-N en parallèle sur N threads (défaut 1 : aucun pool, 0 : coeurs en ligne)
+ *   --wal F           journal des événements (voir wal.h) : reprise au démarrage depuis F.ckpt et
+ *                     la fin du journal, événements acquittés une fois durables, point de reprise à l'arrêt
+ *   --checkpoint-every N  point de reprise (et troncature du journal) tous les N événements (défaut 1000000, 0 : à l'arrêt seulement)
+ *
+ * SIGINT ou SIGTERM arrête le service proprement ; compilé avec make METRICS=1,
+ * SIGUSR1 vide les métriques sur la sortie d'erreur.
+ */
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_stop(int signo) {
+    (void)signo;
+    stop_requested = 1;
+}
+
+static int ends_with(const char* s, const char* suffix) {
+    size_t n = strlen(s), k = strlen(suffix);
+    return n >= k && strcmp(s + n - k, suffix) == 0;
+}
+
+/* même jeu que ev_sim : synthétique ou fichier */
+static int load_stations(StationIndex* idx, const char* path, int synthetic) {
+    if (!path) {
+        static const int powers[] = {7, 22, 50, 100, 150, 350};
+        unsigned seed = 2024;
+        for (int i = 0; i < synthetic; i++) {
+            seed = seed * 1103515245u + 12345u;
+            StationInfo in = { powers[(seed >> 8) % 6], 30 + (int)((seed >> 12) % 50), 1 + (int)((seed >> 4) % 8), 0 };
+            si_add(idx, 1000 + i, in);
+        }
+        return synthetic;
+    }
+    if (ends_with(path, ".ccds")) {
+        StationDataset ds;
+        if (!dset_open(path, &ds, 0)) return -1;
+        int n = dset_to_index(&ds, idx);
+        dset_close(&ds);
+        return n;
+    }
+    return ends_with(path, ".json") ? ds_load_stations_from_json(path, idx) : ds_load_stations_from_csv(path, idx);
+}
+
+int main(int argc, char** argv) {
+    const char* addr = "unix:chargecraft.sock";
+    const char* dataset = NULL;
+    const char* metrics_path = NULL;
+    const char* pricing = NULL;
+    const char* wal_path = NULL;
+    long long checkpoint_every = 1000000;
+    int synthetic = 100000, vehicles = 100000, cache_cap = 64, threads = 1;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!v) { fprintf(stderr, "option %s : valeur manquante\n", a); return 2; }
+        i++;
+        if (strcmp(a, "--listen") == 0) addr = v;
+        else if (strcmp(a, "--dataset") == 0) dataset = v;
+        else if (strcmp(a, "--stations") == 0) synthetic = atoi(v);
+        else if (strcmp(a, "--vehicles") == 0) vehicles = atoi(v);
+        else if (strcmp(a, "--cache") == 0) cache_cap = atoi(v);
+        else if (strcmp(a, "--pricing") == 0) pricing = v;
+        else if (strcmp(a, "--metrics") == 0) metrics_path = v;
+        else if (strcmp(a, "--threads") == 0) threads = atoi(v);
+        else if (strcmp(a, "--wal") == 0) wal_path = v;
+        else if (strcmp(a, "--checkpoint-every") == 0) checkpoint_every = atoll(v);
+        else { fprintf(stderr, "option inconnue : %s\n", a); return 2; }
+    }
+    if (synthetic <= 0 || vehicles < 0 || cache_cap <= 0 || threads < 0 || checkpoint_every < 0) { fprintf(stderr, "paramètres invalides\n"); return 2; }
+    PriceCurve curve;
+    if (pricing && strcmp(pricing, "default") == 0) pr_default_curve(&curve);
+    else if (pricing && !pr_parse_curve(pricing, &curve)) { fprintf(stderr, "courbe de prix invalide : %s\n", pricing); return 2; }
+
+    StationIndex idx;
+    si_init(&idx);
+    // identifiants d'itinérance complets : deux opérateurs ne se partagent plus une station
+    StationKeys keys;
+    sk_init(&keys);
+    idx.keys = &keys;
+    int n = load_stations(&idx, dataset, synthetic);
+    if (n <= 0) {
+        fprintf(stderr, "[SRV] aucune station chargée%s%s\n", dataset ? " depuis " : "", dataset ? dataset : "");
+        si_clear(&idx);
+        sk_clear(&keys);
+        return 1;
+    }
+    // table parfaite pour P_LOOKUP_KEY et P_EVENT_KEY
+    if (keys.count) {
+        if (!sk_build(&keys)) fprintf(stderr, "[SRV] table des identifiants non construite\n");
+        sk_print_stats(&keys);
+    }
+
+    SList* mru = vehicles ? (SList*)malloc(sizeof(SList) * (size_t)vehicles) : NULL;
+    for (int v = 0; mru && v < vehicles; v++) ds_slist_init(&mru[v]);
+    RuleIndexes ri;
+    ri_init(&ri);
+    QueryCache qc;
+    int cached = qc_init(&qc, &idx, &ri, cache_cap);
+    Pipeline pl;
+    pl_init(&pl, &idx, mru, mru ? vehicles : 0, SRV_MRU_CAPACITY);
+    // connecteurs et prix initiaux sur l'index tout juste chargé : capacités du jeu de stations
+    ConnStore conns;
+    cn_init(&conns);
+    int tracked = cn_attach(&conns, &idx) >= 0;
+    if (tracked) idx.conns = &conns;
+    PricingEngine pe;
+    int priced = pricing && pr_init(&pe, &curve, NULL, NULL) && pr_attach(&pe, &idx, 0) >= 0;
+    if (priced) pl.pricing = &pe;
+    // reprise avant le cache : pas de réparations inutiles
+    Wal wal;
+    char ckpt[4096];
+    int logged = 0, recovered = 1;
+    if (wal_path && tracked && (!vehicles || mru) && (!pricing || priced)) {
+        snprintf(ckpt, sizeof ckpt, "%s.ckpt", wal_path);
+        logged = wal_open(&wal, wal_path, WAL_GROUP_BYTES, WAL_GROUP_US);
+        long long replayed = logged ? wal_recover(&wal, ckpt, &pl) : -1;
+        if (replayed >= 0) {
+            pl.wal = &wal;
+            printf("[SRV] reprise : LSN %llu, %lld événements rejoués, %lld octets coupés\n",
+                   (unsigned long long)wal.durable_lsn, replayed, wal.stats.torn_bytes);
+        } else {
+            fprintf(stderr, "[SRV] reprise impossible depuis %s\n", wal_path);
+            recovered = 0;
+        }
+    }
+    if (cached) pl.cache = &qc;
+    // la boucle d'événements ne modifie pas l'index pendant un recalcul : les threads le lisent sans verrou
+    ThreadPool pool;
+    int pooled = cached && threads != 1 && tp_init(&pool, threads);
+    if (pooled) {
+        qc.pool = &pool;
+        printf("[SRV] recalculs top-N sur %d threads\n", pool.nthreads);
+    }
+
+    Server srv;
+    int ok = recovered && tracked && (!vehicles || mru) && cached && (!pricing || priced) && srv_open(&srv, addr, &pl, &qc);
+    if (ok) {
+        if (pl.wal) {
+            srv.checkpoint = ckpt;
+            srv.checkpoint_every = checkpoint_every;
+        }
+        struct sigaction sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sa_handler = on_stop;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGTERM, &sa, NULL);
+        metrics_on_signal(SIGUSR1, NULL);
+        printf("[SRV] %d stations, écoute sur %s\n", idx.size, addr);
+        fflush(stdout);
+        ok = srv_run(&srv, &stop_requested);
+        srv_print_stats(&srv);
+        qc_print_stats(&qc);
+        if (priced) pr_print_stats(&pe);
+        cn_print_stats(&conns);
+        srv_close(&srv);
+    } else if (!recovered) {
+        // rien n'a été servi : journal et point de reprise restent tels quels
+    } else if (!tracked || !cached || (vehicles && !mru) || (pricing && !priced)) {
+        fprintf(stderr, "[SRV] échec d'allocation\n");
+    }
+    if (pl.wal) {
+        // refusé si le journal a échoué : l'état en mémoire contient des événements non durables
+        if (!wal_checkpoint(&wal, ckpt, &pl)) ok = 0;
+        wal_print_stats(&wal);
+        if (!wal_close(&wal)) ok = 0;
+    } else if (logged) {
+        wal_close(&wal);
+    }
+    if (metrics_path && !metrics_dump_path(metrics_path))
+        fprintf(stderr, "[SRV] impossible d'écrire %s\n", metrics_path);
+
+    if (pricing) pr_clear(&pe);
+    cn_clear(&conns);
+    if (pooled) tp_destroy(&pool);
+    if (cached) qc_clear(&qc);
+    ri_clear(&ri);
+    for (int v = 0; mru && v < vehicles; v++) ds_slist_clear(&mru[v]);
+    free(mru);
+    si_clear(&idx);
+    sk_clear(&keys);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "station_index.h"
+#include "csv_loader.h"
+#include "json_loader.h"
+#include "dataset.h"
+#include "pipeline.h"
+#include "sim.h"
+#include "metrics.h"
+#include "pricing.h"
+#include "station_key.h"
+#include "history.h"
+#include "wal.h"
+#include "connector.h"
+
+#define SIM_MRU_CAPACITY 5
+
+/**
+ * @brief Simulation d'une flotte sur un jeu de stations (voir sim.h).
+ *
+ * Usage : ./ev_sim [options]
+ *   --vehicles N      véhicules (défaut 100000)
+ *   --dataset F       stations : .csv, .json ou .ccds (sinon --stations)
+ *   --stations N      stations synthétiques si pas de jeu (défaut 100000)
+ *   --seed S          graine (défaut 42)
+ *   --hours H         durée simulée (défaut 24)
+ *   --zipf S          exposant de popularité (défaut 1.0)
+ *   --sessions X      sessions par véhicule et par jour (défaut 1.0)
+ *   --session-min M   durée médiane d'une session en minutes (défaut 45)
+ *   --no-mru          sans historique MRU par véhicule
+ *   --pricing C       tarification dynamique : "default" ou courbe "occ%:mult%,..." (voir pricing.h)
+ *   --history F       ajoute l'occupation de chaque événement à l'historique F (voir history.h)
+ *   --wal F           journal des événements (voir wal.h) : l'état du point de reprise F.ckpt
+ *                     et la fin du journal sont repris au départ, un point de reprise est écrit à la fin
+ *   --metrics F       vide les métriques dans F à la fin (.json : JSON, sinon texte)
+ *
+ * Compilé avec make METRICS=1, SIGUSR1 vide les métriques sur la sortie d'erreur
+ * pendant la simulation.
+ */
+
+static int ends_with(const char* s, const char* suffix) {
+    size_t n = strlen(s), k = strlen(suffix);
+    return n >= k && strcmp(s + n - k, suffix) == 0;
+}
+
+static int load_stations(StationIndex* idx, const char* path, int synthetic) {
+    if (!path) {
+        // capacités de 1 à 8 points de charge, puissances variées
+        static const int powers[] = {7, 22, 50, 100, 150, 350};
+        unsigned seed = 2024;
+        for (int i = 0; i < synthetic; i++) {
+            seed = seed * 1103515245u + 12345u;
+            StationInfo in = { powers[(seed >> 8) % 6], 30 + (int)((seed >> 12) % 50), 1 + (int)((seed >> 4) % 8), 0 };
+            si_add(idx, 1000 + i, in);
+        }
+        return synthetic;
+    }
+    if (ends_with(path, ".ccds")) {
+        StationDataset ds;
+        if (!dset_open(path, &ds, 0)) return -1;
+        int n = dset_to_index(&ds, idx);
+        dset_close(&ds);
+        return n;
+    }
+    return ends_with(path, ".json") ? ds_load_stations_from_json(path, idx) : ds_load_stations_from_csv(path, idx);
+}
+
+/* profil horaire de la station la plus échantillonnée, relu depuis l'historique */
+static void history_report(HistStore* h, const SimConfig* cfg) {
+    const HsSeries* top = NULL;
+    long long top_n = 0;
+    for (int i = 0; i < h->cap; i++) {
+        const HsSeries* s = &h->series[i];
+        if (s->station_id == HS_EMPTY) continue;
+        long long n = s->head_count;
+        for (int b = 0; b < s->n_blocks; b++) n += s->blocks[b].count;
+        if (n > top_n) { top = s; top_n = n; }
+    }
+    if (!top) return;
+    HsBucket bk[24];
+    int step = cfg->duration_s / 24 > 0 ? cfg->duration_s / 24 : 1;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int nb = hs_downsample(h, top->station_id, cfg->start_ts, cfg->start_ts + 24 * step - 1, step, bk, 24);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (nb < 0) { printf("[HIST] historique illisible\n"); return; }
+    printf("[HIST] station %d (%lld échantillons), créneaux libres moyens par tranche de %d min (%.0f us) :",
+           top->station_id, top_n, step / 60, (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3);
+    for (int k = 0; k < nb; k++) {
+        if (bk[k].count) printf(" %.1f", bk[k].avg);
+        else printf(" -");
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    SimConfig cfg;
+    sim_default_config(&cfg, 100000);
+    const char* dataset = NULL;
+    const char* metrics_path = NULL;
+    const char* pricing = NULL;
+    const char* history = NULL;
+    const char* wal_path = NULL;
+    int synthetic = 100000, use_mru = 1;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--no-mru") == 0) { use_mru = 0; continue; }
+        if (!v) { fprintf(stderr, "option %s : valeur manquante\n", a); return 2; }
+        i++;
+        if (strcmp(a, "--vehicles") == 0) cfg.vehicles = atoi(v);
+        else if (strcmp(a, "--dataset") == 0) dataset = v;
+        else if (strcmp(a, "--stations") == 0) synthetic = atoi(v);
+        else if (strcmp(a, "--seed") == 0) cfg.seed = strtoull(v, NULL, 10);
+        else if (strcmp(a, "--hours") == 0) cfg.duration_s = (int)(atof(v) * 3600);
+        else if (strcmp(a, "--zipf") == 0) cfg.zipf_s = atof(v);
+        else if (strcmp(a, "--sessions") == 0) cfg.sessions_per_day = atof(v);
+        else if (strcmp(a, "--session-min") == 0) cfg.session_median_min = atof(v);
+        else if (strcmp(a, "--metrics") == 0) metrics_path = v;
+        else if (strcmp(a, "--pricing") == 0) pricing = v;
+        else if (strcmp(a, "--history") == 0) history = v;
+        else if (strcmp(a, "--wal") == 0) wal_path = v;
+        else { fprintf(stderr, "option inconnue : %s\n", a); return 2; }
+    }
+    PriceCurve curve;
+    if (pricing && strcmp(pricing, "default") == 0) pr_default_curve(&curve);
+    else if (pricing && !pr_parse_curve(pricing, &curve)) { fprintf(stderr, "courbe de prix invalide : %s\n", pricing); return 2; }
+    if (cfg.vehicles < 0 || synthetic <= 0) { fprintf(stderr, "paramètres invalides\n"); return 2; }
+
+    metrics_on_signal(SIGUSR1, NULL);
+    StationIndex idx;
+    si_init(&idx);
+    // identifiants d'itinérance complets : deux opérateurs ne se partagent plus une station
+    StationKeys keys;
+    sk_init(&keys);
+    idx.keys = &keys;
+    int n = load_stations(&idx, dataset, synthetic);
+    if (n <= 0) {
+        fprintf(stderr, "[SIM] aucune station chargée%s%s\n", dataset ? " depuis " : "", dataset ? dataset : "");
+        si_clear(&idx);
+        sk_clear(&keys);
+        return 1;
+    }
+    // la simulation ne résout aucune chaîne : pas de table parfaite à construire
+    if (keys.count) sk_print_stats(&keys);
+    printf("[SIM] %d stations%s%s, %d véhicules, %.1f h simulées, Zipf %.2f, graine %llu\n", idx.size,
+           dataset ? " depuis " : " synthétiques", dataset ? dataset : "", cfg.vehicles, cfg.duration_s / 3600.0,
+           cfg.zipf_s, (unsigned long long)cfg.seed);
+
+    // l'identifiant du véhicule indexe son historique
+    SList* mru = NULL;
+    if (use_mru) {
+        mru = (SList*)malloc(sizeof(SList) * ((size_t)cfg.vehicles + 1));
+        if (!mru) { si_clear(&idx); sk_clear(&keys); return 1; }
+        for (int v = 0; v <= cfg.vehicles; v++) ds_slist_init(&mru[v]);
+    }
+    Pipeline pl;
+    pl_init(&pl, &idx, mru, mru ? cfg.vehicles + 1 : 0, SIM_MRU_CAPACITY);
+    PricingEngine pe;
+    memset(&pe, 0, sizeof pe);
+    HistStore hist;
+    Wal wal;
+    char ckpt[4096];
+    // connecteurs et tarification sur l'index tout juste chargé : capacités du jeu de stations
+    ConnStore conns;
+    cn_init(&conns);
+    int ready = cn_attach(&conns, &idx) >= 0;
+    if (!ready) fprintf(stderr, "[SIM] échec d'allocation\n");
+    else idx.conns = &conns;
+    if (ready && pricing) {
+        ready = pr_init(&pe, &curve, NULL, NULL) && pr_attach(&pe, &idx, cfg.start_ts) >= 0;
+        if (!ready) fprintf(stderr, "[SIM] échec d'allocation\n");
+        else pl.pricing = &pe;
+    }
+    if (ready && wal_path) {
+        snprintf(ckpt, sizeof ckpt, "%s.ckpt", wal_path);
+        ready = wal_open(&wal, wal_path, WAL_GROUP_BYTES, WAL_GROUP_US);
+        if (!ready) fprintf(stderr, "[SIM] impossible d'ouvrir le journal %s\n", wal_path);
+        else if ((ready = wal_recover(&wal, ckpt, &pl) >= 0)) pl.wal = &wal;
+        else wal_close(&wal);
+    }
+    if (ready && history) {
+        ready = hs_open(&hist, history, 0);
+        if (!ready) fprintf(stderr, "[SIM] impossible d'ouvrir l'historique %s\n", history);
+        else pl.history = &hist;
+    }
+
+    SimStats st;
+    int ok = ready && sim_run(&pl, &cfg, &st);
+    if (ok) sim_print_stats(&st);
+    else if (ready) fprintf(stderr, "[SIM] échec d'allocation\n");
+    if (ok && pricing) pr_print_stats(&pe);
+    if (ok) cn_print_stats(&conns);
+    if (pl.history) {
+        if (!hs_flush(&hist)) {
+            fprintf(stderr, "[SIM] impossible d'écrire %s\n", history);
+            ok = 0;
+        }
+        if (ok) history_report(&hist, &cfg);
+        hs_print_stats(&hist);
+        hs_close(&hist);
+    }
+    if (pl.wal) {
+        if (ok && !wal_checkpoint(&wal, ckpt, &pl)) ok = 0;
+        wal_print_stats(&wal);
+        if (!wal_close(&wal)) ok = 0;
+    }
+    if (metrics_path && !metrics_dump_path(metrics_path))
+        fprintf(stderr, "[SIM] impossible d'écrire %s\n", metrics_path);
+
+    if (pricing) pr_clear(&pe);
+    cn_clear(&conns);
+    for (int v = 0; mru && v <= cfg.vehicles; v++) ds_slist_clear(&mru[v]);
+    free(mru);
+    si_clear(&idx);
+    sk_clear(&keys);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+#include "geo.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* case supprimée de la table des stations */
+static NNode GEO_TOMB;
+
+static const struct { short dept, region; } DEPT_REGIONS[] = {
+    {1, 84}, {2, 32}, {3, 84}, {4, 93}, {5, 93}, {6, 93}, {7, 84}, {8, 44}, {9, 76}, {10, 44},
+    {11, 76}, {12, 76}, {13, 93}, {14, 28}, {15, 84}, {16, 75}, {17, 75}, {18, 24}, {19, 75},
+    {21, 27}, {22, 53}, {23, 75}, {24, 75}, {25, 27}, {26, 84}, {27, 28}, {28, 24}, {29, 53},
+    {30, 76}, {31, 76}, {32, 76}, {33, 75}, {34, 76}, {35, 53}, {36, 24}, {37, 24}, {38, 84},
+    {39, 27}, {40, 75}, {41, 24}, {42, 84}, {43, 84}, {44, 52}, {45, 24}, {46, 76}, {47, 75},
+    {48, 76}, {49, 52}, {50, 28}, {51, 44}, {52, 44}, {53, 52}, {54, 44}, {55, 44}, {56, 53},
+    {57, 44}, {58, 27}, {59, 32}, {60, 32}, {61, 28}, {62, 32}, {63, 84}, {64, 75}, {65, 76},
+    {66, 76}, {67, 44}, {68, 44}, {69, 84}, {70, 27}, {71, 27}, {72, 52}, {73, 84}, {74, 84},
+    {75, 11}, {76, 28}, {77, 11}, {78, 11}, {79, 75}, {80, 32}, {81, 76}, {82, 76}, {83, 93},
+    {84, 93}, {85, 52}, {86, 75}, {87, 75}, {88, 44}, {89, 27}, {90, 27}, {91, 11}, {92, 11},
+    {93, 11}, {94, 11}, {95, 11}, {201, 94}, {202, 94}, {971, 1}, {972, 2}, {973, 3}, {974, 4},
+    {976, 6},
+};
+
+static const struct { short code; const char* name; } REGION_NAMES[] = {
+    {0, "Inconnue"}, {1, "Guadeloupe"}, {2, "Martinique"}, {3, "Guyane"}, {4, "La Réunion"},
+    {6, "Mayotte"}, {11, "Île-de-France"}, {24, "Centre-Val de Loire"},
+    {27, "Bourgogne-Franche-Comté"}, {28, "Normandie"}, {32, "Hauts-de-France"}, {44, "Grand Est"},
+    {52, "Pays de la Loire"}, {53, "Bretagne"}, {75, "Nouvelle-Aquitaine"}, {76, "Occitanie"},
+    {84, "Auvergne-Rhône-Alpes"}, {93, "Provence-Alpes-Côte d'Azur"}, {94, "Corse"},
+};
+
+const char* geo_region_name(int code) {
+    for (size_t i = 0; i < sizeof REGION_NAMES / sizeof REGION_NAMES[0]; i++)
+        if (REGION_NAMES[i].code == code) return REGION_NAMES[i].name;
+    return "?";
+}
+
+static int region_of_dept(int dept) {
+    for (size_t i = 0; i < sizeof DEPT_REGIONS / sizeof DEPT_REGIONS[0]; i++)
+        if (DEPT_REGIONS[i].dept == dept) return DEPT_REGIONS[i].region;
+    return 0;
+}
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+/* "42" -> 42, "2A" -> 201, "2B" -> 202, "971" -> 971 ; -1 si invalide */
+static int dept_code(const char* s, int len) {
+    if (len == 2 && s[0] == '2' && (s[1] == 'A' || s[1] == 'a')) return 201;
+    if (len == 2 && s[0] == '2' && (s[1] == 'B' || s[1] == 'b')) return 202;
+    if (len < 2 || len > 3) return -1;
+    int v = 0;
+    for (int i = 0; i < len; i++) {
+        if (!is_digit(s[i])) return -1;
+        v = v * 10 + (s[i] - '0');
+    }
+    return v > 0 && v < GEO_DEPT_MAX ? v : -1;
+}
+
+/* "42218" -> 42218, "2A004" -> 201004 ; -1 si invalide */
+static int commune_code(const char* s, int len) {
+    if (!s || len != 5) return -1;
+    int d = (s[0] == '9' && s[1] == '7') ? dept_code(s, 3) : dept_code(s, 2);
+    if (d < 0) return -1;
+    int v = 0;
+    for (int i = 2; i < 5; i++) {
+        if (!is_digit(s[i])) return -1;
+        v = v * 10 + (s[i] - '0');
+    }
+    return d >= 201 && d <= 202 ? d * 1000 + v : (s[0] - '0') * 10000 + (s[1] - '0') * 1000 + v;
+}
+
+static int dept_of_commune(int code) {
+    if (code >= 200000) return code / 1000;
+    if (code >= 97000) return code / 100;
+    return code / 1000;
+}
+
+/* ---------- tables ouvertes : code -> noeud ---------- */
+
+static int slot_of(NNode* const* tbl, int cap, int key) {
+    int mask = cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)key) & (uint64_t)mask);
+    while (tbl[i] && (tbl[i] == &GEO_TOMB || tbl[i]->id != key)) i = (i + 1) & mask;
+    return i;
+}
+
+static NNode* tbl_get(NNode* const* tbl, int cap, int key) {
+    return cap ? tbl[slot_of(tbl, cap, key)] : NULL;
+}
+
+/* réinsère les noeuds de tbl dans une table de nc cases (cases supprimées purgées) */
+static int tbl_rehash(NNode*** tbl, int* cap, int nc) {
+    NNode** nt = (NNode**)calloc((size_t)nc, sizeof(NNode*));
+    if (!nt) return 0;
+    for (int i = 0; i < *cap; i++) {
+        NNode* n = (*tbl)[i];
+        if (!n || n == &GEO_TOMB) continue;
+        nt[slot_of(nt, nc, n->id)] = n;
+    }
+    free(*tbl);
+    *tbl = nt;
+    *cap = nc;
+    return 1;
+}
+
+/* ---------- construction ---------- */
+
+static NNode* child_node(NNode* parent, int id) {
+    NNode* n = n_create(id);
+    if (!n) return NULL;
+    if (!n_attach(parent, n)) {
+        free(n);
+        return NULL;
+    }
+    return n;
+}
+
+static NNode* region_get(GeoTree* g, int code) {
+    if (!g->regions[code]) g->regions[code] = child_node(g->root, code);
+    return g->regions[code];
+}
+
+static NNode* dept_get(GeoTree* g, int dept) {
+    if (!g->departments[dept]) {
+        NNode* r = region_get(g, region_of_dept(dept));
+        if (r) g->departments[dept] = child_node(r, dept);
+    }
+    return g->departments[dept];
+}
+
+static NNode* commune_get(GeoTree* g, int code) {
+    NNode* c = tbl_get(g->communes, g->commune_cap, code);
+    if (c) return c;
+    if ((g->commune_count + 1) * 2 > g->commune_cap
+        && !tbl_rehash(&g->communes, &g->commune_cap, g->commune_cap ? g->commune_cap * 2 : 1024))
+        return NULL;
+    NNode* d = dept_get(g, code ? dept_of_commune(code) : 0);
+    if (!d || !(c = child_node(d, code))) return NULL;
+    g->communes[slot_of(g->communes, g->commune_cap, code)] = c;
+    g->commune_count++;
+    return c;
+}
+
+int geo_init(GeoTree* g) {
+    memset(g, 0, sizeof *g);
+    g->root = n_create(0);
+    return g->root != NULL;
+}
+
+/* contribution propre d'une station */
+static NAgg contribution(int connectors, const StationInfo* info) {
+    NAgg a;
+    a.connectors = connectors;
+    a.slots_free = info->slots_free;
+    a.fast_slots_free = info->power_kW >= GEO_FAST_KW ? info->slots_free : 0;
+    a.power_kw = (long long)info->power_kW * connectors;
+    return a;
+}
+
+static NAgg agg_diff(const NAgg* a, const NAgg* b) {
+    NAgg d;
+    d.connectors = a->connectors - b->connectors;
+    d.slots_free = a->slots_free - b->slots_free;
+    d.fast_slots_free = a->fast_slots_free - b->fast_slots_free;
+    d.power_kw = a->power_kw - b->power_kw;
+    return d;
+}
+
+static NAgg agg_neg(const NAgg* a) {
+    NAgg zero = { 0, 0, 0, 0 };
+    return agg_diff(&zero, a);
+}
+
+int geo_add(GeoTree* g, int station_id, const char* insee, int insee_len, int connectors,
+            const StationInfo* info) {
+    if (!g || !g->root || !info) return 0;
+    int code = commune_code(insee, insee_len);
+    if (code < 0) code = 0;
+    NNode* commune = commune_get(g, code);
+    if (!commune) return 0;
+    NAgg a = contribution(connectors, info);
+
+    NNode* leaf = tbl_get(g->stations, g->station_cap, station_id);
+    if (leaf) {
+        if (leaf->parent != commune) {
+            // changement de commune : retrait de l'ancienne branche, ajout sur la nouvelle
+            NNode* old = leaf->parent;
+            n_detach(leaf);
+            if (!n_attach(commune, leaf)) {
+                n_attach(old, leaf);  // la place libérée chez l'ancien parent suffit
+                return 0;
+            }
+            NAgg out = agg_neg(&leaf->agg);
+            n_propagate(old, -1, &out);
+            n_propagate(commune, 1, &a);
+        } else {
+            NAgg d = agg_diff(&a, &leaf->agg);
+            n_propagate(commune, 0, &d);
+        }
+        leaf->agg = a;
+        return 1;
+    }
+
+    if ((g->station_used + 1) * 4 > g->station_cap * 3) {
+        int nc = g->station_cap ? g->station_cap : 1024;
+        while ((g->station_count + 1) * 2 > nc) nc *= 2;
+        if (!tbl_rehash(&g->stations, &g->station_cap, nc)) return 0;
+        g->station_used = g->station_count;
+    }
+    leaf = child_node(commune, station_id);
+    if (!leaf) return 0;
+    leaf->items_count = 1;
+    leaf->agg = a;
+    n_propagate(commune, 1, &a);
+    int s = slot_of(g->stations, g->station_cap, station_id);
+    if (!g->stations[s]) g->station_used++;
+    g->stations[s] = leaf;
+    g->station_count++;
+    return 1;
+}
+
+int geo_update(GeoTree* g, int station_id, const StationInfo* info) {
+    if (!g || !info) return 0;
+    NNode* leaf = tbl_get(g->stations, g->station_cap, station_id);
+    if (!leaf) return 0;
+    NAgg a = contribution(leaf->agg.connectors, info);
+    NAgg d = agg_diff(&a, &leaf->agg);
+    n_propagate(leaf, 0, &d);
+    return 1;
+}
+
+int geo_remove(GeoTree* g, int station_id) {
+    if (!g || !g->station_cap) return 0;
+    int s = slot_of(g->stations, g->station_cap, station_id);
+    NNode* leaf = g->stations[s];
+    if (!leaf) return 0;
+    NAgg out = agg_neg(&leaf->agg);
+    n_propagate(leaf->parent, -1, &out);
+    n_detach(leaf);
+    n_clear(leaf);
+    g->stations[s] = &GEO_TOMB;
+    g->station_count--;
+    return 1;
+}
+
+const NNode* geo_region(const GeoTree* g, int code) {
+    return code >= 0 && code < GEO_REGION_MAX ? g->regions[code] : NULL;
+}
+
+const NNode* geo_department(const GeoTree* g, const char* code) {
+    int d = code ? dept_code(code, (int)strlen(code)) : -1;
+    return d >= 0 ? g->departments[d] : NULL;
+}
+
+const NNode* geo_commune(const GeoTree* g, const char* insee) {
+    int c = insee ? commune_code(insee, (int)strlen(insee)) : -1;
+    return c >= 0 ? tbl_get(g->communes, g->commune_cap, c) : NULL;
+}
+
+const NNode* geo_station(const GeoTree* g, int station_id) {
+    return tbl_get(g->stations, g->station_cap, station_id);
+}
+
+int geo_level(const NNode* n) {
+    int depth = -1;
+    for (; n; n = n->parent) depth++;
+    return depth;
+}
+
+int geo_format_code(const NNode* n, char* buf, size_t len) {
+    if (!n || !len) return 0;
+    int level = geo_level(n), id = n->id, w;
+    if (level == GEO_DEPARTMENT && id >= 201 && id <= 202)
+        w = snprintf(buf, len, "2%c", id == 201 ? 'A' : 'B');
+    else if (level == GEO_DEPARTMENT)
+        w = snprintf(buf, len, "%02d", id);
+    else if (level == GEO_COMMUNE && id >= 200000)
+        w = snprintf(buf, len, "2%c%03d", id / 1000 == 201 ? 'A' : 'B', id % 1000);
+    else if (level == GEO_COMMUNE)
+        w = snprintf(buf, len, "%05d", id);
+    else
+        w = snprintf(buf, len, "%d", id);
+    return w < 0 ? 0 : (w >= (int)len ? (int)len - 1 : w);
+}
+
+static void print_node(const NNode* n, const char* label, int indent) {
+    char code[16];
+    geo_format_code(n, code, sizeof code);
+    printf("%*s%-4s %-*s %7d stations %8d pdc %8d libres (%d rapides) %10lld kW\n", indent, "", code,
+           34 - indent, label, n->items_count, n->agg.connectors, n->agg.slots_free, n->agg.fast_slots_free, n->agg.power_kw);
+}
+
+void geo_print(const GeoTree* g, int max_level) {
+    if (!g || !g->root) return;
+    printf("[GEO] %d stations, %d communes\n", g->root->items_count, g->commune_count);
+    for (int r = 0; r < GEO_REGION_MAX; r++) {
+        if (!g->regions[r] || !g->regions[r]->items_count) continue;
+        print_node(g->regions[r], geo_region_name(r), 2);
+        if (max_level < GEO_DEPARTMENT) continue;
+        for (int d = 0; d < GEO_DEPT_MAX; d++) {
+            const NNode* dn = g->departments[d];
+            if (dn && dn->parent == g->regions[r] && dn->items_count) print_node(dn, "", 6);
+        }
+    }
+}
+
+void geo_clear(GeoTree* g) {
+    if (!g) return;
+    n_clear(g->root);
+    free(g->communes);
+    free(g->stations);
+    memset(g, 0, sizeof *g);
+}
+
+void geo_reset(GeoTree* g) {
+    if (!g) return;
+    geo_clear(g);
+    geo_init(g);
+}
@@ -0,0 +1,103 @@
+#ifndef DS_GEO_H
+#define DS_GEO_H
+#include <stddef.h>
+#include "nary.h"
+#include "station_index.h"
+
+/**
+ * @brief Hiérarchie géographique France → région → département → commune → station sur NNode.
+ *
+ * La commune vient de code_insee_commune, le département de ses deux premiers
+ * caractères (trois en outre-mer), la région d'une table des départements.
+ * Chaque noeud porte les agrégats de son sous-arbre (items_count = stations,
+ * NAgg) ; une mise à jour de station ne touche que ses ancêtres. Les stations
+ * sans code INSEE exploitable sont rangées sous la région, le département et la
+ * commune 0.
+ *
+ * Codes numériques des noeuds : région INSEE (11, 84, ...), département (1..95,
+ * 201 pour 2A, 202 pour 2B, 971..976), commune (42218 ; 201004 pour 2A004),
+ * station : son identifiant.
+ */
+
+#define GEO_FAST_KW 50         /* seuil de charge rapide (kW) */
+#define GEO_REGION_MAX 100
+#define GEO_DEPT_MAX 1000
+
+typedef enum GeoLevel { GEO_ROOT, GEO_REGION, GEO_DEPARTMENT, GEO_COMMUNE, GEO_STATION } GeoLevel;
+
+typedef struct GeoTree {
+    NNode* root;
+    NNode* regions[GEO_REGION_MAX];     /* par code région */
+    NNode* departments[GEO_DEPT_MAX];   /* par code département */
+    NNode** communes;                   /* table ouverte par code commune */
+    int commune_cap, commune_count;
+    NNode** stations;                   /* table ouverte des feuilles par identifiant */
+    int station_cap, station_used;      /* station_used : cases occupées ou supprimées */
+    int station_count;
+} GeoTree;
+
+/**
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  geo_init(GeoTree* g);                                              /* O(1) */
+
+/**
+ * Range une station (ou la déplace si sa commune a changé) et met à jour les agrégats.
+ *
+ * @param g Arbre géographique.
+ * @param station_id Identifiant de la station.
+ * @param insee Code INSEE de la commune (non terminé par '\0'), NULL si inconnu.
+ * @param insee_len Longueur du code.
+ * @param connectors Nombre de points de charge.
+ * @param info Puissance et créneaux libres de la station.
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  geo_add(GeoTree* g, int station_id, const char* insee, int insee_len, int connectors,
+             const StationInfo* info);                                  /* O(profondeur) */
+
+/**
+ * Reporte le nouvel état d'une station (branchement, débranchement, puissance).
+ *
+ * @return 1 si la station est rangée dans l'arbre, 0 sinon.
+ */
+int  geo_update(GeoTree* g, int station_id, const StationInfo* info);  /* O(profondeur) */
+
+/**
+ * Retire une station et soustrait sa contribution à ses ancêtres.
+ *
+ * @return 1 si la station était présente, 0 sinon.
+ */
+int  geo_remove(GeoTree* g, int station_id);                            /* O(profondeur) */
+
+const NNode* geo_region(const GeoTree* g, int code);                    /* O(1) */
+
+/* code "42", "2A", "971" ; NULL si inconnu */
+const NNode* geo_department(const GeoTree* g, const char* code);        /* O(1) */
+
+/* code INSEE "42218" ; NULL si inconnu */
+const NNode* geo_commune(const GeoTree* g, const char* insee);          /* O(1) */
+
+const NNode* geo_station(const GeoTree* g, int station_id);             /* O(1) */
+
+/* niveau d'un noeud (GeoLevel), d'après sa profondeur */
+int  geo_level(const NNode* n);                                          /* O(profondeur) */
+
+/**
+ * Écrit le code lisible d'un noeud ("84", "2A", "42218", "2A004").
+ *
+ * @return Longueur écrite.
+ */
+int  geo_format_code(const NNode* n, char* buf, size_t len);
+
+const char* geo_region_name(int code);
+
+/**
+ * Affiche les agrégats des régions, et de leurs départements si max_level >= GEO_DEPARTMENT.
+ */
+void geo_print(const GeoTree* g, int max_level);
+
+/* vide l'arbre en gardant la structure utilisable */
+void geo_reset(GeoTree* g);                                              /* O(noeuds) */
+void geo_clear(GeoTree* g);                                              /* O(noeuds) */
+
+#endif
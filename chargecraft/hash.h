@@ -0,0 +1,43 @@
+#ifndef DS_HASH_H
+#define DS_HASH_H
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Hachage 64 bits d'une zone mémoire, 8 octets par itération
+ * (multiplication par la constante de Fibonacci puis repliement).
+ *
+ * @param p Début des données.
+ * @param n Nombre d'octets.
+ * @param h Valeur de départ (DS_HASH_SEED, ou un hachage précédent pour chaîner).
+ * @return Empreinte 64 bits.
+ */
+#define DS_HASH_SEED 1469598103934665603ULL
+#define DS_HASH_MUL 0x9E3779B97F4A7C15ULL
+
+static inline uint64_t ds_hash_bytes(const void* p, size_t n, uint64_t h) {
+    const unsigned char* s = (const unsigned char*)p;
+    uint64_t w;
+    while (n >= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ w) * DS_HASH_MUL;
+        h ^= h >> 29;
+        s += 8;
+        n -= 8;
+    }
+    w = (uint64_t)n << 56;
+    for (size_t i = 0; i < n; i++) w |= (uint64_t)s[i] << (8 * i);
+    h = (h ^ w) * DS_HASH_MUL;
+    return h ^ (h >> 32);
+}
+
+/* mélange final (splitmix64) pour répartir les bits faibles d'une clé entière */
+static inline uint64_t ds_hash_mix(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+#endif
@@ -0,0 +1,415 @@
+#define _POSIX_C_SOURCE 200809L
+#include "history.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* pire cas d'un bloc : 36 bits d'horodatage et 16 bits de valeur par échantillon */
+#define HS_MAX_PACKED ((size_t)HS_MAX_CHUNK * 52 / 8 + 8)
+
+/* ---------- flux de bits, poids forts en premier ---------- */
+
+typedef struct BitWriter {
+    unsigned char* out;
+    size_t len;
+    uint64_t acc;
+    int n;                          /* bits en attente dans acc */
+} BitWriter;
+
+static void bw_put(BitWriter* w, uint32_t v, int bits) {
+    if (bits == 0) return;
+    w->acc = (w->acc << bits) | (v & (uint32_t)((1ull << bits) - 1));
+    w->n += bits;
+    while (w->n >= 8) {
+        w->n -= 8;
+        w->out[w->len++] = (unsigned char)(w->acc >> w->n);
+    }
+}
+
+static void bw_end(BitWriter* w) {
+    if (w->n) w->out[w->len++] = (unsigned char)(w->acc << (8 - w->n));
+    w->n = 0;
+}
+
+typedef struct BitReader {
+    const unsigned char* in;
+    size_t len, pos;
+    uint64_t acc;
+    int n;
+} BitReader;
+
+static int br_get(BitReader* r, int bits, uint32_t* v) {
+    if (bits == 0) { *v = 0; return 1; }
+    while (r->n < bits) {
+        if (r->pos >= r->len) return 0;
+        r->acc = (r->acc << 8) | r->in[r->pos++];
+        r->n += 8;
+    }
+    r->n -= bits;
+    *v = (uint32_t)((r->acc >> r->n) & ((1ull << bits) - 1));
+    return 1;
+}
+
+static int width_of(uint32_t v) {
+    int w = 0;
+    while (v) { w++; v >>= 1; }
+    return w;
+}
+
+/* ---------- compression d'un bloc ---------- */
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint32_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* delta de delta : 0 | 10 + 7 bits | 110 + 9 bits | 1110 + 12 bits | 1111 + delta brut sur 32 bits */
+static size_t encode(const HsSample* s, int count, uint16_t vmin, int width, unsigned char* out) {
+    BitWriter w = { out, 0, 0, 0 };
+    int64_t prev_delta = 0;
+    for (int i = 1; i < count; i++) {
+        int64_t delta = (int64_t)s[i].ts - s[i - 1].ts;
+        uint64_t zz = zigzag(delta - prev_delta);
+        if (delta == prev_delta) bw_put(&w, 0, 1);
+        else if (zz < (1u << 7)) { bw_put(&w, 2, 2); bw_put(&w, (uint32_t)zz, 7); }
+        else if (zz < (1u << 9)) { bw_put(&w, 6, 3); bw_put(&w, (uint32_t)zz, 9); }
+        else if (zz < (1u << 12)) { bw_put(&w, 14, 4); bw_put(&w, (uint32_t)zz, 12); }
+        else { bw_put(&w, 15, 4); bw_put(&w, (uint32_t)delta, 32); }
+        prev_delta = delta;
+    }
+    for (int i = 0; i < count; i++) bw_put(&w, (uint32_t)(s[i].slots_free - vmin), width);
+    bw_end(&w);
+    return w.len;
+}
+
+static int decode(const HsBlock* b, const unsigned char* in, HsSample* out) {
+    BitReader r = { in, b->bytes, 0, 0, 0 };
+    int64_t prev_delta = 0, ts = b->t_first;
+    out[0].ts = b->t_first;
+    for (uint32_t i = 1; i < b->count; i++) {
+        uint32_t bit, v;
+        int ones = 0;
+        // préfixe unaire, au plus quatre 1
+        while (ones < 4) {
+            if (!br_get(&r, 1, &bit)) return 0;
+            if (!bit) break;
+            ones++;
+        }
+        static const int BITS[] = { 0, 7, 9, 12 };
+        int64_t delta;
+        if (ones == 4) {
+            if (!br_get(&r, 32, &v)) return 0;
+            delta = v;
+        } else if (ones == 0) {
+            delta = prev_delta;
+        } else {
+            if (!br_get(&r, BITS[ones], &v)) return 0;
+            delta = prev_delta + unzigzag(v);
+        }
+        ts += delta;
+        out[i].ts = (int)ts;
+        prev_delta = delta;
+    }
+    int width = width_of((uint32_t)(b->vmax - b->vmin));
+    for (uint32_t i = 0; i < b->count; i++) {
+        uint32_t v;
+        if (!br_get(&r, width, &v)) return 0;
+        out[i].slots_free = b->vmin + (int)v;
+    }
+    return out[b->count - 1].ts == b->t_last;
+}
+
+/* ---------- table des séries ---------- */
+
+static HsSeries* slot_of(const HistStore* h, int id) {
+    int mask = h->cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)id) & (uint64_t)mask);
+    while (h->series[i].station_id != HS_EMPTY && h->series[i].station_id != id) i = (i + 1) & mask;
+    return &h->series[i];
+}
+
+static HsSeries* find_series(const HistStore* h, int id) {
+    if (!h->cap) return NULL;
+    HsSeries* s = slot_of(h, id);
+    return s->station_id == id ? s : NULL;
+}
+
+static HsSeries* get_series(HistStore* h, int id) {
+    HsSeries* s = find_series(h, id);
+    if (s) return s;
+    if ((h->count + 1) * 2 > h->cap) {
+        int old_cap = h->cap;
+        HsSeries* old = h->series;
+        int cap = old_cap ? 2 * old_cap : 1024;
+        HsSeries* t = (HsSeries*)calloc((size_t)cap, sizeof(HsSeries));
+        if (!t) return NULL;
+        for (int i = 0; i < cap; i++) t[i].station_id = HS_EMPTY;
+        h->series = t;
+        h->cap = cap;
+        for (int i = 0; i < old_cap; i++)
+            if (old[i].station_id != HS_EMPTY) *slot_of(h, old[i].station_id) = old[i];
+        free(old);
+    }
+    s = slot_of(h, id);
+    s->station_id = id;
+    s->last_ts = INT32_MIN;
+    h->count++;
+    return s;
+}
+
+static int push_block(HsSeries* s, const HsBlock* b) {
+    if (s->n_blocks == s->blocks_cap) {
+        int cap = s->blocks_cap ? 2 * s->blocks_cap : 4;
+        HsBlock* nb = (HsBlock*)realloc(s->blocks, sizeof(HsBlock) * (size_t)cap);
+        if (!nb) return 0;
+        s->blocks = nb;
+        s->blocks_cap = cap;
+    }
+    s->blocks[s->n_blocks++] = *b;
+    return 1;
+}
+
+/* ---------- fichier ---------- */
+
+static int write_all(int fd, const unsigned char* p, size_t n) {
+    while (n > 0) {
+        ssize_t k = write(fd, p, n);
+        if (k <= 0) return 0;
+        p += k;
+        n -= (size_t)k;
+    }
+    return 1;
+}
+
+static int flush_buffer(HistStore* h) {
+    if (h->wlen == 0) return 1;
+    if (!write_all(h->fd, h->wbuf, h->wlen)) return 0;
+    h->written += h->wlen;
+    h->wlen = 0;
+    return 1;
+}
+
+/* contenu compressé d'un bloc, depuis le tampon ou le fichier */
+static const unsigned char* read_packed(HistStore* h, const HsBlock* b) {
+    if (b->offset >= h->written) return h->wbuf + (b->offset - h->written);
+    if (pread(h->fd, h->packed, b->bytes, (off_t)b->offset) != (ssize_t)b->bytes) return NULL;
+    return h->packed;
+}
+
+static int seal(HistStore* h, HsSeries* s) {
+    const HsSample* smp = s->head;
+    int count = s->head_count;
+    uint32_t sum = 0;
+    int vmin = smp[0].slots_free, vmax = vmin;
+    for (int i = 0; i < count; i++) {
+        int v = smp[i].slots_free;
+        sum += (uint32_t)v;
+        if (v < vmin) vmin = v;
+        if (v > vmax) vmax = v;
+    }
+    if (h->wlen + sizeof(HsBlockHeader) + HS_MAX_PACKED > HS_WRITE_BUFFER && !flush_buffer(h)) return 0;
+
+    unsigned char* payload = h->wbuf + h->wlen + sizeof(HsBlockHeader);
+    size_t bytes = encode(smp, count, (uint16_t)vmin, width_of((uint32_t)(vmax - vmin)), payload);
+    HsBlockHeader hd = { HS_MAGIC, s->station_id, smp[0].ts, smp[count - 1].ts, (uint32_t)count, (uint32_t)bytes,
+                         sum, (uint16_t)vmin, (uint16_t)vmax, ds_hash_bytes(payload, bytes, DS_HASH_SEED) };
+    memcpy(h->wbuf + h->wlen, &hd, sizeof hd);
+
+    HsBlock b = { hd.t_first, hd.t_last, hd.count, hd.bytes, h->file_end + sizeof hd, sum, hd.vmin, hd.vmax, hd.checksum };
+    if (!push_block(s, &b)) return 0;
+    h->wlen += sizeof hd + bytes;
+    h->file_end += sizeof hd + bytes;
+    h->stats.sealed_blocks++;
+    h->stats.sealed_samples += count;
+    h->stats.disk_bytes += (long long)(sizeof hd + bytes);
+    s->head_count = 0;
+    return 1;
+}
+
+/* relit les en-têtes ; un bloc incomplet ou illisible en fin de fichier est coupé */
+static int scan(HistStore* h, uint64_t size) {
+    uint64_t off = 0;
+    HsBlockHeader hd;
+    while (off + sizeof hd <= size) {
+        if (pread(h->fd, &hd, sizeof hd, (off_t)off) != (ssize_t)sizeof hd) return 0;
+        if (hd.magic != HS_MAGIC || hd.count == 0 || hd.count > HS_MAX_CHUNK || hd.bytes > HS_MAX_PACKED ||
+            hd.t_first > hd.t_last || hd.vmin > hd.vmax || off + sizeof hd + hd.bytes > size)
+            break;
+        HsSeries* s = get_series(h, hd.station_id);
+        if (!s) return 0;
+        HsBlock b = { hd.t_first, hd.t_last, hd.count, hd.bytes, off + sizeof hd, hd.sum, hd.vmin, hd.vmax, hd.checksum };
+        if (!push_block(s, &b)) return 0;
+        s->last_ts = hd.t_last;
+        h->stats.sealed_blocks++;
+        h->stats.sealed_samples += hd.count;
+        h->stats.disk_bytes += (long long)(sizeof hd + hd.bytes);
+        off += sizeof hd + hd.bytes;
+    }
+    if (off < size && ftruncate(h->fd, (off_t)off) != 0) return 0;
+    h->written = h->file_end = off;
+    return 1;
+}
+
+int hs_open(HistStore* h, const char* path, int chunk) {
+    memset(h, 0, sizeof *h);
+    h->fd = -1;
+    h->chunk = chunk > 0 ? (chunk < HS_MAX_CHUNK ? chunk : HS_MAX_CHUNK) : HS_CHUNK_SAMPLES;
+    h->wbuf = (unsigned char*)malloc(HS_WRITE_BUFFER);
+    h->packed = (unsigned char*)malloc(HS_MAX_PACKED);
+    h->samples = (HsSample*)malloc(sizeof(HsSample) * HS_MAX_CHUNK);
+    h->fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (!h->wbuf || !h->packed || !h->samples || h->fd < 0 || fstat(h->fd, &st) != 0 ||
+        !scan(h, (uint64_t)st.st_size) || lseek(h->fd, (off_t)h->file_end, SEEK_SET) < 0) {
+        hs_close(h);
+        return 0;
+    }
+    return 1;
+}
+
+int hs_append(HistStore* h, int station_id, int ts, int slots_free) {
+    if (slots_free < 0 || slots_free > UINT16_MAX) { h->stats.out_of_order++; return -1; }
+    HsSeries* s = get_series(h, station_id);
+    if (!s) return 0;
+    if (ts < s->last_ts) { h->stats.out_of_order++; return -1; }
+    if (s->head_count == s->head_cap) {
+        int cap = s->head_cap ? 2 * s->head_cap : 4;
+        if (cap > h->chunk) cap = h->chunk;
+        HsSample* nh = (HsSample*)realloc(s->head, sizeof(HsSample) * (size_t)cap);
+        if (!nh) return 0;
+        s->head = nh;
+        s->head_cap = cap;
+    }
+    s->head[s->head_count].ts = ts;
+    s->head[s->head_count].slots_free = slots_free;
+    s->head_count++;
+    s->last_ts = ts;
+    h->stats.appended++;
+    if (s->head_count >= h->chunk && !seal(h, s)) return 0;
+    return 1;
+}
+
+/* premier bloc dont la fin atteint from */
+static int first_block(const HsSeries* s, int from) {
+    int lo = 0, hi = s->n_blocks;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (s->blocks[mid].t_last < from) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* décompresse b dans h->samples après contrôle de l'empreinte */
+static const HsSample* load_block(HistStore* h, const HsBlock* b) {
+    const unsigned char* p = read_packed(h, b);
+    if (!p || ds_hash_bytes(p, b->bytes, DS_HASH_SEED) != b->checksum || !decode(b, p, h->samples)) return NULL;
+    h->stats.blocks_decoded++;
+    return h->samples;
+}
+
+int hs_range(HistStore* h, int station_id, int from, int to, HsSample* out, int cap) {
+    HsSeries* s = find_series(h, station_id);
+    if (!s || from > to) return 0;
+    int n = 0;
+    for (int k = first_block(s, from); k < s->n_blocks && s->blocks[k].t_first <= to; k++) {
+        const HsBlock* b = &s->blocks[k];
+        const HsSample* smp = load_block(h, b);
+        if (!smp) return -1;
+        for (uint32_t i = 0; i < b->count; i++) {
+            if (smp[i].ts < from || smp[i].ts > to) continue;
+            if (n < cap) out[n] = smp[i];
+            n++;
+        }
+    }
+    for (int i = 0; i < s->head_count; i++) {
+        if (s->head[i].ts < from || s->head[i].ts > to) continue;
+        if (n < cap) out[n] = s->head[i];
+        n++;
+    }
+    return n;
+}
+
+static void bucket_add(HsBucket* bk, int v) {
+    if (bk->count == 0 || v < bk->min) bk->min = v;
+    if (bk->count == 0 || v > bk->max) bk->max = v;
+    bk->count++;
+    bk->avg += v;               // somme jusqu'à la fin de hs_downsample
+}
+
+int hs_downsample(HistStore* h, int station_id, int from, int to, int step, HsBucket* out, int cap) {
+    if (step <= 0 || from > to) return -1;
+    long long nb = ((long long)to - from) / step + 1;
+    if (nb > cap) return -1;
+    for (int k = 0; k < nb; k++) {
+        memset(&out[k], 0, sizeof out[k]);
+        out[k].start = (int)(from + (long long)k * step);
+    }
+    HsSeries* s = find_series(h, station_id);
+    if (!s) return (int)nb;
+
+    for (int k = first_block(s, from); k < s->n_blocks && s->blocks[k].t_first <= to; k++) {
+        const HsBlock* b = &s->blocks[k];
+        long long first = ((long long)b->t_first - from) / step, last = ((long long)b->t_last - from) / step;
+        if (b->t_first >= from && b->t_last <= to && first == last) {
+            // bloc entier dans un intervalle : ses agrégats suffisent
+            HsBucket* bk = &out[first];
+            if (bk->count == 0 || b->vmin < bk->min) bk->min = b->vmin;
+            if (bk->count == 0 || b->vmax > bk->max) bk->max = b->vmax;
+            bk->count += (int)b->count;
+            bk->avg += b->sum;
+            h->stats.blocks_skipped++;
+            continue;
+        }
+        const HsSample* smp = load_block(h, b);
+        if (!smp) return -1;
+        for (uint32_t i = 0; i < b->count; i++)
+            if (smp[i].ts >= from && smp[i].ts <= to) bucket_add(&out[((long long)smp[i].ts - from) / step], smp[i].slots_free);
+    }
+    for (int i = 0; i < s->head_count; i++)
+        if (s->head[i].ts >= from && s->head[i].ts <= to)
+            bucket_add(&out[((long long)s->head[i].ts - from) / step], s->head[i].slots_free);
+    for (int k = 0; k < nb; k++)
+        if (out[k].count) out[k].avg /= out[k].count;
+    return (int)nb;
+}
+
+int hs_flush(HistStore* h) {
+    for (int i = 0; i < h->cap; i++) {
+        HsSeries* s = &h->series[i];
+        if (s->station_id != HS_EMPTY && s->head_count > 0 && !seal(h, s)) return 0;
+    }
+    return flush_buffer(h);
+}
+
+void hs_print_stats(const HistStore* h) {
+    const HsStats* st = &h->stats;
+    printf("[HIST] %d stations, %lld échantillons ajoutés, %lld refusés | %lld blocs scellés (%lld échantillons), "
+           "%.2f octets par échantillon sur disque (brut : %zu)\n",
+           h->count, st->appended, st->out_of_order, st->sealed_blocks, st->sealed_samples,
+           st->sealed_samples ? (double)st->disk_bytes / st->sealed_samples : 0.0, sizeof(HsSample));
+    if (st->blocks_decoded || st->blocks_skipped)
+        printf("[HIST] requêtes : %lld blocs décompressés, %lld servis par leurs agrégats\n",
+               st->blocks_decoded, st->blocks_skipped);
+}
+
+void hs_close(HistStore* h) {
+    if (h->fd >= 0) close(h->fd);
+    for (int i = 0; i < h->cap; i++) {
+        free(h->series[i].blocks);
+        free(h->series[i].head);
+    }
+    free(h->series);
+    free(h->wbuf);
+    free(h->packed);
+    free(h->samples);
+    memset(h, 0, sizeof *h);
+    h->fd = -1;
+}
@@ -0,0 +1,146 @@
+#ifndef DS_HISTORY_H
+#define DS_HISTORY_H
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Historique d'occupation par station : séries (ts, slots_free) en ajout seul.
+ *
+ * Chaque station a un bloc de tête en mémoire (échantillons bruts). Plein, il
+ * est compressé et scellé à la fin du fichier de l'historique :
+ *   - horodatages en delta de delta, codés sur 1, 9, 12, 16 ou 36 bits
+ *     (un pas régulier ne coûte qu'un bit) ;
+ *   - valeurs bit-packées sur la largeur de (max - min) du bloc.
+ * L'en-tête de bloc garde la plage de temps, min, max et somme des valeurs et
+ * une empreinte du contenu. L'index des blocs vit en mémoire ; hs_open le
+ * reconstruit en lisant les seuls en-têtes et coupe un bloc final incomplet.
+ *
+ * Les requêtes ne décompressent que les blocs qui chevauchent l'intervalle ;
+ * le sous-échantillonnage se contente des agrégats d'en-tête pour un bloc
+ * entièrement contenu dans un intervalle.
+ *
+ * Les blocs scellés passent par un tampon d'écriture, vidé quand il est plein
+ * et par hs_flush ; les requêtes lisent aussi ce tampon.
+ */
+
+#define HS_MAGIC 0x31425348u        /* "HSB1" */
+#define HS_CHUNK_SAMPLES 256        /* échantillons par bloc par défaut */
+#define HS_MAX_CHUNK 4096
+#define HS_WRITE_BUFFER (1 << 20)
+
+typedef struct HsSample {
+    int ts;
+    int slots_free;
+} HsSample;
+
+/* sous-échantillonnage : statistiques des échantillons d'un intervalle */
+typedef struct HsBucket {
+    int start;                      /* début de l'intervalle */
+    int count;                      /* 0 : aucun échantillon, min / max / avg non définis */
+    int min, max;
+    double avg;
+} HsBucket;
+
+/* en-tête d'un bloc scellé sur disque, suivi de bytes octets compressés */
+typedef struct HsBlockHeader {
+    uint32_t magic;
+    int32_t station_id;
+    int32_t t_first, t_last;
+    uint32_t count;
+    uint32_t bytes;
+    uint32_t sum;                   /* somme des valeurs */
+    uint16_t vmin, vmax;
+    uint64_t checksum;              /* ds_hash_bytes du contenu compressé */
+} HsBlockHeader;
+
+/* bloc scellé, index en mémoire */
+typedef struct HsBlock {
+    int32_t t_first, t_last;
+    uint32_t count;
+    uint32_t bytes;
+    uint64_t offset;                /* position du contenu dans le fichier */
+    uint32_t sum;
+    uint16_t vmin, vmax;
+    uint64_t checksum;
+} HsBlock;
+
+typedef struct HsSeries {
+    int station_id;                 /* HS_EMPTY : case libre */
+    int last_ts;
+    HsBlock* blocks;                /* par temps croissant */
+    int n_blocks, blocks_cap;
+    HsSample* head;                 /* bloc de tête, croît jusqu'à chunk */
+    int head_count, head_cap;
+} HsSeries;
+
+#define HS_EMPTY INT32_MIN
+
+typedef struct HsStats {
+    long long appended;
+    long long out_of_order;         /* refusés : antérieurs au dernier de la station ou valeur hors plage */
+    long long sealed_blocks, sealed_samples;
+    long long disk_bytes;           /* en-têtes compris */
+    long long blocks_decoded;       /* blocs décompressés par les requêtes */
+    long long blocks_skipped;       /* blocs servis par leurs agrégats d'en-tête */
+} HsStats;
+
+typedef struct HistStore {
+    int fd;
+    uint64_t file_end;              /* fin logique : fichier + tampon */
+    uint64_t written;               /* octets déjà dans le fichier */
+    unsigned char* wbuf;
+    size_t wlen;
+    int chunk;
+    HsSeries* series;               /* table ouverte par identifiant, au plus à moitié pleine */
+    int count, cap;
+    unsigned char* packed;          /* contenu d'un bloc, compressé */
+    HsSample* samples;              /* contenu d'un bloc, décompressé */
+    HsStats stats;
+} HistStore;
+
+/**
+ * Ouvre ou crée l'historique rangé dans path.
+ *
+ * @param chunk Échantillons par bloc scellé (0 : HS_CHUNK_SAMPLES), au plus HS_MAX_CHUNK.
+ * @return 1 si succès, 0 si le fichier est illisible ou en cas d'échec d'allocation.
+ */
+int  hs_open(HistStore* h, const char* path, int chunk);                             /* O(blocs) */
+
+/**
+ * Ajoute un échantillon à la série d'une station.
+ *
+ * @return 1 si ajouté, -1 si ts précède le dernier échantillon de la station
+ *         (ou valeur hors de 0..65535), 0 en cas d'échec d'allocation ou d'écriture.
+ */
+int  hs_append(HistStore* h, int station_id, int ts, int slots_free);               /* O(1) amorti */
+
+/**
+ * Échantillons de la station dont l'horodatage est dans [from, to], par ordre croissant.
+ *
+ * @param out Reçoit au plus cap échantillons.
+ * @return Nombre d'échantillons dans l'intervalle (peut dépasser cap), -1 si un bloc est corrompu.
+ */
+int  hs_range(HistStore* h, int station_id, int from, int to, HsSample* out, int cap);   /* O(log blocs + blocs touchés) */
+
+/**
+ * Min / moyenne / max des échantillons par intervalle de step secondes,
+ * sur [from, to] : out[k] couvre [from + k x step, from + (k + 1) x step[.
+ *
+ * @param cap Doit couvrir tous les intervalles.
+ * @return Nombre d'intervalles, -1 si cap est trop petit ou un bloc corrompu.
+ */
+int  hs_downsample(HistStore* h, int station_id, int from, int to, int step, HsBucket* out, int cap);
+
+/**
+ * Scelle tous les blocs de tête non vides et vide le tampon d'écriture.
+ *
+ * @return 1 si succès, 0 en cas d'erreur d'écriture.
+ */
+int  hs_flush(HistStore* h);                                                         /* O(stations) */
+
+void hs_print_stats(const HistStore* h);
+
+/* ferme sans sceller : appeler hs_flush avant pour garder les blocs de tête */
+void hs_close(HistStore* h);
+
+#endif
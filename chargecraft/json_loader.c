@@ -1,64 +1,380 @@
 #include "json_loader.h"
+#include "metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
-static int find_int_field(const char* s, const char* key, int* out) {
-    char pat[128];
-    snprintf(pat, sizeof pat, "\"%s\"", key);
-    const char* p = strstr(s, pat);
-    if(!p) return 0;
-    p = strchr(p, ':'); if(!p) return 0;
-    p++;
-    while(*p==' '||*p=='\t') p++;
-    *out = atoi(p);
+#define JR_BUF_SIZE (64 * 1024)
+#define JR_KEY_MAX 64
+
+/**
+ * Lecteur JSON incrémental : le fichier est consommé par blocs de taille fixe,
+ * la mémoire utilisée ne dépend pas du nombre de stations.
+ */
+typedef struct JsonReader {
+    FILE* f;
+    char buf[JR_BUF_SIZE];
+    size_t pos, len;
+    char* text;               /* chaînes de la station courante, bout à bout (agrandi au besoin) */
+    size_t text_len, text_cap;
+    int error;
+} JsonReader;
+
+/**
+ * Destination d'une chaîne décodée : tampon fixe (clés, nombres), tronqué
+ * silencieusement, ou fin du tampon texte du lecteur, agrandi au besoin.
+ */
+typedef struct JrOut {
+    char* p;                  /* tampon fixe (grow à 0) */
+    size_t n, cap;
+    int grow;                 /* 1 : écrit dans r->text */
+} JrOut;
+
+typedef struct JsonStation {
+    int power;
+    int slots;
+    int lat_e6, lon_e6;
+    size_t off[6];            /* dans r->text : identifiant puis opérateur, nom, adresse, INSEE, accès */
+    int len[6];
+} JsonStation;
+
+/* clés des champs texte conservés, dans l'ordre de JsonStation.off (après l'identifiant) */
+static const char* const TEXT_KEYS[5] = {
+    "nom_operateur", "nom_station", "adresse_station", "code_insee_commune", "condition_acces"
+};
+
+static int jr_fill(JsonReader* r) {
+    r->len = fread(r->buf, 1, sizeof r->buf, r->f);
+    r->pos = 0;
+    return r->len > 0;
+}
+
+static int jr_peek(JsonReader* r) {
+    if (r->pos == r->len && !jr_fill(r)) return EOF;
+    return (unsigned char)r->buf[r->pos];
+}
+
+static int jr_get(JsonReader* r) {
+    int c = jr_peek(r);
+    if (c != EOF) r->pos++;
+    return c;
+}
+
+/* premier caractère significatif (espaces sautés), sans le consommer */
+static int jr_peek_token(JsonReader* r) {
+    int c;
+    while ((c = jr_peek(r)) == ' ' || c == '\t' || c == '\n' || c == '\r') r->pos++;
+    return c;
+}
+
+static int jr_expect(JsonReader* r, int want) {
+    if (jr_peek_token(r) != want) { r->error = 1; return 0; }
+    r->pos++;
     return 1;
 }
-static int find_str_suffix_id(const char* s, const char* key) {
-    char pat[128];
-    snprintf(pat, sizeof pat, "\"%s\"", key);
-    const char* p = strstr(s, pat);
-    if(!p) return -1;
-    p = strchr(p, ':'); if(!p) return -1;
-    p++;
-    while(*p==' '||*p=='\t'||*p=='\"') p++;
-    const char* end = strchr(p, '\"'); if(!end) end = p + strlen(p);
-    const char* us = strrchr(p, '_');
-    if(!us || us>=end) return -1;
-    return atoi(us+1);
-}
-
-int ds_load_stations_from_json(const char* path, StationIndex* idx){
-    FILE* f = fopen(path, "r");
-    if(!f) return -1;
-    fseek(f, 0, SEEK_END); long sz = ftell(f); fseek(f, 0, SEEK_SET);
-    char* buf = (char*)malloc(sz+1);
-    if(!buf){ fclose(f); return -1; }
-    if(fread(buf, 1, sz, f)!=(size_t)sz){ free(buf); fclose(f); return -1; }
-    buf[sz]=0; fclose(f);
-
-    int inserted = 0;
-    char* p = buf;
-    while((p = strchr(p, '{'))){
-        char* q = strchr(p, '}');
-        if(!q) break;
-        *q = 0;
-        int id = find_str_suffix_id(p, "id_station_itinerance");
-        int power=0, slots=0;
-        find_int_field(p, "puissance_nominale", &power);
-        find_int_field(p, "nbre_pdc", &slots);
-
-        if(id > 0){
-            StationInfo info;
-            info.power_kW    = power ? power : 50;
-            info.price_cents = 300;
-            info.slots_free  = slots ? slots : 2;
-            info.last_ts     = 0;
-            si_add(idx, id, info);
-            inserted++;
+
+static int hex_val(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int read_hex4(JsonReader* r) {
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        int h = hex_val(jr_get(r));
+        if (h < 0) return -1;
+        v = v * 16 + h;
+    }
+    return v;
+}
+
+/* ajoute k octets ; 0 si le tampon texte ne peut pas grandir */
+static int jr_put(JsonReader* r, JrOut* o, const char* s, size_t k) {
+    if (!o) return 1;
+    if (!o->grow) {
+        // tampon fixe : on garde ce qui tient
+        if (o->n + 1 >= o->cap) return 1;
+        if (k > o->cap - 1 - o->n) k = o->cap - 1 - o->n;
+        memcpy(o->p + o->n, s, k);
+        o->n += k;
+        return 1;
+    }
+    size_t need = r->text_len + k + 1;
+    if (need > r->text_cap) {
+        if (need > INT_MAX) { r->error = 1; return 0; }
+        size_t nc = r->text_cap ? r->text_cap : 1024;
+        while (nc < need) nc *= 2;
+        char* t = (char*)realloc(r->text, nc);
+        if (!t) { r->error = 1; return 0; }
+        r->text = t;
+        r->text_cap = nc;
+    }
+    memcpy(r->text + r->text_len, s, k);
+    r->text_len += k;
+    o->n += k;
+    return 1;
+}
+
+/* ajoute un point de code en UTF-8 */
+static int put_utf8(JsonReader* r, JrOut* o, unsigned cp) {
+    char tmp[4]; int k;
+    if (cp < 0x80)        { tmp[0] = (char)cp; k = 1; }
+    else if (cp < 0x800)  { tmp[0] = (char)(0xC0 | (cp >> 6)); tmp[1] = (char)(0x80 | (cp & 0x3F)); k = 2; }
+    else if (cp < 0x10000){ tmp[0] = (char)(0xE0 | (cp >> 12)); tmp[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                            tmp[2] = (char)(0x80 | (cp & 0x3F)); k = 3; }
+    else                  { tmp[0] = (char)(0xF0 | (cp >> 18)); tmp[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+                            tmp[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); tmp[3] = (char)(0x80 | (cp & 0x3F)); k = 4; }
+    return jr_put(r, o, tmp, (size_t)k);
+}
+
+/**
+ * Lit une chaîne JSON (guillemet ouvrant compris) en décodant les échappements.
+ * o peut être NULL pour simplement sauter la chaîne ; la chaîne écrite est
+ * terminée par '\0'.
+ */
+static int jr_string_to(JsonReader* r, JrOut* o) {
+    if (!jr_expect(r, '"')) return 0;
+    for (;;) {
+        // chemin rapide : copie directe du bloc courant jusqu'au prochain '"' ou '\\'
+        size_t from = r->pos;
+        while (r->pos < r->len && r->buf[r->pos] != '"' && r->buf[r->pos] != '\\') r->pos++;
+        if (!jr_put(r, o, r->buf + from, r->pos - from)) return 0;
+        int c = jr_get(r);
+        if (c == EOF) { r->error = 1; return 0; }
+        if (c == '"') break;
+        int ok = 1;
+        if (c != '\\') {
+            // fin de bloc au milieu de la chaîne : caractère ordinaire
+            char ch = (char)c;
+            if (!jr_put(r, o, &ch, 1)) return 0;
+            continue;
+        }
+        c = jr_get(r);
+        switch (c) {
+            case '"': case '\\': case '/': ok = put_utf8(r, o, (unsigned)c); break;
+            case 'b': ok = put_utf8(r, o, '\b'); break;
+            case 'f': ok = put_utf8(r, o, '\f'); break;
+            case 'n': ok = put_utf8(r, o, '\n'); break;
+            case 'r': ok = put_utf8(r, o, '\r'); break;
+            case 't': ok = put_utf8(r, o, '\t'); break;
+            case 'u': {
+                int cp = read_hex4(r);
+                if (cp < 0) { r->error = 1; return 0; }
+                // paire de substitution UTF-16
+                if (cp >= 0xD800 && cp <= 0xDBFF && jr_peek(r) == '\\') {
+                    r->pos++;
+                    int lo = jr_get(r) == 'u' ? read_hex4(r) : -1;
+                    if (lo < 0xDC00 || lo > 0xDFFF) { r->error = 1; return 0; }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                ok = put_utf8(r, o, (unsigned)cp);
+                break;
+            }
+            default: r->error = 1; return 0;
         }
-        p = q+1;
+        if (!ok) return 0;
     }
-    free(buf);
-    return inserted;
+    if (!o) return 1;
+    if (!o->grow) {
+        if (o->cap) o->p[o->n] = '\0';
+        return 1;
+    }
+    // terminateur gardé dans le tampon, hors de la longueur
+    if (!jr_put(r, o, "", 1)) return 0;
+    o->n--;
+    return 1;
+}
+
+/* chaîne dans un tampon fixe (tronquée s'il est plein), ou sautée si out est NULL */
+static int jr_string(JsonReader* r, char* out, size_t cap) {
+    JrOut o = { out, 0, cap, 0 };
+    return jr_string_to(r, out ? &o : NULL);
+}
+
+/* chaîne entière ajoutée au tampon texte : champ k de la station */
+static int jr_field(JsonReader* r, JsonStation* st, int k) {
+    JrOut o = { NULL, 0, 0, 1 };
+    size_t off = r->text_len;
+    if (!jr_string_to(r, &o)) return 0;
+    st->off[k] = off;
+    st->len[k] = (int)o.n;
+    return 1;
+}
+
+/* texte d'un nombre JSON, copié dans tmp ; renvoie sa longueur (0 si erreur) */
+static size_t jr_number_text(JsonReader* r, char* tmp, size_t cap) {
+    size_t n = 0;
+    int c = jr_peek_token(r);
+    while (c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E' || (c >= '0' && c <= '9')) {
+        if (n + 1 < cap) tmp[n++] = (char)c;
+        r->pos++;
+        c = jr_peek(r);
+    }
+    if (n == 0) r->error = 1;
+    tmp[n] = '\0';
+    return n;
+}
+
+/* nombre JSON lu comme double puis tronqué en entier */
+static int jr_number(JsonReader* r, int* out) {
+    char tmp[64];
+    if (!jr_number_text(r, tmp, sizeof tmp)) return 0;
+    *out = (int)strtod(tmp, NULL);
+    return 1;
+}
+
+/**
+ * Saute une valeur quelconque (objets et tableaux imbriqués compris).
+ * Seule la profondeur est mémorisée : coût mémoire constant.
+ */
+static int jr_skip_value(JsonReader* r) {
+    int depth = 0;
+    do {
+        int c = jr_peek_token(r);
+        if (c == EOF) { r->error = 1; return 0; }
+        if (c == '"') { if (!jr_string(r, NULL, 0)) return 0; continue; }
+        r->pos++;
+        if (c == '{' || c == '[') depth++;
+        else if (c == '}' || c == ']') depth--;
+        else if (c == ',' || c == ':') { if (depth == 0) { r->error = 1; return 0; } }
+        else {
+            // littéral (nombre, true, false, null) : on avance jusqu'au délimiteur
+            while ((c = jr_peek(r)) != EOF && c != ',' && c != '}' && c != ']'
+                   && c != ' ' && c != '\n' && c != '\r' && c != '\t') r->pos++;
+        }
+    } while (depth > 0);
+    return depth == 0;
+}
+
+/* entier accepté sous forme de nombre ou de chaîne ("22") */
+static int jr_int_value(JsonReader* r, int* out) {
+    if (jr_peek_token(r) == '"') {
+        char tmp[32];
+        if (!jr_string(r, tmp, sizeof tmp)) return 0;
+        *out = (int)strtod(tmp, NULL);
+        return 1;
+    }
+    if (jr_peek_token(r) == 'n') return jr_skip_value(r); // null
+    return jr_number(r, out);
+}
+
+/* coordonnée en microdegrés, nombre ou chaîne ("47.45") ; null laisse SP_NO_POS */
+static int jr_coord_value(JsonReader* r, int* out) {
+    char tmp[64];
+    size_t n;
+    int c = jr_peek_token(r);
+    if (c == 'n') return jr_skip_value(r);
+    if (c == '"') {
+        if (!jr_string(r, tmp, sizeof tmp)) return 0;
+        n = strlen(tmp);
+    } else if (!(n = jr_number_text(r, tmp, sizeof tmp))) return 0;
+    *out = sp_parse_coord(tmp, (int)n);
+    return 1;
+}
+
+/* lit un objet station en une passe ; les champs inconnus sont sautés */
+static int jr_station(JsonReader* r, JsonStation* st) {
+    st->power = 0;
+    st->slots = 0;
+    st->lat_e6 = st->lon_e6 = SP_NO_POS;
+    // champs absents : la chaîne vide en tête du tampon texte
+    r->text_len = 0;
+    JrOut empty = { NULL, 0, 0, 1 };
+    if (!jr_put(r, &empty, "", 1)) return 0;
+    for (int k = 0; k < 6; k++) { st->off[k] = 0; st->len[k] = 0; }
+    if (!jr_expect(r, '{')) return 0;
+    if (jr_peek_token(r) == '}') { r->pos++; return 1; }
+    for (;;) {
+        char key[JR_KEY_MAX];
+        if (!jr_string(r, key, sizeof key) || !jr_expect(r, ':')) return 0;
+
+        int ok = -1;
+        int is_str = jr_peek_token(r) == '"';
+        if (strcmp(key, "id_station_itinerance") == 0 && is_str)
+            ok = jr_field(r, st, 0);
+        else if (strcmp(key, "puissance_nominale") == 0) ok = jr_int_value(r, &st->power);
+        else if (strcmp(key, "nbre_pdc") == 0)            ok = jr_int_value(r, &st->slots);
+        else if (strcmp(key, "latitude") == 0)            ok = jr_coord_value(r, &st->lat_e6);
+        else if (strcmp(key, "longitude") == 0)           ok = jr_coord_value(r, &st->lon_e6);
+        else if (is_str) {
+            for (int k = 0; k < 5 && ok < 0; k++)
+                if (strcmp(key, TEXT_KEYS[k]) == 0) ok = jr_field(r, st, k + 1);
+        }
+        if (ok < 0) ok = jr_skip_value(r);
+        if (!ok) return 0;
+
+        int c = jr_peek_token(r);
+        r->pos += (c != EOF);
+        if (c == '}') return 1;
+        if (c != ',') { r->error = 1; return 0; }
+    }
+}
+
+/* nombre après le dernier '_', -1 s'il n'y en a pas */
+static int suffix_id(const char* s) {
+    const char* us = strrchr(s, '_');
+    if (!us || !us[1]) return -1;
+    return atoi(us + 1);
+}
+
+int ds_scan_stations_from_json(const char* path, StationRowFn fn, void* ctx) {
+    METRIC_TIMER(t0);
+    JsonReader* r = (JsonReader*)malloc(sizeof(JsonReader));
+    if (!r) return -1;
+    r->f = fopen(path, "rb");
+    if (!r->f) { free(r); return -1; }
+    r->pos = r->len = 0;
+    r->text = NULL;
+    r->text_len = r->text_cap = 0;
+    r->error = 0;
+
+    int rows = 0;
+    if (jr_expect(r, '[') && jr_peek_token(r) != ']') {
+        for (;;) {
+            if (jr_peek_token(r) == '{') {
+                JsonStation st;
+                if (!jr_station(r, &st)) break;
+                if (st.len[0]) {
+                    const char* id = r->text + st.off[0];
+                    StationRow row;
+                    row.station_id       = suffix_id(id);
+                    row.itinerance.p     = id;
+                    row.itinerance.len   = st.len[0];
+                    row.info.power_kW    = st.power ? st.power : 50;
+                    row.info.price_cents = 300;
+                    row.info.slots_free  = st.slots ? st.slots : 2;
+                    row.info.last_ts     = 0;
+                    row.nbre_pdc         = row.info.slots_free;
+                    int has_pos          = st.lat_e6 != SP_NO_POS && st.lon_e6 != SP_NO_POS;
+                    row.lat_e6           = has_pos ? st.lat_e6 : SP_NO_POS;
+                    row.lon_e6           = has_pos ? st.lon_e6 : SP_NO_POS;
+                    MetaText* f[5] = { &row.text.operator_name, &row.text.name, &row.text.address,
+                                       &row.text.insee, &row.text.access };
+                    for (int k = 0; k < 5; k++) { f[k]->p = r->text + st.off[k + 1]; f[k]->len = st.len[k + 1]; }
+                    fn(ctx, &row);
+                    rows++;
+                }
+            } else if (!jr_skip_value(r)) break;
+
+            int c = jr_peek_token(r);
+            r->pos += (c != EOF);
+            if (c == ']') break;
+            if (c != ',') { r->error = 1; break; }
+        }
+    }
+    int error = r->error;
+    fclose(r->f);
+    free(r->text);
+    free(r);
+    METRIC_INC(MC_LOADS);
+    METRIC_ADD(MC_ROWS_LOADED, error ? 0 : rows);
+    METRIC_TIMER_STOP(MH_LOAD_NS, t0);
+    return error ? -1 : rows;
+}
+
+int ds_load_stations_from_json(const char* path, StationIndex* idx) {
+    return ds_scan_stations_from_json(path, ds_row_insert, idx);
 }
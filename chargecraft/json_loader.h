@@ -1,5 +1,28 @@
 #ifndef DS_JSON_LOADER_H
 #define DS_JSON_LOADER_H
 #include "station_index.h"
+#include "station_row.h"
+
+/**
+ * Charge un tableau JSON de stations IRVE en flux (blocs de taille fixe, une passe
+ * par objet). Les valeurs imbriquées, les échappements et les '}' dans les chaînes
+ * sont gérés ; la mémoire reste constante quel que soit le nombre de stations.
+ *
+ * @param path Chemin du fichier JSON.
+ * @param idx Index de destination (identifiants : voir ds_row_resolve).
+ * @return Nombre de stations lues, -1 si le fichier est illisible ou mal formé
+ *         (les stations lues avant l'erreur restent insérées).
+ */
 int ds_load_stations_from_json(const char* path, StationIndex* idx);
+
+/**
+ * Parcourt les stations du JSON en flux sans toucher à aucun index.
+ *
+ * @param path Chemin du fichier JSON.
+ * @param fn Fonction appelée pour chaque station, dans l'ordre du fichier.
+ * @param ctx Contexte transmis à fn.
+ * @return Nombre de stations transmises, -1 si le fichier est illisible ou mal formé.
+ */
+int ds_scan_stations_from_json(const char* path, StationRowFn fn, void* ctx);
+
 #endif
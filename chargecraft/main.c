@@ -5,14 +5,29 @@
 #include "slist.h"
 #include "queue.h"
 #include "events.h"
+#include "rules.h"
+#include "rule_plan.h"
+#include "pipeline.h"
+#include "connector.h"
+#include "subscribe.h"
+#include "query_cache.h"
+#include "geo.h"
+#include "nary_flat.h"
+#include "spatial.h"
+#include "recommend.h"
+#include "sim.h"
+#include "metrics.h"
 
 
 #define NB_VEHICULES_SIMULES 8
 #define MAX_VEH_ID 20
 #define MRU_CAPACITY 5
 
-// Prototype manuel
-void rules_top_n_print(StationIndex* idx, char* tokens[], int token_count, int n);
+/* notification d'abonnement : la station entre dans la règle ou en sort */
+static void print_alert(void* ctx, int sub_id, int station_id, int matched) {
+    (void)ctx;
+    printf("  [ALERTE #%d] station %d %s\n", sub_id, station_id, matched ? "correspond" : "ne correspond plus");
+}
 
 /**
  * @brief Fonction principale du programme de simulation ChargeCraft.
@@ -25,7 +40,6 @@ void rules_top_n_print(StationIndex* idx, char* tokens[], int token_count, int n
  */
 int main(void) {
     printf("=== CHARGECRAFT: DEMO FLOTTE (%d VEHICULES) ===\n\n", NB_VEHICULES_SIMULES);
-    srand(time(NULL));
 
     // --- 1. INITIALISATION DES STRUCTURES ---
     // mise en place des index, file d'événements et historique MRU par véhicule
@@ -51,65 +65,90 @@ int main(void) {
     si_add(&idx, 103, (StationInfo){100, 60, 1, 0});
     si_add(&idx, 104, (StationInfo){150, 70, 0, 0}); // Saturée
     si_add(&idx, 105, (StationInfo){22, 25, 10, 0}); // Vide
-    
+
+    // hiérarchie géographique : communes INSEE des stations de démonstration
+    GeoTree geo;
+    if (geo_init(&geo)) {
+        static const struct { int id; const char* insee; int pdc; } COMMUNES[] = {
+            {101, "42218", 6}, {102, "42207", 2}, {103, "69123", 2}, {104, "75056", 4}, {105, "2A004", 10},
+        };
+        idx.geo = &geo;
+        for (int i = 0; i < 5; i++) {
+            StationNode* s = si_find(idx.root, COMMUNES[i].id);
+            if (s) geo_add(&geo, s->station_id, COMMUNES[i].insee, 5, COMMUNES[i].pdc, &s->info);
+        }
+    }
+
+    // positions des stations (microdegrés), pour les recommandations
+    SpatialIndex spatial;
+    if (sp_init(&spatial, 0)) {
+        static const struct { int id, lat_e6, lon_e6; } POSITIONS[] = {
+            {101, 45439700, 4387200}, {102, 45477500, 4515300}, {103, 45764000, 4835700},
+            {104, 48856600, 2352200}, {105, 41919200, 8738600},
+        };
+        idx.spatial = &spatial;
+        for (int i = 0; i < 5; i++) sp_set(&spatial, POSITIONS[i].id, POSITIONS[i].lat_e6, POSITIONS[i].lon_e6);
+    }
+
     // Affichage technique
     printf("Aperçu initial (Sideways) :\n");
     si_print_sideways(idx.root);
     printf("---------------------------------------------------\n");
 
 
-    // --- 3. INGESTION (DS_EVENTS + Simulation Aléatoire) ---
-    // chargement des événements historique, puis génération aléatoire de trafic pour simulation
+    // --- 3. INGESTION (DS_EVENTS) ---
+    // chargement des événements historiques ; le trafic simulé est appliqué après eux
     // A. Chargement des événements statiques (Fichier fourni)
     printf("[INGESTION] Chargement de %d événements historiques (DS_EVENTS)...\n", DS_EVENTS_COUNT);
     for (int i = 0; i < DS_EVENTS_COUNT; i++) {
         q_enqueue(&q, DS_EVENTS[i]);
     }
 
-    // B. Génération de trafic pour atteindre 8 véhicules actifs
-    printf("[INGESTION] Génération de trafic supplémentaire pour les véhicules 1 à %d...\n", NB_VEHICULES_SIMULES);
-    int stations_dispo[] = {101, 102, 103, 104, 105};
-    int ts_simu = 2000; // Timestamp fictif futur
-
-    for (int v = 1; v <= NB_VEHICULES_SIMULES; v++) {
-        // Chaque véhicule fait 2 actions aléatoires
-        for (int k = 0; k < 2; k++) {
-            int st_alea = stations_dispo[rand() % 5];
-            
-            // Événement 1: Se branche
-            Event e_in = { .ts = ts_simu++, .vehicle_id = v, .station_id = st_alea, .action = 1 };
-            q_enqueue(&q, e_in);
-
-            // Événement 2: Se débranche (un peu plus tard)
-            Event e_out = { .ts = ts_simu++, .vehicle_id = v, .station_id = st_alea, .action = 0 };
-            q_enqueue(&q, e_out);
-        }
-    }
-
-
     // --- 4. TRAITEMENT DU FLUX ---
     // parcours de la file d'événements, mise à jour des stations et historiques MRU
     printf("[PROCESS] Traitement de la file d'événements...\n");
-    Event e;
-    while(q_dequeue(&q, &e)) {
-        StationNode* node = si_find(idx.root, e.station_id);
-        if (node) {
-            node->info.last_ts = e.ts;
-
-            if (e.action == 1) { // PLUG IN
-                if (node->info.slots_free > 0) node->info.slots_free--;
-                
-                // GESTION MRU
-                // Vérification de sécurité sur l'ID
-                if (e.vehicle_id >= 0 && e.vehicle_id < MAX_VEH_ID) {
-                    ds_slist_update_mru(&flotte_mru[e.vehicle_id], e.station_id, MRU_CAPACITY);
-                }
-
-            } else if (e.action == 0) { // UNPLUG
-                node->info.slots_free++;
-            }
-        }
-    }
+    // alertes permanentes, réévaluées seulement quand une station peut les faire basculer
+    SubEngine subs;
+    sub_init(&subs, print_alert, NULL);
+    sub_register(&subs, "power >= 100 && slots >= 1", NULL, 0);
+    sub_register(&subs, "id == 105 && slots < 10", NULL, 0);
+
+    // requête mise en cache avant le flux : ses entrées sont réparées au fil des événements
+    RuleIndexes ri;
+    ri_init(&ri);
+    QueryCache qc;
+    const int* top = NULL;
+    int cached = qc_init(&qc, &idx, &ri, 16);
+    if (cached) qc_query(&qc, "power >= 50 && slots >= 1", QC_BY_SLOTS, 3, &top);
+
+    Pipeline pl;
+    pl_init(&pl, &idx, flotte_mru, MAX_VEH_ID, MRU_CAPACITY);
+    pl.subs = &subs;
+    if (cached) pl.cache = &qc;
+    // un bit par point de charge : les débranchements en trop ne gonflent plus slots_free
+    ConnStore conns;
+    cn_init(&conns);
+    if (cn_attach(&conns, &idx) >= 0) idx.conns = &conns;
+    pl_drain(&pl, &q);
+
+    // B. Trafic simulé en temps discret pour les véhicules 1 à 8 (voir sim.h)
+    printf("[SIMULATION] Trafic des véhicules 1 à %d sur 6 h simulées...\n", NB_VEHICULES_SIMULES);
+    SimConfig sim_cfg;
+    sim_default_config(&sim_cfg, NB_VEHICULES_SIMULES);
+    sim_cfg.seed = (uint64_t)time(NULL);
+    sim_cfg.start_ts = 7 * 3600;      // 7 h du matin, après les événements historiques
+    sim_cfg.duration_s = 6 * 3600;
+    sim_cfg.sessions_per_day = 4.0;   // une à deux sessions par véhicule sur la période
+    sim_cfg.session_median_min = 30.0;
+    sim_cfg.zipf_s = 0.5;             // cinq stations : popularité peu marquée
+    sim_cfg.verbose = 1;
+    SimStats sim_stats;
+    if (sim_run(&pl, &sim_cfg, &sim_stats)) sim_print_stats(&sim_stats);
+    sub_print_stats(&subs);
+    sub_clear(&subs);
+    if (idx.conns) cn_print_stats(&conns);
+    idx.conns = NULL;
+    cn_clear(&conns);
     printf("Traitement terminé.\n");
     printf("---------------------------------------------------\n");
 
@@ -128,9 +167,55 @@ int main(void) {
     // B. Requête Top-N
     char* rules[] = { "power", "50", ">=", "slots", "1", ">=", "&&" };
     printf("\n[DEMO 2] Top-3 Stations (Power >= 50 && Slots >= 1) :\n");
-    rules_top_n_print(&idx, rules, 7, 3);
+    rules_top_n_print(&idx, rules, 7, 3, NULL);
+
+    // même famille de requête en infixe, avec le plan choisi
+    printf("\n[DEMO 2b] Règle infixe planifiée :\n");
+    rules_query_print(&idx, &ri, "power >= 50 && (slots >= 1 || price < 40)", 3);
+
+    // même règle écrite autrement : même entrée de cache, servie sans parcours
+    if (cached) {
+        printf("\n[DEMO 2c] Top-3 par créneaux libres (cache) :\n");
+        int nt = qc_query(&qc, "power > 49 and slots > 0", QC_BY_SLOTS, 3, &top);
+        for (int i = 0; i < nt; i++) {
+            StationNode* s = si_find(idx.root, top[i]);
+            printf("  %d. Station %d | Slots: %d | Power: %d kW\n",
+                   i + 1, top[i], s ? s->info.slots_free : -1, s ? s->info.power_kW : -1);
+        }
+        qc_query(&qc, "power >= 50 && slots >= 1", QC_BY_SLOTS, 3, &top);  // relecture : succès
+        qc_print_stats(&qc);
+        qc_clear(&qc);
+    }
+    ri_clear(&ri);
+
+    // C. Agrégats géographiques, tenus à jour par le pipeline
+    if (idx.geo) {
+        printf("\n[DEMO 2d] Réseau par région et département :\n");
+        geo_print(&geo, GEO_DEPARTMENT);
+        const NNode* loire = geo_department(&geo, "42");
+        printf("  Créneaux rapides libres dans le département 42 : %d\n", loire ? loire->agg.fast_slots_free : 0);
+
+        // instantané figé : même réponse par requête de sous-arbre sur le parcours d'Euler
+        NFlat snap;
+        if (nf_freeze(&snap, geo.root)) {
+            NAgg a;
+            nf_subtree(&snap, nf_position(&snap, loire), NULL, &a);
+            printf("  Instantané figé (%d noeuds), département 42 : %d\n", snap.count, a.fast_slots_free);
+            nf_clear(&snap);
+        }
+    }
+
+    // D. Recommandation personnalisée : distance, prix, puissance, créneaux et historique MRU
+    if (idx.spatial) {
+        printf("\n[DEMO 2e] Recommandations pour le véhicule 1 (à Saint-Étienne) :\n");
+        RecResult reco[3];
+        int nr = rec_top_k(&idx, &spatial, &flotte_mru[1], 45434000, 4390000, 3, NULL, reco, NULL);
+        for (int i = 0; i < nr; i++)
+            printf("  %d. Station %d | %.1f km | score %.2f\n", i + 1, reco[i].station_id, reco[i].distance_km,
+                   reco[i].score);
+    }
 
-    // C. Affichage visuel final
+    // E. Affichage visuel final
     printf("\n[DEMO 3] État final du réseau (Visualisation Top-Down) :\n");
     si_print_pretty(&idx);
     
@@ -138,10 +223,17 @@ int main(void) {
     printf("\n(Debug: Structure interne Sideways)\n");
     si_print_sideways(idx.root);
 
+#ifdef CC_METRICS
+    // compilé avec make METRICS=1 : compteurs et latences de toute la démo
+    printf("\n");
+    metrics_dump_text(stdout);
+#endif
 
     // --- 6. NETTOYAGE ---
     // libération de toutes les ressources allouées pour éviter les fuites mémoire
     si_clear(&idx);
+    geo_clear(&geo);
+    sp_clear(&spatial);
     q_clear(&q);
     // Nettoyage de chaque liste de la flotte
     for (int i = 0; i < MAX_VEH_ID; i++) {
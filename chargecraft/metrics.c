@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+#include "metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CC_METRICS
+#include <pthread.h>
+#include <time.h>
+
+static const char* COUNTER_NAMES[MC_COUNT] = {
+    "events", "events_rejected", "si_find", "allocs", "queue_enqueue", "queue_dequeue", "rule_evals",
+    "events_unknown", "si_add", "si_delete", "loads", "rows_loaded", "events_stray",
+};
+
+static const struct { const char* name; const char* unit; int sampled; } HISTS[MH_COUNT] = {
+    { "event_apply", "ns", 1 },
+    { "si_find_depth", "noeuds", 1 },
+    { "rule_eval", "ns", 1 },
+    { "load", "ns", 0 },
+};
+
+_Thread_local MetricsShard* metrics_tls;
+volatile sig_atomic_t metrics_dump_requested;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static MetricsShard* registry;          /* toutes les tranches, threads terminés compris */
+static int registry_count;
+static char* signal_path;               /* destination du vidage sur signal, NULL : stderr */
+
+MetricsShard* metrics_attach(void) {
+    // sizeof est un multiple de l'alignement, comme l'exige aligned_alloc
+    MetricsShard* s = (MetricsShard*)aligned_alloc(METRICS_LINE, sizeof(MetricsShard));
+    if (!s) abort();
+    memset(s, 0, sizeof *s);
+    pthread_mutex_lock(&registry_lock);
+    s->next = registry;
+    registry = s;
+    registry_count++;
+    pthread_mutex_unlock(&registry_lock);
+    metrics_tls = s;
+    return s;
+}
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* somme de toutes les tranches */
+typedef struct MetricsView {
+    unsigned long long counters[MC_COUNT];
+    unsigned long long hist[MH_COUNT][MH_BUCKETS];
+    unsigned long long count[MH_COUNT];
+    unsigned long long sum[MH_COUNT];
+    unsigned long long max[MH_COUNT];
+    int threads;
+} MetricsView;
+
+static void merge(MetricsView* v) {
+    memset(v, 0, sizeof *v);
+    pthread_mutex_lock(&registry_lock);
+    v->threads = registry_count;
+    for (MetricsShard* s = registry; s; s = s->next) {
+        for (int c = 0; c < MC_COUNT; c++)
+            v->counters[c] += atomic_load_explicit(&s->counters[c], memory_order_relaxed);
+        for (int h = 0; h < MH_COUNT; h++) {
+            for (int b = 0; b < MH_BUCKETS; b++) {
+                unsigned long long n = atomic_load_explicit(&s->hist[h][b], memory_order_relaxed);
+                v->hist[h][b] += n;
+                v->count[h] += n;
+            }
+            v->sum[h] += atomic_load_explicit(&s->hist_sum[h], memory_order_relaxed);
+            unsigned long long m = atomic_load_explicit(&s->hist_max[h], memory_order_relaxed);
+            if (m > v->max[h]) v->max[h] = m;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+/* événements appliqués : ni refusés, ni ignorés, ni sur une station inconnue */
+static unsigned long long applied(const MetricsView* v) {
+    return v->counters[MC_EVENTS] - v->counters[MC_EVENTS_REJECTED] - v->counters[MC_EVENTS_STRAY] -
+           v->counters[MC_EVENTS_UNKNOWN];
+}
+
+/* plus grande valeur du seau b */
+static unsigned long long bucket_high(int b) {
+    if (b < MH_SUB) return (unsigned long long)b;
+    int e = b / MH_SUB + MH_SUB_BITS - 1;
+    unsigned long long low = (unsigned long long)(MH_SUB + b % MH_SUB) << (e - MH_SUB_BITS);
+    return low + (1ull << (e - MH_SUB_BITS)) - 1;
+}
+
+/* quantile q (0..1) au seau près, borné par le maximum observé */
+static unsigned long long quantile(const MetricsView* v, int h, double q) {
+    if (v->count[h] == 0) return 0;
+    unsigned long long rank = (unsigned long long)(q * v->count[h]);
+    if (rank >= v->count[h]) rank = v->count[h] - 1;
+    unsigned long long seen = 0;
+    for (int b = 0; b < MH_BUCKETS; b++) {
+        seen += v->hist[h][b];
+        if (seen > rank) {
+            unsigned long long hi = bucket_high(b);
+            return hi < v->max[h] ? hi : v->max[h];
+        }
+    }
+    return v->max[h];
+}
+
+void metrics_dump_text(FILE* f) {
+    MetricsView* v = (MetricsView*)malloc(sizeof(MetricsView));
+    if (!v) return;
+    merge(v);
+    fprintf(f, "=== Métriques (%d thread(s), durées échantillonnées 1/%d) ===\n", v->threads, METRICS_SAMPLE_EVERY);
+    for (int c = 0; c < MC_COUNT; c++) fprintf(f, "  %-20s %14llu\n", COUNTER_NAMES[c], v->counters[c]);
+    fprintf(f, "  %-20s %14llu\n", "events_applied", applied(v));
+    fprintf(f, "  %-20s %14lld\n", "queue_depth",
+            (long long)(v->counters[MC_Q_ENQUEUE] - v->counters[MC_Q_DEQUEUE]));
+    for (int h = 0; h < MH_COUNT; h++) {
+        fprintf(f, "  %-14s n=%-10llu moy %.1f  p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu %s%s\n",
+                HISTS[h].name, v->count[h], v->count[h] ? (double)v->sum[h] / v->count[h] : 0.0,
+                quantile(v, h, 0.50), quantile(v, h, 0.90), quantile(v, h, 0.99), quantile(v, h, 0.999),
+                v->max[h], HISTS[h].unit, HISTS[h].sampled ? " (échantillonné)" : "");
+    }
+    free(v);
+}
+
+void metrics_dump_json(FILE* f) {
+    MetricsView* v = (MetricsView*)malloc(sizeof(MetricsView));
+    if (!v) return;
+    merge(v);
+    fprintf(f, "{\"enabled\": true, \"threads\": %d, \"sample_every\": %d, \"counters\": {",
+            v->threads, METRICS_SAMPLE_EVERY);
+    for (int c = 0; c < MC_COUNT; c++) fprintf(f, "%s\"%s\": %llu", c ? ", " : "", COUNTER_NAMES[c], v->counters[c]);
+    fprintf(f, "}, \"gauges\": {\"events_applied\": %llu, \"queue_depth\": %lld}, \"histograms\": {",
+            applied(v), (long long)(v->counters[MC_Q_ENQUEUE] - v->counters[MC_Q_DEQUEUE]));
+    for (int h = 0; h < MH_COUNT; h++) {
+        fprintf(f, "%s\"%s\": {\"unit\": \"%s\", \"sampled\": %s, \"count\": %llu, \"sum\": %llu, "
+                   "\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}",
+                h ? ", " : "", HISTS[h].name, HISTS[h].unit, HISTS[h].sampled ? "true" : "false",
+                v->count[h], v->sum[h], quantile(v, h, 0.50), quantile(v, h, 0.90), quantile(v, h, 0.99),
+                quantile(v, h, 0.999), v->max[h]);
+    }
+    fprintf(f, "}}\n");
+    free(v);
+}
+
+static void on_signal(int signo) {
+    (void)signo;
+    metrics_dump_requested = 1;
+}
+
+int metrics_on_signal(int signo, const char* path) {
+    char* copy = path ? strdup(path) : NULL;
+    if (path && !copy) return 0;
+    free(signal_path);
+    signal_path = copy;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    return sigaction(signo, &sa, NULL) == 0;
+}
+
+void metrics_poll_dump(void) {
+    metrics_dump_requested = 0;
+    metrics_dump_path(signal_path);
+}
+
+void metrics_reset(void) {
+    pthread_mutex_lock(&registry_lock);
+    for (MetricsShard* s = registry; s; s = s->next) {
+        for (int c = 0; c < MC_COUNT; c++) atomic_store_explicit(&s->counters[c], 0, memory_order_relaxed);
+        for (int h = 0; h < MH_COUNT; h++) {
+            for (int b = 0; b < MH_BUCKETS; b++) atomic_store_explicit(&s->hist[h][b], 0, memory_order_relaxed);
+            atomic_store_explicit(&s->hist_sum[h], 0, memory_order_relaxed);
+            atomic_store_explicit(&s->hist_max[h], 0, memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+#else
+
+void metrics_dump_text(FILE* f) {
+    fprintf(f, "=== Métriques désactivées (compiler avec make METRICS=1) ===\n");
+}
+
+void metrics_dump_json(FILE* f) {
+    fprintf(f, "{\"enabled\": false}\n");
+}
+
+int metrics_on_signal(int signo, const char* path) {
+    (void)signo; (void)path;
+    return 0;
+}
+
+void metrics_reset(void) {}
+
+#endif
+
+int metrics_dump_path(const char* path) {
+    if (!path) {
+        metrics_dump_text(stderr);
+        return 1;
+    }
+    FILE* f = fopen(path, "w");
+    if (!f) return 0;
+    size_t n = strlen(path);
+    if (n >= 5 && strcmp(path + n - 5, ".json") == 0) metrics_dump_json(f);
+    else metrics_dump_text(f);
+    return fclose(f) == 0;
+}
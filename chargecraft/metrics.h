@@ -0,0 +1,177 @@
+#ifndef DS_METRICS_H
+#define DS_METRICS_H
+#include <stdio.h>
+
+/**
+ * @brief Instrumentation des chemins chauds : compteurs et histogrammes de latence.
+ *
+ * Active seulement si le code est compilé avec -DCC_METRICS (make METRICS=1) ;
+ * sinon les macros METRIC_* ne génèrent aucun code et les fonctions de
+ * vidage signalent que les métriques sont désactivées.
+ *
+ * Chaque thread écrit dans sa propre tranche (compteurs et histogrammes),
+ * créée au premier usage et jamais libérée : aucune instruction atomique
+ * verrouillée ni partage de ligne de cache sur le chemin chaud. La lecture
+ * additionne les tranches de tous les threads, terminés compris.
+ *
+ * Les histogrammes sont à seaux logarithmiques à la manière de HDR : 16 seaux
+ * linéaires par puissance de deux (erreur relative < 6,25 %) jusqu'à 2^40.
+ * Les durées (et profondeurs) des opérations fréquentes ne sont relevées qu'une
+ * fois sur METRICS_SAMPLE_EVERY, d'après leur propre compteur : le compteur,
+ * lui, reste exact et sert de cadence sans écriture supplémentaire.
+ */
+
+#ifndef METRICS_SAMPLE_EVERY
+#define METRICS_SAMPLE_EVERY 64     /* puissance de deux */
+#endif
+
+/* les huit premiers, les plus fréquents, tiennent dans une ligne de cache */
+typedef enum MetricCounter {
+    MC_EVENTS,              /* appels à pl_apply */
+    MC_EVENTS_REJECTED,     /* branchement refusé, station pleine */
+    MC_SI_FIND,
+    MC_ALLOCS,              /* noeuds alloués : index, file, listes MRU */
+    MC_Q_ENQUEUE,
+    MC_Q_DEQUEUE,
+    MC_RULE_EVALS,          /* eval_rule_postfix */
+    MC_EVENTS_UNKNOWN,      /* station absente de l'index */
+    MC_SI_ADD,
+    MC_SI_DELETE,
+    MC_LOADS,               /* fichiers lus par les chargeurs CSV / JSON */
+    MC_ROWS_LOADED,
+    MC_EVENTS_STRAY,        /* débranchement ignoré, aucun connecteur occupé (suivi des connecteurs) */
+    MC_COUNT
+} MetricCounter;
+
+typedef enum MetricHist {
+    MH_EVENT_APPLY_NS,      /* pl_apply, échantillonné */
+    MH_SI_FIND_DEPTH,       /* noeuds traversés par si_find, échantillonné */
+    MH_RULE_EVAL_NS,        /* eval_rule_postfix, échantillonné */
+    MH_LOAD_NS,             /* chargement complet d'un fichier */
+    MH_COUNT
+} MetricHist;
+
+#define MH_SUB_BITS 4
+#define MH_SUB (1 << MH_SUB_BITS)
+#define MH_MAX_EXP 40
+#define MH_BUCKETS ((MH_MAX_EXP - MH_SUB_BITS + 2) * MH_SUB)
+
+/**
+ * Vide les métriques fusionnées au format texte.
+ *
+ * @param f Destination.
+ */
+void metrics_dump_text(FILE* f);                    /* O(threads x seaux) */
+
+/**
+ * Vide les métriques fusionnées en JSON (un objet).
+ *
+ * @param f Destination.
+ */
+void metrics_dump_json(FILE* f);                    /* O(threads x seaux) */
+
+/**
+ * Vide les métriques vers un fichier : JSON si le nom finit par ".json", texte sinon.
+ *
+ * @param path Chemin du fichier, NULL pour la sortie d'erreur (texte).
+ * @return 1 si succès, 0 si le fichier ne peut pas être écrit.
+ */
+int  metrics_dump_path(const char* path);
+
+/**
+ * Demande un vidage à la réception du signal signo (par ex. SIGUSR1). Le
+ * gestionnaire ne fait que lever un drapeau ; le vidage a lieu au prochain
+ * METRIC_POLL(), appelé par la boucle d'événements (pl_apply).
+ *
+ * @param signo Signal à intercepter.
+ * @param path Destination du vidage (voir metrics_dump_path), copiée.
+ * @return 1 si le gestionnaire est installé, 0 sinon ou si les métriques sont désactivées.
+ */
+int  metrics_on_signal(int signo, const char* path);
+
+/* remet tous les compteurs et histogrammes à zéro ; à appeler quand aucun thread n'écrit */
+void metrics_reset(void);
+
+#ifdef CC_METRICS
+#include <stdatomic.h>
+#include <stdint.h>
+#include <signal.h>
+
+#define METRICS_LINE 64
+
+typedef struct MetricsShard {
+    _Alignas(METRICS_LINE) atomic_ullong counters[MC_COUNT];
+    atomic_ullong hist[MH_COUNT][MH_BUCKETS];
+    atomic_ullong hist_sum[MH_COUNT];
+    atomic_ullong hist_max[MH_COUNT];
+    struct MetricsShard* next;
+} MetricsShard;
+
+extern _Thread_local MetricsShard* metrics_tls;
+extern volatile sig_atomic_t metrics_dump_requested;
+
+MetricsShard* metrics_attach(void);
+uint64_t metrics_now_ns(void);
+void metrics_poll_dump(void);
+
+static inline MetricsShard* metrics_shard(void) {
+    MetricsShard* s = metrics_tls;
+    return s ? s : metrics_attach();
+}
+
+/* un seul écrivain par tranche : lecture + écriture relâchées, sans verrou de bus */
+static inline void metrics_bump(atomic_ullong* c, unsigned long long v) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static inline int metrics_bucket(uint64_t v) {
+    if (v < MH_SUB) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    if (e > MH_MAX_EXP) return MH_BUCKETS - 1;
+    return (e - MH_SUB_BITS + 1) * MH_SUB + (int)((v >> (e - MH_SUB_BITS)) & (MH_SUB - 1));
+}
+
+static inline void metrics_add(MetricCounter c, unsigned long long v) {
+    metrics_bump(&metrics_shard()->counters[c], v);
+}
+
+static inline void metrics_record(MetricHist h, uint64_t v) {
+    MetricsShard* s = metrics_shard();
+    metrics_bump(&s->hist[h][metrics_bucket(v)], 1);
+    metrics_bump(&s->hist_sum[h], v);
+    if (v > atomic_load_explicit(&s->hist_max[h], memory_order_relaxed))
+        atomic_store_explicit(&s->hist_max[h], v, memory_order_relaxed);
+}
+
+/* incrémente c ; 1 si cette occurrence est échantillonnée (une sur METRICS_SAMPLE_EVERY) */
+static inline int metrics_add_sampled(MetricCounter c) {
+    atomic_ullong* p = &metrics_shard()->counters[c];
+    unsigned long long n = atomic_load_explicit(p, memory_order_relaxed);
+    atomic_store_explicit(p, n + 1, memory_order_relaxed);
+    return (n & (METRICS_SAMPLE_EVERY - 1)) == 0;
+}
+
+#define METRIC_INC(c)               metrics_add((c), 1)
+#define METRIC_ADD(c, v)            metrics_add((c), (unsigned long long)(v))
+#define METRIC_INC_SAMPLED(c)       metrics_add_sampled(c)
+#define METRIC_RECORD(h, v)         metrics_record((h), (uint64_t)(v))
+#define METRIC_TIMER(t)             uint64_t t = metrics_now_ns()
+#define METRIC_TIMER_COUNTED(t, c)  uint64_t t = metrics_add_sampled(c) ? metrics_now_ns() : 0
+#define METRIC_TIMER_STOP(h, t)     do { if (t) metrics_record((h), metrics_now_ns() - (t)); } while (0)
+#define METRIC_POLL()               do { if (metrics_dump_requested) metrics_poll_dump(); } while (0)
+
+#else
+
+/* sizeof n'évalue pas son opérande mais le marque comme utilisé */
+#define METRIC_INC(c)               ((void)0)
+#define METRIC_ADD(c, v)            ((void)sizeof(v))
+#define METRIC_INC_SAMPLED(c)       0
+#define METRIC_RECORD(h, v)         ((void)sizeof(v))
+#define METRIC_TIMER(t)             ((void)0)
+#define METRIC_TIMER_COUNTED(t, c)  ((void)0)
+#define METRIC_TIMER_STOP(h, t)     ((void)0)
+#define METRIC_POLL()               ((void)0)
+
+#endif
+
+#endif
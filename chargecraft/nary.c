@@ -2,15 +2,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-typedef struct QN { NNode* v; struct QN* next; } QN;
-typedef struct { QN* head; QN* tail; } Q;
-static void qi(Q* q){ q->head=q->tail=0; }
-static int  qe(Q* q, NNode* n){ QN* x=(QN*)malloc(sizeof* x); if(!x) return 0; x->v=n; x->next=0; if(!q->tail) q->head=q->tail=x; else { q->tail->next=x; q->tail=x; } return 1; }
-static int  qd(Q* q, NNode** out){ QN* h=q->head; if(!h) return 0; if(out) *out=h->v; q->head=h->next; if(!q->head) q->tail=0; free(h); return 1; }
+// file de parcours : tableau agrandi par doublement, un seul malloc pour tout le parcours
+typedef struct { NNode** v; int head, tail, cap; } Q;
+static void qi(Q* q){ q->v=0; q->head=q->tail=q->cap=0; }
+static int  qe(Q* q, NNode* n){ if(q->tail==q->cap){ int nc=q->cap? q->cap*2 : 64; NNode** nv=(NNode**)realloc(q->v, sizeof(NNode*)*nc); if(!nv) return 0; q->v=nv; q->cap=nc; } q->v[q->tail++]=n; return 1; }
+static int  qd(Q* q, NNode** out){ if(q->head==q->tail) return 0; if(out) *out=q->v[q->head]; q->head++; return 1; }
 
 NNode* n_create(int id){
     NNode* n=(NNode*)malloc(sizeof* n); if(!n) return 0;
-    n->id=id; n->items_count=0; n->child=0; n->child_count=0; n->child_cap=0; return n;
+    n->id=id; n->items_count=0; n->child=0; n->child_count=0; n->child_cap=0;
+    n->parent=0; n->agg.connectors=n->agg.slots_free=n->agg.fast_slots_free=0; n->agg.power_kw=0;
+    return n;
 }
 int n_attach(NNode* parent, NNode* child){
     if(!parent||!child) return 0;
@@ -21,17 +23,41 @@ int n_attach(NNode* parent, NNode* child){
         parent->child = nb; parent->child_cap = nc;
     }
     parent->child[parent->child_count++] = child;
+    child->parent = parent;
     return 1;
 }
+int n_detach(NNode* child){
+    if(!child||!child->parent) return 0;
+    NNode* p = child->parent;
+    for(int i=0;i<p->child_count;i++){
+        if(p->child[i]==child){
+            // l'ordre des enfants n'est pas significatif : le dernier prend la place
+            p->child[i] = p->child[--p->child_count];
+            break;
+        }
+    }
+    child->parent = 0;
+    return 1;
+}
+void n_propagate(NNode* node, int items, const NAgg* d){
+    for(NNode* n=node; n; n=n->parent){
+        n->items_count += items;
+        n->agg.connectors += d->connectors;
+        n->agg.slots_free += d->slots_free;
+        n->agg.fast_slots_free += d->fast_slots_free;
+        n->agg.power_kw += d->power_kw;
+    }
+}
 void n_bfs_print(NNode* root){
     if(!root){ printf("(empty n-ary)\n"); return; }
     Q q; qi(&q); qe(&q, root);
-    while(q.head){
-        NNode* cur; qd(&q,&cur);
+    NNode* cur;
+    while(qd(&q,&cur)){
         printf("Node %d (items=%d) -> children: ", cur->id, cur->items_count);
         for(int i=0;i<cur->child_count;i++){ printf("%d ", cur->child[i]->id); qe(&q, cur->child[i]); }
         printf("\n");
     }
+    free(q.v);
 }
 static void n_clear_rec(NNode* r){
     if(!r) return;
@@ -1,15 +1,39 @@
 #ifndef DS_NARY_H
 #define DS_NARY_H
+
+/* agrégats d'un sous-arbre (voir geo.h) */
+typedef struct NAgg {
+    int connectors;        /* points de charge */
+    int slots_free;        /* créneaux libres */
+    int fast_slots_free;   /* créneaux libres des stations rapides */
+    long long power_kw;    /* puissance installée : puissance x points de charge */
+} NAgg;
+
 typedef struct NNode {
     int id;
-    int items_count;
+    int items_count;       /* éléments (stations) du sous-arbre */
     struct NNode** child;
     int child_count;
     int child_cap;
+    struct NNode* parent;  /* NULL pour la racine */
+    NAgg agg;
 } NNode;
 
 NNode* n_create(int id);
 int    n_attach(NNode* parent, NNode* child);
+
+/**
+ * Retire child de la liste des enfants de son parent (sans le libérer).
+ *
+ * @return 1 si child avait un parent, 0 sinon.
+ */
+int    n_detach(NNode* child);                                        /* O(enfants du parent) */
+
+/**
+ * Ajoute items et d à node puis à chacun de ses ancêtres.
+ */
+void   n_propagate(NNode* node, int items, const NAgg* d);           /* O(profondeur) */
+
 void   n_bfs_print(NNode* root);
 void   n_clear(NNode* root);
 
@@ -0,0 +1,212 @@
+#include "nary_flat.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void agg_add(NAgg* a, const NAgg* d) {
+    a->connectors += d->connectors;
+    a->slots_free += d->slots_free;
+    a->fast_slots_free += d->fast_slots_free;
+    a->power_kw += d->power_kw;
+}
+
+static void agg_sub(NAgg* a, const NAgg* d) {
+    a->connectors -= d->connectors;
+    a->slots_free -= d->slots_free;
+    a->fast_slots_free -= d->fast_slots_free;
+    a->power_kw -= d->power_kw;
+}
+
+static int src_slot(const NFlat* f, const NNode* node) {
+    int mask = f->src_cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uintptr_t)node) & (uint64_t)mask);
+    while (f->src[i] && f->src[i] != node) i = (i + 1) & mask;
+    return i;
+}
+
+static int count_nodes(const NNode* root) {
+    int count = 0, top = 0, cap = 64;
+    const NNode** stack = (const NNode**)malloc(sizeof(const NNode*) * cap);
+    if (!stack) return -1;
+    stack[top++] = root;
+    while (top) {
+        const NNode* n = stack[--top];
+        count++;
+        if (top + n->child_count > cap) {
+            while (top + n->child_count > cap) cap *= 2;
+            const NNode** ns = (const NNode**)realloc(stack, sizeof(const NNode*) * cap);
+            if (!ns) { free(stack); return -1; }
+            stack = ns;
+        }
+        for (int i = 0; i < n->child_count; i++) stack[top++] = n->child[i];
+    }
+    free(stack);
+    return count;
+}
+
+int nf_freeze(NFlat* f, const NNode* root) {
+    memset(f, 0, sizeof *f);
+    if (!root) return 1;
+    int n = count_nodes(root);
+    if (n < 0) return 0;
+    f->count = n;
+    f->src_cap = 16;
+    while (f->src_cap < 2 * n) f->src_cap *= 2;
+
+    f->id = (int*)malloc(sizeof(int) * n);
+    f->parent = (int*)malloc(sizeof(int) * n);
+    f->end = (int*)malloc(sizeof(int) * n);
+    f->depth = (int*)malloc(sizeof(int) * n);
+    f->child_off = (int*)calloc(n + 1, sizeof(int));
+    f->child = (int*)malloc(sizeof(int) * (n > 1 ? n - 1 : 1));
+    f->own_items = (int*)malloc(sizeof(int) * n);
+    f->own = (NAgg*)malloc(sizeof(NAgg) * n);
+    f->fen_items = (int*)malloc(sizeof(int) * (n + 1));
+    f->fen = (NAgg*)malloc(sizeof(NAgg) * (n + 1));
+    f->src = (const NNode**)calloc(f->src_cap, sizeof(const NNode*));
+    f->src_pos = (int*)malloc(sizeof(int) * f->src_cap);
+    const NNode** stack = (const NNode**)malloc(sizeof(const NNode*) * n);
+    int* stack_parent = (int*)malloc(sizeof(int) * n);
+    if (!f->id || !f->parent || !f->end || !f->depth || !f->child_off || !f->child || !f->own_items ||
+        !f->own || !f->fen_items || !f->fen || !f->src || !f->src_pos || !stack || !stack_parent) {
+        free(stack);
+        free(stack_parent);
+        nf_clear(f);
+        return 0;
+    }
+
+    // ordre préfixe : les enfants sont empilés à l'envers pour garder leur ordre
+    int top = 0, k = 0;
+    stack[top] = root;
+    stack_parent[top++] = -1;
+    while (top) {
+        top--;
+        const NNode* node = stack[top];
+        int p = k++, pp = stack_parent[top];
+        f->id[p] = node->id;
+        f->parent[p] = pp;
+        f->end[p] = p + 1;
+        f->depth[p] = pp < 0 ? 0 : f->depth[pp] + 1;
+        f->child_off[p + 1] = node->child_count;
+        f->own_items[p] = node->items_count;
+        f->own[p] = node->agg;
+        for (int i = node->child_count - 1; i >= 0; i--) {
+            const NNode* c = node->child[i];
+            f->own_items[p] -= c->items_count;
+            agg_sub(&f->own[p], &c->agg);
+            stack[top] = c;
+            stack_parent[top++] = p;
+        }
+        int s = src_slot(f, node);
+        f->src[s] = node;
+        f->src_pos[s] = p;
+    }
+
+    // fins de sous-arbres : un parent précède tous ses descendants
+    for (int p = n - 1; p > 0; p--)
+        if (f->end[p] > f->end[f->parent[p]]) f->end[f->parent[p]] = f->end[p];
+
+    // CSR : la pile sert de curseur d'écriture par parent
+    int* cursor = stack_parent;
+    for (int p = 0; p < n; p++) {
+        f->child_off[p + 1] += f->child_off[p];
+        cursor[p] = f->child_off[p];
+    }
+    for (int p = 1; p < n; p++) f->child[cursor[f->parent[p]]++] = p;
+
+    // Fenwick construit en O(n) : chaque case se reporte sur la suivante qui la couvre
+    f->fen_items[0] = 0;
+    memset(&f->fen[0], 0, sizeof(NAgg));
+    for (int i = 1; i <= n; i++) {
+        f->fen_items[i] = f->own_items[i - 1];
+        f->fen[i] = f->own[i - 1];
+    }
+    for (int i = 1; i <= n; i++) {
+        int j = i + (i & -i);
+        if (j <= n) {
+            f->fen_items[j] += f->fen_items[i];
+            agg_add(&f->fen[j], &f->fen[i]);
+        }
+    }
+    free(stack);
+    free(stack_parent);
+    return 1;
+}
+
+int nf_position(const NFlat* f, const NNode* node) {
+    if (!node || !f->src) return -1;
+    int s = src_slot(f, node);
+    return f->src[s] ? f->src_pos[s] : -1;
+}
+
+/* somme des contributions des positions [0, i) */
+static void prefix(const NFlat* f, int i, long long* items, NAgg* out) {
+    for (; i > 0; i -= i & -i) {
+        *items += f->fen_items[i];
+        agg_add(out, &f->fen[i]);
+    }
+}
+
+void nf_subtree(const NFlat* f, int pos, int* items, NAgg* out) {
+    long long hi_items = 0, lo_items = 0;
+    NAgg hi = { 0, 0, 0, 0 }, lo = { 0, 0, 0, 0 };
+    if (pos >= 0 && pos < f->count) {
+        prefix(f, f->end[pos], &hi_items, &hi);
+        prefix(f, pos, &lo_items, &lo);
+        agg_sub(&hi, &lo);
+    }
+    if (items) *items = (int)(hi_items - lo_items);
+    if (out) *out = hi;
+}
+
+void nf_update(NFlat* f, int pos, int items, const NAgg* d) {
+    if (pos < 0 || pos >= f->count) return;
+    f->own_items[pos] += items;
+    agg_add(&f->own[pos], d);
+    for (int i = pos + 1; i <= f->count; i += i & -i) {
+        f->fen_items[i] += items;
+        agg_add(&f->fen[i], d);
+    }
+}
+
+void nf_bfs(const NFlat* f, int* order) {
+    if (!f->count) return;
+    int head = 0, tail = 0;
+    order[tail++] = 0;
+    while (head < tail) {
+        int p = order[head++];
+        for (int c = f->child_off[p]; c < f->child_off[p + 1]; c++) order[tail++] = f->child[c];
+    }
+}
+
+void nf_bfs_print(const NFlat* f) {
+    if (!f->count) { printf("(empty n-ary)\n"); return; }
+    int* order = (int*)malloc(sizeof(int) * f->count);
+    if (!order) return;
+    nf_bfs(f, order);
+    for (int k = 0; k < f->count; k++) {
+        int p = order[k], items;
+        nf_subtree(f, p, &items, NULL);
+        printf("Node %d (items=%d) -> children: ", f->id[p], items);
+        for (int c = f->child_off[p]; c < f->child_off[p + 1]; c++) printf("%d ", f->id[f->child[c]]);
+        printf("\n");
+    }
+    free(order);
+}
+
+void nf_clear(NFlat* f) {
+    free(f->id);
+    free(f->parent);
+    free(f->end);
+    free(f->depth);
+    free(f->child_off);
+    free(f->child);
+    free(f->own_items);
+    free(f->own);
+    free(f->fen_items);
+    free(f->fen);
+    free(f->src);
+    free(f->src_pos);
+    memset(f, 0, sizeof *f);
+}
@@ -0,0 +1,80 @@
+#ifndef DS_NARY_FLAT_H
+#define DS_NARY_FLAT_H
+#include "nary.h"
+
+/**
+ * @brief Copie figée et compacte d'un arbre NNode.
+ *
+ * Les noeuds sont rangés en ordre préfixe (parcours d'Euler) : le sous-arbre du
+ * noeud en position p occupe les positions [p, end[p]). Les enfants sont
+ * décrits au format CSR (child_off / child), les données de chaque noeud sont
+ * dans des tableaux contigus. Le parcours en profondeur devient un balayage
+ * linéaire et le parcours en largeur n'utilise qu'un tableau d'entiers.
+ *
+ * Chaque noeud porte sa contribution propre (own_items, own : agrégats du
+ * noeud moins ceux de ses enfants, soit les feuilles pour geo.h). Un arbre de
+ * Fenwick sur ces contributions donne les agrégats d'un sous-arbre en
+ * O(log n) et accepte les mises à jour ponctuelles en O(log n).
+ *
+ * La structure ne suit plus l'arbre source : ajouts et retraits de noeuds
+ * demandent un nouveau nf_freeze.
+ */
+
+typedef struct NFlat {
+    int count;
+    int* id;                /* identifiant du noeud source */
+    int* parent;            /* position du parent, -1 pour la racine */
+    int* end;               /* fin (exclue) du sous-arbre */
+    int* depth;
+    int* child_off;         /* enfants de p : child[child_off[p] .. child_off[p + 1]) */
+    int* child;
+    int* own_items;         /* contribution propre de chaque noeud */
+    NAgg* own;
+    int* fen_items;         /* arbre de Fenwick des contributions (indices 1..count) */
+    NAgg* fen;
+    const NNode** src;      /* table ouverte noeud source -> position */
+    int* src_pos;
+    int src_cap;
+} NFlat;
+
+/**
+ * Fige l'arbre enraciné en root.
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  nf_freeze(NFlat* f, const NNode* root);                               /* O(n) */
+
+/**
+ * Position d'un noeud de l'arbre source.
+ *
+ * @return Position, -1 si le noeud n'a pas été figé.
+ */
+int  nf_position(const NFlat* f, const NNode* node);                       /* O(1) */
+
+/**
+ * Agrégats du sous-arbre en position pos.
+ *
+ * @param f Arbre figé.
+ * @param pos Position du noeud.
+ * @param items Reçoit le nombre d'éléments, peut être NULL.
+ * @param out Reçoit les agrégats, peut être NULL.
+ */
+void nf_subtree(const NFlat* f, int pos, int* items, NAgg* out);           /* O(log n) */
+
+/**
+ * Ajoute items et d à la contribution propre du noeud en position pos
+ * (équivalent figé de n_propagate).
+ */
+void nf_update(NFlat* f, int pos, int items, const NAgg* d);               /* O(log n) */
+
+/**
+ * Écrit dans order les positions en ordre de parcours en largeur.
+ *
+ * @param order Tableau d'au moins f->count cases, sert aussi de file.
+ */
+void nf_bfs(const NFlat* f, int* order);                                   /* O(n) */
+
+void nf_bfs_print(const NFlat* f);
+void nf_clear(NFlat* f);
+
+#endif
@@ -0,0 +1,98 @@
+#include "pipeline.h"
+#include "subscribe.h"
+#include "query_cache.h"
+#include "geo.h"
+#include "pricing.h"
+#include "history.h"
+#include "snapshot.h"
+#include "wal.h"
+#include "connector.h"
+#include "metrics.h"
+
+void pl_init(Pipeline* pl, StationIndex* idx, SList* mru, int n_vehicles, int mru_capacity) {
+    pl->idx = idx;
+    pl->mru = mru;
+    pl->n_vehicles = n_vehicles;
+    pl->mru_capacity = mru_capacity;
+    pl->mru_view = NULL;
+    pl->subs = NULL;
+    pl->cache = NULL;
+    pl->pricing = NULL;
+    pl->history = NULL;
+    pl->wal = NULL;
+    pl->applied = pl->unknown = pl->rejected = pl->stray = 0;
+}
+
+int pl_apply(Pipeline* pl, const Event* e) {
+    METRIC_POLL();
+    METRIC_TIMER_COUNTED(t0, MC_EVENTS);
+    StationNode* node = si_find(pl->idx->root, e->station_id);
+    if (!node) {
+        pl->unknown++;
+        METRIC_INC(MC_EVENTS_UNKNOWN);
+        return 0;
+    }
+    if (e->action == 1 && node->info.slots_free <= 0) {
+        pl->rejected++;
+        METRIC_INC(MC_EVENTS_REJECTED);
+        METRIC_TIMER_STOP(MH_EVENT_APPLY_NS, t0);
+        return 1;
+    }
+    // noeud partagé avec un instantané : copié avant l'écriture (si_find_mut)
+    if (node->gen != pl->idx->gen && !(node = si_find_mut(pl->idx, e->station_id))) {
+        pl->unknown++;
+        METRIC_INC(MC_EVENTS_UNKNOWN);
+        return 0;
+    }
+    // connecteurs suivis (idx->conns) : créneaux libres recomptés sur le bitset de la station
+    ConnStore* conns = pl->idx->conns;
+    int free_after = 0, connector = CN_UNTRACKED;
+    if (conns && e->action == 1) connector = cn_claim(conns, e->station_id, e->vehicle_id, -1, &free_after);
+    else if (conns && e->action == 0) connector = cn_release(conns, e->station_id, e->vehicle_id, &free_after);
+    if (connector == CN_NONE) {
+        if (e->action == 1) {
+            pl->rejected++;
+            METRIC_INC(MC_EVENTS_REJECTED);
+        } else {
+            pl->stray++;
+            METRIC_INC(MC_EVENTS_STRAY);
+        }
+        METRIC_TIMER_STOP(MH_EVENT_APPLY_NS, t0);
+        return 1;
+    }
+    StationInfo before = node->info;
+    node->info.last_ts = e->ts;
+    if (connector >= 0) node->info.slots_free = free_after;
+
+    if (e->action == 1) { // PLUG IN
+        if (connector < 0) node->info.slots_free--;
+        // l'identifiant sert d'indice dans le tableau des historiques
+        if (pl->mru_view) mv_update(pl->mru_view, e->vehicle_id, e->station_id);
+        else if (pl->mru && e->vehicle_id >= 0 && e->vehicle_id < pl->n_vehicles)
+            ds_slist_update_mru(&pl->mru[e->vehicle_id], e->station_id, pl->mru_capacity);
+    } else if (e->action == 0 && connector < 0) { // UNPLUG
+        node->info.slots_free++;
+    }
+
+    // un changement de prix invalide aussi les index secondaires des règles
+    if (pl->pricing && pr_on_event(pl->pricing, node, before.slots_free, e->ts)) si_touch_attr(pl->idx, e->station_id);
+    else si_touch(pl->idx, e->station_id);
+    if (pl->history) hs_append(pl->history, e->station_id, e->ts, node->info.slots_free);
+    if (pl->idx->geo) geo_update(pl->idx->geo, e->station_id, &node->info);
+    if (pl->cache) qc_on_update(pl->cache, e->station_id, &before, &node->info);
+    if (pl->subs) sub_on_update(pl->subs, e->station_id, &before, &node->info);
+    if (pl->wal) wal_append(pl->wal, e);
+    pl->applied++;
+    METRIC_TIMER_STOP(MH_EVENT_APPLY_NS, t0);
+    return 1;
+}
+
+int pl_drain(Pipeline* pl, Queue* q) {
+    int n = 0;
+    Event e;
+    while (q_dequeue(q, &e)) {
+        pl_apply(pl, &e);
+        n++;
+    }
+    return n;
+}
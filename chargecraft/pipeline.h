@@ -0,0 +1,74 @@
+#ifndef DS_PIPELINE_H
+#define DS_PIPELINE_H
+#include "station_index.h"
+#include "slist.h"
+#include "queue.h"
+#include "events.h"
+
+struct SubEngine;
+struct QueryCache;
+struct PricingEngine;
+struct HistStore;
+struct MruView;
+struct Wal;
+struct ConnStore;
+
+/**
+ * @brief Application des événements de charge à l'état du réseau.
+ *
+ * Regroupe ce que la boucle de main.c faisait en ligne : mise à jour de la
+ * station (horodatage, créneaux libres), historique MRU du véhicule, puis
+ * notification des modules abonnés aux changements de station. Chaque
+ * modification est horodatée dans l'index (si_touch) et reportée sur les
+ * agrégats de l'arbre géographique attaché (geo.h). Si un moteur de
+ * tarification est attaché (pricing.h), le nouveau prix éventuel fait partie de
+ * la même mise à jour : cache et abonnements voient créneaux et prix ensemble.
+ * Un historique attaché (history.h) reçoit (ts, slots_free) de chaque
+ * événement appliqué ; un journal attaché (wal.h), l'événement lui-même.
+ *
+ * Avec un suivi des connecteurs attaché (connector.h), un branchement prend le
+ * premier connecteur libre de la station et un débranchement libère celui du
+ * véhicule ; slots_free devient le nombre de connecteurs libres, qui ne peut
+ * plus dépasser la capacité. Sans lui (ou pour une station non suivie),
+ * slots_free reste un simple compteur.
+ */
+typedef struct Pipeline {
+    StationIndex* idx;
+    SList* mru;                 /* historiques MRU indexés par vehicle_id, NULL si absent */
+    int n_vehicles;             /* taille du tableau mru */
+    int mru_capacity;
+    struct MruView* mru_view;   /* historiques d'un scénario (snapshot.h), remplace mru ; NULL par défaut */
+    struct SubEngine* subs;     /* abonnements (subscribe.h), NULL par défaut */
+    struct QueryCache* cache;   /* cache de requêtes à réparer (query_cache.h), NULL par défaut */
+    struct PricingEngine* pricing; /* tarification dynamique (pricing.h), NULL par défaut */
+    struct HistStore* history;  /* historique d'occupation (history.h), NULL par défaut */
+    struct Wal* wal;            /* journal des événements appliqués (wal.h), NULL par défaut */
+    long long applied;          /* événements appliqués à une station connue */
+    long long unknown;          /* événements ignorés : station absente de l'index (ou copie impossible) */
+    long long rejected;         /* branchements refusés : aucun créneau libre */
+    long long stray;            /* débranchements ignorés : aucun connecteur à libérer (suivi des connecteurs) */
+} Pipeline;
+
+void pl_init(Pipeline* pl, StationIndex* idx, SList* mru, int n_vehicles, int mru_capacity); /* O(1) */
+
+/**
+ * Applique un événement (action 1 : branchement, 0 : débranchement).
+ * Un branchement sur une station sans créneau libre est refusé : compté dans
+ * rejected, sans effet sur la station ni sur l'historique du véhicule. Avec le
+ * suivi des connecteurs, un débranchement qui n'a rien à libérer est de même
+ * ignoré (compté dans stray).
+ *
+ * @param pl Pipeline.
+ * @param e Événement à appliquer.
+ * @return 1 si la station existe, 0 sinon.
+ */
+int  pl_apply(Pipeline* pl, const Event* e);   /* O(log n + MRU + tarification et historique O(1) + abonnements touchés + entrées du cache) */
+
+/**
+ * Vide la file en appliquant chaque événement dans l'ordre.
+ *
+ * @return Nombre d'événements retirés de la file.
+ */
+int  pl_drain(Pipeline* pl, Queue* q);
+
+#endif
@@ -0,0 +1,128 @@
+#define _POSIX_C_SOURCE 200809L
+#include "pool.h"
+#include <string.h>
+#include <unistd.h>
+
+/* prochaine tâche de sa propre plage, -1 si vide */
+static int pop_own(PoolDeque* d) {
+    pthread_mutex_lock(&d->lock);
+    int t = d->head < d->tail ? d->head++ : -1;
+    pthread_mutex_unlock(&d->lock);
+    return t;
+}
+
+/* vole la seconde moitié de la plage d'un autre thread ; rend une tâche, garde le reste */
+static int steal(ThreadPool* p, int w) {
+    for (int k = 1; k < p->nthreads; k++) {
+        PoolDeque* v = &p->deques[(w + k) % p->nthreads];
+        pthread_mutex_lock(&v->lock);
+        int left = v->tail - v->head;
+        int lo = v->tail - (left + 1) / 2, hi = v->tail;
+        if (left > 0) v->tail = lo;
+        pthread_mutex_unlock(&v->lock);
+        if (left <= 0) continue;
+        atomic_fetch_add_explicit(&p->steals, 1, memory_order_relaxed);
+        if (hi - lo > 1) {
+            PoolDeque* own = &p->deques[w];
+            pthread_mutex_lock(&own->lock);
+            own->head = lo + 1;
+            own->tail = hi;
+            pthread_mutex_unlock(&own->lock);
+        }
+        return lo;
+    }
+    return -1;
+}
+
+/* travaille jusqu'à ce qu'aucune plage n'ait plus de tâche */
+static void run_batch(ThreadPool* p, int w) {
+    for (;;) {
+        int t = pop_own(&p->deques[w]);
+        if (t < 0) t = steal(p, w);
+        if (t < 0) return;
+        p->fn(p->ctx, t, w);
+        atomic_fetch_sub_explicit(&p->pending, 1, memory_order_acq_rel);
+    }
+}
+
+static void* worker_main(void* arg) {
+    ThreadPool* p = ((PoolWorker*)arg)->pool;
+    int w = ((PoolWorker*)arg)->index;
+    unsigned seen = 0;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->stop && p->generation == seen) pthread_cond_wait(&p->wake, &p->lock);
+        if (p->stop) break;
+        seen = p->generation;
+        p->active++;
+        pthread_mutex_unlock(&p->lock);
+        run_batch(p, w);
+        pthread_mutex_lock(&p->lock);
+        if (--p->active == 0) pthread_cond_signal(&p->idle);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+int tp_init(ThreadPool* p, int nthreads) {
+    memset(p, 0, sizeof *p);
+    if (nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > TP_MAX_THREADS) nthreads = TP_MAX_THREADS;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    pthread_cond_init(&p->idle, NULL);
+    for (int w = 0; w < TP_MAX_THREADS; w++) {
+        pthread_mutex_init(&p->deques[w].lock, NULL);
+        p->workers[w].pool = p;
+        p->workers[w].index = w;
+    }
+    p->nthreads = 1;
+    for (int w = 1; w < nthreads; w++) {
+        if (pthread_create(&p->threads[w], NULL, worker_main, &p->workers[w]) != 0) {
+            tp_destroy(p);
+            return 0;
+        }
+        p->nthreads++;
+    }
+    return 1;
+}
+
+void tp_run(ThreadPool* p, int n, PoolTaskFn fn, void* ctx) {
+    if (n <= 0) return;
+    // fn et ctx d'abord : un thread qui trouve une tâche dans une plage les voit à jour
+    p->fn = fn;
+    p->ctx = ctx;
+    atomic_store(&p->pending, n);
+    for (int w = 0; w < p->nthreads; w++) {
+        PoolDeque* d = &p->deques[w];
+        pthread_mutex_lock(&d->lock);
+        d->head = (int)((long long)n * w / p->nthreads);
+        d->tail = (int)((long long)n * (w + 1) / p->nthreads);
+        pthread_mutex_unlock(&d->lock);
+    }
+    pthread_mutex_lock(&p->lock);
+    p->generation++;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    run_batch(p, 0);
+
+    // les autres threads finissent leur dernière tâche puis quittent le lot
+    pthread_mutex_lock(&p->lock);
+    while (p->active > 0 || atomic_load(&p->pending) > 0) pthread_cond_wait(&p->idle, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void tp_destroy(ThreadPool* p) {
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    for (int w = 1; w < p->nthreads; w++) pthread_join(p->threads[w], NULL);
+    for (int w = 0; w < TP_MAX_THREADS; w++) pthread_mutex_destroy(&p->deques[w].lock);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->wake);
+    pthread_cond_destroy(&p->idle);
+    p->nthreads = 0;
+}
@@ -0,0 +1,69 @@
+#ifndef DS_POOL_H
+#define DS_POOL_H
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ * @brief Pool de threads à vol de travail, pour des lots de tâches indépendantes.
+ *
+ * tp_run distribue les tâches 0..n-1 d'un lot en plages contiguës, une par
+ * thread. Chaque thread prend ses tâches par le début de sa plage ; à court,
+ * il vole la seconde moitié de la plage d'un autre thread (parcouru à partir
+ * du suivant). Le thread appelant travaille comme les autres (thread 0) et
+ * tp_run ne rend la main qu'une fois le lot terminé et les threads au repos.
+ *
+ * Le numéro de thread passé aux tâches permet des états par thread sans verrou.
+ */
+
+#define TP_MAX_THREADS 64
+
+typedef void (*PoolTaskFn)(void* ctx, int task, int worker);
+
+/* plage de tâches d'un thread : [head, tail[ */
+typedef struct PoolDeque {
+    pthread_mutex_t lock;
+    int head, tail;
+    char pad[64 - 2 * sizeof(int)];  /* une plage par ligne de cache */
+} PoolDeque;
+
+struct ThreadPool;
+
+typedef struct PoolWorker {
+    struct ThreadPool* pool;
+    int index;
+} PoolWorker;
+
+typedef struct ThreadPool {
+    int nthreads;                   /* appelant compris */
+    pthread_t threads[TP_MAX_THREADS];
+    PoolWorker workers[TP_MAX_THREADS];
+    PoolDeque deques[TP_MAX_THREADS];
+    pthread_mutex_t lock;           /* protège generation, active et stop */
+    pthread_cond_t wake, idle;
+    unsigned generation;            /* incrémenté à chaque lot */
+    int active;                     /* threads auxiliaires encore dans le lot */
+    int stop;
+    PoolTaskFn fn;
+    void* ctx;
+    atomic_int pending;             /* tâches du lot non terminées */
+    atomic_llong steals;            /* vols réussis, tous lots confondus */
+} ThreadPool;
+
+/**
+ * Démarre le pool.
+ *
+ * @param nthreads Threads, appelant compris (<= 0 : coeurs en ligne), au plus TP_MAX_THREADS.
+ * @return 1 si succès, 0 si un thread n'a pas pu être créé (le pool est alors détruit).
+ */
+int  tp_init(ThreadPool* p, int nthreads);                                   /* O(threads) */
+
+/**
+ * Exécute fn(ctx, t, worker) pour t dans [0, n), chacune une seule fois, et
+ * attend la fin du lot. Un seul lot à la fois : tp_run n'est pas réentrant.
+ */
+void tp_run(ThreadPool* p, int n, PoolTaskFn fn, void* ctx);                 /* O(n / threads) par thread */
+
+/* arrête et attend les threads */
+void tp_destroy(ThreadPool* p);
+
+#endif
@@ -0,0 +1,200 @@
+#include "pricing.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+void pr_default_curve(PriceCurve* c) {
+    static const double occ[] = { 0.0, 0.20, 0.50, 0.75, 0.95 };
+    static const int mult[] = { 90, 100, 110, 125, 200 };
+    memset(c, 0, sizeof *c);
+    c->n_tiers = 5;
+    for (int t = 0; t < c->n_tiers; t++) {
+        c->occ[t] = occ[t];
+        c->mult_pct[t] = mult[t];
+    }
+    c->hysteresis = 0.05;
+    c->util_weight = 0.3;
+    c->half_life_s = 1800;
+}
+
+static int curve_valid(const PriceCurve* c) {
+    if (c->n_tiers < 1 || c->n_tiers > PR_MAX_TIERS || c->occ[0] != 0.0) return 0;
+    for (int t = 0; t < c->n_tiers; t++) {
+        if (c->mult_pct[t] <= 0 || (t > 0 && c->occ[t] <= c->occ[t - 1]) || c->occ[t] > 1.0) return 0;
+    }
+    return c->hysteresis >= 0 && c->util_weight >= 0 && c->util_weight <= 1 && c->half_life_s > 0;
+}
+
+int pr_parse_curve(const char* spec, PriceCurve* c) {
+    pr_default_curve(c);
+    c->n_tiers = 0;
+    for (const char* p = spec; *p;) {
+        char* end;
+        double occ = strtod(p, &end);
+        if (end == p || *end != ':' || c->n_tiers == PR_MAX_TIERS) return 0;
+        p = end + 1;
+        long mult = strtol(p, &end, 10);
+        if (end == p || (*end && *end != ',')) return 0;
+        c->occ[c->n_tiers] = occ / 100;
+        c->mult_pct[c->n_tiers++] = (int)mult;
+        p = *end ? end + 1 : end;
+    }
+    return curve_valid(c);
+}
+
+int pr_init(PricingEngine* e, const PriceCurve* c, PriceNotifyFn fn, void* ctx) {
+    memset(e, 0, sizeof *e);
+    if (!curve_valid(c)) return 0;
+    e->curve = *c;
+    e->fn = fn;
+    e->ctx = ctx;
+    // seuils en float, sentinelles aux bords : up[dernier] jamais atteint, down[0] jamais franchi
+    for (int t = 0; t < c->n_tiers; t++) {
+        e->up[t] = t + 1 < c->n_tiers ? (float)c->occ[t + 1] : INFINITY;
+        e->down[t] = t > 0 ? (float)(c->occ[t] - c->hysteresis) : -INFINITY;
+    }
+    e->util_weight = (float)c->util_weight;
+    for (int dt = 0; dt < PR_DECAY_STEPS; dt++) e->decay[dt] = (float)(1.0 - exp2(-(double)dt / c->half_life_s));
+    return 1;
+}
+
+/* case de id, ou case libre où l'insérer */
+static PrStation* slot_of(const PricingEngine* e, int id) {
+    int mask = e->cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)id) & (uint64_t)mask);
+    while (e->st[i].station_id != PR_EMPTY && e->st[i].station_id != id) i = (i + 1) & mask;
+    return &e->st[i];
+}
+
+static int grow(PricingEngine* e) {
+    // table au plus à moitié pleine : sondages courts, pas de suppression à gérer
+    if ((e->count + 1) * 2 <= e->cap) return 1;
+    int old_cap = e->cap;
+    PrStation* old = e->st;
+    int cap = old_cap ? 2 * old_cap : 2048;
+    PrStation* st = (PrStation*)malloc(sizeof(PrStation) * (size_t)cap);
+    if (!st) return 0;
+    for (int i = 0; i < cap; i++) st[i].station_id = PR_EMPTY;
+    e->st = st;
+    e->cap = cap;
+    for (int i = 0; i < old_cap; i++)
+        if (old[i].station_id != PR_EMPTY) *slot_of(e, old[i].station_id) = old[i];
+    free(old);
+    return 1;
+}
+
+static float occupancy(int capacity, int slots_free) {
+    float occ = 1.0f - (float)slots_free / (float)capacity;
+    return occ < 0 ? 0 : occ > 1 ? 1 : occ;
+}
+
+static int price_of(const PricingEngine* e, const PrStation* s) {
+    return (int)(((long long)s->base_cents * e->curve.mult_pct[s->tier] + 50) / 100);
+}
+
+/* palier de départ : le plus haut dont le seuil est atteint, sans hystérésis */
+static int tier_for(const PriceCurve* c, double eff) {
+    int t = 0;
+    while (t + 1 < c->n_tiers && eff >= c->occ[t + 1]) t++;
+    return t;
+}
+
+int pr_add(PricingEngine* e, int station_id, int base_cents, int capacity, int ts) {
+    if (!grow(e)) return 0;
+    PrStation* s = slot_of(e, station_id);
+    if (s->station_id == PR_EMPTY) {
+        s->station_id = station_id;
+        s->util = 0;
+        s->util_ts = ts;
+        s->tier = 0;
+        e->count++;
+    }
+    s->base_cents = (uint16_t)(base_cents < 0 ? 0 : base_cents > 65535 ? 65535 : base_cents);
+    s->capacity = (uint8_t)(capacity < 0 ? 0 : capacity > 255 ? 255 : capacity);
+    return 1;
+}
+
+int pr_price(const PricingEngine* e, int station_id) {
+    const PrStation* s = e->cap ? slot_of(e, station_id) : NULL;
+    return s && s->station_id != PR_EMPTY ? price_of(e, s) : -1;
+}
+
+int pr_attach(PricingEngine* e, StationIndex* idx, int ts) {
+    SiCursor cur;
+    int count = 0;
+    si_cursor_begin(&cur, idx, INT_MIN, INT_MAX);
+    for (StationNode* n; (n = si_cursor_next(&cur)) != NULL; count++) {
+        if (!pr_add(e, n->station_id, n->info.price_cents, n->info.slots_free, ts)) return -1;
+        PrStation* s = slot_of(e, n->station_id);
+        if (s->capacity == 0) continue;
+        float occ = occupancy(s->capacity, n->info.slots_free);
+        s->util = occ;
+        s->tier = (uint8_t)tier_for(&e->curve, occ);
+        int price = price_of(e, s);
+        if (price != n->info.price_cents) {
+            // forme de l'arbre inchangée : le curseur reste valable (une copie de
+            // chemin laisse intacts les noeuds partagés qu'il parcourt)
+            if (n->gen != idx->gen && !(n = si_find_mut(idx, n->station_id))) return -1;
+            n->info.price_cents = price;
+            si_touch_attr(idx, n->station_id);
+        }
+    }
+    return count;
+}
+
+int pr_on_event(PricingEngine* e, StationNode* node, int slots_before, int ts) {
+    PrStation* s = e->cap ? slot_of(e, node->station_id) : NULL;
+    if (!s || s->station_id == PR_EMPTY) { e->stats.untracked++; return 0; }
+    e->stats.events++;
+    if (s->capacity == 0) return 0;
+
+    // l'occupation d'avant l'événement a régné depuis util_ts
+    int dt = ts - s->util_ts;
+    if (dt > 0) {
+        float a = dt < PR_DECAY_STEPS ? e->decay[dt] : 1.0f;
+        s->util += a * (occupancy(s->capacity, slots_before) - s->util);
+        // une station longtemps vide tend vers 0 sans l'atteindre : couper avant les dénormaux, très lents
+        if (s->util < 1e-6f) s->util = 0;
+        s->util_ts = ts;
+    }
+    float w = e->util_weight;
+    float eff = (1 - w) * occupancy(s->capacity, node->info.slots_free) + w * s->util;
+
+    int t = s->tier;
+    if (eff >= e->up[t]) {
+        while (eff >= e->up[t]) t++;
+    } else {
+        while (eff < e->down[t]) t--;
+    }
+    if (t == s->tier) return 0;
+
+    PriceChange ch = { ts, node->station_id, node->info.price_cents, 0, t, eff };
+    s->tier = (uint8_t)t;
+    ch.new_cents = price_of(e, s);
+    node->info.price_cents = ch.new_cents;
+    e->stats.changes++;
+    if (e->fn) e->fn(e->ctx, &ch);
+    return 1;
+}
+
+void pr_print_stats(const PricingEngine* e) {
+    int per_tier[PR_MAX_TIERS] = {0};
+    for (int k = 0; k < e->cap; k++)
+        if (e->st[k].station_id != PR_EMPTY) per_tier[e->st[k].tier]++;
+    printf("[PRICE] %d stations suivies, %lld événements, %lld changements de prix (%.2f %%), %lld hors suivi\n",
+           e->count, e->stats.events, e->stats.changes,
+           e->stats.events ? 100.0 * e->stats.changes / e->stats.events : 0.0, e->stats.untracked);
+    printf("[PRICE] paliers :");
+    for (int t = 0; t < e->curve.n_tiers; t++)
+        printf(" %s>=%.0f%% x%.2f : %d", t ? "| " : "", 100 * e->curve.occ[t], e->curve.mult_pct[t] / 100.0, per_tier[t]);
+    printf("\n");
+}
+
+void pr_clear(PricingEngine* e) {
+    free(e->st);
+    e->st = NULL;
+    e->count = e->cap = 0;
+}
@@ -0,0 +1,139 @@
+#ifndef DS_PRICING_H
+#define DS_PRICING_H
+#include <stdint.h>
+#include "station_index.h"
+
+/**
+ * @brief Tarification dynamique selon l'occupation des stations.
+ *
+ * L'occupation effective d'une station mêle son occupation instantanée
+ * (1 - slots_free / capacité) et son utilisation récente, moyenne de
+ * l'occupation pondérée par le temps avec une demi-vie configurable :
+ *
+ *     effective = (1 - util_weight) x instantanée + util_weight x récente
+ *
+ * La courbe de prix découpe l'occupation effective en paliers croissants,
+ * chacun avec un multiplicateur du prix de base. Le prix n'est recalculé que
+ * lorsqu'un événement fait franchir une frontière de palier : vers le haut dès
+ * le seuil du palier supérieur, vers le bas seulement sous le seuil du palier
+ * courant moins l'hystérésis, pour ne pas osciller autour d'une frontière.
+ *
+ * Coût par événement constant : une recherche dans une table ouverte dont
+ * les cases contiennent l'état (un seul défaut de cache dans le cas courant),
+ * un facteur d'amortissement tabulé par seconde écoulée, deux comparaisons.
+ * Chaque changement de prix est publié (PriceNotifyFn).
+ */
+
+#define PR_MAX_TIERS 8
+#define PR_DECAY_STEPS 4096     /* amortissements tabulés pour 0..4095 s écoulées */
+
+typedef struct PriceCurve {
+    int n_tiers;
+    double occ[PR_MAX_TIERS];       /* seuil d'occupation effective du palier (occ[0] = 0, croissants) */
+    int mult_pct[PR_MAX_TIERS];     /* prix = prix de base x mult_pct / 100 */
+    double hysteresis;
+    double util_weight;             /* 0 : occupation instantanée seule */
+    int half_life_s;                /* demi-vie de l'utilisation récente */
+} PriceCurve;
+
+typedef struct PriceChange {
+    int ts;
+    int station_id;
+    int old_cents, new_cents;
+    int tier;
+    double occupancy;               /* occupation effective au franchissement */
+} PriceChange;
+
+typedef void (*PriceNotifyFn)(void* ctx, const PriceChange* ch);
+
+/* 16 octets : l'état d'une station est rangé directement dans la case de la table */
+typedef struct PrStation {
+    int station_id;                 /* PR_EMPTY : case libre */
+    float util;                     /* utilisation récente, 0..1 */
+    int util_ts;                    /* horodatage de la dernière mise à jour de util */
+    uint16_t base_cents;
+    uint8_t capacity;               /* points de charge, bornés à 255 ; 0 : prix de base fixe */
+    uint8_t tier;
+} PrStation;
+
+#define PR_EMPTY INT32_MIN
+
+typedef struct PrStats {
+    long long events;               /* événements reçus sur une station suivie */
+    long long changes;              /* franchissements de palier, donc prix publiés */
+    long long untracked;            /* événements sur une station absente du moteur */
+} PrStats;
+
+typedef struct PricingEngine {
+    PriceCurve curve;
+    float up[PR_MAX_TIERS];         /* occupation effective qui fait monter d'un palier */
+    float down[PR_MAX_TIERS];       /* en dessous : descente d'un palier (seuil - hystérésis) */
+    float util_weight;
+    float decay[PR_DECAY_STEPS];    /* 1 - 2^(-dt / demi-vie) */
+    PrStation* st;                  /* table ouverte (sondage linéaire), au plus à moitié pleine */
+    int count, cap;                 /* cap : puissance de deux */
+    PriceNotifyFn fn;
+    void* ctx;
+    PrStats stats;
+} PricingEngine;
+
+/* courbe par défaut : -10 % sous 20 % d'occupation, puis +10 %, +25 %, +50 %, x2 à 95 % */
+void pr_default_curve(PriceCurve* c);
+
+/**
+ * Lit une courbe "occupation%:multiplicateur%,..." (par ex. "0:90,20:100,50:110,75:125").
+ * Hystérésis, poids et demi-vie gardent les valeurs de pr_default_curve.
+ *
+ * @return 1 si la courbe est valide (premier seuil 0, seuils croissants, au plus PR_MAX_TIERS), 0 sinon.
+ */
+int  pr_parse_curve(const char* spec, PriceCurve* c);
+
+/**
+ * Initialise un moteur vide.
+ *
+ * @param fn Appelée à chaque changement de prix, ou NULL.
+ * @return 1 si succès, 0 si la courbe est invalide.
+ */
+int  pr_init(PricingEngine* e, const PriceCurve* c, PriceNotifyFn fn, void* ctx);    /* O(PR_DECAY_STEPS) */
+
+/**
+ * Suit une station. Une nouvelle station part du premier palier ; une station
+ * déjà suivie garde son palier et son utilisation, seuls son prix de base et sa
+ * capacité changent (rechargement du jeu). Le prix publié se lit par pr_price.
+ *
+ * @param base_cents Prix de base, borné à 65535.
+ * @param capacity Points de charge, bornés à 255.
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  pr_add(PricingEngine* e, int station_id, int base_cents, int capacity, int ts);  /* O(1) amorti */
+
+/* prix de la station à son palier courant (base x multiplicateur), -1 si elle n'est pas suivie */
+int  pr_price(const PricingEngine* e, int station_id);                                /* O(1) */
+
+/**
+ * Suit toutes les stations de l'index, juste après leur chargement : la
+ * capacité est le nombre de créneaux libres courant et le prix courant devient
+ * le prix de base. Le prix du palier de départ est appliqué sans publication.
+ *
+ * @return Nombre de stations suivies, -1 en cas d'échec d'allocation.
+ */
+int  pr_attach(PricingEngine* e, StationIndex* idx, int ts);                          /* O(n) */
+
+/**
+ * Met à jour l'utilisation de la station après un changement de créneaux et,
+ * si elle franchit une frontière de palier, son prix (node->info.price_cents).
+ * À appeler avant les notifications de la mise à jour (cache, abonnements) ;
+ * un prix changé se signale par si_touch_attr, pas si_touch (index des règles).
+ *
+ * @param e Moteur.
+ * @param node Station, créneaux libres déjà mis à jour.
+ * @param slots_before Créneaux libres avant l'événement.
+ * @param ts Horodatage de l'événement.
+ * @return 1 si le prix a changé, 0 sinon.
+ */
+int  pr_on_event(PricingEngine* e, StationNode* node, int slots_before, int ts);      /* O(1) */
+
+void pr_print_stats(const PricingEngine* e);
+void pr_clear(PricingEngine* e);
+
+#endif
@@ -0,0 +1,17 @@
+#include "proto.h"
+#include <string.h>
+
+_Static_assert(sizeof(ProtoHeader) == PROTO_HEADER, "en-tête sans remplissage");
+
+size_t proto_put_header(char* buf, uint32_t len, int type, int status, uint32_t tag) {
+    ProtoHeader h = { len, (uint16_t)type, (uint16_t)status, tag };
+    memcpy(buf, &h, PROTO_HEADER);
+    return PROTO_HEADER;
+}
+
+int proto_get_header(const char* buf, size_t avail, ProtoHeader* h) {
+    if (avail < PROTO_HEADER) return 0;
+    memcpy(h, buf, PROTO_HEADER);
+    if (h->len > PROTO_MAX_PAYLOAD) return -1;
+    return avail >= PROTO_HEADER + (size_t)h->len;
+}
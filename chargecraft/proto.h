@@ -0,0 +1,91 @@
+#ifndef DS_PROTO_H
+#define DS_PROTO_H
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Protocole binaire du serveur (server.h) et du générateur de charge.
+ *
+ * Chaque message est un en-tête de 12 octets suivi de len octets de charge
+ * utile. Les entiers sont dans l'ordre natif de la machine : le serveur
+ * n'écoute qu'en local (socket Unix ou 127.0.0.1).
+ *
+ * Le client choisit tag librement ; la réponse le recopie. Les requêtes d'une
+ * connexion peuvent être envoyées sans attendre les réponses (pipelining) ;
+ * les réponses reviennent dans l'ordre des requêtes, et chaque requête voit
+ * l'effet des événements envoyés avant elle sur sa connexion, jamais de ceux
+ * envoyés après. Entre connexions, aucun ordre n'est garanti.
+ *
+ *   P_LOOKUP  requête : int32 station_id
+ *             réponse : StationInfo (4 x int32), ou statut P_NOT_FOUND sans charge
+ *   P_EVENT   requête : Event (4 x int32 : ts, vehicle_id, station_id, action)
+ *             réponse : vide ; statut P_OK, P_NOT_FOUND (station inconnue) ou P_REJECTED
+ *   P_TOPN    requête : uint8 rank (QcRank), uint8 0, uint16 n, puis la règle infixe (sans zéro final)
+ *             réponse : int32 count, puis count x int32 identifiants ; P_INVALID si règle invalide
+ *   P_STATS   requête : vide
+ *             réponse : ProtoStats
+ *   P_LOOKUP_KEY  requête : id_station_itinerance (sans zéro final, au plus PROTO_MAX_KEY octets)
+ *                 réponse : comme P_LOOKUP
+ *   P_EVENT_KEY   requête : 3 x int32 (ts, vehicle_id, action), puis id_station_itinerance
+ *                 réponse : comme P_EVENT
+ *
+ * Les deux dernières désignent la station par son identifiant d'itinérance,
+ * résolu par le registre du serveur (station_key.h) ; une chaîne inconnue, ou
+ * un serveur sans registre, donne P_NOT_FOUND.
+ */
+
+#define PROTO_HEADER 12
+#define PROTO_MAX_PAYLOAD (1 << 20)     /* au-delà, la connexion est fermée */
+#define PROTO_MAX_TOPN 1000
+#define PROTO_MAX_KEY 255
+
+typedef enum ProtoType {
+    P_LOOKUP = 1,
+    P_EVENT = 2,
+    P_TOPN = 3,
+    P_STATS = 4,
+    P_LOOKUP_KEY = 5,
+    P_EVENT_KEY = 6,
+} ProtoType;
+
+typedef enum ProtoStatus {
+    P_OK = 0,
+    P_NOT_FOUND = 1,
+    P_REJECTED = 2,         /* branchement sur une station sans créneau libre, débranchement sans connecteur occupé */
+    P_INVALID = 3,          /* requête mal formée, type inconnu ou règle invalide */
+} ProtoStatus;
+
+typedef struct ProtoHeader {
+    uint32_t len;           /* octets de charge utile */
+    uint16_t type;
+    uint16_t status;        /* 0 dans les requêtes */
+    uint32_t tag;
+} ProtoHeader;
+
+typedef struct ProtoStats {
+    int64_t stations;
+    int64_t applied, unknown, rejected;     /* compteurs du pipeline */
+    int64_t stray;                          /* débranchements sans connecteur occupé (aussi P_REJECTED) */
+    int64_t requests, batches;              /* depuis le démarrage du serveur */
+    int64_t connections;                    /* ouvertes en ce moment */
+} ProtoStats;
+
+/**
+ * Écrit un en-tête dans buf (PROTO_HEADER octets).
+ *
+ * @return PROTO_HEADER.
+ */
+size_t proto_put_header(char* buf, uint32_t len, int type, int status, uint32_t tag);
+
+/**
+ * Lit un en-tête complet au début de buf.
+ *
+ * @param buf Données reçues.
+ * @param avail Octets disponibles.
+ * @param h Reçoit l'en-tête.
+ * @return 1 si un message complet (en-tête et charge utile) est disponible,
+ *         0 s'il faut plus de données, -1 si len dépasse PROTO_MAX_PAYLOAD.
+ */
+int proto_get_header(const char* buf, size_t avail, ProtoHeader* h);
+
+#endif
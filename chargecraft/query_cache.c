@@ -0,0 +1,383 @@
+#include "query_cache.h"
+#include "hash.h"
+#include "rule_par.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_FREE (-1)
+#define SLOT_DELETED (-2)
+#define QC_KEY_MAX 8192
+#define QC_SPARE 16      /* lignes gardées au-delà de N pour combler les retraits */
+
+static const char* RANK_NAMES[QC_RANK_COUNT] = { "id", "power", "price", "slots" };
+
+const char* qc_rank_name(int rank) {
+    return rank >= 0 && rank < QC_RANK_COUNT ? RANK_NAMES[rank] : "?";
+}
+
+static uint64_t key_hash(const char* s, int rank, int n) {
+    uint64_t seed = DS_HASH_SEED ^ ds_hash_mix(((uint64_t)(uint32_t)rank << 32) | (uint32_t)n);
+    return ds_hash_bytes(s, strlen(s), seed);
+}
+
+/* ---------- tables ouvertes texte brut / règle normalisée -> entrée ---------- */
+
+static int tbl_find(const QueryCache* c, const int* tbl, int by_key, uint64_t h, const char* s, int rank, int n) {
+    int mask = c->tbl_cap - 1;
+    for (int i = (int)(h & (uint64_t)mask); tbl[i] != SLOT_FREE; i = (i + 1) & mask) {
+        if (tbl[i] == SLOT_DELETED) continue;
+        const QcEntry* e = &c->entries[tbl[i]];
+        if ((by_key ? e->h_key : e->h_text) == h && e->rank == rank && e->n == n
+            && strcmp(by_key ? e->key : e->text, s) == 0)
+            return tbl[i];
+    }
+    return -1;
+}
+
+static void tbl_put(QueryCache* c, int* tbl, uint64_t h, int entry) {
+    int mask = c->tbl_cap - 1;
+    int i = (int)(h & (uint64_t)mask);
+    while (tbl[i] >= 0) i = (i + 1) & mask;
+    if (tbl[i] == SLOT_FREE) c->tbl_used++;
+    tbl[i] = entry;
+}
+
+static void tbl_del(QueryCache* c, int* tbl, uint64_t h, int entry) {
+    int mask = c->tbl_cap - 1;
+    for (int i = (int)(h & (uint64_t)mask); tbl[i] != SLOT_FREE; i = (i + 1) & mask)
+        if (tbl[i] == entry) {
+            tbl[i] = SLOT_DELETED;
+            return;
+        }
+}
+
+/* reconstruit les deux tables pour purger les cases supprimées */
+static void tbl_rebuild(QueryCache* c) {
+    for (int i = 0; i < c->tbl_cap; i++) c->by_text[i] = c->by_key[i] = SLOT_FREE;
+    c->tbl_used = 0;
+    for (int k = 0; k < c->count; k++) {
+        if (c->entries[k].text) tbl_put(c, c->by_text, c->entries[k].h_text, k);
+        tbl_put(c, c->by_key, c->entries[k].h_key, k);
+    }
+}
+
+/* chaque table reste au plus à moitié occupée (tombstones compris) */
+static void tbl_reserve(QueryCache* c) {
+    if (c->tbl_used + 2 > c->tbl_cap / 2) tbl_rebuild(c);
+}
+
+int qc_init(QueryCache* c, StationIndex* idx, RuleIndexes* ri, int cap) {
+    memset(c, 0, sizeof *c);
+    if (cap < 1) cap = 1;
+    c->idx = idx;
+    c->ri = ri;
+    c->cap = cap;
+    c->tbl_cap = 16;
+    while (c->tbl_cap < cap * 8) c->tbl_cap *= 2;
+    c->entries = (QcEntry*)calloc((size_t)cap, sizeof(QcEntry));
+    c->by_text = (int*)malloc(sizeof(int) * c->tbl_cap);
+    c->by_key = (int*)malloc(sizeof(int) * c->tbl_cap);
+    c->plan = (RulePlan*)malloc(sizeof(RulePlan));
+    if (!c->entries || !c->by_text || !c->by_key || !c->plan) {
+        qc_clear(c);
+        return 0;
+    }
+    tbl_rebuild(c);
+    return 1;
+}
+
+/* ---------- résultat classé borné à n ---------- */
+
+/* insère (k, id) à sa place ; le dernier est perdu si le résultat est plein */
+static void result_insert(QcEntry* e, long long k, int id) {
+    int i = e->count < e->depth ? e->count++ : e->depth - 1;
+    while (i > 0 && qc_rank_cmp(k, id, e->keys[i - 1], e->ids[i - 1]) < 0) {
+        e->keys[i] = e->keys[i - 1];
+        e->ids[i] = e->ids[i - 1];
+        i--;
+    }
+    e->keys[i] = k;
+    e->ids[i] = id;
+}
+
+static void result_remove(QcEntry* e, int pos) {
+    e->count--;
+    memmove(e->ids + pos, e->ids + pos + 1, sizeof(int) * (size_t)(e->count - pos));
+    memmove(e->keys + pos, e->keys + pos + 1, sizeof(long long) * (size_t)(e->count - pos));
+}
+
+/* tranches des identifiants [lo, hi] */
+static uint64_t shard_span(int lo, int hi) {
+    if (lo > hi) return 0;
+    long long a = (long long)lo >> SI_SHARD_SHIFT, b = (long long)hi >> SI_SHARD_SHIFT;
+    if (b - a >= SI_SHARDS - 1) return ~0ULL;
+    uint64_t m = 0;
+    for (long long s = a; s <= b; s++) m |= 1ULL << (s & (SI_SHARDS - 1));
+    return m;
+}
+
+/* un classement par identifiant incomplet ne dépend que des stations avant la borne */
+static void entry_deps(QcEntry* e) {
+    int hi = e->id_hi;
+    if (e->rank == QC_BY_ID && !e->complete && e->bound_id < hi) hi = e->bound_id;
+    e->shards = shard_span(e->id_lo, hi);
+}
+
+typedef struct Collect {
+    QcEntry* e;
+    int id_order;   /* visite par identifiant croissant : arrêt dès n stations */
+} Collect;
+
+static int collect(void* arg, StationNode* node) {
+    Collect* col = (Collect*)arg;
+    QcEntry* e = col->e;
+    long long k = qc_rank_key(e->rank, &node->info);
+    if (e->count < e->depth || qc_rank_cmp(k, node->station_id, e->keys[e->depth - 1], e->ids[e->depth - 1]) < 0)
+        result_insert(e, k, node->station_id);
+    return !(col->id_order && e->count == e->depth);
+}
+
+static void entry_compute(QueryCache* c, QcEntry* e) {
+    RulePlan* p = c->plan;
+    e->count = 0;
+    if (e->depth > 0) {
+        Collect col = { e, e->rank == QC_BY_ID && (p->access == PA_SCAN || p->attr == RA_ID) };
+        // l'arrêt anticipé du classement par id bat le parallélisme : n stations lues au plus
+        if (c->pool && !col.id_order) {
+            int got = rpar_top_n(p, c->idx, c->pool, e->rank, e->depth, e->ids, e->keys);
+            if (got >= 0) e->count = got;
+            else rplan_execute(p, c->idx, collect, &col);
+        } else {
+            rplan_execute(p, c->idx, collect, &col);
+        }
+    }
+    e->complete = e->depth == 0 || e->count < e->depth;
+    e->bound_k = e->complete ? LLONG_MAX : e->keys[e->depth - 1];
+    e->bound_id = e->complete ? INT_MAX : e->ids[e->depth - 1];
+    e->valid = 1;
+    e->stamp = c->idx->data_version;
+    memcpy(e->shard_seen, c->idx->shard_version, sizeof e->shard_seen);
+    entry_deps(e);
+}
+
+static void entry_free(QcEntry* e) {
+    free(e->text);
+    free(e->key);
+    free(e->nodes);
+    free(e->ids);
+    free(e->keys);
+    memset(e, 0, sizeof *e);
+}
+
+/* case pour une nouvelle entrée, en évinçant la moins récemment utilisée */
+static int entry_slot(QueryCache* c) {
+    if (c->count < c->cap) return c->count++;
+    int victim = 0;
+    for (int k = 1; k < c->count; k++)
+        if (c->entries[k].last_use < c->entries[victim].last_use) victim = k;
+    QcEntry* e = &c->entries[victim];
+    if (e->text) tbl_del(c, c->by_text, e->h_text, victim);
+    tbl_del(c, c->by_key, e->h_key, victim);
+    entry_free(e);
+    c->stats.evictions++;
+    return victim;
+}
+
+/* l'entrée est-elle encore exacte pour l'état courant de l'index ? */
+static int entry_fresh(QueryCache* c, QcEntry* e) {
+    if (!e->valid) return 0;
+    if (e->stamp == c->idx->data_version) return 1;
+    for (uint64_t m = e->shards; m; m &= m - 1) {
+        int s = __builtin_ctzll(m);
+        if (e->shard_seen[s] != c->idx->shard_version[s]) {
+            e->valid = 0;
+            c->stats.invalidations++;
+            return 0;
+        }
+    }
+    // seules des tranches sans effet sur le résultat ont bougé
+    e->stamp = c->idx->data_version;
+    memcpy(e->shard_seen, c->idx->shard_version, sizeof e->shard_seen);
+    return 1;
+}
+
+static char* dup_str(const char* s) {
+    size_t n = strlen(s) + 1;
+    char* d = (char*)malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+/* rattache le texte brut à l'entrée k (un seul texte par entrée, le dernier vu) */
+static void set_text(QueryCache* c, int k, const char* text, uint64_t h) {
+    QcEntry* e = &c->entries[k];
+    char* t = dup_str(text);
+    if (!t) return;  // l'entrée reste joignable par sa règle normalisée
+    if (e->text) tbl_del(c, c->by_text, e->h_text, k);
+    free(e->text);
+    e->text = t;
+    e->h_text = h;
+    tbl_put(c, c->by_text, h, k);
+}
+
+/* nouvelle entrée pour la règle planifiée dans c->plan */
+static int entry_create(QueryCache* c, const char* key, uint64_t h_key, int rank, int n) {
+    const RulePlan* p = c->plan;
+    RuleNode* nodes = (RuleNode*)malloc(sizeof(RuleNode) * RULE_MAX_NODES);
+    char* kd = dup_str(key);
+    int depth = n > 0 ? n + (n < QC_SPARE ? n : QC_SPARE) : 0;
+    int* ids = (int*)malloc(sizeof(int) * (size_t)(depth > 0 ? depth : 1));
+    long long* keys = (long long*)malloc(sizeof(long long) * (size_t)(depth > 0 ? depth : 1));
+    int nn = nodes ? rule_compact(&p->rule, nodes, RULE_MAX_NODES) : -1;
+    if (!kd || !ids || !keys || nn < 0) {
+        free(nodes);
+        free(kd);
+        free(ids);
+        free(keys);
+        return -1;
+    }
+    RuleNode* shrunk = (RuleNode*)realloc(nodes, sizeof(RuleNode) * (size_t)(nn > 0 ? nn : 1));
+    if (shrunk) nodes = shrunk;
+
+    int k = entry_slot(c);
+    QcEntry* e = &c->entries[k];
+    e->nodes = nodes;
+    e->key = kd;
+    e->h_key = h_key;
+    e->ids = ids;
+    e->keys = keys;
+    e->rank = rank;
+    e->n = n;
+    e->depth = depth;
+    e->id_lo = INT_MIN;
+    e->id_hi = INT_MAX;
+    if (p->access == PA_EMPTY) {
+        e->id_lo = 1;
+        e->id_hi = 0;
+    } else if (p->cand[RA_ID].usable) {
+        e->id_lo = p->cand[RA_ID].lo;
+        e->id_hi = p->cand[RA_ID].hi;
+    }
+    tbl_put(c, c->by_key, h_key, k);
+    return k;
+}
+
+int qc_query(QueryCache* c, const char* rule, int rank, int n, const int** ids) {
+    if (!c || !rule || rank < 0 || rank >= QC_RANK_COUNT || n < 0) return -1;
+    uint64_t h_text = key_hash(rule, rank, n);
+    int k = tbl_find(c, c->by_text, 0, h_text, rule, rank, n);
+    int planned = 0;
+
+    if (k < 0) {
+        // texte inconnu : la règle normalisée a peut-être déjà une entrée
+        RulePlan* p = c->plan;
+        if (!rplan_build(p, rule, c->idx, c->ri, NULL, 0)) return -1;
+        planned = 1;
+        char key[QC_KEY_MAX];
+        int len = rule_format(&p->rule, p->rule.root, key, sizeof key);
+        const char* kp = len < (int)sizeof key - 1 ? key : rule;  // trop longue : le texte brut sert de clé
+        uint64_t h_key = key_hash(kp, rank, n);
+        tbl_reserve(c);
+        k = tbl_find(c, c->by_key, 1, h_key, kp, rank, n);
+        if (k < 0) {
+            k = entry_create(c, kp, h_key, rank, n);
+            if (k < 0) return -1;
+        }
+        set_text(c, k, rule, h_text);
+    }
+
+    QcEntry* e = &c->entries[k];
+    e->last_use = ++c->tick;
+    if (entry_fresh(c, e)) {
+        c->stats.hits++;
+    } else {
+        c->stats.misses++;
+        if (!planned && !rplan_build(c->plan, rule, c->idx, c->ri, NULL, 0)) return -1;
+        entry_compute(c, e);
+    }
+    *ids = e->ids;
+    return e->count < e->n ? e->count : e->n;
+}
+
+/* range (k, id) parmi les retenues ; si la réserve déborde, la dernière sort et devient la borne */
+static void entry_place(QcEntry* e, long long k, int id) {
+    if (e->count == e->depth) {
+        e->complete = 0;
+        e->bound_k = e->keys[e->depth - 1];
+        e->bound_id = e->ids[e->depth - 1];
+    }
+    result_insert(e, k, id);
+}
+
+/* applique la mise à jour d'une station à une entrée exacte ; 0 si elle devient caduque */
+static int entry_apply(QcEntry* e, int id, const StationInfo* before, const StationInfo* after) {
+    if (e->depth == 0) return 1;
+    int mb = before && rule_eval_nodes(e->nodes, 0, id, before);
+    int ma = after && rule_eval_nodes(e->nodes, 0, id, after);
+    if (!mb && !ma) return 1;
+    long long ka = ma ? qc_rank_key(e->rank, after) : 0;
+
+    int pos = -1;
+    if (mb)
+        for (int i = 0; i < e->count; i++)
+            if (e->ids[i] == id) {
+                pos = i;
+                break;
+            }
+
+    // une station non retenue ne change rien si elle reste classée après la borne
+    int before_bound = ma && qc_rank_cmp(ka, id, e->bound_k, e->bound_id) < 0;
+    if (pos < 0 && !before_bound) return 1;
+    if (pos >= 0) result_remove(e, pos);
+    if (before_bound) entry_place(e, ka, id);
+    entry_deps(e);
+    // une station sortie sous la borne est rejetée au-delà : rien ne comble la place
+    return e->complete || e->count >= e->n ? 2 : 0;
+}
+
+void qc_on_update(QueryCache* c, int station_id, const StationInfo* before, const StationInfo* after) {
+    if (!c) return;
+    unsigned now = c->idx->data_version;
+    int s = si_shard(station_id);
+    for (int k = 0; k < c->count; k++) {
+        QcEntry* e = &c->entries[k];
+        // seules les entrées exactes juste avant cette mise à jour peuvent la suivre
+        if (!e->valid || e->stamp != now - 1) continue;
+        if (e->shards >> s & 1) {
+            int r = entry_apply(e, station_id, before, after);
+            if (r == 0) {
+                e->valid = 0;
+                c->stats.invalidations++;
+                continue;
+            }
+            if (r == 2) c->stats.repairs++;
+        }
+        e->stamp = now;
+        e->shard_seen[s] = c->idx->shard_version[s];
+    }
+}
+
+void qc_print_stats(const QueryCache* c) {
+    const QcStats* st = &c->stats;
+    long long q = st->hits + st->misses;
+    printf("[CACHE] %d/%d entrées : %lld requêtes, %lld succès (%.1f %%), %lld échecs, "
+           "%lld invalidations, %lld réparations, %lld évictions\n",
+           c->count, c->cap, q, st->hits, q ? 100.0 * (double)st->hits / (double)q : 0.0, st->misses,
+           st->invalidations, st->repairs, st->evictions);
+}
+
+void qc_clear(QueryCache* c) {
+    if (!c) return;
+    if (c->entries)
+        for (int k = 0; k < c->count; k++) entry_free(&c->entries[k]);
+    free(c->entries);
+    free(c->by_text);
+    free(c->by_key);
+    free(c->plan);
+    c->entries = NULL;
+    c->by_text = c->by_key = NULL;
+    c->plan = NULL;
+    c->count = c->tbl_used = 0;
+}
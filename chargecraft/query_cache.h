@@ -0,0 +1,129 @@
+#ifndef DS_QUERY_CACHE_H
+#define DS_QUERY_CACHE_H
+#include <stdint.h>
+#include "station_index.h"
+#include "rule_expr.h"
+#include "rule_plan.h"
+
+/**
+ * @brief Cache des résultats de requêtes top-N, horodaté par les versions de l'index.
+ *
+ * Une entrée est identifiée par (règle normalisée, classement, N) : deux textes
+ * équivalents après normalisation partagent le même résultat. Elle mémorise la
+ * data_version de l'index et la version de chaque tranche d'identifiants au
+ * moment où son résultat était exact.
+ *
+ * - Succès en O(1) tant que data_version n'a pas bougé.
+ * - Les mises à jour signalées par qc_on_update (boucle d'événements) sont
+ *   appliquées à chaque entrée encore exacte : ignorées si la station ne peut
+ *   pas changer le résultat, réparées sur place sinon (insertion, retrait,
+ *   reclassement). Une réserve de lignes au-delà de N absorbe les retraits ;
+ *   l'entrée n'est invalidée que lorsqu'elle est épuisée.
+ * - Les autres modifications (si_add, si_delete, rechargement) sont détectées à
+ *   la lecture : l'entrée reste valable si aucune des tranches dont elle dépend
+ *   n'a changé.
+ */
+
+/* classement : clé puis identifiant croissant */
+typedef enum QcRank {
+    QC_BY_ID,       /* identifiant croissant */
+    QC_BY_POWER,    /* puissance décroissante */
+    QC_BY_PRICE,    /* prix croissant */
+    QC_BY_SLOTS,    /* créneaux libres décroissants */
+    QC_RANK_COUNT
+} QcRank;
+
+/* clé de classement : plus petite = meilleure, départagée par l'identifiant */
+static inline long long qc_rank_key(int rank, const StationInfo* in) {
+    switch (rank) {
+        case QC_BY_POWER: return -(long long)in->power_kW;
+        case QC_BY_PRICE: return in->price_cents;
+        case QC_BY_SLOTS: return -(long long)in->slots_free;
+        default:          return 0;
+    }
+}
+
+static inline int qc_rank_cmp(long long ka, int ida, long long kb, int idb) {
+    if (ka != kb) return ka < kb ? -1 : 1;
+    return (ida > idb) - (ida < idb);
+}
+
+typedef struct QcEntry {
+    char* text;                 /* dernier texte brut ayant mené à l'entrée */
+    char* key;                  /* règle normalisée */
+    uint64_t h_text, h_key;
+    int rank, n;
+    RuleNode* nodes;            /* règle compactée, racine en 0, pour qc_on_update */
+    int id_lo, id_hi;           /* plage d'identifiants imposée par la règle */
+    int* ids;                   /* meilleures stations classées, au plus depth (N plus une réserve) */
+    long long* keys;            /* clé de classement de chaque station retenue */
+    int count, depth;
+    int complete;               /* toutes les stations satisfaisant la règle sont retenues */
+    long long bound_k;          /* sinon, les autres sont classées à partir de (bound_k, bound_id) */
+    int bound_id;
+    int valid;
+    unsigned stamp;             /* data_version pour laquelle le résultat est exact */
+    uint64_t shards;            /* tranches pouvant modifier le résultat */
+    unsigned shard_seen[SI_SHARDS];
+    unsigned long long last_use;
+} QcEntry;
+
+typedef struct QcStats {
+    long long hits, misses;
+    long long invalidations;    /* entrées rendues caduques par une modification */
+    long long repairs;          /* entrées corrigées sur place */
+    long long evictions;
+} QcStats;
+
+typedef struct QueryCache {
+    StationIndex* idx;
+    RuleIndexes* ri;            /* index secondaires pour les recalculs, ou NULL */
+    QcEntry* entries;
+    int count, cap;
+    int* by_text;               /* tables ouvertes -> entrée (-1 libre, -2 supprimée) */
+    int* by_key;
+    int tbl_cap, tbl_used;      /* tbl_used : cases occupées ou supprimées (par table) */
+    RulePlan* plan;             /* plan de travail des recalculs */
+    struct ThreadPool* pool;    /* recalculs classés en parallèle (rule_par.h), NULL par défaut */
+    unsigned long long tick;
+    QcStats stats;
+} QueryCache;
+
+/**
+ * Initialise un cache de cap entrées (éviction de la moins récemment utilisée).
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  qc_init(QueryCache* c, StationIndex* idx, RuleIndexes* ri, int cap);      /* O(cap) */
+
+/**
+ * Top-N des stations satisfaisant une règle infixe, servi depuis le cache si possible.
+ *
+ * @param c Cache.
+ * @param rule Règle infixe (voir rule_expr.h).
+ * @param rank Classement (QcRank).
+ * @param n Nombre maximal de stations.
+ * @param ids Reçoit le tableau des identifiants, valable jusqu'au prochain appel.
+ * @return Nombre de stations, -1 si la règle est invalide ou en cas d'échec d'allocation.
+ */
+int  qc_query(QueryCache* c, const char* rule, int rank, int n, const int** ids);
+                                                          /* O(1) si succès, requête planifiée sinon */
+
+/**
+ * Signale la mise à jour d'une station déjà horodatée par si_touch ; répare ou
+ * invalide les entrées dont elle peut modifier le résultat.
+ *
+ * @param c Cache.
+ * @param station_id Station modifiée.
+ * @param before État avant la mise à jour, NULL pour une nouvelle station.
+ * @param after État après la mise à jour, NULL pour une station supprimée.
+ */
+void qc_on_update(QueryCache* c, int station_id, const StationInfo* before, const StationInfo* after);
+                                                          /* O(entrées + N par entrée touchée) */
+
+void qc_print_stats(const QueryCache* c);
+void qc_clear(QueryCache* c);                             /* O(cap) */
+
+const char* qc_rank_name(int rank);
+
+#endif
@@ -1,5 +1,6 @@
 #include "queue.h"
 #include <stdlib.h>
+#include "metrics.h"
 
 void q_init(Queue* q){ q->head=q->tail=0; }
 int  q_is_empty(Queue* q){ return q->head==0; }
@@ -12,6 +13,7 @@ int  q_is_empty(Queue* q){ return q->head==0; }
  */
 int  q_enqueue(Queue* q, Event e){
     QNode* n=(QNode*)malloc(sizeof*n); if(!n) return 0;
+    METRIC_INC(MC_ALLOCS); METRIC_INC(MC_Q_ENQUEUE);
     n->e=e; n->next=0;
     if(!q->tail) q->head=q->tail=n; else { q->tail->next=n; q->tail=n; } // ajout en fin de liste
     return 1;
@@ -25,6 +27,7 @@ int  q_enqueue(Queue* q, Event e){
  */
 int  q_dequeue(Queue* q, Event* out){
     QNode* h=q->head; if(!h) return 0; if(out) *out=h->e;
+    METRIC_INC(MC_Q_DEQUEUE);
     q->head=h->next; // déplace la tête vers le suivant
     if(!q->head) q->tail=0; // file vide, on réinitialise la queue
     free(h); // libération mémoire du noeud retiré
@@ -0,0 +1,143 @@
+#include "recommend.h"
+#include <math.h>
+#include <stddef.h>
+
+#define REC_KM_PER_DEG 111.195
+#define REC_RAD_PER_DEG 0.017453292519943295
+
+void rec_default_weights(RecWeights* w) {
+    w->per_km = 1.0;
+    w->per_euro = 1.0;
+    w->power = 2.0;
+    w->slots = 1.0;
+    w->history = 3.0;
+    w->min_slots = 1;
+}
+
+/* a est moins bon que b : score plus faible, ou égal avec un identifiant plus grand */
+static int worse(const RecResult* a, const RecResult* b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->station_id > b->station_id;
+}
+
+/* tas des k meilleurs : la racine est le moins bon retenu */
+static void heap_down(RecResult* h, int n, int i) {
+    for (;;) {
+        int l = 2 * i + 1, m = i;
+        if (l < n && worse(&h[l], &h[m])) m = l;
+        if (l + 1 < n && worse(&h[l + 1], &h[m])) m = l + 1;
+        if (m == i) return;
+        RecResult t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
+
+static void heap_up(RecResult* h, int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!worse(&h[i], &h[p])) return;
+        RecResult t = h[i]; h[i] = h[p]; h[p] = t;
+        i = p;
+    }
+}
+
+/**
+ * Distance minimale du point aux cellules hors du carré d'anneaux [row - r, row + r].
+ * La longitude est comptée au cosinus le plus faible de la bande traversée,
+ * ce qui minore la distance de sp_distance_km.
+ */
+static double ring_min_km(const SpatialIndex* sp, int lat_e6, int lon_e6, int row, int col, int r) {
+    double cell = sp->cell_e6;
+    double north = (row + r + 1) * cell - lat_e6;
+    double south = lat_e6 - (row - r) * cell;
+    double east = (col + r + 1) * cell - lon_e6;
+    double west = lon_e6 - (col - r) * cell;
+    double lat_gap = (north < south ? north : south) * 1e-6 * REC_KM_PER_DEG;
+    double far_lat = fabs(lat_e6 * 1e-6) + (r + 1) * cell * 1e-6;
+    if (far_lat > 89.0) far_lat = 89.0;
+    double lon_gap = (east < west ? east : west) * 1e-6 * REC_KM_PER_DEG * cos(far_lat * REC_RAD_PER_DEG);
+    return lat_gap < lon_gap ? lat_gap : lon_gap;
+}
+
+/* évalue une station et la garde si elle entre dans les k meilleures */
+static void offer(const StationIndex* idx, const RecWeights* w, int id, double d, double aff, RecResult* out,
+                  int k, int* count, RecStats* stats) {
+    const StationNode* s = si_find(idx->root, id);
+    if (!s || s->info.slots_free < w->min_slots) return;
+    if (stats) stats->candidates++;
+    int pw = s->info.power_kW < REC_POWER_REF ? s->info.power_kW : REC_POWER_REF;
+    int sl = s->info.slots_free < REC_SLOTS_REF ? s->info.slots_free : REC_SLOTS_REF;
+    RecResult cand = { id,
+                       w->power * pw / REC_POWER_REF + w->slots * sl / REC_SLOTS_REF + w->history * aff
+                       - w->per_euro * s->info.price_cents / 100.0 - w->per_km * d,
+                       d };
+    if (*count < k) {
+        out[*count] = cand;
+        heap_up(out, (*count)++);
+    } else if (worse(&out[0], &cand)) {
+        out[0] = cand;
+        heap_down(out, *count, 0);
+    }
+}
+
+int rec_top_k(const StationIndex* idx, const SpatialIndex* sp, const SList* history, int lat_e6, int lon_e6,
+              int k, const RecWeights* w, RecResult* out, RecStats* stats) {
+    RecWeights def;
+    if (!w) { rec_default_weights(&def); w = &def; }
+    if (stats) stats->cells = stats->candidates = 0;
+    if (k <= 0 || !sp->cells || sp->count == 0) return 0;
+
+    int hist[REC_HISTORY_MAX], n_hist = 0;
+    for (const SNode* h = history ? history->head : NULL; h && n_hist < REC_HISTORY_MAX; h = h->next)
+        hist[n_hist++] = h->value;
+
+    int row, col, count = 0;
+    sp_cell_of(sp, lat_e6, lon_e6, &row, &col);
+
+    // stations de l'historique évaluées d'abord : le reste du parcours ne compte plus leur bonus
+    for (int j = 0; j < n_hist; j++) {
+        int lat, lon;
+        if (sp_get(sp, hist[j], &lat, &lon))
+            offer(idx, w, hist[j], sp_distance_km(lat_e6, lon_e6, lat, lon), 1.0 - (double)j / n_hist, out, k, &count, stats);
+    }
+    double bonus_max = w->power + w->slots;
+
+    for (int r = 0;; r++) {
+        // anneau r : cellules à distance de Tchebychev r de (row, col), limitées à l'englobant
+        int r_lo = row - r > sp->row_min ? row - r : sp->row_min;
+        int r_hi = row + r < sp->row_max ? row + r : sp->row_max;
+        int c_lo = col - r > sp->col_min ? col - r : sp->col_min;
+        int c_hi = col + r < sp->col_max ? col + r : sp->col_max;
+        for (int rr = r_lo; rr <= r_hi; rr++) {
+            int edge = rr == row - r || rr == row + r;
+            for (int cc = edge ? c_lo : col - r; cc <= (edge ? c_hi : col + r); cc += edge ? 1 : 2 * r) {
+                if (!edge && (cc < c_lo || cc > c_hi)) continue;
+                const SpCell* c = sp_cell(sp, rr, cc);
+                if (stats) stats->cells++;
+                if (!c) continue;
+                for (int e = 0; e < c->count; e++) {
+                    const SpEntry* it = &c->items[e];
+                    double d = sp_distance_km(lat_e6, lon_e6, it->lat_e6, it->lon_e6);
+                    // élagage individuel : même le meilleur bonus ne suffirait pas
+                    if (count == k && bonus_max - w->per_km * d < out[0].score) continue;
+                    int seen = 0;
+                    for (int j = 0; j < n_hist && !seen; j++) seen = hist[j] == it->station_id;
+                    if (!seen) offer(idx, w, it->station_id, d, 0, out, k, &count, stats);
+                }
+            }
+        }
+        // tout l'englobant des cellules occupées est couvert
+        if (row - r <= sp->row_min && row + r >= sp->row_max && col - r <= sp->col_min && col + r >= sp->col_max)
+            break;
+        if (count == k && w->per_km > 0 &&
+            out[0].score > bonus_max - w->per_km * ring_min_km(sp, lat_e6, lon_e6, row, col, r))
+            break;
+    }
+
+    // tri final par extractions successives du moins bon
+    for (int n = count; n > 1; n--) {
+        RecResult t = out[0]; out[0] = out[n - 1]; out[n - 1] = t;
+        heap_down(out, n - 1, 0);
+    }
+    return count;
+}
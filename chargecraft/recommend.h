@@ -0,0 +1,75 @@
+#ifndef DS_RECOMMEND_H
+#define DS_RECOMMEND_H
+#include "station_index.h"
+#include "spatial.h"
+#include "slist.h"
+
+/**
+ * @brief Recommandation de stations pour un véhicule à une position donnée.
+ *
+ * Score (plus grand = meilleur) :
+ *   power   * min(puissance, REC_POWER_REF) / REC_POWER_REF
+ * + slots   * min(créneaux libres, REC_SLOTS_REF) / REC_SLOTS_REF
+ * + history * affinité MRU (1 pour la tête de liste, décroissante ensuite, 0 si absente)
+ * - per_euro * prix en euros
+ * - per_km   * distance
+ *
+ * Les stations de l'historique sont évaluées d'abord, où qu'elles soient. Les
+ * cellules de la grille spatiale sont ensuite parcourues par anneaux autour du
+ * point. Hors de l'anneau r, une autre station est au moins à la distance d(r)
+ * et son score ne dépasse pas power + slots - per_km * d(r) : dès que les k
+ * meilleures trouvées font strictement mieux, le parcours s'arrête. Le résultat
+ * est celui d'un calcul exhaustif.
+ *
+ * Les pondérations sont positives ou nulles.
+ *
+ * Aucune allocation ni écriture partagée : plusieurs threads peuvent interroger
+ * en parallèle tant que l'index et la grille ne sont pas modifiés.
+ */
+
+#define REC_POWER_REF 150     /* kW au-delà desquels la puissance ne rapporte plus */
+#define REC_SLOTS_REF 4
+#define REC_HISTORY_MAX 32    /* entrées MRU prises en compte */
+
+typedef struct RecWeights {
+    double per_km;        /* pénalité par kilomètre */
+    double per_euro;      /* pénalité par euro de prix */
+    double power;
+    double slots;
+    double history;
+    int min_slots;        /* créneaux libres exigés */
+} RecWeights;
+
+typedef struct RecResult {
+    int station_id;
+    double score;
+    double distance_km;
+} RecResult;
+
+typedef struct RecStats {
+    int cells;            /* cellules visitées */
+    int candidates;       /* stations évaluées */
+} RecStats;
+
+/* pondérations par défaut : 1 par km, 1 par euro, 2 puissance, 1 créneaux, 3 historique, 1 créneau libre */
+void rec_default_weights(RecWeights* w);
+
+/**
+ * k meilleures stations pour un véhicule, par score décroissant puis identifiant croissant.
+ *
+ * @param idx Index des stations (puissance, prix, créneaux).
+ * @param sp Positions des stations.
+ * @param history Historique MRU du véhicule, NULL si aucun.
+ * @param lat_e6 Latitude du véhicule (microdegrés).
+ * @param lon_e6 Longitude du véhicule (microdegrés).
+ * @param k Nombre de stations voulues.
+ * @param w Pondérations, NULL pour les valeurs par défaut.
+ * @param out Reçoit au plus k résultats.
+ * @param stats Reçoit le coût de la requête, peut être NULL.
+ * @return Nombre de résultats.
+ */
+int  rec_top_k(const StationIndex* idx, const SpatialIndex* sp, const SList* history, int lat_e6, int lon_e6,
+               int k, const RecWeights* w, RecResult* out, RecStats* stats);
+                                            /* O(voisinage x (log n + k)) */
+
+#endif
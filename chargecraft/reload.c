@@ -0,0 +1,249 @@
+#include "reload.h"
+#include "csv_loader.h"
+#include "json_loader.h"
+#include "station_row.h"
+#include "geo.h"
+#include "pricing.h"
+#include "connector.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SLOT_FREE (-1)
+#define SLOT_DELETED (-2)
+
+typedef struct ReloadCtx {
+    StationIndex* idx;
+    ReloadState* st;
+    ReloadStats stats;
+    int failed;
+} ReloadCtx;
+
+void rl_init(ReloadState* st) {
+    st->ents = NULL;
+    st->count = st->cap = st->live = 0;
+    st->slots = NULL;
+    st->slot_cap = st->slot_used = 0;
+    st->cursor = -1;
+    st->gen = 0;
+    st->pricing = NULL;
+}
+
+void rl_clear(ReloadState* st) {
+    if (!st) return;
+    free(st->ents);
+    free(st->slots);
+    rl_init(st);
+}
+
+/* case de station_id dans la table, ou case où l'insérer si absente */
+static int slot_find(const ReloadState* st, int id, int* found) {
+    int mask = st->slot_cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)id) & (uint64_t)mask);
+    int tomb = -1;
+    *found = 0;
+    while (st->slots[i] != SLOT_FREE) {
+        if (st->slots[i] == SLOT_DELETED) {
+            if (tomb < 0) tomb = i;
+        } else if (st->ents[st->slots[i]].station_id == id) {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return tomb >= 0 ? tomb : i;
+}
+
+/**
+ * Reconstruit la table de hachage ; avec compact, retire aussi les entrées
+ * mortes de ents en conservant l'ordre du fichier.
+ */
+static int rl_rebuild(ReloadState* st, int compact) {
+    if (compact) {
+        int w = 0;
+        for (int r = 0; r < st->count; r++)
+            if (!st->ents[r].dead) st->ents[w++] = st->ents[r];
+        st->count = w;
+        st->cursor = -1;
+    }
+    int nc = 1024;
+    while ((st->live + 1) * 2 > nc) nc *= 2;
+    int32_t* ns = (int32_t*)malloc(sizeof(int32_t) * nc);
+    if (!ns) return 0;
+    for (int i = 0; i < nc; i++) ns[i] = SLOT_FREE;
+    free(st->slots);
+    st->slots = ns;
+    st->slot_cap = nc;
+    st->slot_used = 0;
+    for (int r = 0; r < st->count; r++) {
+        if (st->ents[r].dead) continue;
+        int found;
+        st->slots[slot_find(st, st->ents[r].station_id, &found)] = r;
+        st->slot_used++;
+    }
+    return 1;
+}
+
+/* entrée de la station id (NULL si inconnue), en essayant d'abord la suivante du curseur */
+static ReloadEntry* rl_lookup(ReloadState* st, int id) {
+    int next = st->cursor + 1;
+    if (next < st->count && st->ents[next].station_id == id && !st->ents[next].dead) {
+        st->cursor = next;
+        return &st->ents[next];
+    }
+    if (st->slot_cap == 0) return NULL;
+    int found;
+    int s = slot_find(st, id, &found);
+    if (!found) return NULL;
+    st->cursor = st->slots[s];
+    return &st->ents[st->cursor];
+}
+
+static ReloadEntry* rl_append(ReloadState* st, int id) {
+    if ((st->slot_used + 1) * 4 > st->slot_cap * 3 && !rl_rebuild(st, 0)) return NULL;
+    if (st->count == st->cap) {
+        int nc = st->cap ? st->cap * 2 : 1024;
+        ReloadEntry* ne = (ReloadEntry*)realloc(st->ents, sizeof(ReloadEntry) * nc);
+        if (!ne) return NULL;
+        st->ents = ne;
+        st->cap = nc;
+    }
+    int found;
+    int s = slot_find(st, id, &found);
+    if (st->slots[s] == SLOT_FREE) st->slot_used++;
+    st->slots[s] = st->count;
+    ReloadEntry* e = &st->ents[st->count++];
+    e->station_id = id;
+    e->dead = 0;
+    e->is_new = 1;
+    e->gen = st->gen;
+    st->live++;
+    return e;
+}
+
+/**
+ * Traite une ligne du nouveau jeu : seule une empreinte différente de l'état
+ * courant de la station touche l'index. Les compteurs sont établis au balayage
+ * final, pour qu'un identifiant répété dans le fichier ne compte qu'une fois.
+ */
+/* prix publié d'une ligne : sans tarification, celui du jeu ; avec, celui du palier sur le nouveau prix de base */
+static int rl_price(ReloadState* st, const StationRow* row, int ts) {
+    if (!st->pricing) return row->info.price_cents;
+    if (!pr_add(st->pricing, row->station_id, row->info.price_cents, row->nbre_pdc, ts)) return -1;
+    return pr_price(st->pricing, row->station_id);
+}
+
+static void rl_apply_row(void* arg, const StationRow* row) {
+    ReloadCtx* c = (ReloadCtx*)arg;
+    ReloadState* st = c->st;
+    c->stats.rows++;
+    if (c->failed) return;
+    // identifiant attribué par le registre s'il est attaché, stable d'un rechargement à l'autre
+    StationRow r = *row;
+    if (!ds_row_resolve(c->idx, &r)) return;
+    row = &r;
+
+    uint64_t h = ds_row_hash(row);
+    ReloadEntry* e = rl_lookup(st, row->station_id);
+    if (e && e->gen != st->gen) {
+        e->base_hash = e->hash;
+        e->is_new = 0;
+        e->gen = st->gen;
+    }
+    if (e && e->hash == h) return;
+
+    StationNode* node = si_find_mut(c->idx, row->station_id);
+    if (node) {
+        // mise à jour des champs statiques, occupation conservée et bornée
+        int slots;
+        if (c->idx->conns) {
+            // connecteurs suivis : ceux qui restent gardent leur occupant
+            if (!cn_resize(c->idx->conns, row->station_id, row->nbre_pdc)) { c->failed = 1; return; }
+            slots = cn_free(c->idx->conns, row->station_id);
+        } else {
+            int old_pdc = e ? e->nbre_pdc : row->nbre_pdc;
+            slots = node->info.slots_free + (row->nbre_pdc - old_pdc);
+            if (slots < 0) slots = 0;
+            if (slots > row->nbre_pdc) slots = row->nbre_pdc;
+        }
+        int price = rl_price(st, row, node->info.last_ts);
+        if (price < 0) { c->failed = 1; return; }
+        node->info.power_kW    = row->info.power_kW;
+        node->info.price_cents = price;
+        node->info.slots_free  = slots;
+        c->idx->version++;
+        si_touch(c->idx, node->station_id);
+        if (c->idx->meta && !sm_set(c->idx->meta, row->station_id, &row->text)) { c->failed = 1; return; }
+        if (c->idx->geo)
+            geo_add(c->idx->geo, row->station_id, row->text.insee.p, row->text.insee.len, row->nbre_pdc, &node->info);
+        if (c->idx->spatial) sp_set(c->idx->spatial, row->station_id, row->lat_e6, row->lon_e6);
+    } else {
+        // réservé ici pour signaler l'échec : ds_row_insert retrouve la capacité déjà fixée
+        if (c->idx->conns && !cn_resize(c->idx->conns, row->station_id, row->nbre_pdc)) { c->failed = 1; return; }
+        ds_row_insert(c->idx, row);
+        int price = rl_price(st, row, 0);
+        if (price < 0) { c->failed = 1; return; }
+        if (price != row->info.price_cents && (node = si_find_mut(c->idx, row->station_id)) != NULL) {
+            node->info.price_cents = price;
+            si_touch_attr(c->idx, row->station_id);
+        }
+    }
+
+    if (!e && !(e = rl_append(st, row->station_id))) { c->failed = 1; return; }
+    e->nbre_pdc = row->nbre_pdc;
+    e->hash = h;
+}
+
+/* classe chaque station et supprime de l'index celles que le nouveau jeu n'a pas vues */
+static void rl_sweep(ReloadCtx* c) {
+    ReloadState* st = c->st;
+    int dead = 0;
+    for (int r = 0; r < st->count; r++) {
+        ReloadEntry* e = &st->ents[r];
+        if (e->dead) { dead++; continue; }
+        if (e->gen == st->gen) {
+            if (e->is_new) c->stats.inserted++;
+            else if (e->hash != e->base_hash) c->stats.updated++;
+            else c->stats.unchanged++;
+            continue;
+        }
+        si_delete(c->idx, e->station_id);
+        int found;
+        int s = slot_find(st, e->station_id, &found);
+        if (found) st->slots[s] = SLOT_DELETED;
+        e->dead = 1;
+        st->live--;
+        dead++;
+        c->stats.deleted++;
+    }
+    // compactage quand les trous dépassent le quart des entrées
+    if (dead * 4 > st->count) rl_rebuild(st, 1);
+    st->cursor = -1;
+}
+
+static int rl_run(int (*scan)(const char*, StationRowFn, void*), const char* path,
+                  StationIndex* idx, ReloadState* st, ReloadStats* out) {
+    if (!idx || !st) return -1;
+    ReloadCtx c = { idx, st, {0, 0, 0, 0, 0}, 0 };
+    st->gen++;
+    st->cursor = -1;
+    int rows = scan(path, rl_apply_row, &c);
+    if (rows >= 0 && !c.failed) rl_sweep(&c);
+    if (out) *out = c.stats;
+    if (rows < 0 || c.failed) return -1;
+    return c.stats.inserted + c.stats.updated + c.stats.deleted;
+}
+
+int ds_reload_stations_from_csv(const char* path, StationIndex* idx, ReloadState* st, ReloadStats* out) {
+    return rl_run(ds_scan_stations_from_csv, path, idx, st, out);
+}
+
+int ds_reload_stations_from_json(const char* path, StationIndex* idx, ReloadState* st, ReloadStats* out) {
+    return rl_run(ds_scan_stations_from_json, path, idx, st, out);
+}
+
+void rl_print_stats(const ReloadStats* s) {
+    if (!s) return;
+    printf("[RELOAD] %d lignes : +%d insérées, ~%d modifiées, -%d supprimées, %d inchangées\n",
+           s->rows, s->inserted, s->updated, s->deleted, s->unchanged);
+}
@@ -0,0 +1,78 @@
+#ifndef DS_RELOAD_H
+#define DS_RELOAD_H
+#include <stdint.h>
+#include "station_index.h"
+
+/**
+ * @brief Rechargement incrémental d'un jeu IRVE.
+ *
+ * L'état mémorise, pour chaque station issue du jeu, l'empreinte de sa ligne et
+ * sa capacité déclarée. Un rechargement ne modifie l'index que pour les lignes
+ * nouvelles, modifiées ou disparues ; slots_free et last_ts sont conservés.
+ * Le premier rechargement (état vide, index vide) équivaut à un chargement complet.
+ *
+ * Avec une tarification attachée (pricing), le prix d'une ligne nouvelle ou
+ * modifiée devient le prix de base de la station (pr_add) et le prix publié
+ * reste celui de son palier courant.
+ */
+
+typedef struct ReloadEntry {
+    int station_id;
+    int nbre_pdc;
+    uint64_t hash;      /* empreinte de la dernière ligne appliquée */
+    uint64_t base_hash; /* empreinte à la fin du rechargement précédent */
+    uint32_t gen;       /* génération du dernier rechargement ayant vu la station */
+    uint8_t dead;       /* supprimée, en attente de compactage */
+    uint8_t is_new;     /* apparue pendant le rechargement courant */
+} ReloadEntry;
+
+/**
+ * Les entrées sont rangées dans l'ordre du fichier : comme un export conserve
+ * l'essentiel de son ordre, la ligne suivante est d'abord cherchée juste après
+ * la précédente (accès séquentiel), la table de hachage ne sert qu'en cas d'écart.
+ */
+typedef struct ReloadState {
+    ReloadEntry* ents;
+    int count, cap, live;
+    int32_t* slots;     /* station_id -> indice dans ents (-1 libre, -2 supprimé) */
+    int slot_cap, slot_used;
+    int cursor;         /* indice de la dernière entrée reconnue */
+    uint32_t gen;
+    struct PricingEngine* pricing; /* tarification dynamique (pricing.h), NULL par défaut */
+} ReloadState;
+
+typedef struct ReloadStats {
+    int rows;       /* lignes lues */
+    int inserted;
+    int updated;
+    int deleted;
+    int unchanged;
+} ReloadStats;
+
+void rl_init(ReloadState* st);                                     /* O(1) */
+
+/**
+ * Applique la différence entre un CSV IRVE et l'index courant.
+ *
+ * @param path Chemin du nouveau fichier CSV.
+ * @param idx Index à mettre à jour (métadonnées attachées comprises).
+ * @param st État du rechargement précédent, mis à jour.
+ * @param out Compteurs de changements (peut être NULL).
+ * @return Nombre de changements appliqués, -1 si le fichier est illisible
+ *         (l'index n'est alors pas modifié pour les suppressions).
+ */
+int  ds_reload_stations_from_csv(const char* path, StationIndex* idx, ReloadState* st, ReloadStats* out);
+
+/**
+ * Équivalent de ds_reload_stations_from_csv pour un export JSON.
+ */
+int  ds_reload_stations_from_json(const char* path, StationIndex* idx, ReloadState* st, ReloadStats* out);
+
+/**
+ * Affiche les compteurs d'un rechargement.
+ */
+void rl_print_stats(const ReloadStats* s);
+
+void rl_clear(ReloadState* st);                                    /* O(n) */
+
+#endif
@@ -0,0 +1,488 @@
+#include "rule_expr.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char* const ATTR_NAMES[RA_COUNT] = { "id", "power", "price", "slots", "ts" };
+static const char* const OP_NAMES[] = { "<", "<=", ">", ">=", "==", "!=", "+", "-", "*" };
+
+const char* rule_attr_name(int attr) {
+    return (attr >= 0 && attr < RA_COUNT) ? ATTR_NAMES[attr] : "?";
+}
+
+/* ---------- analyse ---------- */
+
+typedef struct Parser {
+    const char* s;
+    int pos;
+    Rule* r;
+    char* err;
+    size_t err_len;
+    int failed;
+} Parser;
+
+static void fail(Parser* p, const char* msg) {
+    if (p->failed) return;
+    p->failed = 1;
+    if (p->err && p->err_len) snprintf(p->err, p->err_len, "position %d : %s", p->pos, msg);
+}
+
+static int node_new(Rule* r, int kind, int op, int a, int b, int value) {
+    if (r->count >= RULE_MAX_NODES) return -1;
+    RuleNode* n = &r->nodes[r->count];
+    n->kind = (unsigned char)kind;
+    n->op = (unsigned char)op;
+    n->a = (short)a;
+    n->b = (short)b;
+    n->value = value;
+    return r->count++;
+}
+
+static int make(Parser* p, int kind, int op, int a, int b, int value) {
+    if (p->failed) return -1;
+    if (p->r->count >= RULE_PARSE_MAX) { fail(p, "règle trop longue"); return -1; }
+    return node_new(p->r, kind, op, a, b, value);
+}
+
+static void skip_spaces(Parser* p) {
+    while (isspace((unsigned char)p->s[p->pos])) p->pos++;
+}
+
+/* consomme tok s'il se trouve à la position courante */
+static int accept(Parser* p, const char* tok) {
+    skip_spaces(p);
+    size_t n = strlen(tok);
+    if (strncmp(p->s + p->pos, tok, n) != 0) return 0;
+    // un mot-clé ne doit pas être le début d'un identifiant plus long
+    if (isalpha((unsigned char)tok[0]) && (isalnum((unsigned char)p->s[p->pos + n]) || p->s[p->pos + n] == '_'))
+        return 0;
+    p->pos += (int)n;
+    return 1;
+}
+
+static int parse_or(Parser* p);
+
+static int parse_atom(Parser* p) {
+    if (p->failed) return -1;
+    skip_spaces(p);
+    const char* s = p->s + p->pos;
+    if (accept(p, "(")) {
+        int e = parse_or(p);
+        if (!accept(p, ")")) fail(p, "')' attendu");
+        return e;
+    }
+    if (accept(p, "-")) {
+        int a = parse_atom(p);
+        int zero = make(p, RK_CONST, 0, -1, -1, 0);
+        return make(p, RK_ARITH, RO_SUB, zero, a, 0);
+    }
+    if (isdigit((unsigned char)*s)) {
+        long long v = 0;
+        while (isdigit((unsigned char)p->s[p->pos])) {
+            v = v * 10 + (p->s[p->pos++] - '0');
+            if (v > INT_MAX) { fail(p, "entier trop grand"); return -1; }
+        }
+        return make(p, RK_CONST, 0, -1, -1, (int)v);
+    }
+    if (isalpha((unsigned char)*s) || *s == '_') {
+        int n = 0;
+        while (isalnum((unsigned char)s[n]) || s[n] == '_') n++;
+        for (int a = 0; a < RA_COUNT; a++) {
+            if ((int)strlen(ATTR_NAMES[a]) == n && strncmp(s, ATTR_NAMES[a], (size_t)n) == 0) {
+                p->pos += n;
+                return make(p, RK_ATTR, 0, -1, -1, a);
+            }
+        }
+        fail(p, "attribut inconnu (id, power, price, slots, ts)");
+        return -1;
+    }
+    fail(p, *s ? "opérande attendu" : "fin de règle inattendue");
+    return -1;
+}
+
+static int parse_prod(Parser* p) {
+    int e = parse_atom(p);
+    while (!p->failed && accept(p, "*")) e = make(p, RK_ARITH, RO_MUL, e, parse_atom(p), 0);
+    return e;
+}
+
+static int parse_sum(Parser* p) {
+    int e = parse_prod(p);
+    while (!p->failed) {
+        if (accept(p, "+")) e = make(p, RK_ARITH, RO_ADD, e, parse_prod(p), 0);
+        else if (accept(p, "-")) e = make(p, RK_ARITH, RO_SUB, e, parse_prod(p), 0);
+        else break;
+    }
+    return e;
+}
+
+static int parse_cmp(Parser* p) {
+    int e = parse_sum(p);
+    // les opérateurs à deux caractères d'abord
+    static const struct { const char* tok; int op; } CMPS[] = {
+        { "<=", RO_LE }, { ">=", RO_GE }, { "==", RO_EQ }, { "!=", RO_NE }, { "<", RO_LT }, { ">", RO_GT },
+    };
+    for (size_t i = 0; !p->failed && i < sizeof CMPS / sizeof CMPS[0]; i++)
+        if (accept(p, CMPS[i].tok)) return make(p, RK_CMP, CMPS[i].op, e, parse_sum(p), 0);
+    return e;
+}
+
+static int parse_not(Parser* p) {
+    skip_spaces(p);
+    // "!" seul, pas le début de "!="
+    if ((p->s[p->pos] == '!' && p->s[p->pos + 1] != '=' && accept(p, "!")) || accept(p, "not"))
+        return make(p, RK_NOT, 0, parse_not(p), -1, 0);
+    return parse_cmp(p);
+}
+
+static int parse_and(Parser* p) {
+    int e = parse_not(p);
+    while (!p->failed && (accept(p, "&&") || accept(p, "and"))) e = make(p, RK_AND, 0, e, parse_not(p), 0);
+    return e;
+}
+
+static int parse_or(Parser* p) {
+    int e = parse_and(p);
+    while (!p->failed && (accept(p, "||") || accept(p, "or"))) e = make(p, RK_OR, 0, e, parse_and(p), 0);
+    return e;
+}
+
+int rule_parse(const char* text, Rule* out, char* err, size_t err_len) {
+    Parser p = { text ? text : "", 0, out, err, err_len, 0 };
+    out->count = 0;
+    out->root = parse_or(&p);
+    skip_spaces(&p);
+    if (!p.failed && p.s[p.pos] != '\0') fail(&p, "opérateur attendu");
+    if (p.failed) {
+        out->count = 0;
+        out->root = -1;
+        return 0;
+    }
+    return 1;
+}
+
+/* ---------- évaluation ---------- */
+
+static int arith(int op, int a, int b) {
+    // arithmétique modulaire : pas de comportement indéfini en cas de dépassement
+    switch (op) {
+        case RO_ADD: return (int)((unsigned)a + (unsigned)b);
+        case RO_SUB: return (int)((unsigned)a - (unsigned)b);
+        default:     return (int)((unsigned)a * (unsigned)b);
+    }
+}
+
+static int compare(int op, int a, int b) {
+    switch (op) {
+        case RO_LT: return a < b;
+        case RO_LE: return a <= b;
+        case RO_GT: return a > b;
+        case RO_GE: return a >= b;
+        case RO_EQ: return a == b;
+        default:    return a != b;
+    }
+}
+
+static int attr_value(int attr, int station_id, const StationInfo* info) {
+    switch (attr) {
+        case RA_ID:    return station_id;
+        case RA_POWER: return info->power_kW;
+        case RA_PRICE: return info->price_cents;
+        case RA_SLOTS: return info->slots_free;
+        default:       return info->last_ts;
+    }
+}
+
+int rule_eval_nodes(const RuleNode* nodes, int node, int station_id, const StationInfo* info) {
+    const RuleNode* n = &nodes[node];
+    switch (n->kind) {
+        case RK_CONST: return n->value;
+        case RK_ATTR:  return attr_value(n->value, station_id, info);
+        case RK_CMP:
+            return compare(n->op, rule_eval_nodes(nodes, n->a, station_id, info),
+                           rule_eval_nodes(nodes, n->b, station_id, info));
+        case RK_ARITH:
+            return arith(n->op, rule_eval_nodes(nodes, n->a, station_id, info),
+                         rule_eval_nodes(nodes, n->b, station_id, info));
+        case RK_NOT: return !rule_eval_nodes(nodes, n->a, station_id, info);
+        case RK_AND:
+            return rule_eval_nodes(nodes, n->a, station_id, info) && rule_eval_nodes(nodes, n->b, station_id, info);
+        default:
+            return rule_eval_nodes(nodes, n->a, station_id, info) || rule_eval_nodes(nodes, n->b, station_id, info);
+    }
+}
+
+int rule_eval(const Rule* r, int node, int station_id, const StationInfo* info) {
+    return rule_eval_nodes(r->nodes, node, station_id, info);
+}
+
+static int compact_rec(const Rule* r, int n, RuleNode* out, int cap, int* count) {
+    if (*count >= cap) return -1;
+    int at = (*count)++;
+    out[at] = r->nodes[n];
+    const RuleNode* x = &r->nodes[n];
+    if (x->kind == RK_CONST || x->kind == RK_ATTR) return at;
+    int a = compact_rec(r, x->a, out, cap, count);
+    int b = x->kind == RK_NOT ? -1 : compact_rec(r, x->b, out, cap, count);
+    if (a < 0 || (x->kind != RK_NOT && b < 0)) return -1;
+    out[at].a = (short)a;
+    out[at].b = (short)b;
+    return at;
+}
+
+int rule_compact(const Rule* r, RuleNode* out, int cap) {
+    int count = 0;
+    if (!r || r->root < 0 || compact_rec(r, r->root, out, cap, &count) < 0) return -1;
+    return count;
+}
+
+static void split_rec(const Rule* r, int n, int kind, int* out, int cap, int* count) {
+    if (r->nodes[n].kind == kind) {
+        split_rec(r, r->nodes[n].a, kind, out, cap, count);
+        split_rec(r, r->nodes[n].b, kind, out, cap, count);
+    } else {
+        if (*count < cap) out[*count] = n;
+        (*count)++;
+    }
+}
+
+int rule_conjuncts(const Rule* r, int node, int* out, int cap) {
+    int count = 0;
+    if (r && node >= 0) split_rec(r, node, RK_AND, out, cap, &count);
+    return count;
+}
+
+int rule_disjuncts(const Rule* r, int node, int* out, int cap) {
+    int count = 0;
+    if (r && node >= 0) split_rec(r, node, RK_OR, out, cap, &count);
+    return count;
+}
+
+int rule_conj_range(const Rule* r, int n, int* lo, int* hi) {
+    const RuleNode* x = &r->nodes[n];
+    if (x->kind != RK_CMP || x->op == RO_NE) return -1;
+    const RuleNode* a = &r->nodes[x->a];
+    const RuleNode* b = &r->nodes[x->b];
+    if (a->kind != RK_ATTR || b->kind != RK_CONST) return -1;
+    int k = b->value;
+    *lo = INT_MIN;
+    *hi = INT_MAX;
+    switch (x->op) {
+        case RO_LT: if (k == INT_MIN) { *lo = 1; *hi = 0; } else *hi = k - 1; break;
+        case RO_LE: *hi = k; break;
+        case RO_GT: if (k == INT_MAX) { *lo = 1; *hi = 0; } else *lo = k + 1; break;
+        case RO_GE: *lo = k; break;
+        default:    *lo = *hi = k; break;
+    }
+    return a->value;
+}
+
+/* ---------- normalisation ---------- */
+
+static int is_const(const Rule* r, int n) { return r->nodes[n].kind == RK_CONST; }
+
+static int is_bool(const Rule* r, int n) {
+    const RuleNode* x = &r->nodes[n];
+    if (x->kind == RK_CONST) return x->value == 0 || x->value == 1;
+    return x->kind == RK_CMP || x->kind == RK_NOT || x->kind == RK_AND || x->kind == RK_OR;
+}
+
+static int set_const(Rule* r, int n, int v) {
+    r->nodes[n].kind = RK_CONST;
+    r->nodes[n].value = v;
+    r->nodes[n].a = r->nodes[n].b = -1;
+    return n;
+}
+
+static int mirror_op(int op) {
+    switch (op) {
+        case RO_LT: return RO_GT;
+        case RO_LE: return RO_GE;
+        case RO_GT: return RO_LT;
+        case RO_GE: return RO_LE;
+        default:    return op;
+    }
+}
+
+static int negate_op(int op) {
+    switch (op) {
+        case RO_LT: return RO_GE;
+        case RO_LE: return RO_GT;
+        case RO_GT: return RO_LE;
+        case RO_GE: return RO_LT;
+        case RO_EQ: return RO_NE;
+        default:    return RO_EQ;
+    }
+}
+
+/* valeur numérique en contexte logique : x devient (x != 0) */
+static int as_bool(Rule* r, int n) {
+    if (is_bool(r, n)) return n;
+    if (is_const(r, n)) return set_const(r, n, r->nodes[n].value != 0);
+    int zero = node_new(r, RK_CONST, 0, -1, -1, 0);
+    return node_new(r, RK_CMP, RO_NE, n, zero, 0);
+}
+
+/* négation d'un sous-arbre booléen normalisé, en place (De Morgan) */
+static int negate(Rule* r, int n) {
+    RuleNode* x = &r->nodes[n];
+    switch (x->kind) {
+        case RK_CONST: x->value = !x->value; return n;
+        case RK_CMP:   x->op = (unsigned char)negate_op(x->op); return n;
+        case RK_AND:
+        case RK_OR:
+            x->kind = x->kind == RK_AND ? RK_OR : RK_AND;
+            x->a = (short)negate(r, x->a);
+            x->b = (short)negate(r, x->b);
+            return n;
+        default:
+            return n; // inatteignable : la forme normale ne contient plus de RK_NOT
+    }
+}
+
+/* "x + c op k" -> "x op k - c", "x - c op k" -> "x op k + c", sans dépassement */
+static void isolate_attr(Rule* r, RuleNode* cmp) {
+    for (;;) {
+        RuleNode* lhs = &r->nodes[cmp->a];
+        if (lhs->kind != RK_ARITH || lhs->op == RO_MUL || !is_const(r, cmp->b)) return;
+        long long k = r->nodes[cmp->b].value;
+        long long c;
+        int x;
+        if (is_const(r, lhs->b)) {
+            c = r->nodes[lhs->b].value;
+            x = lhs->a;
+            k = lhs->op == RO_ADD ? k - c : k + c;
+        } else if (is_const(r, lhs->a) && lhs->op == RO_ADD) {
+            c = r->nodes[lhs->a].value;
+            x = lhs->b;
+            k -= c;
+        } else {
+            return;
+        }
+        if (k < INT_MIN || k > INT_MAX) return;
+        r->nodes[cmp->b].value = (int)k;
+        cmp->a = (short)x;
+    }
+}
+
+static int normalize(Rule* r, int n) {
+    RuleNode* x = &r->nodes[n];
+    switch (x->kind) {
+        case RK_ARITH: {
+            x->a = (short)normalize(r, x->a);
+            x->b = (short)normalize(r, x->b);
+            if (is_const(r, x->a) && is_const(r, x->b))
+                return set_const(r, n, arith(x->op, r->nodes[x->a].value, r->nodes[x->b].value));
+            return n;
+        }
+        case RK_CMP: {
+            x->a = (short)normalize(r, x->a);
+            x->b = (short)normalize(r, x->b);
+            if (is_const(r, x->a) && is_const(r, x->b))
+                return set_const(r, n, compare(x->op, r->nodes[x->a].value, r->nodes[x->b].value));
+            if (is_const(r, x->a)) {
+                // constante à droite : "50 <= power" -> "power >= 50"
+                short t = x->a; x->a = x->b; x->b = t;
+                x->op = (unsigned char)mirror_op(x->op);
+            }
+            isolate_attr(r, x);
+            return n;
+        }
+        case RK_NOT:
+            return negate(r, as_bool(r, normalize(r, x->a)));
+        case RK_AND:
+        case RK_OR: {
+            int a = as_bool(r, normalize(r, x->a));
+            int b = as_bool(r, normalize(r, x->b));
+            x = &r->nodes[n];
+            int absorbing = x->kind == RK_OR; // vrai absorbe OU, faux absorbe ET
+            if ((is_const(r, a) && r->nodes[a].value == absorbing) ||
+                (is_const(r, b) && r->nodes[b].value == absorbing))
+                return set_const(r, n, absorbing);
+            if (is_const(r, a)) return b; // élément neutre
+            if (is_const(r, b)) return a;
+            x->a = (short)a;
+            x->b = (short)b;
+            return n;
+        }
+        default:
+            return n;
+    }
+}
+
+/* comparaisons strictes réécrites au sens large : "x > 0" -> "x >= 1", "x < 40" -> "x <= 39" */
+static void inclusive_rec(Rule* r, int n) {
+    RuleNode* x = &r->nodes[n];
+    if (x->kind == RK_AND || x->kind == RK_OR) {
+        inclusive_rec(r, x->a);
+        inclusive_rec(r, x->b);
+        return;
+    }
+    if (x->kind != RK_CMP || !is_const(r, x->b)) return;
+    int* k = &r->nodes[x->b].value;
+    if (x->op == RO_GT && *k != INT_MAX) {
+        x->op = RO_GE;
+        (*k)++;
+    } else if (x->op == RO_LT && *k != INT_MIN) {
+        x->op = RO_LE;
+        (*k)--;
+    }
+}
+
+void rule_normalize(Rule* r) {
+    if (!r || r->root < 0) return;
+    r->root = as_bool(r, normalize(r, r->root));
+    inclusive_rec(r, r->root);
+}
+
+/* ---------- affichage ---------- */
+
+typedef struct Out { char* buf; size_t len, pos; } Out;
+
+static void out_puts(Out* o, const char* s) {
+    while (*s) {
+        if (o->pos + 1 < o->len) o->buf[o->pos] = *s;
+        o->pos++;
+        s++;
+    }
+    if (o->len) o->buf[o->pos < o->len ? o->pos : o->len - 1] = '\0';
+}
+
+static int prec(const RuleNode* x) {
+    switch (x->kind) {
+        case RK_OR:    return 1;
+        case RK_AND:   return 2;
+        case RK_NOT:   return 3;
+        case RK_CMP:   return 4;
+        case RK_ARITH: return x->op == RO_MUL ? 6 : 5;
+        default:       return 7;
+    }
+}
+
+static void format_rec(const Rule* r, int n, int parent_prec, Out* o) {
+    const RuleNode* x = &r->nodes[n];
+    char num[16];
+    int p = prec(x);
+    if (p < parent_prec) out_puts(o, "(");
+    switch (x->kind) {
+        case RK_CONST: snprintf(num, sizeof num, "%d", x->value); out_puts(o, num); break;
+        case RK_ATTR:  out_puts(o, rule_attr_name(x->value)); break;
+        case RK_NOT:   out_puts(o, "!"); format_rec(r, x->a, p, o); break;
+        default:
+            format_rec(r, x->a, p, o);
+            out_puts(o, x->kind == RK_AND ? " && " : x->kind == RK_OR ? " || " : " ");
+            if (x->kind == RK_CMP || x->kind == RK_ARITH) { out_puts(o, OP_NAMES[x->op]); out_puts(o, " "); }
+            // opérande droit : priorité + 1 pour garder l'associativité à gauche
+            format_rec(r, x->b, x->kind == RK_AND || x->kind == RK_OR ? p : p + 1, o);
+            break;
+    }
+    if (p < parent_prec) out_puts(o, ")");
+}
+
+int rule_format(const Rule* r, int node, char* buf, size_t len) {
+    Out o = { buf, len, 0 };
+    if (len) buf[0] = '\0';
+    if (r && node >= 0) format_rec(r, node, 0, &o);
+    return (int)o.pos;
+}
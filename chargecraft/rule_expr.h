@@ -0,0 +1,108 @@
+#ifndef DS_RULE_EXPR_H
+#define DS_RULE_EXPR_H
+#include <stddef.h>
+#include "station_index.h"
+
+/**
+ * @brief Règles en notation infixe, par ex. "power >= 50 && (slots >= 1 || price < 40)".
+ *
+ * Grammaire (priorité croissante) :
+ *   ou    := et (('||' | 'or') et)*
+ *   et    := non (('&&' | 'and') non)*
+ *   non   := ('!' | 'not') non | cmp
+ *   cmp   := somme (('<' | '<=' | '>' | '>=' | '==' | '!=') somme)?
+ *   somme := prod (('+' | '-') prod)*
+ *   prod  := atome ('*' atome)*
+ *   atome := entier | attribut | '(' ou ')' | '-' atome
+ * Attributs : id, power, price, slots, ts. Comme en postfixe, une valeur non
+ * nulle est vraie. Les noeuds vivent dans un tableau fixe, fils par indice.
+ */
+
+typedef enum RuleKind { RK_CONST, RK_ATTR, RK_CMP, RK_ARITH, RK_NOT, RK_AND, RK_OR } RuleKind;
+typedef enum RuleAttr { RA_ID, RA_POWER, RA_PRICE, RA_SLOTS, RA_TS, RA_COUNT } RuleAttr;
+typedef enum RuleOp { RO_LT, RO_LE, RO_GT, RO_GE, RO_EQ, RO_NE, RO_ADD, RO_SUB, RO_MUL } RuleOp;
+
+#define RULE_PARSE_MAX 128  /* noeuds produits par le parseur */
+#define RULE_MAX_NODES 384  /* marge pour la normalisation (2 noeuds max ajoutés par noeud) */
+
+typedef struct RuleNode {
+    unsigned char kind;  /* RuleKind */
+    unsigned char op;    /* RuleOp, pour RK_CMP et RK_ARITH */
+    short a, b;          /* fils ; b inutilisé pour RK_NOT */
+    int value;           /* constante (RK_CONST) ou RuleAttr (RK_ATTR) */
+} RuleNode;
+
+typedef struct Rule {
+    RuleNode nodes[RULE_MAX_NODES];
+    int count;
+    int root;
+} Rule;
+
+/**
+ * Analyse une règle infixe.
+ *
+ * @param text Texte de la règle.
+ * @param out Règle à remplir.
+ * @param err Tampon recevant le message d'erreur (peut être NULL).
+ * @param err_len Taille du tampon err.
+ * @return 1 si succès, 0 si erreur de syntaxe.
+ */
+int  rule_parse(const char* text, Rule* out, char* err, size_t err_len);  /* O(longueur) */
+
+/**
+ * Met la règle sous forme normale : constantes repliées, négations poussées
+ * jusqu'aux comparaisons (plus aucun RK_NOT), comparaisons écrites
+ * "attribut op constante" quand c'est possible et au sens large (<=, >=),
+ * opérandes logiques booléens.
+ */
+void rule_normalize(Rule* r);                                               /* O(noeuds) */
+
+/**
+ * Évalue le sous-arbre node sur une station.
+ *
+ * @return Valeur de l'expression (0 = faux).
+ */
+int  rule_eval(const Rule* r, int node, int station_id, const StationInfo* info);
+
+/* même chose sur un tableau de noeuds nu (règle compactée) */
+int  rule_eval_nodes(const RuleNode* nodes, int node, int station_id, const StationInfo* info);
+
+/**
+ * Copie les noeuds atteignables depuis la racine dans out, racine en 0.
+ *
+ * @return Nombre de noeuds copiés, -1 si cap est insuffisant.
+ */
+int  rule_compact(const Rule* r, RuleNode* out, int cap);
+
+/**
+ * Liste les conjonctions du sous-arbre node (fils des RK_AND successifs).
+ *
+ * @return Nombre de conjonctions (peut dépasser cap : seules cap sont écrites).
+ */
+int  rule_conjuncts(const Rule* r, int node, int* out, int cap);
+
+/**
+ * Liste les disjonctions du sous-arbre node (fils des RK_OR successifs).
+ *
+ * @return Nombre de disjonctions (peut dépasser cap : seules cap sont écrites).
+ */
+int  rule_disjuncts(const Rule* r, int node, int* out, int cap);
+
+/**
+ * Plage inclusive [lo, hi] imposée par la conjonction n si elle est de la forme
+ * "attribut op constante" (op différent de !=).
+ *
+ * @return L'attribut contraint (RuleAttr), -1 sinon. lo > hi si la plage est vide.
+ */
+int  rule_conj_range(const Rule* r, int n, int* lo, int* hi);
+
+/**
+ * Réécrit le sous-arbre node en infixe dans buf (tronqué si trop court).
+ *
+ * @return Longueur écrite.
+ */
+int  rule_format(const Rule* r, int node, char* buf, size_t len);
+
+const char* rule_attr_name(int attr);
+
+#endif
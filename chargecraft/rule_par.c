@@ -0,0 +1,197 @@
+#include "rule_par.h"
+#include "query_cache.h"
+#include "rules.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int parts_for(const ThreadPool* pool) {
+    int parts = pool ? pool->nthreads * RPAR_PARTS_PER_THREAD : 1;
+    return parts < RPAR_MAX_PARTS ? parts : RPAR_MAX_PARTS;
+}
+
+/* ---------- top-N classé ---------- */
+
+/* tas borné à n, le moins bon candidat en tête */
+typedef struct RankHeap {
+    long long* keys;
+    int* ids;
+    int count;
+} RankHeap;
+
+typedef struct TopCtx {
+    const RulePlan* p;
+    const StationIndex* idx;
+    const RulePart* parts;
+    RankHeap heaps[TP_MAX_THREADS];
+    int rank, n;
+} TopCtx;
+
+typedef struct TopVisit {
+    RankHeap* h;
+    int rank, n;
+    int stop_when_full;   /* visite par identifiant croissant et classement par id */
+} TopVisit;
+
+static void heap_swap(RankHeap* h, int a, int b) {
+    long long k = h->keys[a]; h->keys[a] = h->keys[b]; h->keys[b] = k;
+    int id = h->ids[a]; h->ids[a] = h->ids[b]; h->ids[b] = id;
+}
+
+static int heap_push(void* arg, StationNode* node) {
+    TopVisit* v = (TopVisit*)arg;
+    RankHeap* h = v->h;
+    long long k = qc_rank_key(v->rank, &node->info);
+    int id = node->station_id;
+    if (h->count < v->n) {
+        // remontée : le parent doit rester moins bon que l'enfant
+        int i = h->count++;
+        h->keys[i] = k;
+        h->ids[i] = id;
+        while (i > 0 && qc_rank_cmp(h->keys[(i - 1) / 2], h->ids[(i - 1) / 2], k, id) < 0) {
+            heap_swap(h, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return 1;
+    }
+    if (qc_rank_cmp(k, id, h->keys[0], h->ids[0]) >= 0) return !v->stop_when_full;
+    h->keys[0] = k;
+    h->ids[0] = id;
+    for (int i = 0;;) {
+        int w = i, l = 2 * i + 1, r = l + 1;
+        if (l < h->count && qc_rank_cmp(h->keys[l], h->ids[l], h->keys[w], h->ids[w]) > 0) w = l;
+        if (r < h->count && qc_rank_cmp(h->keys[r], h->ids[r], h->keys[w], h->ids[w]) > 0) w = r;
+        if (w == i) break;
+        heap_swap(h, i, w);
+        i = w;
+    }
+    return 1;
+}
+
+static void top_task(void* arg, int task, int worker) {
+    TopCtx* t = (TopCtx*)arg;
+    const RulePart* part = &t->parts[task];
+    TopVisit v = { &t->heaps[worker], t->rank, t->n, t->rank == QC_BY_ID && !part->by_index };
+    rplan_execute_part(t->p, t->idx, part, heap_push, &v);
+}
+
+typedef struct Ranked {
+    long long key;
+    int id;
+} Ranked;
+
+static int cmp_ranked(const void* a, const void* b) {
+    const Ranked* x = (const Ranked*)a;
+    const Ranked* y = (const Ranked*)b;
+    return qc_rank_cmp(x->key, x->id, y->key, y->id);
+}
+
+int rpar_top_n(const RulePlan* p, const StationIndex* idx, ThreadPool* pool, int rank, int n,
+               int* ids, long long* keys) {
+    if (!p || !idx || n <= 0) return 0;
+    RulePart parts[RPAR_MAX_PARTS];
+    int n_parts = rplan_partitions(p, idx, parts_for(pool), parts);
+    if (n_parts == 0) return 0;
+
+    int threads = pool ? pool->nthreads : 1;
+    TopCtx t;
+    t.p = p;
+    t.idx = idx;
+    t.parts = parts;
+    t.rank = rank;
+    t.n = n;
+    long long* key_mem = (long long*)malloc(sizeof(long long) * (size_t)threads * n);
+    int* id_mem = (int*)malloc(sizeof(int) * (size_t)threads * n);
+    Ranked* all = (Ranked*)malloc(sizeof(Ranked) * (size_t)threads * n);
+    if (!key_mem || !id_mem || !all) {
+        free(key_mem);
+        free(id_mem);
+        free(all);
+        return -1;
+    }
+    for (int w = 0; w < threads; w++)
+        t.heaps[w] = (RankHeap){ key_mem + (size_t)w * n, id_mem + (size_t)w * n, 0 };
+
+    if (pool) tp_run(pool, n_parts, top_task, &t);
+    else for (int k = 0; k < n_parts; k++) top_task(&t, k, 0);
+
+    // fusion : l'ordre (clé, id) est total, le résultat ne dépend pas de la répartition
+    int total = 0;
+    for (int w = 0; w < threads; w++)
+        for (int i = 0; i < t.heaps[w].count; i++) all[total++] = (Ranked){ t.heaps[w].keys[i], t.heaps[w].ids[i] };
+    if (total > 1) qsort(all, (size_t)total, sizeof(Ranked), cmp_ranked);
+    if (total > n) total = n;
+    for (int i = 0; i < total; i++) {
+        ids[i] = all[i].id;
+        if (keys) keys[i] = all[i].key;
+    }
+    free(key_mem);
+    free(id_mem);
+    free(all);
+    return total;
+}
+
+/* ---------- n premières stations d'une règle postfixée ---------- */
+
+typedef struct FirstCtx {
+    const StationIndex* idx;
+    char** toks;
+    int n_toks, n;
+    const int* starts;
+    int n_parts;
+    StationNode** found;    /* n cases par tranche */
+    int* counts;
+    atomic_int cutoff;      /* plus petite tranche ayant trouvé n stations (n_parts sinon) */
+} FirstCtx;
+
+static void first_task(void* arg, int task, int worker) {
+    (void)worker;
+    FirstCtx* f = (FirstCtx*)arg;
+    int lo = f->starts[task], hi = task + 1 < f->n_parts ? f->starts[task + 1] - 1 : INT_MAX;
+    StationNode** found = f->found + (size_t)task * f->n;
+    int count = 0;
+    SiCursor cur;
+    si_cursor_begin(&cur, f->idx, lo, hi);
+    for (StationNode* node; count < f->n && (node = si_cursor_next(&cur)) != NULL;) {
+        // une tranche précédente suffit déjà : inutile de continuer
+        if (atomic_load_explicit(&f->cutoff, memory_order_relaxed) < task) break;
+        if (eval_rule_postfix(f->toks, f->n_toks, &node->info)) found[count++] = node;
+    }
+    f->counts[task] = count;
+    if (count == f->n) {
+        int c = atomic_load(&f->cutoff);
+        while (task < c && !atomic_compare_exchange_weak(&f->cutoff, &c, task)) {}
+    }
+}
+
+int rpar_first_n_postfix(const StationIndex* idx, ThreadPool* pool, char* toks[], int n_toks, int n,
+                         StationNode** out) {
+    if (!idx || n <= 0 || !idx->root) return 0;
+    int starts[RPAR_MAX_PARTS];
+    FirstCtx f;
+    f.idx = idx;
+    f.toks = toks;
+    f.n_toks = n_toks;
+    f.n = n;
+    f.starts = starts;
+    f.n_parts = si_partition(idx, parts_for(pool), starts);
+    f.found = (StationNode**)malloc(sizeof(StationNode*) * (size_t)f.n_parts * n);
+    f.counts = (int*)calloc((size_t)f.n_parts, sizeof(int));
+    if (!f.found || !f.counts) {
+        free(f.found);
+        free(f.counts);
+        return -1;
+    }
+    atomic_init(&f.cutoff, f.n_parts);
+
+    if (pool) tp_run(pool, f.n_parts, first_task, &f);
+    else for (int k = 0; k < f.n_parts; k++) first_task(&f, k, 0);
+
+    // concaténation dans l'ordre des tranches, donc des identifiants
+    int total = 0;
+    for (int k = 0; k < f.n_parts && total < n; k++)
+        for (int i = 0; i < f.counts[k] && total < n; i++) out[total++] = f.found[(size_t)k * n + i];
+    free(f.found);
+    free(f.counts);
+    return total;
+}
@@ -0,0 +1,50 @@
+#ifndef DS_RULE_PAR_H
+#define DS_RULE_PAR_H
+#include "station_index.h"
+#include "rule_plan.h"
+#include "pool.h"
+
+/**
+ * @brief Exécution parallèle des requêtes de règles sur un pool de threads.
+ *
+ * Le plan est découpé en tranches (rplan_partitions : sous-arbres de l'AVL ou
+ * intervalles d'un index secondaire), environ RPAR_PARTS_PER_THREAD par thread
+ * pour que le vol de travail équilibre les tranches inégales. Chaque thread
+ * garde ses meilleurs candidats dans un tas borné à lui ; la fusion trie
+ * l'union des tas sur (clé, identifiant), ordre total : le résultat est
+ * identique à celui de l'exécution séquentielle quel que soit le nombre de
+ * threads ou l'ordre des tranches.
+ *
+ * L'index ne doit pas être modifié pendant l'appel (lecture seule partagée).
+ */
+
+#define RPAR_PARTS_PER_THREAD 4
+#define RPAR_MAX_PARTS 256
+
+/**
+ * Top-N d'un plan selon un classement de query_cache.h (QcRank).
+ *
+ * @param pool Pool de threads, ou NULL pour une exécution séquentielle.
+ * @param rank Classement (QcRank).
+ * @param n Nombre maximal de stations.
+ * @param ids Reçoit les identifiants classés (au moins n cases).
+ * @param keys Reçoit leur clé de classement (au moins n cases), ou NULL.
+ * @return Nombre de stations, -1 en cas d'échec d'allocation.
+ */
+int rpar_top_n(const RulePlan* p, const StationIndex* idx, ThreadPool* pool, int rank, int n,
+               int* ids, long long* keys);                      /* O(k log n / threads + threads n log n) */
+
+/**
+ * Les n premières stations (ordre des identifiants) satisfaisant une règle
+ * postfixée. Chaque tranche d'identifiants garde ses n premières
+ * correspondances ; une tranche est abandonnée dès qu'une tranche précédente
+ * en a trouvé n.
+ *
+ * @param pool Pool de threads, ou NULL pour une exécution séquentielle.
+ * @param out Reçoit les noeuds (au moins n cases).
+ * @return Nombre de stations, -1 en cas d'échec d'allocation.
+ */
+int rpar_first_n_postfix(const StationIndex* idx, ThreadPool* pool, char* toks[], int n_toks, int n,
+                         StationNode** out);                    /* O(stations parcourues / threads) */
+
+#endif
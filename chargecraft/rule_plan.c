@@ -0,0 +1,402 @@
+#include "rule_plan.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* coût relatif d'une station lue via un index secondaire (accès dans le désordre) */
+#define SECONDARY_FETCH_COST 1.5
+
+void ri_init(RuleIndexes* ri) {
+    ri->by_power = ri->by_price = NULL;
+    ri->count = ri->cap = 0;
+    ri->version = ri->attr_version = 0;
+    ri->built = 0;
+}
+
+void ri_clear(RuleIndexes* ri) {
+    if (!ri) return;
+    free(ri->by_power);
+    free(ri->by_price);
+    ri_init(ri);
+}
+
+static int cmp_entry(const void* a, const void* b) {
+    const AttrEntry* x = (const AttrEntry*)a;
+    const AttrEntry* y = (const AttrEntry*)b;
+    if (x->value != y->value) return x->value < y->value ? -1 : 1;
+    return (x->node->station_id > y->node->station_id) - (x->node->station_id < y->node->station_id);
+}
+
+static int collect(void* ctx, StationNode* n) {
+    RuleIndexes* ri = (RuleIndexes*)ctx;
+    ri->by_power[ri->count].value = n->info.power_kW;
+    ri->by_power[ri->count].node = n;
+    ri->by_price[ri->count].value = n->info.price_cents;
+    ri->by_price[ri->count].node = n;
+    ri->count++;
+    return 1;
+}
+
+int ri_refresh(RuleIndexes* ri, const StationIndex* idx) {
+    if (!ri || !idx) return 0;
+    if (ri->built && ri->version == idx->version && ri->attr_version == idx->attr_version) return 1;
+    if (idx->size > ri->cap) {
+        int nc = idx->size;
+        AttrEntry* pw = (AttrEntry*)realloc(ri->by_power, sizeof(AttrEntry) * nc);
+        if (pw) ri->by_power = pw;
+        AttrEntry* pr = (AttrEntry*)realloc(ri->by_price, sizeof(AttrEntry) * nc);
+        if (pr) ri->by_price = pr;
+        if (!pw || !pr) { ri->built = 0; return 0; }
+        ri->cap = nc;
+    }
+    ri->count = 0;
+    si_range(idx, INT_MIN, INT_MAX, collect, ri);
+    if (ri->count > 1) {
+        qsort(ri->by_power, (size_t)ri->count, sizeof(AttrEntry), cmp_entry);
+        qsort(ri->by_price, (size_t)ri->count, sizeof(AttrEntry), cmp_entry);
+    }
+    ri->version = idx->version;
+    ri->attr_version = idx->attr_version;
+    ri->built = 1;
+    return 1;
+}
+
+/* premier indice dont la valeur est >= v */
+static int lower_bound(const AttrEntry* e, int n, int v) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (e[mid].value < v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* premier indice dont la valeur est > v */
+static int upper_bound(const AttrEntry* e, int n, int v) {
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (e[mid].value <= v) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static const AttrEntry* entries_of(const RuleIndexes* ri, int attr) {
+    return attr == RA_POWER ? ri->by_power : ri->by_price;
+}
+
+static int ri_usable(const RuleIndexes* ri, const StationIndex* idx) {
+    return ri && ri->built && ri->version == idx->version && ri->attr_version == idx->attr_version;
+}
+
+/* ---------- planification ---------- */
+
+/* attribut indexé contraint par la conjonction n, -1 sinon */
+static int conj_range(const Rule* r, int n, int* lo, int* hi) {
+    int a = rule_conj_range(r, n, lo, hi);
+    return (a == RA_ID || a == RA_POWER || a == RA_PRICE) ? a : -1;
+}
+
+static void id_bounds(const StationIndex* idx, int* min_id, int* max_id) {
+    StationNode* n = idx->root;
+    while (n->left) n = n->left;
+    *min_id = n->station_id;
+    n = idx->root;
+    while (n->right) n = n->right;
+    *max_id = n->station_id;
+}
+
+static void estimate(RulePlan* p, const StationIndex* idx, const RuleIndexes* ri) {
+    double n = p->total;
+    double seek = n > 1 ? log2(n) : 1.0;
+    for (int a = 0; a < RA_COUNT; a++) {
+        PlanCandidate* c = &p->cand[a];
+        if (!c->usable) continue;
+        if (c->lo > c->hi || n == 0) {
+            c->rows = 0;
+            c->cost = 0;
+        } else if (a == RA_ID) {
+            // répartition uniforme des identifiants entre le min et le max de l'AVL
+            int min_id, max_id;
+            id_bounds(idx, &min_id, &max_id);
+            double lo = c->lo > min_id ? c->lo : min_id;
+            double hi = c->hi < max_id ? c->hi : max_id;
+            double span = (double)max_id - min_id + 1;
+            c->rows = hi < lo ? 0 : n * (hi - lo + 1) / span;
+            c->cost = seek + c->rows;
+        } else if (ri) {
+            // index trié : le nombre exact de lignes est connu
+            const AttrEntry* e = entries_of(ri, a);
+            c->rows = upper_bound(e, ri->count, c->hi) - lower_bound(e, ri->count, c->lo);
+            c->cost = seek + c->rows * SECONDARY_FETCH_COST;
+        } else {
+            c->usable = 0;
+        }
+    }
+}
+
+int rplan_build(RulePlan* p, const char* text, const StationIndex* idx, RuleIndexes* ri,
+                char* err, size_t err_len) {
+    memset(p, 0, sizeof *p);
+    if (!rule_parse(text, &p->rule, err, err_len)) return 0;
+    rule_normalize(&p->rule);
+
+    const Rule* r = &p->rule;
+    p->total = idx ? idx->size : 0;
+    p->ri = (ri && idx && ri_refresh(ri, idx)) ? ri : NULL;
+
+    const RuleNode* root = &r->nodes[r->root];
+    if (root->kind == RK_CONST) {
+        // règle constante : tout ou rien, sans filtre
+        p->access = root->value ? PA_SCAN : PA_EMPTY;
+        p->est_rows = p->cost = root->value ? p->total : 0;
+        return 1;
+    }
+
+    int conj[RULE_MAX_CONJ];
+    p->n_conj = rule_conjuncts(r, r->root, conj, RULE_MAX_CONJ);
+    if (p->n_conj > RULE_MAX_CONJ) {
+        // trop de conjonctions : on évalue la règle entière en balayage
+        p->access = PA_SCAN;
+        p->residual[p->n_residual++] = r->root;
+        p->est_rows = p->cost = p->total;
+        return 1;
+    }
+
+    for (int i = 0; i < p->n_conj; i++) {
+        int lo, hi;
+        int a = conj_range(r, conj[i], &lo, &hi);
+        if (a < 0) continue;
+        PlanCandidate* c = &p->cand[a];
+        if (!c->usable) { c->usable = 1; c->lo = INT_MIN; c->hi = INT_MAX; }
+        if (lo > c->lo) c->lo = lo;
+        if (hi < c->hi) c->hi = hi;
+    }
+    estimate(p, idx, p->ri);
+
+    p->access = PA_SCAN;
+    p->attr = -1;
+    p->est_rows = p->cost = p->total;
+    for (int a = 0; a < RA_COUNT; a++) {
+        const PlanCandidate* c = &p->cand[a];
+        if (!c->usable || c->cost >= p->cost) continue;
+        p->access = c->lo > c->hi ? PA_EMPTY : PA_RANGE;
+        p->attr = a;
+        p->lo = c->lo;
+        p->hi = c->hi;
+        p->est_rows = c->rows;
+        p->cost = c->cost;
+    }
+    if (p->access == PA_EMPTY) return 1;
+
+    // les conjonctions couvertes par la plage pilote ne sont pas réévaluées
+    for (int i = 0; i < p->n_conj; i++) {
+        int lo, hi;
+        if (p->access == PA_RANGE && conj_range(r, conj[i], &lo, &hi) == p->attr) continue;
+        p->residual[p->n_residual++] = conj[i];
+    }
+    return 1;
+}
+
+static void print_bound(int v) {
+    if (v == INT_MIN) printf("-inf");
+    else if (v == INT_MAX) printf("+inf");
+    else printf("%d", v);
+}
+
+void rplan_explain(const RulePlan* p) {
+    char buf[512];
+    rule_format(&p->rule, p->rule.root, buf, sizeof buf);
+    printf("=== EXPLAIN (%.0f stations indexées) ===\n", p->total);
+    printf("  règle normalisée : %s\n", buf);
+    printf("  accès            : ");
+    if (p->access == PA_EMPTY) printf("VIDE (règle insatisfiable)");
+    else if (p->access == PA_SCAN) printf("BALAYAGE complet (AVL, ordre des id)");
+    else {
+        printf("%s %s [", p->attr == RA_ID ? "PLAGE AVL" : "INDEX", rule_attr_name(p->attr));
+        print_bound(p->lo);
+        printf(", ");
+        print_bound(p->hi);
+        printf("]");
+    }
+    printf("  ~%.0f lignes, coût %.1f\n", p->est_rows, p->cost);
+
+    printf("  filtre résiduel  : ");
+    if (p->n_residual == 0) printf("(aucun)\n");
+    for (int i = 0; i < p->n_residual; i++) {
+        rule_format(&p->rule, p->residual[i], buf, sizeof buf);
+        int paren = p->n_residual > 1 && p->rule.nodes[p->residual[i]].kind == RK_OR;
+        printf("%s%s%s%s", i ? " && " : "", paren ? "(" : "", buf, paren ? ")" : "");
+        if (i == p->n_residual - 1) printf("\n");
+    }
+
+    printf("  alternatives     : BALAYAGE coût %.1f", p->total);
+    for (int a = 0; a < RA_COUNT; a++) {
+        const PlanCandidate* c = &p->cand[a];
+        if (!c->usable) continue;
+        printf(" ; %s [", rule_attr_name(a));
+        print_bound(c->lo);
+        printf(", ");
+        print_bound(c->hi);
+        printf("] ~%.0f lignes coût %.1f", c->rows, c->cost);
+    }
+    printf("\n");
+}
+
+/* ---------- exécution ---------- */
+
+typedef struct ExecCtx {
+    const RulePlan* p;
+    const int* filter;
+    int n_filter;
+    RuleMatchFn fn;
+    void* ctx;
+    int matches;
+    int stopped;
+} ExecCtx;
+
+/* 0 quand fn demande l'arrêt */
+static int visit(void* ctx, StationNode* n) {
+    ExecCtx* x = (ExecCtx*)ctx;
+    const Rule* r = &x->p->rule;
+    for (int i = 0; i < x->n_filter; i++)
+        if (!rule_eval(r, x->filter[i], n->station_id, &n->info)) return 1;
+    x->matches++;
+    if (!x->fn(x->ctx, n)) x->stopped = 1;
+    return !x->stopped;
+}
+
+int rplan_execute(const RulePlan* p, const StationIndex* idx, RuleMatchFn fn, void* ctx) {
+    if (!p || !idx || !fn || p->access == PA_EMPTY) return 0;
+    ExecCtx x = { p, p->residual, p->n_residual, fn, ctx, 0, 0 };
+
+    if (p->access == PA_SCAN || p->attr == RA_ID) {
+        int lo = p->access == PA_SCAN ? INT_MIN : p->lo;
+        int hi = p->access == PA_SCAN ? INT_MAX : p->hi;
+        si_range(idx, lo, hi, visit, &x);
+        return x.matches;
+    }
+    if (!ri_usable(p->ri, idx)) {
+        // l'AVL ou un prix a changé depuis la planification : on retombe sur la règle entière
+        x.filter = &p->rule.root;
+        x.n_filter = 1;
+        si_range(idx, INT_MIN, INT_MAX, visit, &x);
+        return x.matches;
+    }
+    const AttrEntry* e = entries_of(p->ri, p->attr);
+    for (int i = lower_bound(e, p->ri->count, p->lo); i < p->ri->count && e[i].value <= p->hi && !x.stopped; i++)
+        visit(&x, e[i].node);
+    return x.matches;
+}
+
+/* le plan s'exécute-t-il sur l'AVL (ordre des id) plutôt que sur un index secondaire ? */
+static int runs_on_avl(const RulePlan* p, const StationIndex* idx) {
+    return p->access == PA_SCAN || p->attr == RA_ID || !ri_usable(p->ri, idx);
+}
+
+int rplan_partitions(const RulePlan* p, const StationIndex* idx, int parts, RulePart* out) {
+    if (!p || !idx || parts < 1 || p->access == PA_EMPTY || !idx->root) return 0;
+    if (runs_on_avl(p, idx)) {
+        int lo = p->access == PA_RANGE && p->attr == RA_ID ? p->lo : INT_MIN;
+        int hi = p->access == PA_RANGE && p->attr == RA_ID ? p->hi : INT_MAX;
+        int* starts = (int*)malloc(sizeof(int) * (size_t)parts);
+        if (!starts) {
+            out[0] = (RulePart){ 0, lo, hi };
+            return 1;
+        }
+        int k = si_partition(idx, parts, starts), n = 0;
+        for (int i = 0; i < k; i++) {
+            // intersection de la plage du sous-arbre avec celle du plan
+            int a = starts[i], b = i + 1 < k ? starts[i + 1] - 1 : INT_MAX;
+            if (a < lo) a = lo;
+            if (b > hi) b = hi;
+            if (a <= b) out[n++] = (RulePart){ 0, a, b };
+        }
+        free(starts);
+        return n;
+    }
+    const AttrEntry* e = entries_of(p->ri, p->attr);
+    int a = lower_bound(e, p->ri->count, p->lo), b = upper_bound(e, p->ri->count, p->hi);
+    if (a >= b) return 0;
+    if (parts > b - a) parts = b - a;
+    for (int i = 0; i < parts; i++)
+        out[i] = (RulePart){ 1, a + (int)((long long)(b - a) * i / parts), a + (int)((long long)(b - a) * (i + 1) / parts) };
+    return parts;
+}
+
+int rplan_execute_part(const RulePlan* p, const StationIndex* idx, const RulePart* part,
+                       RuleMatchFn fn, void* ctx) {
+    if (!p || !idx || !part || !fn || p->access == PA_EMPTY) return 0;
+    ExecCtx x = { p, p->residual, p->n_residual, fn, ctx, 0, 0 };
+    if (!part->by_index) {
+        if (p->access == PA_RANGE && p->attr != RA_ID) {
+            // index secondaire périmé (voir rplan_execute) : règle entière
+            x.filter = &p->rule.root;
+            x.n_filter = 1;
+        }
+        si_range(idx, part->lo, part->hi, visit, &x);
+        return x.matches;
+    }
+    if (!ri_usable(p->ri, idx)) return 0;
+    const AttrEntry* e = entries_of(p->ri, p->attr);
+    for (int i = part->lo; i < part->hi && !x.stopped; i++) visit(&x, e[i].node);
+    return x.matches;
+}
+
+typedef struct TopN {
+    StationNode** nodes;
+    int count, cap;
+    int limit;  /* arrêt anticipé quand l'ordre de visite est celui des id */
+} TopN;
+
+static int topn_collect(void* arg, StationNode* n) {
+    TopN* t = (TopN*)arg;
+    if (t->count == t->cap) {
+        int nc = t->cap ? t->cap * 2 : 64;
+        StationNode** nn = (StationNode**)realloc(t->nodes, sizeof(StationNode*) * nc);
+        if (!nn) return 0;
+        t->nodes = nn;
+        t->cap = nc;
+    }
+    t->nodes[t->count++] = n;
+    return t->limit <= 0 || t->count < t->limit;
+}
+
+static int cmp_node_id(const void* a, const void* b) {
+    int x = (*(StationNode* const*)a)->station_id;
+    int y = (*(StationNode* const*)b)->station_id;
+    return (x > y) - (x < y);
+}
+
+void rules_query_print(StationIndex* idx, RuleIndexes* ri, const char* text, int n) {
+    RulePlan* p = (RulePlan*)malloc(sizeof(RulePlan));
+    if (!p) return;
+    char err[128];
+    if (!rplan_build(p, text, idx, ri, err, sizeof err)) {
+        printf("[Rules] Règle invalide \"%s\" : %s\n", text, err);
+        free(p);
+        return;
+    }
+    rplan_explain(p);
+
+    int id_order = p->access == PA_SCAN || p->attr == RA_ID;
+    TopN t = { NULL, 0, 0, id_order ? n : 0 };
+    rplan_execute(p, idx, topn_collect, &t);
+    if (!id_order && t.count > 1) qsort(t.nodes, (size_t)t.count, sizeof(StationNode*), cmp_node_id);
+
+    printf("\n=== TOP-%d Stations (%s) ===\n", n, text);
+    int shown = t.count < n ? t.count : n;
+    for (int i = 0; i < shown; i++) {
+        const StationNode* s = t.nodes[i];
+        printf("  %d. Station %d | Power: %d kW | Slots: %d | Prix: %d cts\n",
+               i + 1, s->station_id, s->info.power_kW, s->info.slots_free, s->info.price_cents);
+    }
+    if (shown == 0) printf("  Aucune station ne correspond aux critères.\n");
+    printf("========================================\n");
+    free(t.nodes);
+    free(p);
+}
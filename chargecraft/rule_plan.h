@@ -0,0 +1,130 @@
+#ifndef DS_RULE_PLAN_H
+#define DS_RULE_PLAN_H
+#include <stddef.h>
+#include "station_index.h"
+#include "rule_expr.h"
+
+/**
+ * @brief Planificateur de règles infixes.
+ *
+ * La règle normalisée est découpée en conjonctions. Celles de la forme
+ * "attribut op constante" sur un attribut indexé (id via l'AVL, power et price
+ * via RuleIndexes) donnent une plage ; la plage la plus sélective pilote le
+ * parcours, les autres conjonctions sont évaluées en filtre résiduel.
+ */
+
+typedef struct AttrEntry {
+    int value;
+    StationNode* node;
+} AttrEntry;
+
+/* index secondaires triés par (valeur, id), reconstruits quand l'AVL ou un prix a changé */
+typedef struct RuleIndexes {
+    AttrEntry* by_power;
+    AttrEntry* by_price;
+    int count, cap;
+    unsigned version;   /* version de l'AVL indexée */
+    unsigned attr_version;  /* attr_version de l'AVL indexée (prix changés sur place) */
+    int built;
+} RuleIndexes;
+
+void ri_init(RuleIndexes* ri);                                  /* O(1) */
+
+/**
+ * Reconstruit les index secondaires si l'AVL a changé depuis la dernière construction,
+ * ou si une puissance ou un prix a changé sur place (tarification dynamique) ; les
+ * créneaux libres ne sont pas indexés : leurs mises à jour ne les invalident pas.
+ *
+ * @return 1 si les index sont à jour, 0 en cas d'échec d'allocation.
+ */
+int  ri_refresh(RuleIndexes* ri, const StationIndex* idx);      /* O(1) ou O(n log n) */
+
+void ri_clear(RuleIndexes* ri);
+
+typedef enum PlanAccess { PA_EMPTY, PA_SCAN, PA_RANGE } PlanAccess;
+
+#define RULE_MAX_CONJ 64
+
+typedef struct PlanCandidate {
+    int usable;          /* au moins une conjonction de plage sur cet attribut */
+    int lo, hi;          /* plage inclusive */
+    double rows, cost;   /* lignes estimées, coût estimé */
+} PlanCandidate;
+
+typedef struct RulePlan {
+    Rule rule;                       /* règle normalisée */
+    int access;                      /* PlanAccess */
+    int attr;                        /* attribut pilote (PA_RANGE) */
+    int lo, hi;
+    int residual[RULE_MAX_CONJ];     /* conjonctions à évaluer sur chaque candidat */
+    int n_residual;
+    int n_conj;
+    PlanCandidate cand[RA_COUNT];    /* alternatives étudiées, pour EXPLAIN */
+    double total, est_rows, cost;    /* stations indexées, lignes et coût du plan retenu */
+    const RuleIndexes* ri;           /* index secondaires utilisés (NULL : AVL seule) */
+} RulePlan;
+
+/**
+ * Analyse, normalise et planifie une règle infixe.
+ *
+ * @param p Plan à remplir.
+ * @param text Règle infixe.
+ * @param idx Index des stations (statistiques et accès par id).
+ * @param ri Index secondaires (rafraîchis au besoin), ou NULL.
+ * @param err Message d'erreur de syntaxe (peut être NULL).
+ * @param err_len Taille de err.
+ * @return 1 si succès, 0 si la règle est invalide.
+ */
+int  rplan_build(RulePlan* p, const char* text, const StationIndex* idx, RuleIndexes* ri,
+                 char* err, size_t err_len);
+
+/**
+ * Affiche le plan retenu, son coût estimé et les alternatives (façon EXPLAIN).
+ */
+void rplan_explain(const RulePlan* p);
+
+/* appelée pour chaque station retenue ; retourner 0 arrête le parcours */
+typedef int (*RuleMatchFn)(void* ctx, StationNode* node);
+
+/**
+ * Exécute le plan. Les stations sont visitées par identifiant croissant pour
+ * PA_SCAN et une plage sur id, par valeur de l'attribut pilote sinon.
+ *
+ * @return Nombre de stations transmises à fn.
+ */
+int  rplan_execute(const RulePlan* p, const StationIndex* idx, RuleMatchFn fn, void* ctx);
+
+/* tranche d'un plan, exécutable indépendamment des autres */
+typedef struct RulePart {
+    int by_index;   /* 1 : positions [lo, hi[ de l'index secondaire pilote ; 0 : identifiants [lo, hi] */
+    int lo, hi;
+} RulePart;
+
+/**
+ * Découpe l'exécution d'un plan en tranches disjointes qui, parcourues dans
+ * l'ordre, visitent exactement les stations de rplan_execute dans le même ordre :
+ * plages de sous-arbres de l'AVL (si_partition) pour un balayage ou une plage
+ * sur id, intervalles égaux de l'index secondaire pour power et price.
+ *
+ * @param parts Nombre de tranches souhaité.
+ * @param out Reçoit au plus parts tranches.
+ * @return Nombre de tranches (0 pour un plan vide).
+ */
+int  rplan_partitions(const RulePlan* p, const StationIndex* idx, int parts, RulePart* out);  /* O(parts + log n) */
+
+/**
+ * Exécute une tranche de plan. Plusieurs tranches d'un même plan peuvent être
+ * exécutées en parallèle tant que l'index n'est pas modifié.
+ *
+ * @return Nombre de stations transmises à fn.
+ */
+int  rplan_execute_part(const RulePlan* p, const StationIndex* idx, const RulePart* part,
+                        RuleMatchFn fn, void* ctx);
+
+/**
+ * Équivalent infixe de rules_top_n_print : affiche le plan puis les n premières
+ * stations (ordre des identifiants) qui satisfont la règle.
+ */
+void rules_query_print(StationIndex* idx, RuleIndexes* ri, const char* text, int n);
+
+#endif
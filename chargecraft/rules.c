@@ -1,8 +1,11 @@
-#include "station_index.h"
+#include "rules.h"
 #include "stack.h"
+#include "metrics.h"
+#include "rule_par.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 
 /**
  * Évalue une expression logique donnée sous forme postfixée sur les attributs d'une station.
@@ -16,6 +19,7 @@
  * @return int 1 si la règle est satisfaite, 0 sinon
  */
 int eval_rule_postfix(char* toks[], int n, StationInfo* info){ /* O(n) */
+    METRIC_TIMER_COUNTED(t0, MC_RULE_EVALS);
     Stack st; st_init(&st);
     for(int i=0;i<n;i++){
         char* t=toks[i];
@@ -56,6 +60,7 @@ int eval_rule_postfix(char* toks[], int n, StationInfo* info){ /* O(n) */
         }
     }
     int ok=0; st_pop(&st,&ok); st_clear(&st); 
+    METRIC_TIMER_STOP(MH_RULE_EVAL_NS, t0);
     return ok!=0;
 }
 
@@ -69,39 +74,45 @@ int eval_rule_postfix(char* toks[], int n, StationInfo* info){ /* O(n) */
  * @param tokens tableau de chaînes correspondant à la règle postfixée à appliquer
  * @param token_count nombre de tokens dans la règle
  * @param n nombre maximal de stations à afficher
+ * @param pool pool de threads pour un parcours parallèle, NULL pour le parcours séquentiel
  */
-void rules_top_n_print(StationIndex* idx, char* tokens[], int token_count, int n) { /* O(n log n) */
+void rules_top_n_print(StationIndex* idx, char* tokens[], int token_count, int n,
+                       struct ThreadPool* pool) { /* O(n) */
     if (!idx || !idx->root) {
         printf("[Rules] Index vide.\n");
         return;
     }
 
-    int cap = 1000;
-    int* ids = (int*)malloc(cap * sizeof(int));
-    if (!ids) return;
+    printf("\n=== TOP-%d Stations (Filtre Postfix) ===\n", n);
 
-    // récupère toutes les station_id dans un tableau
-    int count = si_to_array(idx->root, ids, cap);
+    StationNode** found = pool && n > 0 ? (StationNode**)malloc(sizeof(StationNode*) * (size_t)n) : NULL;
+    int got = found ? rpar_first_n_postfix(idx, pool, tokens, token_count, n, found) : -1;
+    if (got >= 0) {
+        for (int i = 0; i < got; i++)
+            printf("  %d. Station %d | Power: %d kW | Slots: %d | Prix: %d cts\n",
+                   i + 1, found[i]->station_id, found[i]->info.power_kW,
+                   found[i]->info.slots_free, found[i]->info.price_cents);
+        if (got == 0) printf("  Aucune station ne correspond aux critères.\n");
+        printf("========================================\n");
+        free(found);
+        return;
+    }
+    free(found);
 
-    printf("\n=== TOP-%d Stations (Filtre Postfix) ===\n", n);
-    
+    // parcours dans l'ordre des identifiants, arrêté dès n correspondances
+    SiCursor cur;
+    si_cursor_begin(&cur, idx, INT_MIN, INT_MAX);
     int matches = 0;
-    for (int i = 0; i < count; i++) {
-        StationNode* node = si_find(idx->root, ids[i]);
-        
-        if (node) {
-            // teste la station avec la règle postfixée
-            if (eval_rule_postfix(tokens, token_count, &node->info)) {
-                printf("  %d. Station %d | Power: %d kW | Slots: %d | Prix: %d cts\n",
-                       matches + 1,
-                       node->station_id,
-                       node->info.power_kW,
-                       node->info.slots_free,
-                       node->info.price_cents);
-                
-                matches++;
-                if (matches >= n) break; // stoppe après n correspondances
-            }
+    for (StationNode* node; matches < n && (node = si_cursor_next(&cur)) != NULL;) {
+        // teste la station avec la règle postfixée
+        if (eval_rule_postfix(tokens, token_count, &node->info)) {
+            printf("  %d. Station %d | Power: %d kW | Slots: %d | Prix: %d cts\n",
+                   matches + 1,
+                   node->station_id,
+                   node->info.power_kW,
+                   node->info.slots_free,
+                   node->info.price_cents);
+            matches++;
         }
     }
 
@@ -109,7 +120,5 @@ void rules_top_n_print(StationIndex* idx, char* tokens[], int token_count, int n
         printf("  Aucune station ne correspond aux critères.\n");
     }
     printf("========================================\n");
-
-    free(ids);
 }
 
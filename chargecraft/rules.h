@@ -0,0 +1,26 @@
+#ifndef DS_RULES_H
+#define DS_RULES_H
+#include "station_index.h"
+
+struct ThreadPool;
+
+/**
+ * Évalue une règle postfixée ("power 50 >= slots 1 >= &&") sur une station.
+ *
+ * @param toks Tokens de l'expression postfixée.
+ * @param n Nombre de tokens.
+ * @param info Données de la station testée.
+ * @return 1 si la règle est satisfaite, 0 sinon.
+ */
+int eval_rule_postfix(char* toks[], int n, StationInfo* info);                     /* O(n) */
+
+/**
+ * Affiche les n premières stations (ordre des identifiants) satisfaisant une règle postfixée.
+ * Parcours ordonné de l'index (curseur), arrêté à la n-ième correspondance ;
+ * voir rule_plan.h pour les règles infixes planifiées. Avec un pool de
+ * threads, les sous-arbres de l'index sont évalués en parallèle (rule_par.h).
+ */
+void rules_top_n_print(StationIndex* idx, char* tokens[], int token_count, int n,
+                       struct ThreadPool* pool);                                   /* O(stations parcourues) */
+
+#endif
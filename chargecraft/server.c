@@ -0,0 +1,478 @@
+#define _POSIX_C_SOURCE 200809L
+#include "server.h"
+#include "wal.h"
+#include "station_key.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define SRV_READ_CHUNK 65536
+#define SRV_EVENTS 256
+
+typedef struct SrvBuf {
+    char* data;
+    size_t off, len, cap;       /* octets utiles : data[off..len) */
+} SrvBuf;
+
+typedef struct SrvConn {
+    int fd;
+    int slot;                   /* indice dans srv->conns */
+    unsigned interest;          /* événements epoll demandés */
+    int dead;                   /* fin de flux ou erreur : fermée en fin de tour */
+    SrvBuf in, out;
+} SrvConn;
+
+typedef struct SrvReq {
+    SrvConn* conn;
+    ProtoHeader h;
+    const char* payload;        /* dans conn->in, valable jusqu'à la fin du lot */
+    int status;
+    int epoch;                  /* étape du lot : ses lectures voient les événements des étapes <= epoch */
+    int station_id;             /* P_LOOKUP_KEY, P_EVENT_KEY : identifiant résolu */
+    StationInfo info;           /* P_LOOKUP */
+    int off, count;             /* P_TOPN : résultat dans srv->topn_ids */
+    ProtoStats stats;           /* P_STATS */
+} SrvReq;
+
+/* ---------- tampons ---------- */
+
+/* garantit extra octets libres après len, en tassant d'abord les octets déjà consommés */
+static int buf_reserve(SrvBuf* b, size_t extra) {
+    if (b->off > 0 && (b->off == b->len || b->len + extra > b->cap)) {
+        memmove(b->data, b->data + b->off, b->len - b->off);
+        b->len -= b->off;
+        b->off = 0;
+    }
+    if (b->len + extra <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) cap *= 2;
+    char* d = (char*)realloc(b->data, cap);
+    if (!d) return 0;
+    b->data = d;
+    b->cap = cap;
+    return 1;
+}
+
+static int buf_append(SrvBuf* b, const void* p, size_t n) {
+    if (!buf_reserve(b, n)) return 0;
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+    return 1;
+}
+
+/* ---------- ouverture ---------- */
+
+static int set_nonblock(int fd) {
+    int fl = fcntl(fd, F_GETFL, 0);
+    return fl >= 0 && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0;
+}
+
+static int listen_unix(Server* srv, const char* path) {
+    struct sockaddr_un sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof sa.sun_path) { fprintf(stderr, "[SRV] chemin trop long : %s\n", path); return -1; }
+    strcpy(sa.sun_path, path);
+    // socket laissée par une exécution précédente ; jamais un fichier ordinaire
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) { fprintf(stderr, "[SRV] %s existe et n'est pas une socket\n", path); return -1; }
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr*)&sa, sizeof sa) != 0) { close(fd); return -1; }
+    srv->unix_path = strdup(path);
+    return fd;
+}
+
+static int listen_tcp(int port) {
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t)port);
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    if (bind(fd, (struct sockaddr*)&sa, sizeof sa) != 0) { close(fd); return -1; }
+    return fd;
+}
+
+int srv_open(Server* srv, const char* addr, Pipeline* pl, QueryCache* cache) {
+    memset(srv, 0, sizeof *srv);
+    srv->listen_fd = srv->epoll_fd = -1;
+    srv->pl = pl;
+    srv->cache = cache;
+    if (strncmp(addr, "unix:", 5) == 0) srv->listen_fd = listen_unix(srv, addr + 5);
+    else if (strchr(addr, '/')) srv->listen_fd = listen_unix(srv, addr);
+    else {
+        char* end;
+        long port = strtol(addr, &end, 10);
+        if (*end || port <= 0 || port > 65535) { fprintf(stderr, "[SRV] adresse invalide : %s\n", addr); return 0; }
+        srv->listen_fd = listen_tcp((int)port);
+    }
+    srv->batch = (SrvReq*)malloc(sizeof(SrvReq) * SRV_MAX_BATCH);
+    srv->order = (int*)malloc(sizeof(int) * SRV_MAX_BATCH);
+    srv->ids = (int*)malloc(sizeof(int) * SRV_MAX_BATCH);
+    srv->nodes = (StationNode**)malloc(sizeof(StationNode*) * SRV_MAX_BATCH);
+    srv->keys = (uint64_t*)malloc(sizeof(uint64_t) * SRV_MAX_BATCH);
+    srv->epoll_fd = epoll_create1(0);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (srv->listen_fd < 0 || listen(srv->listen_fd, SOMAXCONN) != 0 || !set_nonblock(srv->listen_fd) ||
+        srv->epoll_fd < 0 || epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, srv->listen_fd, &ev) != 0 ||
+        !srv->batch || !srv->order || !srv->ids || !srv->nodes || !srv->keys) {
+        fprintf(stderr, "[SRV] impossible d'écouter sur %s : %s\n", addr, strerror(errno));
+        srv_close(srv);
+        return 0;
+    }
+    return 1;
+}
+
+/* ---------- connexions ---------- */
+
+static void conn_interest(Server* srv, SrvConn* c) {
+    size_t pending = c->out.len - c->out.off;
+    unsigned want = (pending < SRV_MAX_OUTPUT ? EPOLLIN : 0) | (pending > 0 ? EPOLLOUT : 0);
+    if (want == c->interest) return;
+    struct epoll_event ev = { .events = want, .data.ptr = c };
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->interest = want;
+}
+
+static void accept_all(Server* srv) {
+    for (;;) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) return;     // EAGAIN, ou client déjà reparti
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);    // sans effet sur une socket Unix
+        SrvConn* c = (SrvConn*)calloc(1, sizeof(SrvConn));
+        if (srv->n_conns == srv->cap_conns) {
+            int cap = srv->cap_conns ? 2 * srv->cap_conns : 16;
+            SrvConn** a = (SrvConn**)realloc(srv->conns, sizeof(SrvConn*) * (size_t)cap);
+            if (a) { srv->conns = a; srv->cap_conns = cap; }
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (!c || srv->n_conns == srv->cap_conns || !set_nonblock(fd) ||
+            epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->interest = EPOLLIN;
+        c->slot = srv->n_conns;
+        srv->conns[srv->n_conns++] = c;
+    }
+}
+
+static void conn_close(Server* srv, SrvConn* c) {
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    // la dernière connexion prend la place libérée
+    SrvConn* last = srv->conns[--srv->n_conns];
+    srv->conns[c->slot] = last;
+    last->slot = c->slot;
+    free(c->in.data);
+    free(c->out.data);
+    free(c);
+}
+
+static void conn_read(SrvConn* c) {
+    // un morceau par notification : epoll (déclenché par niveau) rappelle si des données restent
+    if (!buf_reserve(&c->in, SRV_READ_CHUNK)) { c->dead = 1; return; }
+    ssize_t n = read(c->fd, c->in.data + c->in.len, SRV_READ_CHUNK);
+    if (n > 0) c->in.len += (size_t)n;
+    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) c->dead = 1;
+}
+
+static void conn_flush(Server* srv, SrvConn* c) {
+    while (!c->dead && c->out.off < c->out.len) {
+        ssize_t n = send(c->fd, c->out.data + c->out.off, c->out.len - c->out.off, MSG_NOSIGNAL);
+        if (n > 0) c->out.off += (size_t)n;
+        else if (n < 0 && errno == EINTR) continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        else c->dead = 1;
+    }
+    if (c->out.off == c->out.len) c->out.off = c->out.len = 0;
+    if (!c->dead) conn_interest(srv, c);
+}
+
+/* ---------- traitement d'un lot ---------- */
+
+/*
+ * Messages complets de c ajoutés au lot ; 1 s'il en reste faute de place (ou d'étape).
+ * Un événement qui suit une lecture de c ouvre l'étape suivante du lot.
+ */
+static int parse_conn(Server* srv, SrvConn* c, int* count) {
+    if (c->dead || c->out.len - c->out.off >= SRV_MAX_OUTPUT) return 0;
+    ProtoHeader h;
+    int r, epoch = 0, read_seen = 0;
+    while (*count < SRV_MAX_BATCH && (r = proto_get_header(c->in.data + c->in.off, c->in.len - c->in.off, &h)) != 0) {
+        if (r < 0) { c->dead = 1; return 0; }
+        int event = h.type == P_EVENT || h.type == P_EVENT_KEY;
+        if (event && read_seen) {
+            if (epoch + 1 == SRV_MAX_EPOCHS) return 1;
+            epoch++;
+            read_seen = 0;
+        }
+        read_seen |= !event;
+        if (epoch >= srv->epochs) srv->epochs = epoch + 1;
+        SrvReq* q = &srv->batch[(*count)++];
+        q->conn = c;
+        q->h = h;
+        q->epoch = epoch;
+        q->payload = c->in.data + c->in.off + PROTO_HEADER;
+        q->status = P_OK;
+        c->in.off += PROTO_HEADER + h.len;
+    }
+    return *count == SRV_MAX_BATCH && proto_get_header(c->in.data + c->in.off, c->in.len - c->in.off, &h) > 0;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* identifiants d'itinérance du lot résolus par le registre de l'index ; le registre ne change pas en service */
+static void resolve_keys(Server* srv, int count) {
+    const StationKeys* keys = srv->pl->idx->keys;
+    for (int i = 0; i < count; i++) {
+        SrvReq* q = &srv->batch[i];
+        size_t head = q->h.type == P_EVENT_KEY ? 3 * sizeof(int32_t) : 0;
+        if (q->h.type != P_LOOKUP_KEY && q->h.type != P_EVENT_KEY) continue;
+        if (q->h.len <= head || q->h.len - head > PROTO_MAX_KEY) { q->status = P_INVALID; continue; }
+        q->station_id = keys ? sk_resolve(keys, q->payload + head, (int)(q->h.len - head)) : -1;
+        if (q->station_id < 0) q->status = P_NOT_FOUND;
+    }
+}
+
+static void apply_events(Server* srv, int count, int epoch) {
+    for (int i = 0; i < count; i++) {
+        SrvReq* q = &srv->batch[i];
+        if ((q->h.type != P_EVENT && q->h.type != P_EVENT_KEY) || q->epoch != epoch || q->status != P_OK) continue;
+        Event e;
+        if (q->h.type == P_EVENT_KEY) {
+            int32_t f[3];
+            memcpy(f, q->payload, sizeof f);
+            e = (Event){ f[0], f[1], q->station_id, f[2] };
+        } else if (q->h.len == sizeof(Event)) {
+            memcpy(&e, q->payload, sizeof e);
+        } else {
+            q->status = P_INVALID;
+            continue;
+        }
+        long long rejected = srv->pl->rejected + srv->pl->stray;
+        if (!pl_apply(srv->pl, &e)) q->status = P_NOT_FOUND;
+        else if (srv->pl->rejected + srv->pl->stray != rejected) q->status = P_REJECTED;
+    }
+}
+
+static void lookup_sorted(Server* srv, int count, int epoch) {
+    // clé de tri : identifiant (décalé pour rester ordonné en non signé), puis position dans le lot
+    uint64_t* keys = srv->keys;
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        SrvReq* q = &srv->batch[i];
+        if ((q->h.type != P_LOOKUP && q->h.type != P_LOOKUP_KEY) || q->epoch != epoch || q->status != P_OK) continue;
+        int id = q->station_id;
+        if (q->h.type == P_LOOKUP && q->h.len != sizeof(int)) { q->status = P_INVALID; continue; }
+        if (q->h.type == P_LOOKUP) memcpy(&id, q->payload, sizeof id);
+        keys[n++] = (uint64_t)((uint32_t)id ^ 0x80000000u) << 32 | (uint32_t)i;
+    }
+    qsort(keys, (size_t)n, sizeof(uint64_t), cmp_u64);
+    for (int k = 0; k < n; k++) {
+        srv->order[k] = (int)(uint32_t)keys[k];
+        srv->ids[k] = (int)((uint32_t)(keys[k] >> 32) ^ 0x80000000u);
+    }
+    si_find_sorted(srv->pl->idx->root, srv->ids, n, srv->nodes);
+    for (int k = 0; k < n; k++) {
+        SrvReq* q = &srv->batch[srv->order[k]];
+        if (srv->nodes[k]) q->info = srv->nodes[k]->info;
+        else q->status = P_NOT_FOUND;
+    }
+}
+
+static int topn_reserve(Server* srv, int extra) {
+    if (srv->topn_used + extra <= srv->topn_cap) return 1;
+    int cap = srv->topn_cap ? srv->topn_cap : 1024;
+    while (cap < srv->topn_used + extra) cap *= 2;
+    int* a = (int*)realloc(srv->topn_ids, sizeof(int) * (size_t)cap);
+    if (!a) return 0;
+    srv->topn_ids = a;
+    srv->topn_cap = cap;
+    return 1;
+}
+
+static void answer_topn(Server* srv, int count, int epoch) {
+    const SrvReq* prev = NULL;
+    for (int i = 0; i < count; i++) {
+        SrvReq* q = &srv->batch[i];
+        if (q->h.type != P_TOPN || q->epoch != epoch) continue;
+        uint16_t n;
+        if (q->h.len >= 4) memcpy(&n, q->payload + 2, sizeof n);
+        if (!srv->cache || q->h.len < 4 || n == 0 || n > PROTO_MAX_TOPN) { q->status = P_INVALID; continue; }
+        // requête identique à la précédente de l'étape : même résultat, aucun événement entre les deux
+        if (prev && prev->h.len == q->h.len && memcmp(prev->payload, q->payload, q->h.len) == 0) {
+            q->status = prev->status;
+            q->off = prev->off;
+            q->count = prev->count;
+            continue;
+        }
+        int len = (int)q->h.len - 4;
+        if (len + 1 > srv->rule_cap) {
+            char* r = (char*)realloc(srv->rule, (size_t)len + 1);
+            if (!r) { q->status = P_INVALID; continue; }
+            srv->rule = r;
+            srv->rule_cap = len + 1;
+        }
+        memcpy(srv->rule, q->payload + 4, (size_t)len);
+        srv->rule[len] = '\0';
+        const int* ids;
+        int k = qc_query(srv->cache, srv->rule, (unsigned char)q->payload[0], n, &ids);
+        if (k < 0 || !topn_reserve(srv, k)) q->status = P_INVALID;
+        else {
+            q->off = srv->topn_used;
+            q->count = k;
+            memcpy(srv->topn_ids + srv->topn_used, ids, sizeof(int) * (size_t)k);
+            srv->topn_used += k;
+        }
+        prev = q;
+    }
+}
+
+/* compteurs vus par les P_STATS de l'étape */
+static void answer_stats(Server* srv, int count, int epoch) {
+    for (int i = 0; i < count; i++) {
+        SrvReq* q = &srv->batch[i];
+        if (q->h.type != P_STATS || q->epoch != epoch) continue;
+        ProtoStats* st = &q->stats;
+        st->stations = srv->pl->idx->size;
+        st->applied = srv->pl->applied;
+        st->unknown = srv->pl->unknown;
+        st->rejected = srv->pl->rejected;
+        st->stray = srv->pl->stray;
+        st->requests = srv->requests + i;
+        st->batches = srv->batches;
+        st->connections = srv->n_conns;
+    }
+}
+
+static void write_responses(Server* srv, int count) {
+    for (int i = 0; i < count; i++) {
+        SrvReq* q = &srv->batch[i];
+        SrvConn* c = q->conn;
+        char head[PROTO_HEADER];
+        const void* body = NULL;
+        uint32_t len = 0;
+        if (q->status == P_OK) {
+            switch (q->h.type) {
+            case P_LOOKUP: case P_LOOKUP_KEY: body = &q->info; len = sizeof q->info; break;
+            case P_EVENT: case P_EVENT_KEY: break;
+            case P_TOPN: body = srv->topn_ids + q->off; len = (uint32_t)(sizeof(int) * (size_t)q->count); break;
+            case P_STATS: body = &q->stats; len = sizeof q->stats; break;
+            default: q->status = P_INVALID; break;
+            }
+        }
+        if (q->status != P_OK) { body = NULL; len = 0; }
+        int32_t n = q->count;
+        uint32_t total = q->h.type == P_TOPN && q->status == P_OK ? len + 4 : len;
+        proto_put_header(head, total, q->h.type, q->status, q->h.tag);
+        int ok = buf_append(&c->out, head, PROTO_HEADER);
+        if (total != len) ok = ok && buf_append(&c->out, &n, 4);
+        if (len) ok = ok && buf_append(&c->out, body, len);
+        if (!ok) c->dead = 1;
+    }
+}
+
+static int process(Server* srv, int count) {
+    // étape par étape : ses événements, puis ses lectures
+    srv->topn_used = 0;
+    resolve_keys(srv, count);
+    for (int e = 0; e < srv->epochs; e++) {
+        apply_events(srv, count, e);
+        lookup_sorted(srv, count, e);
+        answer_topn(srv, count, e);
+        answer_stats(srv, count, e);
+    }
+    srv->epochs = 0;
+    // validation groupée : aucune réponse ne part avant que les événements du lot soient durables
+    Wal* wal = srv->pl->wal;
+    if (wal && !wal_commit(wal)) return 0;
+    write_responses(srv, count);
+    srv->requests += count;
+    srv->batches++;
+    if (count > srv->max_batch) srv->max_batch = count;
+    if (wal && srv->checkpoint && srv->checkpoint_every > 0 &&
+        (long long)(wal->durable_lsn - wal->base_lsn) >= srv->checkpoint_every &&
+        !wal_checkpoint(wal, srv->checkpoint, srv->pl))
+        srv->checkpoint = NULL;    // le journal continue de grandir ; nouvel essai à l'arrêt
+    return 1;
+}
+
+int srv_run(Server* srv, volatile sig_atomic_t* stop) {
+    struct epoll_event evs[SRV_EVENTS];
+    int backlog = 0;            // messages complets restés hors du dernier lot
+    while (!*stop) {
+        int n = epoll_wait(srv->epoll_fd, evs, SRV_EVENTS, backlog ? 0 : 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            SrvConn* c = (SrvConn*)evs[i].data.ptr;
+            if (!c) { accept_all(srv); continue; }
+            if (evs[i].events & EPOLLOUT) conn_flush(srv, c);
+            if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) conn_read(c);
+        }
+        int count = 0;
+        backlog = 0;
+        for (int k = 0; k < srv->n_conns; k++) backlog |= parse_conn(srv, srv->conns[k], &count);
+        if (count > 0 && !process(srv, count)) {
+            fprintf(stderr, "[SRV] journal non validé : arrêt\n");
+            return 0;
+        }
+        for (int k = srv->n_conns - 1; k >= 0; k--) {
+            SrvConn* c = srv->conns[k];
+            if (c->out.len > c->out.off) conn_flush(srv, c);
+            if (c->dead) conn_close(srv, c);
+        }
+    }
+    return 1;
+}
+
+void srv_close(Server* srv) {
+    while (srv->n_conns > 0) conn_close(srv, srv->conns[srv->n_conns - 1]);
+    if (srv->listen_fd >= 0) close(srv->listen_fd);
+    if (srv->epoll_fd >= 0) close(srv->epoll_fd);
+    if (srv->unix_path) unlink(srv->unix_path);
+    free(srv->unix_path);
+    free(srv->conns);
+    free(srv->batch);
+    free(srv->order);
+    free(srv->ids);
+    free(srv->nodes);
+    free(srv->keys);
+    free(srv->topn_ids);
+    free(srv->rule);
+    memset(srv, 0, sizeof *srv);
+    srv->listen_fd = srv->epoll_fd = -1;
+}
+
+void srv_print_stats(const Server* srv) {
+    printf("[SRV] %lld requêtes en %lld lots (moyenne %.1f, max %d), %lld événements appliqués, "
+           "%lld inconnus, %lld refusés, %lld débranchements ignorés\n",
+           srv->requests, srv->batches, srv->batches ? (double)srv->requests / srv->batches : 0.0, srv->max_batch,
+           srv->pl->applied, srv->pl->unknown, srv->pl->rejected, srv->pl->stray);
+}
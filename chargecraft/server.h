@@ -0,0 +1,94 @@
+#ifndef DS_SERVER_H
+#define DS_SERVER_H
+#include <signal.h>
+#include "pipeline.h"
+#include "query_cache.h"
+#include "proto.h"
+
+/**
+ * @brief Serveur de requêtes et d'événements sur socket locale (protocole : proto.h).
+ *
+ * Un seul thread et une boucle epoll. À chaque tour, toutes les connexions
+ * prêtes sont lues et leurs messages complets (au plus SRV_MAX_BATCH) forment
+ * un lot. Les identifiants d'itinérance (P_LOOKUP_KEY, P_EVENT_KEY) y sont
+ * d'abord résolus par le registre attaché à l'index (sk_resolve : une case de
+ * la table parfaite), puis le lot est traité en trois phases :
+ *
+ * 1. événements appliqués en groupe, dans l'ordre d'arrivée (pl_apply) ;
+ * 2. consultations triées par identifiant et résolues par un seul parcours
+ *    de l'index (si_find_sorted) ;
+ * 3. requêtes top-N servies par le cache (qc_query), réparé par les
+ *    événements de la phase 1.
+ *
+ * Pour qu'une lecture ne voie jamais un événement envoyé après elle sur la
+ * même connexion, le lot est découpé en étapes : sur chaque connexion, un
+ * événement qui suit une lecture ouvre l'étape suivante. Les trois phases
+ * s'enchaînent étape par étape, le lot gardant sa taille (au plus
+ * SRV_MAX_EPOCHS étapes : au-delà, la connexion attend le lot suivant). Les
+ * réponses sont écrites dans l'ordre des requêtes de chaque connexion.
+ *
+ * Avec un journal attaché au pipeline (wal.h), les événements du lot sont
+ * validés ensemble (un fdatasync) avant l'écriture des réponses : un client
+ * n'est acquitté que d'un événement durable. Si la validation échoue, le lot
+ * reste sans réponse et le service s'arrête.
+ *
+ * Contre-pression : une connexion dont plus de SRV_MAX_OUTPUT octets de
+ * réponses attendent n'est plus lue tant que le client ne les a pas reçus.
+ */
+
+#define SRV_MAX_BATCH 4096
+#define SRV_MAX_OUTPUT (4 << 20)
+#define SRV_MAX_EPOCHS 64
+
+struct SrvConn;
+struct SrvReq;
+
+typedef struct Server {
+    int listen_fd;
+    int epoll_fd;
+    char* unix_path;            /* fichier de la socket Unix, supprimé à la fermeture ; NULL en TCP */
+    Pipeline* pl;
+    QueryCache* cache;          /* NULL : P_TOPN répond P_INVALID */
+    struct SrvConn** conns;     /* connexions ouvertes */
+    int n_conns, cap_conns;
+    struct SrvReq* batch;       /* lot en cours */
+    int epochs;                 /* étapes du lot en cours */
+    uint64_t* keys;             /* consultations du lot : (identifiant, position) à trier */
+    int* order;                 /* positions des consultations, par identifiant croissant */
+    int* ids;
+    StationNode** nodes;
+    int* topn_ids;              /* résultats top-N du lot, bout à bout */
+    int topn_used, topn_cap;
+    char* rule;                 /* texte de règle terminé par un zéro */
+    int rule_cap;
+    const char* checkpoint;     /* point de reprise du journal, NULL : aucun en service */
+    long long checkpoint_every; /* événements journalisés entre deux points de reprise */
+    long long requests;
+    long long batches;
+    int max_batch;
+} Server;
+
+/**
+ * Ouvre la socket d'écoute.
+ *
+ * @param srv Serveur à initialiser.
+ * @param addr "unix:chemin", un chemin contenant '/', ou un port TCP (écoute sur 127.0.0.1).
+ * @param pl Pipeline recevant les événements (son index sert aux consultations).
+ * @param cache Cache des requêtes top-N, ou NULL.
+ * @return 1 si succès, 0 sinon (message sur la sortie d'erreur).
+ */
+int  srv_open(Server* srv, const char* addr, Pipeline* pl, QueryCache* cache);
+
+/**
+ * Boucle de service, jusqu'à ce que *stop devienne non nul (gestionnaire de signal).
+ *
+ * @return 1 à l'arrêt demandé, 0 en cas d'erreur d'epoll ou d'écriture du journal.
+ */
+int  srv_run(Server* srv, volatile sig_atomic_t* stop);
+
+/* ferme les connexions et la socket d'écoute, supprime le fichier de la socket Unix */
+void srv_close(Server* srv);
+
+void srv_print_stats(const Server* srv);
+
+#endif
@@ -0,0 +1,325 @@
+#define _POSIX_C_SOURCE 200809L
+#include "sim.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define SIM_MIN_SESSION_S 300
+#define SIM_MAX_SESSION_S 43200
+
+enum { SIM_ARRIVE, SIM_UNPLUG };
+
+/* ---------- générateur pseudo-aléatoire (xoshiro256**) ---------- */
+
+typedef struct SimRng { uint64_t s[4]; } SimRng;
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_seed(SimRng* r, uint64_t seed) {
+    for (int i = 0; i < 4; i++) r->s[i] = splitmix64(&seed);
+}
+
+static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+static uint64_t rng_next(SimRng* r) {
+    uint64_t* s = r->s;
+    uint64_t out = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return out;
+}
+
+/* uniforme dans [0, 1) */
+static double rng_unit(SimRng* r) { return (rng_next(r) >> 11) * 0x1.0p-53; }
+
+/* uniforme dans [0, n) (multiplication 64 x 64 -> haut, biais négligeable) */
+static uint32_t rng_below(SimRng* r, uint32_t n) {
+    return (uint32_t)(((rng_next(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+static double rng_normal(SimRng* r) {
+    double u = rng_unit(r), v = rng_unit(r);
+    return sqrt(-2.0 * log(1.0 - u)) * cos(6.283185307179586 * v);
+}
+
+/* ---------- loi de Zipf par la méthode des alias (Vose) ---------- */
+
+typedef struct Zipf {
+    int n;
+    uint32_t* prob;     /* seuil sur 32 bits : garder i, sinon alias[i] */
+    int* alias;
+} Zipf;
+
+static int zipf_init(Zipf* z, int n, double s) {
+    z->n = n;
+    z->prob = (uint32_t*)malloc(sizeof(uint32_t) * n);
+    z->alias = (int*)malloc(sizeof(int) * n);
+    double* p = (double*)malloc(sizeof(double) * n);
+    int* small = (int*)malloc(sizeof(int) * n);
+    int* large = (int*)malloc(sizeof(int) * n);
+    if (!z->prob || !z->alias || !p || !small || !large) {
+        free(z->prob); free(z->alias); free(p); free(small); free(large);
+        return 0;
+    }
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += p[i] = s > 0 ? pow(i + 1.0, -s) : 1.0;
+    int ns = 0, nl = 0;
+    for (int i = 0; i < n; i++) {
+        p[i] = p[i] * n / sum;
+        if (p[i] < 1.0) small[ns++] = i; else large[nl++] = i;
+    }
+    while (ns && nl) {
+        int a = small[--ns], b = large[--nl];
+        z->prob[a] = (uint32_t)(p[a] * 4294967295.0);
+        z->alias[a] = b;
+        p[b] -= 1.0 - p[a];
+        if (p[b] < 1.0) small[ns++] = b; else large[nl++] = b;
+    }
+    // restes (arrondis) : toujours gardés
+    while (nl) { int b = large[--nl]; z->prob[b] = UINT32_MAX; z->alias[b] = b; }
+    while (ns) { int a = small[--ns]; z->prob[a] = UINT32_MAX; z->alias[a] = a; }
+    free(p); free(small); free(large);
+    return 1;
+}
+
+static int zipf_draw(const Zipf* z, SimRng* r) {
+    uint64_t x = rng_next(r);
+    int i = (int)(((x >> 32) * (uint64_t)z->n) >> 32);
+    return (uint32_t)x < z->prob[i] ? i : z->alias[i];
+}
+
+/* ---------- calendrier : un seau FIFO par seconde simulée ---------- */
+
+typedef struct SimEv {
+    int vehicle;
+    int station;
+    int kind;
+    int tries;
+    int next;           /* suivant dans le seau, ou dans la liste libre */
+} SimEv;
+
+typedef struct Calendar {
+    int* head;
+    int* tail;
+    int horizon;        /* nombre de secondes */
+    SimEv* pool;
+    int cap, free_list, pending;
+} Calendar;
+
+static int cal_init(Calendar* c, int horizon, int cap) {
+    c->horizon = horizon;
+    c->head = (int*)malloc(sizeof(int) * horizon);
+    c->tail = (int*)malloc(sizeof(int) * horizon);
+    c->pool = (SimEv*)malloc(sizeof(SimEv) * cap);
+    if (!c->head || !c->tail || !c->pool) {
+        free(c->head); free(c->tail); free(c->pool);
+        memset(c, 0, sizeof *c);
+        return 0;
+    }
+    memset(c->head, 0xff, sizeof(int) * horizon);
+    c->cap = cap;
+    for (int i = 0; i < cap; i++) c->pool[i].next = i + 1 < cap ? i + 1 : -1;
+    c->free_list = 0;
+    c->pending = 0;
+    return 1;
+}
+
+/* planifie un événement à la seconde t ; ignoré au-delà de l'horizon */
+static int cal_push(Calendar* c, int t, const SimEv* ev) {
+    if (t >= c->horizon) return 1;
+    if (c->free_list < 0) {
+        int nc = c->cap * 2;
+        SimEv* np = (SimEv*)realloc(c->pool, sizeof(SimEv) * nc);
+        if (!np) return 0;
+        c->pool = np;
+        for (int i = c->cap; i < nc; i++) c->pool[i].next = i + 1 < nc ? i + 1 : -1;
+        c->free_list = c->cap;
+        c->cap = nc;
+    }
+    int i = c->free_list;
+    c->free_list = c->pool[i].next;
+    c->pool[i] = *ev;
+    c->pool[i].next = -1;
+    if (c->head[t] < 0) c->head[t] = i;
+    else c->pool[c->tail[t]].next = i;
+    c->tail[t] = i;
+    c->pending++;
+    return 1;
+}
+
+static int cal_pop(Calendar* c, int t, SimEv* out) {
+    int i = c->head[t];
+    if (i < 0) return 0;
+    *out = c->pool[i];
+    c->head[t] = c->pool[i].next;
+    c->pool[i].next = c->free_list;
+    c->free_list = i;
+    c->pending--;
+    return 1;
+}
+
+static void cal_free(Calendar* c) {
+    free(c->head);
+    free(c->tail);
+    free(c->pool);
+}
+
+/* ---------- simulation ---------- */
+
+void sim_default_config(SimConfig* cfg, int vehicles) {
+    static const double HOURLY[24] = {
+        2, 1, 1, 1, 1, 2, 4, 8, 10, 8, 6, 6, 7, 6, 6, 7, 9, 11, 10, 8, 6, 5, 4, 3,
+    };
+    memset(cfg, 0, sizeof *cfg);
+    cfg->vehicles = vehicles;
+    cfg->seed = 42;
+    cfg->duration_s = 86400;
+    cfg->zipf_s = 1.0;
+    cfg->sessions_per_day = 1.0;
+    cfg->session_median_min = 45.0;
+    cfg->session_sigma = 0.7;
+    memcpy(cfg->hourly, HOURLY, sizeof HOURLY);
+    cfg->retry_delay_s = 600;
+    cfg->max_retries = 2;
+}
+
+typedef struct Sim {
+    Pipeline* pl;
+    const SimConfig* cfg;
+    SimRng rng;
+    Zipf zipf;
+    int* stations;      /* rang de popularité -> identifiant */
+    Calendar cal;
+    double rate_max;    /* intensité maximale d'arrivée par véhicule (par seconde) */
+    double w_max;
+} Sim;
+
+/* prochaine arrivée après t (secondes depuis le début), par amincissement ; -1 si hors horizon */
+static int next_arrival(Sim* s, int t) {
+    double x = t;
+    if (s->rate_max <= 0) return -1;
+    for (;;) {
+        x += -log(1.0 - rng_unit(&s->rng)) / s->rate_max;
+        if (x >= s->cal.horizon) return -1;
+        long long abs_ts = s->cfg->start_ts + (long long)x;
+        int hour = (int)((abs_ts % 86400 + 86400) % 86400 / 3600);
+        if (rng_unit(&s->rng) * s->w_max < s->cfg->hourly[hour]) break;
+    }
+    int n = (int)ceil(x);
+    return n > t ? n : t + 1;
+}
+
+static int session_length(Sim* s) {
+    double len = exp(log(s->cfg->session_median_min * 60.0) + s->cfg->session_sigma * rng_normal(&s->rng));
+    if (len < SIM_MIN_SESSION_S) len = SIM_MIN_SESSION_S;
+    if (len > SIM_MAX_SESSION_S) len = SIM_MAX_SESSION_S;
+    return (int)len;
+}
+
+static int schedule_arrival(Sim* s, int vehicle, int after, int tries) {
+    int t = tries ? after + s->cfg->retry_delay_s : next_arrival(s, after);
+    if (t < 0) return 1;
+    SimEv ev = { vehicle, 0, SIM_ARRIVE, tries, -1 };
+    return cal_push(&s->cal, t, &ev);
+}
+
+static int sim_step(Sim* s, int t, const SimEv* ev, SimStats* st) {
+    Event e = { s->cfg->start_ts + t, ev->vehicle, ev->station, ev->kind == SIM_ARRIVE };
+    st->events++;
+    if (ev->kind == SIM_UNPLUG) {
+        pl_apply(s->pl, &e);
+        st->unplugged++;
+        if (s->cfg->verbose) printf("  [SIM] t=%d véhicule %d quitte la station %d\n", e.ts, e.vehicle_id, e.station_id);
+        return schedule_arrival(s, ev->vehicle, t, 0);
+    }
+
+    if (!ev->tries) st->arrivals++;
+    e.station_id = s->stations[zipf_draw(&s->zipf, &s->rng)];
+    long long rejected = s->pl->rejected;
+    pl_apply(s->pl, &e);
+    if (s->pl->rejected != rejected) {
+        st->rejected++;
+        if (s->cfg->verbose) printf("  [SIM] t=%d véhicule %d refusé à la station %d (pleine)\n", e.ts, e.vehicle_id, e.station_id);
+        if (ev->tries < s->cfg->max_retries) return schedule_arrival(s, ev->vehicle, t, ev->tries + 1);
+        st->gave_up++;
+        return schedule_arrival(s, ev->vehicle, t, 0);
+    }
+    st->plugged++;
+    if (s->cfg->verbose) printf("  [SIM] t=%d véhicule %d se branche à la station %d\n", e.ts, e.vehicle_id, e.station_id);
+    SimEv out = { ev->vehicle, e.station_id, SIM_UNPLUG, 0, -1 };
+    return cal_push(&s->cal, t + session_length(s), &out);
+}
+
+int sim_run(Pipeline* pl, const SimConfig* cfg, SimStats* out) {
+    memset(out, 0, sizeof *out);
+    int n = pl->idx->size;
+    if (n <= 0 || cfg->duration_s <= 0 || cfg->vehicles < 0) return 0;
+
+    Sim s;
+    memset(&s, 0, sizeof s);
+    s.pl = pl;
+    s.cfg = cfg;
+    rng_seed(&s.rng, cfg->seed);
+    s.stations = (int*)malloc(sizeof(int) * n);
+    if (!s.stations) return 0;
+    if (si_to_array(pl->idx->root, s.stations, n) != n || !zipf_init(&s.zipf, n, cfg->zipf_s)) {
+        free(s.stations);
+        return 0;
+    }
+    // popularité indépendante de l'identifiant : permutation de Fisher-Yates
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)rng_below(&s.rng, (uint32_t)i + 1);
+        int tmp = s.stations[i]; s.stations[i] = s.stations[j]; s.stations[j] = tmp;
+    }
+    double w_sum = 0;
+    for (int h = 0; h < 24; h++) {
+        w_sum += cfg->hourly[h];
+        if (cfg->hourly[h] > s.w_max) s.w_max = cfg->hourly[h];
+    }
+    s.rate_max = w_sum > 0 ? cfg->sessions_per_day / 86400.0 * 24.0 * s.w_max / w_sum : 0;
+
+    int ok = cal_init(&s.cal, cfg->duration_s, cfg->vehicles > 0 ? cfg->vehicles : 1);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int v = 1; ok && v <= cfg->vehicles; v++) ok = schedule_arrival(&s, v, 0, 0);
+    if (ok) out->calendar_peak = s.cal.pending;
+    for (int t = 0; ok && t < cfg->duration_s; t++) {
+        SimEv ev;
+        while (ok && cal_pop(&s.cal, t, &ev)) ok = sim_step(&s, t, &ev, out);
+        if (s.cal.pending > out->calendar_peak) out->calendar_peak = s.cal.pending;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    out->wall_s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    out->active_at_end = out->plugged - out->unplugged;
+
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) out->peak_rss_kb = ru.ru_maxrss;
+
+    if (s.cal.pool) cal_free(&s.cal);
+    free(s.zipf.prob);
+    free(s.zipf.alias);
+    free(s.stations);
+    return ok;
+}
+
+void sim_print_stats(const SimStats* st) {
+    printf("[SIM] %lld événements en %.2f s (%.0f év/s) | calendrier : %lld en attente au maximum\n",
+           st->events, st->wall_s, st->wall_s > 0 ? st->events / st->wall_s : 0.0, st->calendar_peak);
+    printf("[SIM] %lld sessions demandées, %lld branchements, %lld refus (station pleine), %lld abandons, "
+           "%lld débranchements, %lld encore branchés\n",
+           st->arrivals, st->plugged, st->rejected, st->gave_up, st->unplugged, st->active_at_end);
+    printf("[SIM] mémoire résidente maximale : %.1f Mo\n", st->peak_rss_kb / 1024.0);
+}
@@ -0,0 +1,71 @@
+#ifndef DS_SIM_H
+#define DS_SIM_H
+#include <stdint.h>
+#include "pipeline.h"
+
+/**
+ * @brief Simulation à événements discrets d'une flotte de véhicules.
+ *
+ * Le temps simulé avance par secondes entières. Un calendrier à un seau par
+ * seconde (insertion et retrait en O(1), FIFO dans une même seconde) contient
+ * au plus un événement en attente par véhicule : sa prochaine arrivée, son
+ * débranchement ou sa nouvelle tentative. Chaque branchement et débranchement
+ * passe par pl_apply, donc par l'index, les agrégats, le cache et les abonnements.
+ *
+ * - Arrivées : processus de Poisson non homogène (courbe horaire sur 24 h),
+ *   tiré par amincissement.
+ * - Station visée : loi de Zipf sur une permutation aléatoire des stations
+ *   (méthode des alias, O(1) par tirage).
+ * - Durée de session : loi log-normale, bornée à [5 min, 12 h].
+ * - Station pleine : branchement refusé, nouvel essai ailleurs après retry_delay_s,
+ *   abandon après max_retries.
+ *
+ * Les tirages viennent d'un xoshiro256** initialisé par splitmix64 : même graine,
+ * même jeu de données, même suite d'événements.
+ */
+
+typedef struct SimConfig {
+    int vehicles;
+    uint64_t seed;
+    int start_ts;               /* horodatage simulé du début */
+    int duration_s;             /* durée simulée (86400 : 24 h) */
+    double zipf_s;              /* exposant de popularité (0 : uniforme) */
+    double sessions_per_day;    /* sessions moyennes par véhicule et par jour */
+    double session_median_min; /* durée médiane d'une session */
+    double session_sigma;       /* dispersion log-normale */
+    double hourly[24];          /* poids relatifs des arrivées par heure */
+    int retry_delay_s;
+    int max_retries;
+    int verbose;                /* affiche chaque branchement / débranchement */
+} SimConfig;
+
+typedef struct SimStats {
+    long long events;           /* événements du calendrier traités */
+    long long arrivals;         /* sessions demandées */
+    long long plugged;          /* branchements acceptés */
+    long long rejected;         /* branchements refusés : station pleine */
+    long long gave_up;          /* sessions abandonnées après max_retries */
+    long long unplugged;
+    long long active_at_end;    /* véhicules encore branchés à la fin */
+    long long calendar_peak;    /* événements en attente au maximum */
+    double wall_s;              /* durée réelle de la simulation */
+    long peak_rss_kb;           /* mémoire résidente maximale du processus */
+} SimStats;
+
+/* valeurs par défaut : 24 h, Zipf 1.0, 1 session / jour, médiane 45 min, courbe à deux pointes */
+void sim_default_config(SimConfig* cfg, int vehicles);
+
+/**
+ * Simule la flotte sur les stations de pl->idx et applique chaque événement.
+ * Les identifiants de véhicules vont de 1 à cfg->vehicles.
+ *
+ * @param pl Pipeline cible (son index doit contenir au moins une station).
+ * @param cfg Paramètres.
+ * @param out Reçoit les compteurs.
+ * @return 1 si succès, 0 si l'index est vide ou en cas d'échec d'allocation.
+ */
+int  sim_run(Pipeline* pl, const SimConfig* cfg, SimStats* out);   /* O(événements + stations) */
+
+void sim_print_stats(const SimStats* st);
+
+#endif
@@ -1,6 +1,7 @@
 #include "slist.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include "metrics.h"
 
 /**
  * Supprime le premier noeud contenant la valeur v dans la liste.
@@ -129,6 +130,7 @@ void ds_slist_init(SList* l) {
 int ds_slist_insert_head(SList* l, int v) {
     SNode* n = (SNode*)malloc(sizeof(SNode));
     if (!n) return 0;
+    METRIC_INC(MC_ALLOCS);
     n->value = v;
     n->next = l->head;
     l->head = n;
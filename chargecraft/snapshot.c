@@ -0,0 +1,136 @@
+#include "snapshot.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void mru_release(MruSnapshot* m) {
+    if (!m || atomic_fetch_sub(&m->refs, 1) != 1) return;
+    free(m->ids);
+    free(m->len);
+    free(m);
+}
+
+static MruSnapshot* mru_freeze(const SList* mru, int n_vehicles, int capacity) {
+    MruSnapshot* m = (MruSnapshot*)malloc(sizeof(MruSnapshot));
+    if (!m) return NULL;
+    m->ids = (int*)malloc(sizeof(int) * (size_t)n_vehicles * capacity);
+    m->len = (uint8_t*)calloc((size_t)n_vehicles, 1);
+    if (!m->ids || !m->len) {
+        free(m->ids);
+        free(m->len);
+        free(m);
+        return NULL;
+    }
+    m->n_vehicles = n_vehicles;
+    m->capacity = capacity;
+    atomic_init(&m->refs, 1);
+    for (int v = 0; v < n_vehicles; v++) {
+        int k = 0;
+        for (const SNode* n = mru[v].head; n && k < capacity; n = n->next) m->ids[(size_t)v * capacity + k++] = n->value;
+        m->len[v] = (uint8_t)k;
+    }
+    return m;
+}
+
+int ss_take(StateSnapshot* s, StationIndex* idx, const SList* mru, int n_vehicles, int capacity) {
+    s->stations = NULL;
+    s->mru = NULL;
+    if (capacity < 0 || capacity > 255) return 0;
+    if (mru && n_vehicles > 0 && !(s->mru = mru_freeze(mru, n_vehicles, capacity))) return 0;
+    if (!(s->stations = si_snapshot(idx))) {
+        mru_release(s->mru);
+        s->mru = NULL;
+        return 0;
+    }
+    // l'index garde sa propre référence : seule celle de l'appelant est à rendre
+    return 1;
+}
+
+void ss_release(StateSnapshot* s) {
+    si_snapshot_release(s->stations);
+    mru_release(s->mru);
+    s->stations = NULL;
+    s->mru = NULL;
+}
+
+int ss_branch(const StateSnapshot* s, StationIndex* idx, MruView* mru) {
+    if (mru) {
+        memset(mru, 0, sizeof *mru);
+        if (s->mru) {
+            mru->n_vehicles = s->mru->n_vehicles;
+            mru->capacity = s->mru->capacity;
+            mru->n_pages = (mru->n_vehicles + MV_PAGE - 1) / MV_PAGE;
+            mru->pages = (MruPage**)calloc((size_t)mru->n_pages, sizeof(MruPage*));
+            if (!mru->pages) return 0;
+            mru->base = s->mru;
+            atomic_fetch_add(&s->mru->refs, 1);
+        }
+    }
+    si_branch(idx, s->stations);
+    return 1;
+}
+
+/* liste du véhicule, recopiée de l'instantané à la première écriture */
+static SList* own_list(MruView* v, int vehicle_id) {
+    MruPage** slot = &v->pages[vehicle_id / MV_PAGE];
+    if (!*slot) {
+        // calloc : listes vides, aucune chargée
+        if (!(*slot = (MruPage*)calloc(1, sizeof(MruPage)))) return NULL;
+        v->pages_owned++;
+    }
+    int i = vehicle_id % MV_PAGE;
+    SList* l = &(*slot)->lists[i];
+    uint64_t bit = 1ull << (i & 63);
+    if ((*slot)->loaded[i / 64] & bit) return l;
+    const int* ids = v->base->ids + (size_t)vehicle_id * v->capacity;
+    // insertion en tête, du plus ancien au plus récent
+    for (int k = v->base->len[vehicle_id] - 1; k >= 0; k--) {
+        if (!ds_slist_insert_head(l, ids[k])) {
+            ds_slist_clear(l);
+            return NULL;
+        }
+    }
+    (*slot)->loaded[i / 64] |= bit;
+    v->lists_owned++;
+    return l;
+}
+
+int mv_update(MruView* v, int vehicle_id, int station_id) {
+    if (!v->pages || vehicle_id < 0 || vehicle_id >= v->n_vehicles) return 0;
+    SList* l = own_list(v, vehicle_id);
+    if (!l) return 0;
+    ds_slist_update_mru(l, station_id, v->capacity);
+    return 1;
+}
+
+int mv_get(const MruView* v, int vehicle_id, int* out, int cap) {
+    if (!v->pages || vehicle_id < 0 || vehicle_id >= v->n_vehicles) return 0;
+    const MruPage* p = v->pages[vehicle_id / MV_PAGE];
+    int i = vehicle_id % MV_PAGE, k = 0;
+    if (p && (p->loaded[i / 64] >> (i & 63) & 1)) {
+        for (const SNode* n = p->lists[i].head; n && k < cap; n = n->next) out[k++] = n->value;
+        return k;
+    }
+    const int* ids = v->base->ids + (size_t)vehicle_id * v->capacity;
+    for (; k < v->base->len[vehicle_id] && k < cap; k++) out[k] = ids[k];
+    return k;
+}
+
+size_t mv_memory_bytes(const MruView* v) {
+    size_t bytes = sizeof(MruPage*) * (size_t)v->n_pages + sizeof(MruPage) * (size_t)v->pages_owned;
+    for (int p = 0; p < v->n_pages; p++) {
+        if (!v->pages[p]) continue;
+        for (int i = 0; i < MV_PAGE; i++) bytes += sizeof(SNode) * (size_t)ds_slist_size(&v->pages[p]->lists[i]);
+    }
+    return bytes;
+}
+
+void mv_clear(MruView* v) {
+    for (int p = 0; p < v->n_pages; p++) {
+        if (!v->pages[p]) continue;
+        for (int i = 0; i < MV_PAGE; i++) ds_slist_clear(&v->pages[p]->lists[i]);
+        free(v->pages[p]);
+    }
+    free(v->pages);
+    mru_release(v->base);
+    memset(v, 0, sizeof *v);
+}
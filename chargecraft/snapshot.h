@@ -0,0 +1,94 @@
+#ifndef DS_SNAPSHOT_H
+#define DS_SNAPSHOT_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "station_index.h"
+#include "slist.h"
+
+/**
+ * @brief Instantanés de l'état (index et historiques MRU) pour des scénarios « et si ».
+ *
+ * ss_take fige l'index en O(1) (si_snapshot : copie de chemin à l'écriture)
+ * et recopie les historiques MRU de la flotte dans un tableau compact, au plus
+ * capacity identifiants par véhicule. ss_branch ouvre sur l'instantané un
+ * index et une vue MRU modifiables, en O(1) et O(véhicules / MV_PAGE) :
+ *   - l'index copie les noeuds qu'il modifie et leur chemin ;
+ *   - la vue MRU alloue une page de MV_PAGE véhicules à la première écriture
+ *     dans la page, et ne recopie une liste qu'à sa première écriture.
+ * La mémoire d'un scénario croît donc avec ses seules modifications.
+ *
+ * Un instantané est en lecture seule : plusieurs threads peuvent y ouvrir et
+ * modifier chacun leur scénario, puis le refermer, sans verrou.
+ */
+
+#define MV_PAGE 256
+
+typedef struct MruSnapshot {
+    int* ids;                   /* capacity identifiants par véhicule, du plus récent au plus ancien */
+    uint8_t* len;
+    int n_vehicles, capacity;
+    atomic_int refs;
+} MruSnapshot;
+
+typedef struct MruPage {
+    uint64_t loaded[MV_PAGE / 64];  /* listes recopiées de l'instantané */
+    SList lists[MV_PAGE];
+} MruPage;
+
+typedef struct MruView {
+    MruSnapshot* base;          /* NULL : historiques vides au départ */
+    MruPage** pages;            /* NULL tant qu'aucun véhicule de la page n'a été modifié */
+    int n_pages, n_vehicles, capacity;
+    int pages_owned, lists_owned;
+} MruView;
+
+typedef struct StateSnapshot {
+    SiSnapshot* stations;
+    MruSnapshot* mru;           /* NULL sans flotte */
+} StateSnapshot;
+
+/**
+ * Fige l'état courant. L'index et les historiques restent modifiables.
+ *
+ * @param mru Historiques MRU indexés par vehicle_id, ou NULL.
+ * @param n_vehicles Taille du tableau mru.
+ * @param capacity Capacité des historiques (au plus 255).
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  ss_take(StateSnapshot* s, StationIndex* idx, const SList* mru, int n_vehicles, int capacity);
+                                                          /* O(1) + O(véhicules x capacity) */
+
+/**
+ * Ouvre un scénario : idx et mru deviennent des vues modifiables de l'instantané
+ * (voir si_branch). À refermer par si_clear et mv_clear.
+ *
+ * @param mru Vue MRU à initialiser, ou NULL.
+ * @return 1 si succès, 0 en cas d'échec d'allocation (rien n'est ouvert).
+ */
+int  ss_branch(const StateSnapshot* s, StationIndex* idx, MruView* mru);      /* O(véhicules / MV_PAGE) */
+
+/* rend la référence de l'appelant ; les scénarios ouverts gardent la leur */
+void ss_release(StateSnapshot* s);
+
+/**
+ * Équivalent de ds_slist_update_mru pour un véhicule de la vue.
+ *
+ * @return 1 si succès, 0 si vehicle_id est hors flotte ou en cas d'échec d'allocation.
+ */
+int  mv_update(MruView* v, int vehicle_id, int station_id);                  /* O(capacity) */
+
+/**
+ * Historique d'un véhicule, du plus récent au plus ancien.
+ *
+ * @param out Reçoit au plus cap identifiants.
+ * @return Nombre d'identifiants copiés.
+ */
+int  mv_get(const MruView* v, int vehicle_id, int* out, int cap);             /* O(capacity) */
+
+/* octets alloués par la vue (pages et listes recopiées), hors instantané */
+size_t mv_memory_bytes(const MruView* v);
+
+void mv_clear(MruView* v);                                                    /* O(listes recopiées) */
+
+#endif
@@ -0,0 +1,264 @@
+#include "spatial.h"
+#include "hash.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SP_KM_PER_DEG 111.195   /* rayon terrestre moyen 6371 km */
+#define SP_RAD_PER_DEG 0.017453292519943295
+
+static long long cell_key(int row, int col) {
+    // décalage : une clé valide n'est jamais nulle
+    return ((long long)(row + 0x40000000) << 32) | (unsigned)(col + 0x40000000);
+}
+
+static int floor_div(int a, int b) {
+    int q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+int sp_init(SpatialIndex* s, double cell_deg) {
+    memset(s, 0, sizeof *s);
+    if (cell_deg <= 0) cell_deg = SP_CELL_DEG;
+    s->cell_e6 = (int)(cell_deg * 1e6 + 0.5);
+    if (s->cell_e6 < 1) s->cell_e6 = 1;
+    s->cell_cap = 64;
+    s->station_cap = 64;
+    s->cells = (SpCell*)calloc(s->cell_cap, sizeof(SpCell));
+    s->station_cell = (long long*)malloc(sizeof(long long) * s->station_cap);
+    s->station_keys = (int*)malloc(sizeof(int) * s->station_cap);
+    if (!s->cells || !s->station_cell || !s->station_keys) { sp_clear(s); return 0; }
+    memset(s->station_keys, 0xff, sizeof(int) * s->station_cap);
+    return 1;
+}
+
+/* ---------- table des cellules ---------- */
+
+static int cell_slot(const SpatialIndex* s, long long key) {
+    int mask = s->cell_cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)key) & (uint64_t)mask);
+    while (s->cells[i].key && s->cells[i].key != key) i = (i + 1) & mask;
+    return i;
+}
+
+static int cells_grow(SpatialIndex* s) {
+    SpCell* old = s->cells;
+    int old_cap = s->cell_cap;
+    SpCell* nc = (SpCell*)calloc((size_t)old_cap * 2, sizeof(SpCell));
+    if (!nc) return 0;
+    s->cells = nc;
+    s->cell_cap = old_cap * 2;
+    for (int i = 0; i < old_cap; i++)
+        if (old[i].key) s->cells[cell_slot(s, old[i].key)] = old[i];
+    free(old);
+    return 1;
+}
+
+/* cellule (row, col), créée si absente */
+static SpCell* cell_get(SpatialIndex* s, int row, int col) {
+    long long key = cell_key(row, col);
+    int i = cell_slot(s, key);
+    if (s->cells[i].key) return &s->cells[i];
+    if ((s->cell_used + 1) * 2 > s->cell_cap) {
+        if (!cells_grow(s)) return NULL;
+        i = cell_slot(s, key);
+    }
+    SpCell* c = &s->cells[i];
+    c->key = key;
+    c->row = row;
+    c->col = col;
+    if (!s->cell_used) {
+        s->row_min = s->row_max = row;
+        s->col_min = s->col_max = col;
+    }
+    if (row < s->row_min) s->row_min = row;
+    if (row > s->row_max) s->row_max = row;
+    if (col < s->col_min) s->col_min = col;
+    if (col > s->col_max) s->col_max = col;
+    s->cell_used++;
+    return c;
+}
+
+const SpCell* sp_cell(const SpatialIndex* s, int row, int col) {
+    if (!s->cells) return NULL;
+    const SpCell* c = &s->cells[cell_slot(s, cell_key(row, col))];
+    return c->key && c->count ? c : NULL;
+}
+
+void sp_cell_of(const SpatialIndex* s, int lat_e6, int lon_e6, int* row, int* col) {
+    *row = floor_div(lat_e6, s->cell_e6);
+    *col = floor_div(lon_e6, s->cell_e6);
+}
+
+/* ---------- table des stations ---------- */
+
+static int station_slot(const SpatialIndex* s, int id, int for_insert) {
+    int mask = s->station_cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)id) & (uint64_t)mask);
+    int tomb = -1;
+    while (s->station_keys[i] != -1) {
+        if (s->station_keys[i] == id) return i;
+        if (s->station_keys[i] == -2 && tomb < 0) tomb = i;
+        i = (i + 1) & mask;
+    }
+    return for_insert && tomb >= 0 ? tomb : i;
+}
+
+static int stations_rebuild(SpatialIndex* s) {
+    int cap = s->station_cap;
+    while ((s->count + 1) * 2 > cap) cap *= 2;
+    int* keys = (int*)malloc(sizeof(int) * cap);
+    long long* cells = (long long*)malloc(sizeof(long long) * cap);
+    if (!keys || !cells) { free(keys); free(cells); return 0; }
+    int* old_keys = s->station_keys;
+    long long* old_cells = s->station_cell;
+    int old_cap = s->station_cap;
+    memset(keys, 0xff, sizeof(int) * cap);
+    s->station_keys = keys;
+    s->station_cell = cells;
+    s->station_cap = cap;
+    s->station_used = s->count;
+    for (int i = 0; i < old_cap; i++) {
+        if (old_keys[i] < 0) continue;
+        int j = station_slot(s, old_keys[i], 1);
+        keys[j] = old_keys[i];
+        cells[j] = old_cells[i];
+    }
+    free(old_keys);
+    free(old_cells);
+    return 1;
+}
+
+static void cell_take(SpatialIndex* s, long long key, int station_id) {
+    SpCell* c = &s->cells[cell_slot(s, key)];
+    for (int k = 0; k < c->count; k++) {
+        if (c->items[k].station_id == station_id) {
+            c->items[k] = c->items[--c->count];
+            return;
+        }
+    }
+}
+
+int sp_set(SpatialIndex* s, int station_id, int lat_e6, int lon_e6) {
+    if (lat_e6 == SP_NO_POS || lon_e6 == SP_NO_POS) { sp_remove(s, station_id); return 1; }
+    if (lat_e6 < -90000000 || lat_e6 > 90000000 || lon_e6 < -180000000 || lon_e6 > 180000000) return 0;
+    int row, col;
+    sp_cell_of(s, lat_e6, lon_e6, &row, &col);
+    long long key = cell_key(row, col);
+
+    int i = station_slot(s, station_id, 0);
+    if (s->station_keys[i] == station_id) {
+        SpCell* c = &s->cells[cell_slot(s, s->station_cell[i])];
+        if (s->station_cell[i] == key) {
+            // même cellule : la position est mise à jour sur place
+            for (int k = 0; k < c->count; k++)
+                if (c->items[k].station_id == station_id) {
+                    c->items[k].lat_e6 = lat_e6;
+                    c->items[k].lon_e6 = lon_e6;
+                }
+            return 1;
+        }
+    }
+
+    SpCell* c = cell_get(s, row, col);
+    if (!c) return 0;
+    if (c->count == c->cap) {
+        int nc = c->cap ? c->cap * 2 : 4;
+        SpEntry* ni = (SpEntry*)realloc(c->items, sizeof(SpEntry) * nc);
+        if (!ni) return 0;
+        c->items = ni;
+        c->cap = nc;
+    }
+    SpEntry e = { station_id, lat_e6, lon_e6 };
+
+    // la table peut être reconstruite : on relocalise la station après
+    i = station_slot(s, station_id, 0);
+    if (s->station_keys[i] == station_id) {
+        cell_take(s, s->station_cell[i], station_id);
+        c = &s->cells[cell_slot(s, key)];
+        c->items[c->count++] = e;
+        s->station_cell[i] = key;
+        return 1;
+    }
+    if (s->station_used + 1 > s->station_cap / 2) {
+        if (!stations_rebuild(s)) return 0;
+    }
+    i = station_slot(s, station_id, 1);
+    if (s->station_keys[i] == -1) s->station_used++;
+    s->station_keys[i] = station_id;
+    s->station_cell[i] = key;
+    c->items[c->count++] = e;
+    s->count++;
+    return 1;
+}
+
+int sp_get(const SpatialIndex* s, int station_id, int* lat_e6, int* lon_e6) {
+    if (!s->station_keys) return 0;
+    int i = station_slot(s, station_id, 0);
+    if (s->station_keys[i] != station_id) return 0;
+    const SpCell* c = &s->cells[cell_slot(s, s->station_cell[i])];
+    for (int k = 0; k < c->count; k++) {
+        if (c->items[k].station_id == station_id) {
+            *lat_e6 = c->items[k].lat_e6;
+            *lon_e6 = c->items[k].lon_e6;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int sp_remove(SpatialIndex* s, int station_id) {
+    if (!s->station_keys) return 0;
+    int i = station_slot(s, station_id, 0);
+    if (s->station_keys[i] != station_id) return 0;
+    cell_take(s, s->station_cell[i], station_id);
+    s->station_keys[i] = -2;
+    s->count--;
+    return 1;
+}
+
+double sp_distance_km(int lat1_e6, int lon1_e6, int lat2_e6, int lon2_e6) {
+    double mean = (lat1_e6 + (double)lat2_e6) * 0.5e-6 * SP_RAD_PER_DEG;
+    double dy = (lat2_e6 - (double)lat1_e6) * 1e-6 * SP_KM_PER_DEG;
+    double dx = (lon2_e6 - (double)lon1_e6) * 1e-6 * SP_KM_PER_DEG * cos(mean);
+    return sqrt(dx * dx + dy * dy);
+}
+
+int sp_parse_coord(const char* p, int len) {
+    int i = 0, neg = 0, digits = 0;
+    long long v = 0;
+    while (i < len && (p[i] == ' ' || p[i] == '"')) i++;
+    if (i < len && (p[i] == '-' || p[i] == '+')) { neg = p[i] == '-'; i++; }
+    for (; i < len && p[i] >= '0' && p[i] <= '9'; i++, digits++) {
+        v = v * 10 + (p[i] - '0');
+        if (v > 180) return SP_NO_POS;
+    }
+    v *= 1000000;
+    if (i < len && p[i] == '.') {
+        long long scale = 100000;
+        int frac = 0;
+        for (i++; i < len && p[i] >= '0' && p[i] <= '9'; i++, frac++) {
+            if (frac < 6) v += (p[i] - '0') * scale, scale /= 10;
+            else if (frac == 6 && p[i] >= '5') v++;   // arrondi au microdegré
+        }
+        digits += frac;
+    }
+    while (i < len && (p[i] == ' ' || p[i] == '"' || p[i] == '\r')) i++;
+    if (digits == 0 || i != len || v > 180000000) return SP_NO_POS;
+    return (int)(neg ? -v : v);
+}
+
+void sp_reset(SpatialIndex* s) {
+    for (int i = 0; i < s->cell_cap; i++) s->cells[i].count = 0;
+    if (s->station_keys) memset(s->station_keys, 0xff, sizeof(int) * s->station_cap);
+    s->station_used = 0;
+    s->count = 0;
+}
+
+void sp_clear(SpatialIndex* s) {
+    for (int i = 0; s->cells && i < s->cell_cap; i++) free(s->cells[i].items);
+    free(s->cells);
+    free(s->station_cell);
+    free(s->station_keys);
+    memset(s, 0, sizeof *s);
+}
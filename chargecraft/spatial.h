@@ -0,0 +1,82 @@
+#ifndef DS_SPATIAL_H
+#define DS_SPATIAL_H
+#include <limits.h>
+
+/**
+ * @brief Positions des stations sur une grille régulière latitude / longitude.
+ *
+ * Coordonnées en microdegrés. Chaque cellule non vide garde ses stations avec
+ * leur position, pour qu'un parcours par anneaux autour d'un point lise des
+ * données contiguës. Une table ouverte donne la cellule d'une station pour les
+ * déplacements et retraits.
+ */
+
+#define SP_NO_POS INT_MIN     /* station sans position */
+#define SP_CELL_DEG 0.05      /* côté de cellule par défaut (~5,5 km en latitude) */
+
+typedef struct SpEntry {
+    int station_id;
+    int lat_e6, lon_e6;
+} SpEntry;
+
+typedef struct SpCell {
+    long long key;          /* (ligne, colonne) repliées ; 0 pour une case libre */
+    int row, col;
+    SpEntry* items;
+    int count, cap;
+} SpCell;
+
+typedef struct SpatialIndex {
+    int cell_e6;            /* côté de cellule en microdegrés */
+    SpCell* cells;          /* table ouverte par (ligne, colonne) */
+    int cell_cap, cell_used;
+    long long* station_cell; /* table ouverte : station -> clé de cellule */
+    int* station_keys;       /* -1 libre, -2 supprimée, sinon identifiant */
+    int station_cap, station_used;
+    int count;
+    int row_min, row_max, col_min, col_max; /* cellules occupées (englobant) */
+} SpatialIndex;
+
+/**
+ * @param cell_deg Côté de cellule en degrés (SP_CELL_DEG si <= 0).
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  sp_init(SpatialIndex* s, double cell_deg);                        /* O(1) */
+
+/**
+ * Place (ou déplace) une station ; lat_e6 == SP_NO_POS la retire.
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation ou de coordonnées invalides.
+ */
+int  sp_set(SpatialIndex* s, int station_id, int lat_e6, int lon_e6);  /* O(1) amorti */
+
+/**
+ * @return 1 si la station a une position (écrite dans lat_e6 / lon_e6), 0 sinon.
+ */
+int  sp_get(const SpatialIndex* s, int station_id, int* lat_e6, int* lon_e6); /* O(1) */
+
+int  sp_remove(SpatialIndex* s, int station_id);                       /* O(stations de la cellule) */
+
+/* cellule contenant un point */
+void sp_cell_of(const SpatialIndex* s, int lat_e6, int lon_e6, int* row, int* col);
+
+/* cellule (row, col), NULL si vide */
+const SpCell* sp_cell(const SpatialIndex* s, int row, int col);       /* O(1) */
+
+/**
+ * Distance approchée (projection équirectangulaire), précise à mieux que 0,5 %
+ * sous 100 km.
+ */
+double sp_distance_km(int lat1_e6, int lon1_e6, int lat2_e6, int lon2_e6);
+
+/**
+ * Convertit un texte décimal ("47.458211", "-5.1") en microdegrés.
+ *
+ * @return SP_NO_POS si vide, mal formé ou hors de [-180, 180].
+ */
+int  sp_parse_coord(const char* p, int len);
+
+void sp_reset(SpatialIndex* s);                                        /* O(cellules) */
+void sp_clear(SpatialIndex* s);                                        /* O(cellules) */
+
+#endif
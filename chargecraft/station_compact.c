@@ -0,0 +1,257 @@
+#include "station_compact.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define N(c, i) ((c)->nodes[i])
+
+static int max(int a, int b) {
+    return a > b ? a : b;
+}
+
+static int height(const CompactIndex* c, uint32_t i) {
+    return i == SC_NIL ? 0 : N(c, i).height;
+}
+
+static void fix_height(CompactIndex* c, uint32_t i) {
+    N(c, i).height = (uint8_t)(1 + max(height(c, N(c, i).left), height(c, N(c, i).right)));
+}
+
+static int get_balance(const CompactIndex* c, uint32_t i) {
+    return i == SC_NIL ? 0 : height(c, N(c, i).left) - height(c, N(c, i).right);
+}
+
+void sc_init(CompactIndex* c, int base_ts) {
+    memset(c, 0, sizeof *c);
+    c->base_ts = base_ts;
+}
+
+int sc_reserve(CompactIndex* c, int n) {
+    uint64_t need = (uint64_t)(c->used ? c->used : 1) + (uint64_t)(n > 0 ? n : 0);
+    if (need <= c->cap) return 1;
+    if (need > UINT32_MAX) return 0;
+    // doublement pour les ajouts un à un, taille exacte pour une grosse réserve
+    uint64_t cap = c->cap ? 2 * (uint64_t)c->cap : 1024;
+    if (cap < need) cap = need;
+    if (cap > UINT32_MAX) cap = UINT32_MAX;
+    CompactNode* nodes = (CompactNode*)realloc(c->nodes, sizeof(CompactNode) * (size_t)cap);
+    if (!nodes) return 0;
+    c->nodes = nodes;
+    c->cap = (uint32_t)cap;
+    if (c->used == 0) c->used = 1;     // case 0 réservée : SC_NIL
+    return 1;
+}
+
+/* champs compressés de in dans n, 0 si l'un d'eux sort de sa plage */
+static int pack(const CompactIndex* c, const StationInfo* in, CompactNode* n) {
+    if (in->power_kW < 0 || in->power_kW > UINT16_MAX || in->price_cents < 0 || in->price_cents > UINT16_MAX ||
+        in->slots_free < 0 || in->slots_free > UINT16_MAX || in->last_ts < c->base_ts)
+        return 0;
+    n->power_kW = (uint16_t)in->power_kW;
+    n->price_cents = (uint16_t)in->price_cents;
+    n->slots_free = (uint16_t)in->slots_free;
+    n->ts_delta = (uint32_t)((int64_t)in->last_ts - c->base_ts);
+    return 1;
+}
+
+void sc_info(const CompactIndex* c, uint32_t pos, StationInfo* out) {
+    const CompactNode* n = &N(c, pos);
+    out->power_kW = n->power_kW;
+    out->price_cents = n->price_cents;
+    out->slots_free = n->slots_free;
+    out->last_ts = (int)((int64_t)c->base_ts + n->ts_delta);
+}
+
+int sc_set(CompactIndex* c, uint32_t pos, const StationInfo* in) {
+    return pack(c, in, &N(c, pos)) ? 1 : -1;
+}
+
+/* case libre, la place a été réservée avant la descente */
+static uint32_t take_slot(CompactIndex* c) {
+    uint32_t i = c->free_list;
+    if (i != SC_NIL) c->free_list = N(c, i).left;
+    else i = c->used++;
+    return i;
+}
+
+static uint32_t right_rotate(CompactIndex* c, uint32_t y) {
+    uint32_t x = N(c, y).left;
+    N(c, y).left = N(c, x).right;
+    N(c, x).right = y;
+    fix_height(c, y);
+    fix_height(c, x);
+    return x;
+}
+
+static uint32_t left_rotate(CompactIndex* c, uint32_t x) {
+    uint32_t y = N(c, x).right;
+    N(c, x).right = N(c, y).left;
+    N(c, y).left = x;
+    fix_height(c, x);
+    fix_height(c, y);
+    return y;
+}
+
+/* rééquilibrage AVL du noeud i, mêmes cas que station_index.c */
+static uint32_t rebalance(CompactIndex* c, uint32_t i) {
+    fix_height(c, i);
+    int balance = get_balance(c, i);
+    if (balance > 1) {
+        if (get_balance(c, N(c, i).left) < 0) N(c, i).left = left_rotate(c, N(c, i).left);
+        return right_rotate(c, i);
+    }
+    if (balance < -1) {
+        if (get_balance(c, N(c, i).right) > 0) N(c, i).right = right_rotate(c, N(c, i).right);
+        return left_rotate(c, i);
+    }
+    return i;
+}
+
+static uint32_t insert_rec(CompactIndex* c, uint32_t i, const CompactNode* in, int* created) {
+    if (i == SC_NIL) {
+        i = take_slot(c);
+        N(c, i) = *in;
+        *created = 1;
+        return i;
+    }
+    if (in->station_id < N(c, i).station_id) {
+        uint32_t l = insert_rec(c, N(c, i).left, in, created);
+        N(c, i).left = l;
+    } else if (in->station_id > N(c, i).station_id) {
+        uint32_t r = insert_rec(c, N(c, i).right, in, created);
+        N(c, i).right = r;
+    } else {
+        CompactNode* n = &N(c, i);
+        n->power_kW = in->power_kW;
+        n->price_cents = in->price_cents;
+        n->slots_free = in->slots_free;
+        n->ts_delta = in->ts_delta;
+        return i;
+    }
+    return *created ? rebalance(c, i) : i;
+}
+
+int sc_add(CompactIndex* c, int id, StationInfo in) {
+    CompactNode n;
+    memset(&n, 0, sizeof n);
+    n.station_id = id;
+    n.height = 1;
+    if (!pack(c, &in, &n)) return -1;
+    // la descente ne réalloue jamais : positions stables pendant la récursion
+    if (c->free_list == SC_NIL && !sc_reserve(c, 1)) return 0;
+    int created = 0;
+    c->root = insert_rec(c, c->root, &n, &created);
+    c->size += created;
+    return 1;
+}
+
+uint32_t sc_find(const CompactIndex* c, int id) {
+    uint32_t i = c->root;
+    while (i != SC_NIL && N(c, i).station_id != id)
+        i = id < N(c, i).station_id ? N(c, i).left : N(c, i).right;
+    return i;
+}
+
+static uint32_t delete_rec(CompactIndex* c, uint32_t i, int id) {
+    if (i == SC_NIL) return i;
+    if (id < N(c, i).station_id) {
+        uint32_t l = delete_rec(c, N(c, i).left, id);
+        N(c, i).left = l;
+    } else if (id > N(c, i).station_id) {
+        uint32_t r = delete_rec(c, N(c, i).right, id);
+        N(c, i).right = r;
+    } else if (N(c, i).left == SC_NIL || N(c, i).right == SC_NIL) {
+        // zéro ou un enfant : il remplace directement le noeud, dont la case est rendue
+        uint32_t child = N(c, i).left != SC_NIL ? N(c, i).left : N(c, i).right;
+        N(c, i).left = c->free_list;
+        c->free_list = i;
+        return child;
+    } else {
+        // deux enfants : on récupère le successeur (plus petit de droite)
+        uint32_t s = N(c, i).right;
+        while (N(c, s).left != SC_NIL) s = N(c, s).left;
+        CompactNode* n = &N(c, i);
+        const CompactNode* succ = &N(c, s);
+        n->station_id = succ->station_id;
+        n->power_kW = succ->power_kW;
+        n->price_cents = succ->price_cents;
+        n->slots_free = succ->slots_free;
+        n->ts_delta = succ->ts_delta;
+        uint32_t r = delete_rec(c, n->right, n->station_id);
+        N(c, i).right = r;
+    }
+    return rebalance(c, i);
+}
+
+int sc_delete(CompactIndex* c, int id) {
+    if (sc_find(c, id) == SC_NIL) return 0;
+    c->root = delete_rec(c, c->root, id);
+    c->size--;
+    return 1;
+}
+
+/* ---------- copie équilibrée d'un StationIndex ---------- */
+
+typedef struct Sorted {
+    const StationNode** at;
+    int count;
+} Sorted;
+
+static int collect(void* ctx, StationNode* n) {
+    Sorted* s = (Sorted*)ctx;
+    s->at[s->count++] = n;
+    return 1;
+}
+
+/* sous-arbre des stations [lo, hi] en ordre préfixe : le noeud, puis ses fils gauche et droit */
+static uint32_t build(CompactIndex* c, const Sorted* s, int lo, int hi, int* ok) {
+    if (lo > hi) return SC_NIL;
+    int mid = lo + (hi - lo) / 2;
+    uint32_t i = c->used++;
+    CompactNode* n = &N(c, i);
+    memset(n, 0, sizeof *n);
+    n->station_id = s->at[mid]->station_id;
+    if (!pack(c, &s->at[mid]->info, n)) *ok = 0;
+    uint32_t l = build(c, s, lo, mid - 1, ok);
+    uint32_t r = build(c, s, mid + 1, hi, ok);
+    N(c, i).left = l;
+    N(c, i).right = r;
+    fix_height(c, i);
+    return i;
+}
+
+int sc_from_index(CompactIndex* c, const StationIndex* idx) {
+    Sorted s = { NULL, 0 };
+    if (idx->size > 0) {
+        s.at = (const StationNode**)malloc(sizeof(StationNode*) * (size_t)idx->size);
+        if (!s.at) return -1;
+        si_range(idx, INT_MIN, INT_MAX, collect, &s);
+    }
+    int base = s.count ? s.at[0]->info.last_ts : 0;
+    for (int k = 1; k < s.count; k++)
+        if (s.at[k]->info.last_ts < base) base = s.at[k]->info.last_ts;
+
+    sc_clear(c);
+    sc_init(c, base);
+    // taille exacte : la copie sert surtout figée
+    c->nodes = (CompactNode*)malloc(sizeof(CompactNode) * ((size_t)s.count + 1));
+    int ok = c->nodes != NULL;
+    if (ok) {
+        c->cap = (uint32_t)s.count + 1;
+        c->used = 1;
+        c->root = build(c, &s, 0, s.count - 1, &ok);
+        c->size = s.count;
+    }
+    free(s.at);
+    if (!ok) { sc_clear(c); return -1; }
+    return c->size;
+}
+
+size_t sc_bytes(const CompactIndex* c) {
+    return sizeof(CompactNode) * (size_t)c->cap;
+}
+
+void sc_clear(CompactIndex* c) {
+    free(c->nodes);
+    sc_init(c, c->base_ts);
+}
@@ -0,0 +1,106 @@
+#ifndef DS_STATION_COMPACT_H
+#define DS_STATION_COMPACT_H
+#include <stddef.h>
+#include <stdint.h>
+#include "station_index.h"
+
+/**
+ * @brief Index AVL compact : mêmes opérations que station_index.h, autre disposition.
+ *
+ * Les noeuds vivent dans un seul tableau et se désignent par des positions sur
+ * 32 bits (0 : aucun noeud, la case 0 n'est jamais utilisée). Les champs de
+ * StationInfo sont réduits à leur plage réelle : puissance, prix et créneaux
+ * sur 16 bits, horodatage en écart à base_ts sur 32 bits non signés, hauteur
+ * sur un octet (6 bits suffisent pour 2^31 noeuds). Un noeud occupe 24 octets
+ * contre 48 pour StationNode, plus l'en-tête malloc de chaque noeud.
+ *
+ * Les cases libérées par sc_delete sont chaînées (par left) et réutilisées.
+ * sc_from_index range l'arbre en ordre préfixe, parfaitement équilibré : un
+ * fils gauche suit directement son parent en mémoire.
+ *
+ * Une valeur hors plage (négative, puissance ou prix > 65535, horodatage
+ * antérieur à base_ts) est refusée plutôt que tronquée.
+ */
+
+#define SC_NIL 0u
+
+typedef struct CompactNode {
+    int32_t station_id;
+    uint32_t left, right;       /* positions des fils, SC_NIL : aucun */
+    uint32_t ts_delta;          /* last_ts - base_ts */
+    uint16_t power_kW;
+    uint16_t price_cents;
+    uint16_t slots_free;
+    uint8_t height;
+    uint8_t unused;
+} CompactNode;
+
+typedef struct CompactIndex {
+    CompactNode* nodes;
+    uint32_t cap;               /* cases allouées, case 0 comprise */
+    uint32_t used;              /* cases déjà distribuées (la suivante est nodes[used]) */
+    uint32_t free_list;         /* cases rendues par sc_delete, chaînées par left */
+    uint32_t root;
+    int size;                   /* nombre de stations */
+    int base_ts;                /* origine des horodatages */
+} CompactIndex;
+
+/**
+ * Initialise un index vide.
+ *
+ * @param base_ts Origine des horodatages : last_ts doit être >= base_ts.
+ */
+void sc_init(CompactIndex* c, int base_ts);                              /* O(1) */
+
+/**
+ * Prépare la place de n stations de plus.
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation ou au-delà de 2^32 cases.
+ */
+int  sc_reserve(CompactIndex* c, int n);                                 /* O(taille) */
+
+/**
+ * Ajoute une station ou met à jour ses informations.
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation, -1 si un champ sort de sa plage.
+ */
+int  sc_add(CompactIndex* c, int id, StationInfo in);                    /* O(log n) amorti */
+
+/**
+ * Recherche une station.
+ *
+ * @return Position du noeud, SC_NIL si absente.
+ */
+uint32_t sc_find(const CompactIndex* c, int id);                         /* O(log n) */
+
+/* informations du noeud en position pos, décompressées */
+void sc_info(const CompactIndex* c, uint32_t pos, StationInfo* out);     /* O(1) */
+
+/**
+ * Remplace les informations du noeud en position pos.
+ *
+ * @return 1 si succès, -1 si un champ sort de sa plage (noeud inchangé).
+ */
+int  sc_set(CompactIndex* c, uint32_t pos, const StationInfo* in);       /* O(1) */
+
+/**
+ * Supprime une station.
+ *
+ * @return 1 si elle était présente, 0 sinon.
+ */
+int  sc_delete(CompactIndex* c, int id);                                 /* O(log n) */
+
+/**
+ * Remplace le contenu par une copie de l'index idx, parfaitement équilibrée et
+ * rangée en ordre préfixe. base_ts devient le plus petit last_ts de idx.
+ *
+ * @return Nombre de stations copiées, -1 en cas d'échec d'allocation ou de champ hors plage.
+ */
+int  sc_from_index(CompactIndex* c, const StationIndex* idx);            /* O(n) */
+
+/* octets alloués pour les noeuds */
+size_t sc_bytes(const CompactIndex* c);                                  /* O(1) */
+
+void sc_clear(CompactIndex* c);                                          /* O(1) */
+
+#endif
@@ -1,11 +1,17 @@
 #include "station_index.h"
+#include "station_meta.h"
+#include "geo.h"
+#include "spatial.h"
+#include "connector.h"
+#include "metrics.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <limits.h>
 
 static void print_rec(StationNode* root, int level);
-static void clear_rec(StationNode* node);
+static void clear_rec(StationNode* node, unsigned gen);
 static int get_height_rec(StationNode* node);
 static void fill_buffer(char** canvas, StationNode* node, int level, int left, int right);
 
@@ -22,14 +28,103 @@ static int get_balance(StationNode *n) {
     return height(n->left) - height(n->right);
 }
 
-static StationNode* new_node(int id, StationInfo info) {
+void si_init(StationIndex* idx) {
+    if (idx) {
+        idx->root = NULL;
+        idx->meta = NULL;
+        idx->geo = NULL;
+        idx->spatial = NULL;
+        idx->keys = NULL;
+        idx->conns = NULL;
+        idx->slab = NULL;
+        idx->size = 0;
+        idx->version = 0;
+        idx->data_version = 0;
+        idx->attr_version = 0;
+        memset(idx->shard_version, 0, sizeof idx->shard_version);
+        idx->gen = 0;
+        idx->base = NULL;
+    }
+}
+
+void si_touch(StationIndex* idx, int id) {
+    idx->data_version++;
+    idx->shard_version[si_shard(id)]++;
+}
+
+void si_touch_attr(StationIndex* idx, int id) {
+    idx->attr_version++;
+    si_touch(idx, id);
+}
+
+/* ---------- copie sur écriture ---------- */
+
+/* générations attribuées aux index et instantanés ; 0 : index jamais figé */
+static atomic_uint next_gen = 1;
+
+/*
+ * Contexte d'une écriture : les copies sont allouées avant de toucher à
+ * l'arbre, pour qu'un échec d'allocation le laisse intact.
+ */
+typedef struct Cow {
+    unsigned gen;
+    StationNode** spare;
+    int n_spare;
+} Cow;
+
+#define COW_SPARE (3 * SI_CURSOR_DEPTH)
+
+static void cow_release(Cow* c) {
+    while (c->n_spare > 0) free(c->spare[--c->n_spare]);
+}
+
+static int cow_reserve(Cow* c, const StationIndex* idx, int need, StationNode** buf) {
+    c->gen = idx->gen;
+    c->spare = buf;
+    c->n_spare = 0;
+    // sans instantané, tous les noeuds appartiennent à l'index
+    if (!idx->base) return 1;
+    if (need > COW_SPARE) need = COW_SPARE;
+    while (c->n_spare < need) {
+        StationNode* n = (StationNode*)malloc(sizeof(StationNode));
+        if (!n) { cow_release(c); return 0; }
+        METRIC_INC(MC_ALLOCS);
+        buf[c->n_spare++] = n;
+    }
+    return 1;
+}
+
+/* le noeud lui-même s'il appartient à l'écrivain, sinon sa copie (à rebrancher par l'appelant) */
+static StationNode* own(StationNode* n, Cow* c) {
+    if (!n || n->gen == c->gen) return n;
+    StationNode* copy = c->spare[--c->n_spare];
+    *copy = *n;
+    copy->gen = c->gen;
+    copy->slab = 0;
+    return copy;
+}
+
+/* noeuds partagés sur le chemin de id : les ancêtres d'un noeud propre sont propres */
+static int shared_on_path(const StationIndex* idx, int id) {
+    int k = 0;
+    for (StationNode* n = idx->root; n; n = id < n->station_id ? n->left : n->right) {
+        k += n->gen != idx->gen;
+        if (n->station_id == id) break;
+    }
+    return k;
+}
+
+static StationNode* new_node(int id, StationInfo info, unsigned gen) {
     StationNode* node = (StationNode*)malloc(sizeof(StationNode));
     if (!node) return NULL;
+    METRIC_INC(MC_ALLOCS);
     node->station_id = id;
     node->info = info;
+    node->slab = 0;
     node->left = NULL;
     node->right = NULL;
     node->height = 1;
+    node->gen = gen;
     return node;
 }
 
@@ -39,8 +134,9 @@ static StationNode* new_node(int id, StationInfo info) {
  * Cette opération rééquilibre l'arbre AVL en cas de déséquilibre gauche-gauche.
  * Retourne le nouveau nœud racine après rotation.
  */
-static StationNode* right_rotate(StationNode *y) {
-    StationNode *x = y->left;
+static StationNode* right_rotate(StationNode *y, Cow* c) {
+    y = own(y, c);
+    StationNode *x = own(y->left, c);
     StationNode *T2 = x->right;
 
     x->right = y;
@@ -57,8 +153,9 @@ static StationNode* right_rotate(StationNode *y) {
  * Cette opération rééquilibre l'arbre AVL en cas de déséquilibre droite-droite.
  * Retourne le nouveau nœud racine après rotation.
  */
-static StationNode* left_rotate(StationNode *x) {
-    StationNode *y = x->right;
+static StationNode* left_rotate(StationNode *x, Cow* c) {
+    x = own(x, c);
+    StationNode *y = own(x->right, c);
     StationNode *T2 = y->left;
 
     y->left = x;
@@ -75,14 +172,20 @@ static StationNode* left_rotate(StationNode *x) {
  * Insère récursivement un nœud dans l'arbre AVL.
  * Si la clé existe déjà, met à jour les informations.
  * Après insertion, rééquilibre l'arbre en appliquant les rotations AVL nécessaires.
+ * Les noeuds partagés du chemin sont copiés (les rotations restent sur le chemin).
  */
-static StationNode* insert_rec(StationNode* node, int id, StationInfo info) {
-    if (node == NULL) return new_node(id, info);
+static StationNode* insert_rec(StationNode* node, int id, StationInfo info, int* created, Cow* c) {
+    if (node == NULL) {
+        node = new_node(id, info, c->gen);
+        *created = node != NULL;
+        return node;
+    }
 
+    node = own(node, c);
     if (id < node->station_id)
-        node->left = insert_rec(node->left, id, info);
+        node->left = insert_rec(node->left, id, info, created, c);
     else if (id > node->station_id)
-        node->right = insert_rec(node->right, id, info);
+        node->right = insert_rec(node->right, id, info, created, c);
     else {
         node->info = info;
         return node;
@@ -95,22 +198,22 @@ static StationNode* insert_rec(StationNode* node, int id, StationInfo info) {
 
     // cas gauche-gauche
     if (balance > 1 && id < node->left->station_id)
-        return right_rotate(node);
+        return right_rotate(node, c);
 
     // cas droite-droite
     if (balance < -1 && id > node->right->station_id)
-        return left_rotate(node);
+        return left_rotate(node, c);
 
     // cas gauche-droite
     if (balance > 1 && id > node->left->station_id) {
-        node->left = left_rotate(node->left);
-        return right_rotate(node);
+        node->left = left_rotate(node->left, c);
+        return right_rotate(node, c);
     }
 
     // cas droite-gauche
     if (balance < -1 && id < node->right->station_id) {
-        node->right = right_rotate(node->right);
-        return left_rotate(node);
+        node->right = right_rotate(node->right, c);
+        return left_rotate(node, c);
     }
 
     return node;
@@ -130,67 +233,50 @@ static StationNode* min_value_node(StationNode* node) {
 /**
  * Supprime récursivement un nœud de l'arbre AVL.
  * Gère tous les cas (0, 1 ou 2 enfants).
- * Rééquilibre l'arbre après suppression.
+ * Rééquilibre l'arbre après suppression. Un nœud partagé avec un instantané
+ * est copié avant d'être modifié et n'est jamais libéré.
  */
-static StationNode* delete_rec(StationNode* root, int id) {
+static StationNode* delete_rec(StationNode* root, int id, Cow* c) {
     if (root == NULL) return root;
 
+    if (id == root->station_id && (root->left == NULL || root->right == NULL)) {
+        // aucun ou un seul enfant : il remplace directement le nœud supprimé
+        StationNode *temp = root->left ? root->left : root->right;
+        if (root->gen == c->gen && !root->slab) free(root);
+        return temp;
+    }
+
+    root = own(root, c);
     if (id < root->station_id)
-        root->left = delete_rec(root->left, id);
+        root->left = delete_rec(root->left, id, c);
     else if (id > root->station_id)
-        root->right = delete_rec(root->right, id);
+        root->right = delete_rec(root->right, id, c);
     else {
-        // nœud à supprimer trouvé
-        if ((root->left == NULL) || (root->right == NULL)) {
-            StationNode *temp = root->left ? root->left : root->right;
-            // aucun enfant
-            if (temp == NULL) {
-                temp = root;
-                root = NULL;
-            } else {
-                // un seul enfant : on copie le contenu de l'enfant dans la racine à supprimer
-                *root = *temp;
-                free(temp);
-               // attention : on ne doit pas free root ici, on vient juste de le remplacer
-               // la ligne suivante est incorrecte et doit être retirée, mais on la laisse pour respecter le code original
-               StationNode* child = root->left ? root->left : root->right;
-               free(root);
-               return child;
-            }
-            // si racine est NULL, on libère temp et retourne NULL
-            if (root == NULL) {
-                free(temp);
-                return NULL;
-            }
-        } else {
-            // nœud avec deux enfants : on récupère le successeur (plus petit de droite)
-            StationNode* temp = min_value_node(root->right);
-            root->station_id = temp->station_id;
-            root->info = temp->info;
-            // suppression récursive du successeur
-            root->right = delete_rec(root->right, temp->station_id);
-        }
+        // nœud avec deux enfants : on récupère le successeur (plus petit de droite)
+        StationNode* temp = min_value_node(root->right);
+        root->station_id = temp->station_id;
+        root->info = temp->info;
+        // suppression récursive du successeur
+        root->right = delete_rec(root->right, temp->station_id, c);
     }
 
-    if (root == NULL) return root;
-
     root->height = 1 + max(height(root->left), height(root->right));
     
     int balance = get_balance(root);
 
     // rééquilibrage AVL après suppression
     if (balance > 1 && get_balance(root->left) >= 0)
-        return right_rotate(root);
+        return right_rotate(root, c);
 
     if (balance > 1 && get_balance(root->left) < 0) {
-        root->left = left_rotate(root->left);
-        return right_rotate(root);
+        root->left = left_rotate(root->left, c);
+        return right_rotate(root, c);
     }
     if (balance < -1 && get_balance(root->right) <= 0)
-        return left_rotate(root);
+        return left_rotate(root, c);
     if (balance < -1 && get_balance(root->right) > 0) {
-        root->right = right_rotate(root->right);
-        return left_rotate(root);
+        root->right = right_rotate(root->right, c);
+        return left_rotate(root, c);
     }
 
     return root;
@@ -202,18 +288,106 @@ static StationNode* delete_rec(StationNode* root, int id) {
  * Retourne un pointeur vers le nœud si trouvé, NULL sinon.
  */
 StationNode* si_find(StationNode* r, int id) {
-    if (r == NULL || r->station_id == id) return r;
-    if (id < r->station_id) return si_find(r->left, id);
-    return si_find(r->right, id);
+    int depth = 0;
+    while (r != NULL && r->station_id != id) {
+        r = id < r->station_id ? r->left : r->right;
+        depth++;
+    }
+    if (METRIC_INC_SAMPLED(MC_SI_FIND)) METRIC_RECORD(MH_SI_FIND_DEPTH, depth);
+    return r;
+}
+
+/**
+ * Recherche groupée sur identifiants triés : pile des ancêtres avec leur
+ * intervalle ouvert (lo, hi) ; on dépile tant que l'identifiant en sort.
+ */
+int si_find_sorted(StationNode* r, const int* ids, int n, StationNode** out) {
+    // un AVL de 2^31 noeuds a une hauteur inférieure à 46
+    struct { StationNode* node; long long lo, hi; } path[64];
+    int top = 0, found = 0;
+    for (int i = 0; i < n; i++) {
+        long long id = ids[i];
+        while (top > 0 && (id <= path[top - 1].lo || id >= path[top - 1].hi)) top--;
+        StationNode* cur;
+        long long lo, hi;
+        if (top == 0) { cur = r; lo = LLONG_MIN; hi = LLONG_MAX; }
+        else {
+            // l'ancêtre est dans l'intervalle : il a déjà été comparé, on repart de son fils
+            StationNode* a = path[top - 1].node;
+            if (id == a->station_id) { out[i] = a; found++; continue; }
+            lo = path[top - 1].lo; hi = path[top - 1].hi;
+            if (id < a->station_id) { cur = a->left; hi = a->station_id; }
+            else { cur = a->right; lo = a->station_id; }
+        }
+        while (cur != NULL && cur->station_id != id) {
+            path[top].node = cur; path[top].lo = lo; path[top].hi = hi; top++;
+            if (id < cur->station_id) { hi = cur->station_id; cur = cur->left; }
+            else { lo = cur->station_id; cur = cur->right; }
+        }
+        if (cur != NULL) {
+            path[top].node = cur; path[top].lo = lo; path[top].hi = hi; top++;
+            found++;
+        }
+        out[i] = cur;
+    }
+    METRIC_ADD(MC_SI_FIND, n);
+    return found;
 }
 
 /**
  * Ajoute un nœud dans l'index AVL avec la clé id et les informations info.
  * Rééquilibre l'arbre automatiquement.
  */
+/* sous-arbre équilibré des ids[lo..hi], chaque noeud à sa place dans le bloc */
+static StationNode* build_rec(StationNode* nodes, const int* ids, int lo, int hi, unsigned gen) {
+    if (lo > hi) return NULL;
+    int mid = lo + (hi - lo) / 2;
+    StationNode* n = &nodes[mid];
+    n->station_id = ids[mid];
+    memset(&n->info, 0, sizeof n->info);
+    n->slab = 1;
+    n->gen = gen;
+    n->left = build_rec(nodes, ids, lo, mid - 1, gen);
+    n->right = build_rec(nodes, ids, mid + 1, hi, gen);
+    n->height = 1 + max(height(n->left), height(n->right));
+    return n;
+}
+
+int si_build_sorted(StationIndex* idx, const int* ids, int n, StationNode** nodes) {
+    *nodes = NULL;
+    if (!idx || idx->root || idx->base || n < 0) return 0;
+    for (int i = 1; i < n; i++)
+        if (ids[i] <= ids[i - 1]) return 0;
+    if (n == 0) return 1;
+    StationNode* slab = (StationNode*)malloc(sizeof(StationNode) * (size_t)n);
+    if (!slab) return 0;
+    METRIC_INC(MC_ALLOCS);
+    // bloc d'un arbre vidé par si_delete : plus aucun noeud n'y pointe
+    free(idx->slab);
+    idx->slab = slab;
+    idx->root = build_rec(slab, ids, 0, n - 1, idx->gen);
+    idx->size = n;
+    idx->version++;
+    idx->data_version++;
+    for (int s = 0; s < SI_SHARDS; s++) idx->shard_version[s]++;
+    *nodes = slab;
+    return 1;
+}
+
 void si_add(StationIndex* idx, int id, StationInfo in) {
     if (idx) {
-        idx->root = insert_rec(idx->root, id, in);
+        int created = 0;
+        StationNode* spare[COW_SPARE];
+        Cow c;
+        if (!cow_reserve(&c, idx, shared_on_path(idx, id), spare)) return;
+        METRIC_INC(MC_SI_ADD);
+        idx->root = insert_rec(idx->root, id, in, &created, &c);
+        cow_release(&c);
+        idx->size += created;
+        idx->version++;
+        si_touch(idx, id);
+        // station absente de l'arbre (ajout direct, sans code INSEE) : commune inconnue
+        if (idx->geo && !geo_update(idx->geo, id, &in)) geo_add(idx->geo, id, NULL, 0, in.slots_free, &in);
     }
 }
 
@@ -226,25 +400,169 @@ int si_delete(StationIndex* idx, int id) {
     
     if (si_find(idx->root, id) == NULL) return 0;
 
-    idx->root = delete_rec(idx->root, id);
+    // chemin du noeud et de son successeur, plus deux noeuds par rotation hors chemin
+    StationNode* spare[COW_SPARE];
+    Cow c;
+    if (!cow_reserve(&c, idx, 3 * idx->root->height, spare)) return 0;
+    METRIC_INC(MC_SI_DELETE);
+    idx->root = delete_rec(idx->root, id, &c);
+    cow_release(&c);
+    idx->size--;
+    idx->version++;
+    si_touch(idx, id);
+    if (idx->meta) sm_remove(idx->meta, id);
+    if (idx->geo) geo_remove(idx->geo, id);
+    if (idx->spatial) sp_remove(idx->spatial, id);
+    if (idx->conns) cn_remove(idx->conns, id);
     return 1;
 }
 
-/**
- * Remplit récursivement un tableau d'identifiants en parcourant l'arbre en ordre croissant.
- * Limite la quantité de données ajoutées au tableau en fonction de la capacité cap.
- */
-static void to_array_rec(StationNode* root, int* ids, int cap, int* count) {
-    if (!root || *count >= cap) return;
+/* empile le chemin vers la première station d'identifiant >= lo */
+static int seek(StationNode* n, long long lo, StationNode** stack) {
+    int top = 0;
+    while (n) {
+        if (n->station_id >= lo) {
+            stack[top++] = n;
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+    return top;
+}
 
-    to_array_rec(root->left, ids, cap, count);
-    
-    if (*count < cap) {
-        ids[(*count)] = root->station_id;
-        (*count)++;
+/* sommet de pile rendu, puis le chemin le plus à gauche de son sous-arbre droit */
+static StationNode* pop_next(StationNode** stack, int* top) {
+    if (*top == 0) return NULL;
+    StationNode* n = stack[--*top];
+    for (StationNode* m = n->right; m; m = m->left) stack[(*top)++] = m;
+    return n;
+}
+
+void si_cursor_begin(SiCursor* c, const StationIndex* idx, int lo, int hi) {
+    c->idx = idx;
+    c->version = idx->version;
+    c->next_id = lo;
+    c->hi = hi;
+    c->top = lo <= hi ? seek(idx->root, lo, c->stack) : 0;
+}
+
+StationNode* si_cursor_next(SiCursor* c) {
+    if (c->next_id > c->hi) return NULL;
+    if (c->version != c->idx->version) {
+        // l'arbre a changé de forme : les noeuds de la pile ne sont plus sûrs
+        c->version = c->idx->version;
+        c->top = seek(c->idx->root, c->next_id, c->stack);
     }
-    
-    to_array_rec(root->right, ids, cap, count);
+    StationNode* n = pop_next(c->stack, &c->top);
+    if (!n || n->station_id > c->hi) {
+        c->next_id = (long long)c->hi + 1;
+        c->top = 0;
+        return NULL;
+    }
+    c->next_id = (long long)n->station_id + 1;
+    return n;
+}
+
+int si_range(const StationIndex* idx, int lo, int hi, SiVisitFn fn, void* ctx) {
+    SiCursor c;
+    int visited = 0;
+    si_cursor_begin(&c, idx, lo, hi);
+    for (StationNode* n; (n = si_cursor_next(&c)) != NULL;) {
+        visited++;
+        if (!fn(ctx, n)) break;
+    }
+    return visited;
+}
+
+SiSnapshot* si_snapshot(StationIndex* idx) {
+    SiSnapshot* s = (SiSnapshot*)malloc(sizeof(SiSnapshot));
+    if (!s) return NULL;
+    s->root = idx->root;
+    s->gen = idx->gen;
+    atomic_init(&s->refs, 2);   // l'index et l'appelant
+    s->base = idx->base;        // la référence de l'index passe à l'instantané
+    s->slab = idx->slab;        // comme le bloc de ses noeuds
+    idx->slab = NULL;
+    s->size = idx->size;
+    s->version = idx->version;
+    s->data_version = idx->data_version;
+    s->attr_version = idx->attr_version;
+    memcpy(s->shard_version, idx->shard_version, sizeof s->shard_version);
+    idx->base = s;
+    idx->gen = atomic_fetch_add(&next_gen, 1);
+    return s;
+}
+
+void si_branch(StationIndex* idx, SiSnapshot* s) {
+    si_init(idx);
+    atomic_fetch_add(&s->refs, 1);
+    idx->root = s->root;
+    idx->size = s->size;
+    idx->version = s->version;
+    idx->data_version = s->data_version;
+    idx->attr_version = s->attr_version;
+    memcpy(idx->shard_version, s->shard_version, sizeof idx->shard_version);
+    idx->base = s;
+    idx->gen = atomic_fetch_add(&next_gen, 1);
+}
+
+void si_snapshot_release(SiSnapshot* s) {
+    // chaîne d'instantanés : chacun tient une référence sur le précédent
+    while (s && atomic_fetch_sub(&s->refs, 1) == 1) {
+        SiSnapshot* base = s->base;
+        clear_rec(s->root, s->gen);
+        free(s->slab);
+        free(s);
+        s = base;
+    }
+}
+
+StationNode* si_find_mut(StationIndex* idx, int id) {
+    StationNode* n = si_find(idx->root, id);
+    if (!n || n->gen == idx->gen) return n;
+    StationNode* spare[COW_SPARE];
+    Cow c;
+    if (!cow_reserve(&c, idx, shared_on_path(idx, id), spare)) return NULL;
+    // copie du chemin, de la racine au noeud
+    StationNode** link = &idx->root;
+    for (;;) {
+        n = own(*link, &c);
+        *link = n;
+        if (n->station_id == id) break;
+        link = id < n->station_id ? &n->left : &n->right;
+    }
+    cow_release(&c);
+    idx->version++;
+    return n;
+}
+
+static int owned_rec(const StationNode* n, unsigned gen) {
+    if (!n || n->gen != gen) return 0;
+    return 1 + owned_rec(n->left, gen) + owned_rec(n->right, gen);
+}
+
+int si_owned_nodes(const StationIndex* idx) {
+    return owned_rec(idx->root, idx->gen);
+}
+
+/* pivots des levels premiers niveaux, dans l'ordre des identifiants */
+static void pivots_rec(const StationNode* n, int levels, int* out, int* count) {
+    if (!n || levels == 0) return;
+    pivots_rec(n->left, levels - 1, out, count);
+    if (n->station_id != INT_MIN) out[(*count)++] = n->station_id;  // INT_MIN ouvre déjà la première plage
+    pivots_rec(n->right, levels - 1, out, count);
+}
+
+int si_partition(const StationIndex* idx, int parts, int* lo_out) {
+    if (!idx->root || parts < 1) return 0;
+    // d niveaux donnent au plus 2^d - 1 pivots, donc 2^d plages
+    int levels = 0;
+    while (levels < 30 && (2 << levels) <= parts) levels++;
+    lo_out[0] = INT_MIN;
+    int count = 1;
+    pivots_rec(idx->root, levels, lo_out, &count);
+    return count;
 }
 
 /**
@@ -252,8 +570,9 @@ static void to_array_rec(StationNode* root, int* ids, int cap, int* count) {
  * Retourne le nombre d'éléments copiés.
  */
 int si_to_array(StationNode* r, int* ids, int cap) {
-    int count = 0;
-    to_array_rec(r, ids, cap, &count);
+    StationNode* stack[SI_CURSOR_DEPTH];
+    int top = seek(r, INT_MIN, stack), count = 0;
+    for (StationNode* n; count < cap && (n = pop_next(stack, &top)) != NULL;) ids[count++] = n->station_id;
     return count;
 }
 
@@ -315,11 +634,39 @@ void si_print_pretty(StationIndex* idx) {
  */
 void si_clear(StationIndex* idx) {
     if (idx) {
-        clear_rec(idx->root);
+        clear_rec(idx->root, idx->gen);
         idx->root = NULL;
+        free(idx->slab);
+        idx->slab = NULL;
+        si_snapshot_release(idx->base);
+        idx->base = NULL;
+        idx->size = 0;
+        idx->version++;
+        idx->data_version++;
+        for (int s = 0; s < SI_SHARDS; s++) idx->shard_version[s]++;
+        if (idx->meta) sm_clear(idx->meta);
+        if (idx->geo) geo_reset(idx->geo);
+        if (idx->spatial) sp_reset(idx->spatial);
+        if (idx->conns) cn_reset(idx->conns);
     }
 }
 
+static void print_rec(StationNode* root, int level) {
+    if (!root) return;
+    print_rec(root->right, level + 1);
+    for (int i = 0; i < level; i++) printf("    ");
+    printf("%d (pw=%d, slots=%d)\n", root->station_id, root->info.power_kW, root->info.slots_free);
+    print_rec(root->left, level + 1);
+}
+
+static void clear_rec(StationNode* node, unsigned gen) {
+    // un noeud partagé n'a que des descendants partagés
+    if (!node || node->gen != gen) return;
+    clear_rec(node->left, gen);
+    clear_rec(node->right, gen);
+    if (!node->slab) free(node);
+}
+
 static int get_height_rec(StationNode* node) {
     if (!node) return 0;
     int lh = get_height_rec(node->left);
@@ -334,7 +681,7 @@ static void fill_buffer(char** canvas, StationNode* node, int level, int left, i
     int mid = (left + right) / 2;
     char buf[10];
     sprintf(buf, "%d", node->station_id);
-    size_t len = strlen(buf);
+    int len = (int)strlen(buf);
     
     for (int i = 0; i < len; i++) {
         int pos = mid - len / 2 + i;
@@ -1,5 +1,6 @@
 #ifndef DS_STATION_INDEX_H
 #define DS_STATION_INDEX_H
+#include <stdatomic.h>
 
 typedef struct StationInfo {
     int power_kW;
@@ -11,17 +12,83 @@ typedef struct StationInfo {
 typedef struct StationNode {
     int station_id;
     StationInfo info;
+    int slab;       /* 1 : pris dans le bloc de si_build_sorted, jamais libéré seul ; loge dans le bourrage */
     struct StationNode* left;
     struct StationNode* right;
     int height;
+    unsigned gen;   /* génération propriétaire (instantanés) ; loge dans le bourrage */
 } StationNode;
 
+struct StationMeta;
+struct GeoTree;
+struct SpatialIndex;
+struct StationKeys;
+struct ConnStore;
+struct SiSnapshot;
+
+#define SI_SHARDS 64        /* tranches d'identifiants versionnées séparément */
+#define SI_SHARD_SHIFT 14   /* 16384 identifiants consécutifs par tranche (modulo SI_SHARDS) */
+
 typedef struct StationIndex {
     StationNode* root;
+    struct StationMeta* meta; /* métadonnées optionnelles (station_meta.h), NULL par défaut */
+    struct GeoTree* geo;      /* hiérarchie géographique optionnelle (geo.h), NULL par défaut */
+    struct SpatialIndex* spatial; /* positions optionnelles (spatial.h), NULL par défaut */
+    struct StationKeys* keys; /* identifiants d'itinérance optionnels (station_key.h), NULL par défaut */
+    struct ConnStore* conns;  /* occupation par connecteur optionnelle (connector.h), NULL par défaut */
+    int size;                 /* nombre de stations */
+    unsigned version;         /* incrémenté à chaque ajout, mise à jour ou suppression */
+    unsigned data_version;    /* idem, plus les changements de créneaux libres (si_touch) */
+    unsigned attr_version;    /* changements de puissance ou de prix sur place (si_touch_attr) */
+    unsigned shard_version[SI_SHARDS]; /* data_version par tranche d'identifiants */
+    unsigned gen;             /* génération des noeuds modifiables en place */
+    struct SiSnapshot* base;  /* instantané dont l'arbre partage les noeuds, NULL par défaut */
+    StationNode* slab;        /* bloc de noeuds de si_build_sorted, NULL par défaut */
 } StationIndex;
 
+/**
+ * @brief Instantané figé d'un index, partagé par copie sur écriture.
+ *
+ * si_snapshot fige l'arbre courant en O(1) : ses noeuds passent à
+ * l'instantané et l'index reçoit une nouvelle génération. Un index n'écrit
+ * en place que dans les noeuds de sa génération ; les autres sont copiés avec
+ * leur chemin depuis la racine au moment de l'écriture (si_add, si_delete,
+ * si_find_mut), si bien que les noeuds partagés ne changent jamais. Un index
+ * ne possède donc en propre que ce qu'il a modifié depuis l'instantané.
+ *
+ * si_branch ouvre sur un instantané autant d'index que voulu, modifiables
+ * indépendamment, y compris depuis des threads différents. L'instantané est
+ * compté en références : il vit tant qu'un index ou un appelant le tient.
+ */
+typedef struct SiSnapshot {
+    StationNode* root;
+    unsigned gen;               /* génération des noeuds qu'il possède */
+    atomic_int refs;
+    struct SiSnapshot* base;    /* instantané plus ancien dont il partage les noeuds */
+    StationNode* slab;          /* bloc de si_build_sorted repris de l'index figé, NULL sinon */
+    int size;
+    unsigned version, data_version, attr_version;
+    unsigned shard_version[SI_SHARDS];
+} SiSnapshot;
+
+static inline int si_shard(int id) {
+    return (int)(((unsigned)id >> SI_SHARD_SHIFT) & (SI_SHARDS - 1));
+}
+
 void si_init(StationIndex* idx);                         /* O(1) */
 
+/**
+ * Signale une modification de la station id faite hors de si_add / si_delete
+ * (créneaux libres, horodatage) : incrémente data_version et la version de sa tranche.
+ *
+ * @param idx Index modifié.
+ * @param id Identifiant de la station touchée.
+ */
+void si_touch(StationIndex* idx, int id);                /* O(1) */
+
+/* comme si_touch, pour un changement de puissance ou de prix : incrémente aussi attr_version */
+void si_touch_attr(StationIndex* idx, int id);           /* O(1) */
+
 /**
  * Recherche un noeud représentant une station par son identifiant dans l'arbre.
  * 
@@ -31,6 +98,87 @@ void si_init(StationIndex* idx);                         /* O(1) */
  */
 StationNode* si_find(StationNode* r, int id);           /* O(log n) */
 
+/**
+ * Recherche groupée : un seul parcours de l'arbre pour des identifiants triés.
+ * Le chemin de la recherche précédente est conservé ; chaque identifiant ne
+ * remonte que jusqu'au premier ancêtre dont l'intervalle le contient, si bien
+ * que des identifiants proches partagent la descente commune.
+ *
+ * @param r Racine de l'arbre à parcourir.
+ * @param ids Identifiants, triés par ordre croissant (doublons admis).
+ * @param n Nombre d'identifiants.
+ * @param out Reçoit le noeud de chaque identifiant, NULL si absent.
+ * @return Nombre d'identifiants trouvés.
+ */
+int  si_find_sorted(StationNode* r, const int* ids, int n, StationNode** out); /* O(n log(N / n) + n) */
+
+/* un AVL de 2^31 noeuds a une hauteur inférieure à 46 */
+#define SI_CURSOR_DEPTH 64
+
+/**
+ * Curseur ordonné sur les identifiants de [lo, hi], sans récursion : la pile
+ * contient les ancêtres dont le noeud et le sous-arbre droit restent à rendre.
+ *
+ * Le curseur ne modifie pas l'index et peut rester ouvert entre deux lots
+ * d'événements. Tant que la forme de l'arbre ne change pas (mises à jour de
+ * créneaux ou de prix), la pile reste valable ; après un ajout ou une
+ * suppression (idx->version a changé), le prochain si_cursor_next repart par
+ * une recherche juste après le dernier identifiant rendu.
+ */
+typedef struct SiCursor {
+    const StationIndex* idx;
+    unsigned version;           /* idx->version quand la pile a été construite */
+    long long next_id;          /* plus petit identifiant encore à rendre */
+    int hi;                     /* borne haute incluse */
+    int top;
+    StationNode* stack[SI_CURSOR_DEPTH];
+} SiCursor;
+
+/* appelée sur chaque station ; 0 arrête le parcours */
+typedef int (*SiVisitFn)(void* ctx, StationNode* node);
+
+/**
+ * Place le curseur sur la première station d'identifiant >= lo.
+ *
+ * @param c Curseur à initialiser.
+ * @param idx Index parcouru, en lecture seule.
+ * @param lo Borne basse incluse.
+ * @param hi Borne haute incluse.
+ */
+void si_cursor_begin(SiCursor* c, const StationIndex* idx, int lo, int hi);   /* O(log n) */
+
+/**
+ * Station suivante dans l'ordre des identifiants.
+ *
+ * @return Noeud, NULL une fois hi dépassé ou l'index épuisé.
+ */
+StationNode* si_cursor_next(SiCursor* c);            /* O(1) amorti, O(log n) après une modification */
+
+/**
+ * Parcourt les stations d'identifiant dans [lo, hi] par ordre croissant.
+ *
+ * @param fn Appelée pour chaque station ; le parcours s'arrête quand elle rend 0.
+ * @return Nombre de stations passées à fn.
+ */
+int  si_range(const StationIndex* idx, int lo, int hi, SiVisitFn fn, void* ctx);   /* O(log n + k) */
+
+/**
+ * Construit d'un coup l'arbre d'un index vide à partir d'identifiants
+ * strictement croissants : arbre parfaitement équilibré, tous les noeuds dans
+ * un seul bloc alloué. Le noeud de ids[i] est (*nodes)[i] ; ses informations
+ * sont à zéro, à remplir par l'appelant. Les noeuds du bloc se modifient et
+ * se suppriment comme les autres ; le bloc est libéré avec l'arbre (si_clear),
+ * ou avec l'instantané qui l'a repris (si_snapshot).
+ *
+ * @param idx Index sans station ni instantané.
+ * @param ids Identifiants strictement croissants.
+ * @param n Nombre d'identifiants.
+ * @param nodes Reçoit le bloc de noeuds, dans l'ordre de ids (NULL si n = 0).
+ * @return 1 si succès, 0 si l'index n'est pas vide, ids n'est pas strictement
+ *         croissant ou en cas d'échec d'allocation (index inchangé).
+ */
+int  si_build_sorted(StationIndex* idx, const int* ids, int n, StationNode** nodes); /* O(n) */
+
 /**
  * Ajoute une nouvelle station dans l'index ou met à jour une station existante.
  * 
@@ -50,7 +198,52 @@ void si_add(StationIndex* idx, int id, StationInfo in); /* O(log n) */
 int  si_delete(StationIndex* idx, int id);              /* O(log n) */
 
 /**
- * Copie les identifiants de toutes les stations dans un tableau.
+ * Fige l'état courant de l'index. L'index reste modifiable : ses écritures
+ * suivantes copient les noeuds touchés.
+ *
+ * @return Instantané (une référence pour l'appelant), NULL en cas d'échec d'allocation.
+ */
+SiSnapshot* si_snapshot(StationIndex* idx);              /* O(1) */
+
+/**
+ * Initialise idx comme une vue modifiable de l'instantané : mêmes stations et
+ * versions, aucun magasin attaché (métadonnées, géographie, positions).
+ *
+ * @param idx Index non initialisé, ou vidé par si_clear.
+ * @param s Instantané, qui gagne une référence.
+ */
+void si_branch(StationIndex* idx, SiSnapshot* s);        /* O(1) */
+
+/* rend une référence ; le dernier détenteur libère les noeuds propres à l'instantané */
+void si_snapshot_release(SiSnapshot* s);                 /* O(1), O(noeuds propres) au dernier */
+
+/**
+ * Noeud modifiable en place de la station id : copie au besoin son chemin
+ * depuis la racine (idx->version est alors incrémenté, les pointeurs de noeud
+ * gardés ailleurs, comme RuleIndexes, désignant l'ancienne copie).
+ * Sans instantané, équivaut à si_find.
+ *
+ * @return Noeud, NULL si la station est absente ou en cas d'échec d'allocation.
+ */
+StationNode* si_find_mut(StationIndex* idx, int id);    /* O(log n) */
+
+/* nombre de noeuds possédés par l'index, c'est-à-dire non partagés avec un instantané */
+int  si_owned_nodes(const StationIndex* idx);            /* O(noeuds propres) */
+
+/**
+ * Découpe l'espace des identifiants en plages contiguës d'effectifs voisins,
+ * bornées par les pivots des premiers niveaux de l'AVL (sous-arbres).
+ *
+ * @param parts Nombre de plages souhaité ; on en obtient au plus parts (une
+ *        puissance de deux pour un arbre complet sur ces niveaux).
+ * @param lo_out Reçoit le début de chaque plage, croissant, lo_out[0] = INT_MIN ;
+ *        la plage k couvre [lo_out[k], lo_out[k + 1] - 1], la dernière va jusqu'à INT_MAX.
+ * @return Nombre de plages, 0 si l'index est vide.
+ */
+int  si_partition(const StationIndex* idx, int parts, int* lo_out);  /* O(parts) */
+
+/**
+ * Copie les identifiants de toutes les stations dans un tableau, par ordre croissant.
  * 
  * @param r Racine de l'arbre à parcourir.
  * @param ids Tableau de destination pour les identifiants.
@@ -75,6 +268,9 @@ void si_print_pretty(StationIndex* idx);                 /* O(n) */
 
 /**
  * Libère toutes les ressources associées à l'index et réinitialise l'index.
+ * Le magasin de métadonnées, l'arbre géographique et les positions attachés,
+ * s'ils existent, sont vidés mais restent attachés. Les noeuds partagés avec
+ * un instantané lui sont laissés et sa référence est rendue.
  * 
  * @param idx Index à nettoyer.
  */
@@ -0,0 +1,336 @@
+#include "station_key.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SK_DIRECT 0x80000000u
+#define SK_MAX_TRIES (1u << 24)         /* essais de pilote par panier avant de changer de graine */
+#define SK_MAX_SEEDS 8
+
+void sk_init(StationKeys* k) {
+    memset(k, 0, sizeof *k);
+    k->next_spill = SK_SPILL_FIRST;
+    k->mph_seed = DS_HASH_SEED;
+}
+
+/* 1..38 pour l'alphabet des préfixes, 0 sinon */
+static int prefix_code(char c) {
+    if (c >= '0' && c <= '9') return 1 + (c - '0');
+    if (c >= 'A' && c <= 'Z') return 11 + (c - 'A');
+    if (c == '_') return 37;
+    if (c == '*') return 38;
+    return 0;
+}
+
+uint64_t sk_key_of(const char* s, int len) {
+    int d = len;
+    while (d > 0 && s[d - 1] >= '0' && s[d - 1] <= '9') d--;
+    int digits = len - d;
+    // forme exacte : préfixe court, nombre canonique (un zéro de tête rendrait "_01" et "_1" égaux)
+    if (digits >= 1 && digits <= SK_DIGITS_MAX && d <= SK_PREFIX_MAX && (digits == 1 || s[d] != '0')) {
+        uint64_t prefix = 0;
+        int ok = 1;
+        for (int i = 0; i < SK_PREFIX_MAX; i++) {
+            int c = i < d ? prefix_code(s[i]) : 0;
+            if (i < d && c == 0) { ok = 0; break; }
+            prefix = prefix * 39 + (uint64_t)c;
+        }
+        if (ok) {
+            uint64_t num = 0;
+            for (int i = d; i < len; i++) num = num * 10 + (uint64_t)(s[i] - '0');
+            return prefix << 31 | num;
+        }
+    }
+    return SK_HASHED | (ds_hash_bytes(s, (size_t)len, DS_HASH_SEED) & ~SK_HASHED);
+}
+
+/* clé suivante d'une chaîne dont l'empreinte est déjà prise */
+static uint64_t next_key(uint64_t key) {
+    return SK_HASHED | (ds_hash_mix(key) & ~SK_HASHED);
+}
+
+static int key_slot(const StationKeys* k, uint64_t key) {
+    int mask = k->slot_cap - 1;
+    int i = (int)(ds_hash_mix(key) & (uint64_t)mask);
+    while (k->by_key[i] >= 0 && k->entries[k->by_key[i]].key != key) i = (i + 1) & mask;
+    return i;
+}
+
+static int id_slot(const StationKeys* k, int id) {
+    int mask = k->slot_cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)id) & (uint64_t)mask);
+    while (k->by_id[i] >= 0 && k->entries[k->by_id[i]].station_id != id) i = (i + 1) & mask;
+    return i;
+}
+
+/* remplit les deux tables depuis entries (après agrandissement ou permutation) */
+static void reindex(StationKeys* k) {
+    for (int i = 0; i < k->slot_cap; i++) k->by_key[i] = k->by_id[i] = -1;
+    for (int e = 0; e < k->count; e++) {
+        k->by_key[key_slot(k, k->entries[e].key)] = e;
+        k->by_id[id_slot(k, k->entries[e].station_id)] = e;
+    }
+}
+
+static int grow(StationKeys* k, size_t text) {
+    if (k->arena_len + text > k->arena_cap) {
+        size_t cap = k->arena_cap ? 2 * k->arena_cap : 65536;
+        while (cap < k->arena_len + text) cap *= 2;
+        char* a = (char*)realloc(k->arena, cap);
+        if (!a) return 0;
+        k->arena = a;
+        k->arena_cap = cap;
+    }
+    if (k->count == k->cap) {
+        int cap = k->cap ? 2 * k->cap : 1024;
+        SkEntry* e = (SkEntry*)realloc(k->entries, sizeof(SkEntry) * (size_t)cap);
+        if (!e) return 0;
+        k->entries = e;
+        k->cap = cap;
+    }
+    // tables au plus à moitié pleines, comme celles de station_meta.c
+    if ((k->count + 1) * 2 > k->slot_cap) {
+        int cap = k->slot_cap ? 2 * k->slot_cap : 2048;
+        int32_t* bk = (int32_t*)malloc(sizeof(int32_t) * (size_t)cap);
+        int32_t* bi = (int32_t*)malloc(sizeof(int32_t) * (size_t)cap);
+        if (!bk || !bi) { free(bk); free(bi); return 0; }
+        free(k->by_key);
+        free(k->by_id);
+        k->by_key = bk;
+        k->by_id = bi;
+        k->slot_cap = cap;
+        reindex(k);
+    }
+    return 1;
+}
+
+static int same_text(const StationKeys* k, const SkEntry* e, const char* s, int len) {
+    return e->len == (uint32_t)len && memcmp(k->arena + e->off, s, (size_t)len) == 0;
+}
+
+int sk_find(const StationKeys* k, const char* s, int len) {
+    if (len <= 0 || k->slot_cap == 0) return -1;
+    uint64_t key = sk_key_of(s, len);
+    for (;;) {
+        int e = k->by_key[key_slot(k, key)];
+        if (e < 0) return -1;
+        const SkEntry* en = &k->entries[e];
+        // forme exacte : la clé suffit
+        if (!(key & SK_HASHED) || same_text(k, en, s, len)) return en->station_id;
+        key = next_key(key);
+    }
+}
+
+int sk_add(StationKeys* k, const char* s, int len, int hint) {
+    if (len <= 0) return -1;
+    if (!grow(k, (size_t)len + 1)) return -1;
+    uint64_t key = sk_key_of(s, len);
+    int shared = 0;
+    for (;;) {
+        int slot = key_slot(k, key);
+        int e = k->by_key[slot];
+        if (e < 0) break;
+        SkEntry* en = &k->entries[e];
+        if (!(key & SK_HASHED) || same_text(k, en, s, len)) return en->station_id;
+        // même empreinte, autre chaîne : les deux passent par la comparaison de texte
+        if (!en->shared) { en->shared = 1; k->shared++; }
+        shared = 1;
+        key = next_key(key);
+    }
+
+    int id = hint;
+    if (id < 0 || k->by_id[id_slot(k, id)] >= 0) {
+        while (k->by_id[id_slot(k, k->next_spill)] >= 0) k->next_spill++;
+        id = k->next_spill++;
+        k->renumbered++;
+    }
+    SkEntry* en = &k->entries[k->count];
+    en->key = key;
+    en->station_id = id;
+    en->off = (uint32_t)k->arena_len;
+    en->len = (uint32_t)len;
+    en->shared = (uint8_t)shared;
+    k->shared += shared;
+    memcpy(k->arena + k->arena_len, s, (size_t)len);
+    k->arena[k->arena_len + (size_t)len] = '\0';
+    k->arena_len += (size_t)len + 1;
+    k->by_key[key_slot(k, key)] = k->count;
+    k->by_id[id_slot(k, id)] = k->count;
+    k->count++;
+    k->mph_n = 0;   // table parfaite périmée
+    return id;
+}
+
+/* ---------- table de hachage parfaite minimale ---------- */
+
+static uint32_t fastrange(uint32_t x, uint32_t n) {
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+static uint32_t position(uint64_t h, uint32_t pilot, uint32_t n) {
+    return fastrange((uint32_t)ds_hash_mix(h ^ (pilot * DS_HASH_MUL)), n);
+}
+
+static uint32_t mph_slot(const StationKeys* k, uint64_t key) {
+    uint64_t h = ds_hash_mix(key ^ k->mph_seed);
+    uint32_t pilot = k->pilots[fastrange((uint32_t)(h >> 32), (uint32_t)k->n_buckets)];
+    return pilot & SK_DIRECT ? pilot & ~SK_DIRECT : position(h, pilot, (uint32_t)k->mph_n);
+}
+
+/*
+ * Place chaque entrée dans une case de [0, n) : les paniers sont traités du plus
+ * grand au plus petit, chacun avec le premier pilote qui envoie toutes ses clés
+ * dans des cases libres et distinctes. Écrit la case de chaque entrée dans slot_of.
+ */
+static int place(const StationKeys* k, uint64_t seed, uint32_t* pilots, uint32_t m, uint32_t* slot_of) {
+    uint32_t n = (uint32_t)k->count;
+    uint64_t* h = (uint64_t*)malloc(sizeof(uint64_t) * n);
+    uint32_t* start = (uint32_t*)calloc((size_t)m + 1, sizeof(uint32_t));
+    uint32_t* members = (uint32_t*)malloc(sizeof(uint32_t) * n);
+    uint32_t* order = (uint32_t*)malloc(sizeof(uint32_t) * m);
+    uint32_t* by_size = NULL;
+    uint8_t* taken = (uint8_t*)calloc(n, 1);
+    int ok = h && start && members && order && taken;
+
+    // paniers par tri comptage
+    uint32_t max_size = 0;
+    for (uint32_t e = 0; ok && e < n; e++) {
+        h[e] = ds_hash_mix(k->entries[e].key ^ seed);
+        start[fastrange((uint32_t)(h[e] >> 32), m) + 1]++;
+    }
+    for (uint32_t b = 0; ok && b < m; b++) {
+        if (start[b + 1] > max_size) max_size = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    if (ok) {
+        by_size = (uint32_t*)calloc((size_t)max_size + 2, sizeof(uint32_t));
+        ok = by_size != NULL;
+    }
+    if (ok) {
+        uint32_t* fill = order;   // sert de curseur d'écriture, réécrit ensuite
+        for (uint32_t b = 0; b < m; b++) fill[b] = start[b];
+        for (uint32_t e = 0; e < n; e++) members[fill[fastrange((uint32_t)(h[e] >> 32), m)]++] = e;
+        // paniers par taille décroissante, encore par tri comptage
+        for (uint32_t b = 0; b < m; b++) by_size[max_size - (start[b + 1] - start[b]) + 1]++;
+        for (uint32_t s = 0; s <= max_size; s++) by_size[s + 1] += by_size[s];
+        for (uint32_t b = 0; b < m; b++) order[by_size[max_size - (start[b + 1] - start[b])]++] = b;
+    }
+
+    uint32_t next_free = 0;
+    for (uint32_t o = 0; ok && o < m; o++) {
+        uint32_t b = order[o];
+        uint32_t size = start[b + 1] - start[b];
+        const uint32_t* mem = members + start[b];
+        pilots[b] = 0;
+        if (size == 0) continue;
+        if (size == 1) {
+            // les paniers d'une clé passent en dernier : case libre désignée directement
+            while (taken[next_free]) next_free++;
+            taken[next_free] = 1;
+            slot_of[mem[0]] = next_free;
+            pilots[b] = SK_DIRECT | next_free;
+            continue;
+        }
+        uint32_t p = 0;
+        for (; p < SK_MAX_TRIES; p++) {
+            uint32_t j = 0;
+            for (; j < size; j++) {
+                uint32_t pos = position(h[mem[j]], p, n);
+                if (taken[pos]) break;
+                taken[pos] = 1;
+                slot_of[mem[j]] = pos;
+            }
+            if (j == size) break;
+            while (j-- > 0) taken[slot_of[mem[j]]] = 0;
+        }
+        if (p == SK_MAX_TRIES) ok = 0;
+        else pilots[b] = p;
+    }
+    free(h);
+    free(start);
+    free(members);
+    free(order);
+    free(by_size);
+    free(taken);
+    return ok;
+}
+
+int sk_build(StationKeys* k) {
+    if (k->count == 0) return 1;
+    uint32_t n = (uint32_t)k->count;
+    uint32_t m = (n + SK_BUCKET_KEYS - 1) / SK_BUCKET_KEYS;
+    uint32_t* pilots = (uint32_t*)malloc(sizeof(uint32_t) * m);
+    uint32_t* slot_of = (uint32_t*)malloc(sizeof(uint32_t) * n);
+    SkEntry* sorted = (SkEntry*)malloc(sizeof(SkEntry) * (size_t)k->cap);
+    int ok = pilots && slot_of && sorted;
+    uint64_t seed = k->mph_seed;
+    int placed = 0;
+    // un panier sans pilote en SK_MAX_TRIES essais est très improbable : nouvelle graine
+    for (int t = 0; ok && t < SK_MAX_SEEDS; t++) {
+        if ((placed = place(k, seed, pilots, m, slot_of))) break;
+        seed = ds_hash_mix(seed + 1);
+    }
+    if (!ok || !placed) {
+        free(pilots);
+        free(slot_of);
+        free(sorted);
+        return 0;
+    }
+    // entrées rangées par case : sk_resolve ne lit qu'une entrée
+    for (uint32_t e = 0; e < n; e++) sorted[slot_of[e]] = k->entries[e];
+    free(k->entries);
+    free(k->pilots);
+    free(slot_of);
+    k->entries = sorted;
+    k->pilots = pilots;
+    k->n_buckets = (int)m;
+    k->mph_seed = seed;
+    k->mph_n = k->count;
+    reindex(k);
+    return 1;
+}
+
+int sk_resolve(const StationKeys* k, const char* s, int len) {
+    if (k->mph_n == 0 || k->mph_n != k->count) return sk_find(k, s, len);
+    if (len <= 0) return -1;
+    uint64_t key = sk_key_of(s, len);
+    const SkEntry* e = &k->entries[mph_slot(k, key)];
+    if (e->key == key && !e->shared) return e->station_id;
+    // clé absente : la chaîne n'est pas enregistrée, sauf sous une clé dérivée
+    if (e->key != key && k->shared == 0) return -1;
+    return sk_find(k, s, len);
+}
+
+const char* sk_name(const StationKeys* k, int station_id, uint64_t* key) {
+    if (k->slot_cap == 0) return NULL;
+    int e = k->by_id[id_slot(k, station_id)];
+    if (e < 0) return NULL;
+    if (key) *key = k->entries[e].key;
+    return k->arena + k->entries[e].off;
+}
+
+size_t sk_memory_bytes(const StationKeys* k) {
+    return k->arena_cap + sizeof(SkEntry) * (size_t)k->cap + 2 * sizeof(int32_t) * (size_t)k->slot_cap +
+           sizeof(uint32_t) * (size_t)k->n_buckets;
+}
+
+void sk_print_stats(const StationKeys* k) {
+    int hashed = 0;
+    for (int e = 0; e < k->count; e++) hashed += (k->entries[e].key & SK_HASHED) != 0;
+    printf("[KEYS] %d identifiants d'itinérance (%d exacts, %d hachés, %d à vérifier), %d renumérotés\n",
+           k->count, k->count - hashed, hashed, k->shared, k->renumbered);
+    printf("[KEYS] table parfaite : %s, %d paniers (%.1f bits par clé), %.1f octets par station\n",
+           k->mph_n == k->count && k->count ? "à jour" : "absente", k->mph_n ? k->n_buckets : 0,
+           k->mph_n ? 32.0 * k->n_buckets / k->mph_n : 0.0,
+           k->count ? (double)sk_memory_bytes(k) / k->count : 0.0);
+}
+
+void sk_clear(StationKeys* k) {
+    free(k->arena);
+    free(k->entries);
+    free(k->by_key);
+    free(k->by_id);
+    free(k->pilots);
+    sk_init(k);
+}
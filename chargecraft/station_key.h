@@ -0,0 +1,112 @@
+#ifndef DS_STATION_KEY_H
+#define DS_STATION_KEY_H
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Registre des identifiants d'itinérance (id_station_itinerance) complets.
+ *
+ * Chaque chaîne reçoit une clé 64 bits unique et un identifiant de station
+ * (l'entier de StationIndex). Les chaînes d'origine sont gardées dans une arène.
+ *
+ * Clé : une chaîne de la forme préfixe + nombre (préfixe d'au plus 6 caractères
+ * parmi A-Z, 0-9, '_' et '*', nombre d'au plus 9 chiffres sans zéro de tête,
+ * comme FRIZI_1001) est codée exactement : préfixe en base 39 sur les bits
+ * 31 à 62, nombre sur les bits 0 à 30. Deux chaînes distinctes de cette forme
+ * ne partagent jamais leur clé. Les autres sont hachées, bit 63 à 1 ; deux
+ * chaînes dont les empreintes coïncident sont séparées à l'enregistrement
+ * (clé dérivée pour la seconde, les deux marquées pour une comparaison de texte).
+ *
+ * Identifiant : le nombre de fin de la chaîne s'il est libre (un jeu mono-
+ * opérateur garde ses identifiants), sinon le suivant à partir de SK_SPILL_FIRST.
+ *
+ * sk_build construit une table de hachage parfaite minimale clé -> case :
+ * sk_resolve coûte alors le calcul de la clé plus une seule case lue, sans
+ * comparaison de chaînes (sauf chaînes marquées). Les paniers de plusieurs
+ * clés reçoivent un pilote trouvé par essais ; les paniers d'une seule clé, placés
+ * en dernier, désignent directement une case libre.
+ */
+
+#define SK_HASHED (1ull << 63)          /* clé hachée, pas de forme préfixe + nombre */
+#define SK_PREFIX_MAX 6
+#define SK_DIGITS_MAX 9
+#define SK_SPILL_FIRST (1 << 30)        /* premiers identifiants attribués sur collision de nombre */
+#define SK_BUCKET_KEYS 3                /* clés par panier en moyenne */
+
+typedef struct SkEntry {
+    uint64_t key;
+    int32_t station_id;
+    uint32_t off;                       /* chaîne dans l'arène, terminée par '\0' */
+    uint32_t len;
+    uint8_t shared;                     /* empreinte partagée : vérifier le texte */
+} SkEntry;
+
+typedef struct StationKeys {
+    char* arena;
+    size_t arena_len, arena_cap;
+    SkEntry* entries;                   /* après sk_build : rangées par case de la table parfaite */
+    int count, cap;
+    int32_t* by_key;                    /* table ouverte clé -> entrée (-1 libre), au plus à moitié pleine */
+    int32_t* by_id;                     /* idem, station_id -> entrée */
+    int slot_cap;
+    uint32_t* pilots;                   /* par panier ; bit 31 : case directe */
+    int n_buckets;
+    int mph_n;                          /* entrées couvertes par la table parfaite */
+    uint64_t mph_seed;
+    int next_spill;
+    int renumbered;                     /* identifiants attribués faute de nombre libre */
+    int shared;                         /* entrées marquées */
+} StationKeys;
+
+void sk_init(StationKeys* k);                                                  /* O(1) */
+
+/**
+ * Clé 64 bits d'un identifiant d'itinérance (voir plus haut), sans registre :
+ * exacte pour la forme préfixe + nombre, empreinte sinon.
+ */
+uint64_t sk_key_of(const char* s, int len);                                     /* O(len) */
+
+/**
+ * Enregistre un identifiant d'itinérance, ou retrouve celui déjà enregistré.
+ *
+ * @param s Chaîne, non nécessairement terminée par '\0'.
+ * @param hint Identifiant souhaité (nombre de fin), -1 si aucun.
+ * @return Identifiant de station attribué, -1 si la chaîne est vide ou en cas
+ *         d'échec d'allocation.
+ */
+int  sk_add(StationKeys* k, const char* s, int len, int hint);                 /* O(len) amorti */
+
+/**
+ * Construit la table parfaite sur les entrées enregistrées. Un ajout ultérieur
+ * la désactive jusqu'au sk_build suivant (sk_resolve passe alors par sk_find).
+ *
+ * @return 1 si succès, 0 en cas d'échec d'allocation.
+ */
+int  sk_build(StationKeys* k);                                                  /* O(n) attendu */
+
+/**
+ * Identifiant de station d'une chaîne par la table parfaite.
+ *
+ * @return station_id, -1 si la chaîne n'est pas enregistrée.
+ */
+int  sk_resolve(const StationKeys* k, const char* s, int len);                 /* O(len) */
+
+/* même résultat par la table ouverte, en comparant les chaînes */
+int  sk_find(const StationKeys* k, const char* s, int len);                    /* O(len) */
+
+/**
+ * Chaîne d'origine et clé d'une station.
+ *
+ * @param key Reçoit la clé si non NULL.
+ * @return Chaîne terminée par '\0', NULL si la station n'a pas d'identifiant d'itinérance.
+ */
+const char* sk_name(const StationKeys* k, int station_id, uint64_t* key);      /* O(1) */
+
+/* octets occupés (arène, entrées, tables) */
+size_t sk_memory_bytes(const StationKeys* k);
+
+void sk_print_stats(const StationKeys* k);
+
+void sk_clear(StationKeys* k);                                                  /* O(1) */
+
+#endif
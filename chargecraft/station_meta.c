@@ -0,0 +1,418 @@
+#include "station_meta.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_FREE (-1)
+#define SLOT_DELETED (-2)
+#define SMALL_ID_MAX 0xFFFF
+#define ARENA_COMPACT_MIN (64 * 1024)   /* en dessous, les octets morts ne valent pas une copie */
+
+static void pool_init(InternPool* p) {
+    p->offs = NULL;
+    p->count = p->cap = 0;
+    p->slots = NULL;
+    p->slot_cap = 0;
+}
+
+static void pool_clear(InternPool* p) {
+    free(p->offs);
+    free(p->slots);
+    pool_init(p);
+}
+
+void sm_init(StationMeta* m) {
+    m->arena = NULL;
+    m->arena_len = m->arena_cap = 0;
+    m->arena_dead = 0;
+    m->arena_borrowed = 0;
+    m->recs = NULL;
+    m->count = m->cap = 0;
+    m->slots = NULL;
+    m->slot_cap = m->slot_used = 0;
+    pool_init(&m->operators);
+    pool_init(&m->access);
+    pool_init(&m->communes);
+}
+
+/* octets occupés par le texte libre d'offset off ('\0' compris) */
+static size_t arena_bytes(const StationMeta* m, uint32_t off) {
+    return off ? strlen(m->arena + off) + 1 : 0;
+}
+
+/**
+ * Recopie bout à bout les chaînes internées puis le texte libre vivant, dans
+ * une arène neuve ; sans mémoire, l'arène reste telle quelle.
+ */
+static void arena_compact(StationMeta* m) {
+    size_t live = m->arena_len - m->arena_dead;
+    size_t nc = 4096;
+    while (nc < live + live / 2) nc *= 2;
+    char* na = (char*)malloc(nc);
+    if (!na) return;
+    size_t len = 0;
+    na[len++] = '\0';
+    InternPool* pools[3] = { &m->operators, &m->access, &m->communes };
+    for (int k = 0; k < 3; k++) {
+        for (int id = 1; id < pools[k]->count; id++) {
+            size_t b = arena_bytes(m, pools[k]->offs[id]);
+            memcpy(na + len, m->arena + pools[k]->offs[id], b);
+            pools[k]->offs[id] = (uint32_t)len;
+            len += b;
+        }
+    }
+    for (int r = 0; r < m->count; r++) {
+        uint32_t* offs[2] = { &m->recs[r].name_off, &m->recs[r].address_off };
+        for (int k = 0; k < 2; k++) {
+            if (!*offs[k]) continue;
+            size_t b = arena_bytes(m, *offs[k]);
+            memcpy(na + len, m->arena + *offs[k], b);
+            *offs[k] = (uint32_t)len;
+            len += b;
+        }
+    }
+    if (!m->arena_borrowed) free(m->arena);
+    m->arena = na;
+    m->arena_len = len;
+    m->arena_cap = nc;
+    m->arena_dead = 0;
+    m->arena_borrowed = 0;
+}
+
+static void arena_maybe_compact(StationMeta* m) {
+    if (m->arena_len >= ARENA_COMPACT_MIN && m->arena_dead * 2 > m->arena_len) arena_compact(m);
+}
+
+/**
+ * Copie len octets en fin d'arène, suivis d'un '\0'.
+ * L'offset 0 est réservé à la chaîne vide. Retourne l'offset, ou 0 si échec
+ * (len <= 0 rend aussi 0, la chaîne vide).
+ */
+static uint32_t arena_push(StationMeta* m, const char* s, int len) {
+    if (len <= 0) return 0;
+    if (m->arena_borrowed) {
+        // arène empruntée : recopiée avant la première écriture
+        size_t nc = 4096;
+        while (nc < m->arena_len * 2) nc *= 2;
+        char* na = (char*)malloc(nc);
+        if (!na) return 0;
+        memcpy(na, m->arena, m->arena_len);
+        m->arena = na;
+        m->arena_cap = nc;
+        m->arena_borrowed = 0;
+    }
+    size_t need = m->arena_len + (size_t)len + 1 + (m->arena_len == 0);
+    if (need > UINT32_MAX) return 0;
+    if (need > m->arena_cap) {
+        size_t nc = m->arena_cap ? m->arena_cap * 2 : 4096;
+        while (nc < need) nc *= 2;
+        char* na = (char*)realloc(m->arena, nc);
+        if (!na) return 0;
+        m->arena = na;
+        m->arena_cap = nc;
+    }
+    if (m->arena_len == 0) m->arena[m->arena_len++] = '\0';
+    uint32_t off = (uint32_t)m->arena_len;
+    memcpy(m->arena + off, s, (size_t)len);
+    m->arena[off + len] = '\0';
+    m->arena_len += (size_t)len + 1;
+    return off;
+}
+
+static int pool_rehash(StationMeta* m, InternPool* p, int nc) {
+    int32_t* ns = (int32_t*)malloc(sizeof(int32_t) * nc);
+    if (!ns) return 0;
+    for (int i = 0; i < nc; i++) ns[i] = SLOT_FREE;
+    for (int id = 1; id < p->count; id++) {
+        const char* s = m->arena + p->offs[id];
+        uint64_t h = ds_hash_bytes(s, strlen(s), DS_HASH_SEED);
+        int i = (int)(h & (uint64_t)(nc - 1));
+        while (ns[i] != SLOT_FREE) i = (i + 1) & (nc - 1);
+        ns[i] = id;
+    }
+    free(p->slots);
+    p->slots = ns;
+    p->slot_cap = nc;
+    return 1;
+}
+
+/**
+ * Identifiant interné de la chaîne dans *id (0 pour la chaîne vide ou si le
+ * pool a atteint max_id). Retourne 0 en cas d'échec d'allocation.
+ */
+static int pool_intern(StationMeta* m, InternPool* p, MetaText t, uint32_t max_id, uint32_t* id) {
+    *id = 0;
+    if (t.len <= 0) return 1;
+    if (p->count == 0) {
+        // id 0 = chaîne vide
+        p->offs = (uint32_t*)malloc(sizeof(uint32_t) * 16);
+        if (!p->offs) return 0;
+        p->cap = 16;
+        p->offs[0] = 0;
+        p->count = 1;
+    }
+    if ((p->count + 1) * 2 > p->slot_cap && !pool_rehash(m, p, p->slot_cap ? p->slot_cap * 2 : 64)) return 0;
+
+    uint64_t h = ds_hash_bytes(t.p, (size_t)t.len, DS_HASH_SEED);
+    int i = (int)(h & (uint64_t)(p->slot_cap - 1));
+    while (p->slots[i] != SLOT_FREE) {
+        const char* s = m->arena + p->offs[p->slots[i]];
+        if (memcmp(s, t.p, (size_t)t.len) == 0 && s[t.len] == '\0') {
+            *id = (uint32_t)p->slots[i];
+            return 1;
+        }
+        i = (i + 1) & (p->slot_cap - 1);
+    }
+
+    if ((uint32_t)p->count > max_id) return 1;
+    if (p->count == p->cap) {
+        uint32_t* no = (uint32_t*)realloc(p->offs, sizeof(uint32_t) * p->cap * 2);
+        if (!no) return 0;
+        p->offs = no;
+        p->cap *= 2;
+    }
+    uint32_t off = arena_push(m, t.p, t.len);
+    if (!off) return 0;
+    p->offs[p->count] = off;
+    p->slots[i] = p->count;
+    *id = (uint32_t)p->count++;
+    return 1;
+}
+
+static const char* pool_str(const StationMeta* m, const InternPool* p, uint32_t id) {
+    if (id == 0 || (int)id >= p->count) return "";
+    return m->arena + p->offs[id];
+}
+
+/* position de station_id dans la table, ou de la case où l'insérer si absente */
+static int slot_find(const StationMeta* m, int station_id, int* found) {
+    int mask = m->slot_cap - 1;
+    int i = (int)(ds_hash_mix((uint64_t)(uint32_t)station_id) & (uint64_t)mask);
+    int first_free = -1;
+    *found = 0;
+    while (m->slots[i] != SLOT_FREE) {
+        if (m->slots[i] == SLOT_DELETED) {
+            if (first_free < 0) first_free = i;
+        } else if (m->recs[m->slots[i]].station_id == station_id) {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return first_free >= 0 ? first_free : i;
+}
+
+static int slots_rehash(StationMeta* m, int nc) {
+    int32_t* ns = (int32_t*)malloc(sizeof(int32_t) * nc);
+    if (!ns) return 0;
+    for (int i = 0; i < nc; i++) ns[i] = SLOT_FREE;
+    for (int r = 0; r < m->count; r++) {
+        int i = (int)(ds_hash_mix((uint64_t)(uint32_t)m->recs[r].station_id) & (uint64_t)(nc - 1));
+        while (ns[i] != SLOT_FREE) i = (i + 1) & (nc - 1);
+        ns[i] = r;
+    }
+    free(m->slots);
+    m->slots = ns;
+    m->slot_cap = nc;
+    m->slot_used = m->count;
+    return 1;
+}
+
+int sm_set(StationMeta* m, int station_id, const StationMetaInput* in) {
+    if (!m || !in) return 0;
+    if ((m->slot_used + 1) * 4 > m->slot_cap * 3) {
+        // tables pleines aux 3/4 (tombstones compris) : on agrandit ou on nettoie
+        int nc = m->slot_cap ? m->slot_cap : 64;
+        while ((m->count + 1) * 2 > nc) nc *= 2;
+        if (!slots_rehash(m, nc)) return 0;
+    }
+
+    // arène presque pleine : les octets morts sont récupérés avant d'écrire
+    const MetaText* t[5] = { &in->operator_name, &in->access, &in->insee, &in->name, &in->address };
+    size_t text = 6;
+    for (int k = 0; k < 5; k++) text += t[k]->len > 0 ? (size_t)t[k]->len + 1 : 0;
+    if (m->arena_len + text > UINT32_MAX && m->arena_dead) arena_compact(m);
+
+    // texte copié avant de toucher à l'enregistrement : un échec laisse la station intacte
+    uint32_t op, acc, commune;
+    if (!pool_intern(m, &m->operators, in->operator_name, SMALL_ID_MAX, &op) ||
+        !pool_intern(m, &m->access, in->access, SMALL_ID_MAX, &acc) ||
+        !pool_intern(m, &m->communes, in->insee, UINT32_MAX, &commune))
+        return 0;
+    uint32_t name = arena_push(m, in->name.p, in->name.len);
+    if (in->name.len > 0 && !name) return 0;
+    uint32_t address = arena_push(m, in->address.p, in->address.len);
+    if (in->address.len > 0 && !address) {
+        m->arena_dead += arena_bytes(m, name);
+        return 0;
+    }
+
+    int found;
+    int s = slot_find(m, station_id, &found);
+    int r;
+    if (found) {
+        // l'ancien texte libre devient mort
+        r = m->slots[s];
+        m->arena_dead += arena_bytes(m, m->recs[r].name_off) + arena_bytes(m, m->recs[r].address_off);
+    } else {
+        if (m->count == m->cap) {
+            int nc = m->cap ? m->cap * 2 : 256;
+            StationMetaRec* nr = (StationMetaRec*)realloc(m->recs, sizeof(StationMetaRec) * nc);
+            if (!nr) {
+                m->arena_dead += arena_bytes(m, name) + arena_bytes(m, address);
+                return 0;
+            }
+            m->recs = nr;
+            m->cap = nc;
+        }
+        r = m->count++;
+        if (m->slots[s] == SLOT_FREE) m->slot_used++;
+        m->slots[s] = r;
+    }
+
+    StationMetaRec* rec = &m->recs[r];
+    rec->station_id  = station_id;
+    rec->operator_id = (uint16_t)op;
+    rec->access_id   = (uint16_t)acc;
+    rec->commune_id  = commune;
+    rec->name_off    = name;
+    rec->address_off = address;
+    arena_maybe_compact(m);
+    return 1;
+}
+
+/* offsets de la table (count entrées) dans l'arène, copiés ; table de hachage reconstruite */
+static int pool_adopt(StationMeta* m, InternPool* p, const uint32_t* offs, int count) {
+    if (count <= 1) return 1;   // chaîne vide seule : pool laissé vide
+    p->offs = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)count);
+    if (!p->offs) return 0;
+    memcpy(p->offs, offs, sizeof(uint32_t) * (size_t)count);
+    p->count = p->cap = count;
+    int nc = 64;
+    while ((count + 1) * 2 > nc) nc *= 2;
+    return pool_rehash(m, p, nc);
+}
+
+int sm_adopt(StationMeta* m, const StationMetaImage* img) {
+    if (!m || !img || m->count || m->arena_len || img->count < 0) return 0;
+    if (img->arena_len == 0 || img->arena_len > UINT32_MAX || img->arena[img->arena_len - 1] != '\0') return 0;
+    // toute chaîne référencée commence dans l'arène et s'y termine (dernier octet à '\0')
+    for (int k = 0; k < 3; k++)
+        for (int id = 0; id < img->pool_count[k]; id++)
+            if (img->pool_offs[k][id] >= img->arena_len) return 0;
+    for (int r = 0; r < img->count; r++)
+        if (img->recs[r].name_off >= img->arena_len || img->recs[r].address_off >= img->arena_len) return 0;
+
+    InternPool* pools[3] = { &m->operators, &m->access, &m->communes };
+    int nc = 64;
+    while ((img->count + 1) * 2 > nc) nc *= 2;
+    m->recs = (StationMetaRec*)malloc(sizeof(StationMetaRec) * (size_t)(img->count ? img->count : 1));
+    int ok = m->recs != NULL;
+    if (ok) {
+        memcpy(m->recs, img->recs, sizeof(StationMetaRec) * (size_t)img->count);
+        m->count = m->cap = img->count;
+        // l'arène d'abord : pool_rehash y lit les chaînes internées
+        m->arena = (char*)img->arena;
+        m->arena_len = img->arena_len;
+        m->arena_borrowed = 1;
+        ok = slots_rehash(m, nc);
+    }
+    for (int k = 0; ok && k < 3; k++) ok = pool_adopt(m, pools[k], img->pool_offs[k], img->pool_count[k]);
+    if (!ok) {
+        sm_clear(m);
+        return 0;
+    }
+    return 1;
+}
+
+int sm_get(const StationMeta* m, int station_id, StationMetaView* out) {
+    if (!m || m->count == 0) return 0;
+    int found;
+    int s = slot_find(m, station_id, &found);
+    if (!found) return 0;
+    const StationMetaRec* rec = &m->recs[m->slots[s]];
+    if (out) {
+        out->operator_name = pool_str(m, &m->operators, rec->operator_id);
+        out->access        = pool_str(m, &m->access, rec->access_id);
+        out->insee         = pool_str(m, &m->communes, rec->commune_id);
+        out->name          = rec->name_off ? m->arena + rec->name_off : "";
+        out->address       = rec->address_off ? m->arena + rec->address_off : "";
+        out->commune_id    = rec->commune_id;
+    }
+    return 1;
+}
+
+const StationMetaRec* sm_find_rec(const StationMeta* m, int station_id) {
+    if (!m || m->count == 0) return NULL;
+    int found;
+    int s = slot_find(m, station_id, &found);
+    return found ? &m->recs[m->slots[s]] : NULL;
+}
+
+int sm_remove(StationMeta* m, int station_id) {
+    if (!m || m->count == 0) return 0;
+    int found;
+    int s = slot_find(m, station_id, &found);
+    if (!found) return 0;
+
+    // le dernier enregistrement vient boucher le trou pour garder recs contigu
+    int r = m->slots[s];
+    m->arena_dead += arena_bytes(m, m->recs[r].name_off) + arena_bytes(m, m->recs[r].address_off);
+    m->slots[s] = SLOT_DELETED;
+    int last = --m->count;
+    if (r != last) {
+        m->recs[r] = m->recs[last];
+        int ms = slot_find(m, m->recs[r].station_id, &found);
+        m->slots[ms] = r;
+    }
+    arena_maybe_compact(m);
+    return 1;
+}
+
+const char* sm_commune(const StationMeta* m, uint32_t id) {
+    return m ? pool_str(m, &m->communes, id) : "";
+}
+
+static size_t pool_bytes(const InternPool* p) {
+    return sizeof(uint32_t) * (size_t)p->cap + sizeof(int32_t) * (size_t)p->slot_cap;
+}
+
+size_t sm_memory_bytes(const StationMeta* m) {
+    if (!m) return 0;
+    return m->arena_cap
+         + sizeof(StationMetaRec) * (size_t)m->cap
+         + sizeof(int32_t) * (size_t)m->slot_cap
+         + pool_bytes(&m->operators) + pool_bytes(&m->access) + pool_bytes(&m->communes);
+}
+
+void sm_print_memory_report(const StationMeta* m) {
+    if (!m) return;
+    double n = m->count ? (double)m->count : 1.0;
+    size_t recs = sizeof(StationMetaRec) * (size_t)m->cap;
+    size_t slots = sizeof(int32_t) * (size_t)m->slot_cap;
+    size_t pools = pool_bytes(&m->operators) + pool_bytes(&m->access) + pool_bytes(&m->communes);
+    size_t total = sm_memory_bytes(m);
+
+    printf("=== Métadonnées stations : %d stations ===\n", m->count);
+    printf("  arène texte      : %10zu o (%zu utilisés, %zu morts)  %6.1f o/station\n", m->arena_cap, m->arena_len,
+           m->arena_dead, m->arena_cap / n);
+    printf("  enregistrements  : %10zu o  %6.1f o/station\n", recs, recs / n);
+    printf("  table id         : %10zu o  %6.1f o/station\n", slots, slots / n);
+    printf("  chaînes internées: %10zu o  (%d opérateurs, %d accès, %d communes)\n", pools,
+           m->operators.count ? m->operators.count - 1 : 0,
+           m->access.count ? m->access.count - 1 : 0,
+           m->communes.count ? m->communes.count - 1 : 0);
+    printf("  total            : %10zu o  %6.1f o/station\n", total, total / n);
+}
+
+void sm_clear(StationMeta* m) {
+    if (!m) return;
+    if (!m->arena_borrowed) free(m->arena);
+    free(m->recs);
+    free(m->slots);
+    pool_clear(&m->operators);
+    pool_clear(&m->access);
+    pool_clear(&m->communes);
+    sm_init(m);
+}
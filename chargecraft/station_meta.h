@@ -0,0 +1,147 @@
+#ifndef DS_STATION_META_H
+#define DS_STATION_META_H
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Métadonnées d'affichage des stations, stockées à côté de l'index AVL.
+ *
+ * Les chaînes répétées (opérateur, condition d'accès, commune INSEE) sont
+ * internées en petits entiers ; le texte libre (nom, adresse) est copié dans
+ * une unique arène contiguë et référencé par offset. StationInfo reste inchangé.
+ *
+ * Le texte libre remplacé (sm_set) ou oublié (sm_remove) est compté comme
+ * mort ; l'arène est compactée quand il dépasse la moitié des octets utilisés.
+ */
+
+typedef struct MetaText {
+    const char* p;
+    int len;
+} MetaText;
+
+/* champs bruts fournis par les chargeurs (chaînes non terminées par '\0') */
+typedef struct StationMetaInput {
+    MetaText operator_name;  /* nom_operateur */
+    MetaText name;           /* nom_station */
+    MetaText address;        /* adresse_station */
+    MetaText insee;          /* code_insee_commune */
+    MetaText access;         /* condition_acces */
+} StationMetaInput;
+
+/* enregistrement compact : 20 octets par station */
+typedef struct StationMetaRec {
+    int station_id;
+    uint32_t name_off;
+    uint32_t address_off;
+    uint32_t commune_id;
+    uint16_t operator_id;
+    uint16_t access_id;
+} StationMetaRec;
+
+/* vue de lecture : pointeurs dans l'arène, valides jusqu'au prochain sm_set ou sm_remove */
+typedef struct StationMetaView {
+    const char* operator_name;
+    const char* name;
+    const char* address;
+    const char* insee;
+    const char* access;
+    uint32_t commune_id;
+} StationMetaView;
+
+typedef struct InternPool {
+    uint32_t* offs;     /* id -> offset dans l'arène */
+    int count, cap;
+    int32_t* slots;     /* table ouverte : -1 libre, sinon id */
+    int slot_cap;
+} InternPool;
+
+typedef struct StationMeta {
+    char* arena;
+    size_t arena_len, arena_cap;
+    size_t arena_dead;  /* octets de texte libre qui ne sont plus référencés */
+    int arena_borrowed; /* 1 : arène lue ailleurs (sm_adopt), recopiée à la première écriture */
+    StationMetaRec* recs;
+    int count, cap;
+    int32_t* slots;     /* station_id -> indice dans recs (-1 libre, -2 supprimé) */
+    int slot_cap, slot_used;
+    InternPool operators, access, communes;
+} StationMeta;
+
+void sm_init(StationMeta* m);                                        /* O(1) */
+
+/* image d'un magasin déjà construit, telle qu'un .ccds la stocke (dataset.h) */
+typedef struct StationMetaImage {
+    const char* arena;
+    size_t arena_len;
+    const StationMetaRec* recs;
+    int count;
+    const uint32_t* pool_offs[3];   /* opérateurs, accès, communes : id -> offset */
+    int pool_count[3];
+} StationMetaImage;
+
+/**
+ * Reprend l'image d'un magasin dans un magasin vide. L'arène n'est pas
+ * copiée : elle doit rester valide jusqu'au premier sm_set, qui la recopie,
+ * ou jusqu'à sm_clear. Seuls les enregistrements et les tables de hachage
+ * sont construits.
+ *
+ * @return 1 si succès, 0 si le magasin n'est pas vide, si l'image est
+ *         incohérente (offset hors de l'arène, arène non terminée par '\0')
+ *         ou en cas d'échec d'allocation (magasin laissé vide).
+ */
+int  sm_adopt(StationMeta* m, const StationMetaImage* img);             /* O(n + chaînes internées) */
+
+/**
+ * Enregistre (ou remplace) les métadonnées d'une station.
+ *
+ * @param m Magasin de métadonnées.
+ * @param station_id Identifiant de la station.
+ * @param in Champs bruts à copier.
+ * @return 1 si succès, 0 en cas d'échec d'allocation ou d'arène pleine (4 Gio) ;
+ *         la station garde alors ses métadonnées précédentes.
+ */
+int  sm_set(StationMeta* m, int station_id, const StationMetaInput* in); /* O(longueur des champs) */
+
+/**
+ * Lit les métadonnées d'une station.
+ *
+ * @param m Magasin de métadonnées.
+ * @param station_id Identifiant recherché.
+ * @param out Vue remplie si la station est connue.
+ * @return 1 si trouvée, 0 sinon.
+ */
+int  sm_get(const StationMeta* m, int station_id, StationMetaView* out);  /* O(1) */
+
+/**
+ * Enregistrement compact d'une station (ids internés et offsets dans l'arène).
+ *
+ * @return Pointeur valide jusqu'à la prochaine modification, NULL si inconnue.
+ */
+const StationMetaRec* sm_find_rec(const StationMeta* m, int station_id); /* O(1) */
+
+/**
+ * Oublie les métadonnées d'une station ; son texte libre est récupéré au
+ * prochain compactage.
+ *
+ * @return 1 si la station était présente, 0 sinon.
+ */
+int  sm_remove(StationMeta* m, int station_id);                     /* O(1) amorti */
+
+/**
+ * Chaîne internée de la commune d'identifiant id ("" si inconnu).
+ */
+const char* sm_commune(const StationMeta* m, uint32_t id);          /* O(1) */
+
+/**
+ * Octets occupés par le magasin (arène, enregistrements, tables de hachage).
+ */
+size_t sm_memory_bytes(const StationMeta* m);
+
+/**
+ * Affiche la répartition mémoire du magasin et le coût par station.
+ */
+void sm_print_memory_report(const StationMeta* m);
+
+void sm_clear(StationMeta* m);                                       /* O(n) */
+
+#endif
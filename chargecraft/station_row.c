@@ -0,0 +1,41 @@
+#include "station_row.h"
+#include "hash.h"
+#include "geo.h"
+#include "station_key.h"
+#include "connector.h"
+
+int ds_row_resolve(StationIndex* idx, StationRow* row) {
+    if (idx->keys) row->station_id = sk_add(idx->keys, row->itinerance.p, row->itinerance.len, row->station_id);
+    return row->station_id >= 0;
+}
+
+void ds_row_insert(void* ctx, const StationRow* row) {
+    StationIndex* idx = (StationIndex*)ctx;
+    StationRow r = *row;
+    if (!ds_row_resolve(idx, &r)) return;
+    // connecteurs suivis : les créneaux libres découlent de leur bitset
+    if (idx->conns) {
+        if (!cn_resize(idx->conns, r.station_id, r.nbre_pdc)) return;
+        r.info.slots_free = cn_free(idx->conns, r.station_id);
+    }
+    row = &r;
+    // rangée d'abord dans sa commune : si_add n'a plus qu'à confirmer l'état
+    if (idx->geo)
+        geo_add(idx->geo, row->station_id, row->text.insee.p, row->text.insee.len, row->nbre_pdc, &row->info);
+    si_add(idx, row->station_id, row->info);
+    if (idx->meta) sm_set(idx->meta, row->station_id, &row->text);
+    if (idx->spatial) sp_set(idx->spatial, row->station_id, row->lat_e6, row->lon_e6);
+}
+
+uint64_t ds_row_hash(const StationRow* row) {
+    int nums[5] = { row->info.power_kW, row->info.price_cents, row->nbre_pdc, row->lat_e6, row->lon_e6 };
+    uint64_t h = ds_hash_bytes(nums, sizeof nums, DS_HASH_SEED);
+    const MetaText* t[5] = { &row->text.operator_name, &row->text.name, &row->text.address,
+                             &row->text.insee, &row->text.access };
+    for (int k = 0; k < 5; k++) {
+        // la longueur sépare les champs : ("ab","c") et ("a","bc") diffèrent
+        h = ds_hash_bytes(&t[k]->len, sizeof t[k]->len, h);
+        h = ds_hash_bytes(t[k]->p, (size_t)t[k]->len, h);
+    }
+    return h;
+}
@@ -0,0 +1,46 @@
+#ifndef DS_STATION_ROW_H
+#define DS_STATION_ROW_H
+#include "station_index.h"
+#include "station_meta.h"
+#include "spatial.h"
+
+/**
+ * @brief Ligne de jeu de données telle que produite par les chargeurs CSV/JSON.
+ *
+ * Les chaînes de text pointent dans les tampons du chargeur : elles ne sont
+ * valides que pendant l'appel du StationRowFn.
+ */
+typedef struct StationRow {
+    int station_id;        /* nombre après le dernier '_' de l'identifiant, -1 s'il n'y en a pas */
+    MetaText itinerance;   /* id_station_itinerance complet */
+    int nbre_pdc;          /* capacité déclarée (points de charge) */
+    StationInfo info;      /* slots_free = nbre_pdc au chargement */
+    StationMetaInput text; /* opérateur, nom, adresse, INSEE, accès */
+    int lat_e6, lon_e6;    /* microdegrés, SP_NO_POS si absents */
+} StationRow;
+
+typedef void (*StationRowFn)(void* ctx, const StationRow* row);
+
+/**
+ * Identifiant sous lequel ranger la ligne : sans registre attaché à idx, le
+ * nombre de fin de l'identifiant d'itinérance (deux opérateurs peuvent alors
+ * se partager une station) ; avec idx->keys, celui attribué par le registre à
+ * la chaîne complète (voir station_key.h).
+ *
+ * @return 1 si row->station_id est utilisable, 0 si la ligne doit être ignorée.
+ */
+int  ds_row_resolve(StationIndex* idx, StationRow* row);
+
+/**
+ * StationRowFn qui insère la ligne dans l'index (ctx = StationIndex*), dans
+ * son magasin de métadonnées, son arbre géographique et ses positions s'ils
+ * sont attachés, sous l'identifiant donné par ds_row_resolve.
+ */
+void ds_row_insert(void* ctx, const StationRow* row);
+
+/**
+ * Empreinte du contenu statique d'une ligne (puissance, prix, capacité, position, textes).
+ */
+uint64_t ds_row_hash(const StationRow* row);
+
+#endif
@@ -0,0 +1,487 @@
+#include "subscribe.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SUB_MAX_CONJ 64
+#define DIM_NONE (-1)
+
+/* domaines nominaux servant à comparer la largeur des intervalles entre dimensions */
+static const double DOMAIN_LO[SUB_DIMS] = { 0, 0, 0, 0 };
+static const double DOMAIN_HI[SUB_DIMS] = { (double)INT_MAX, 400, 200, 32 };
+
+/* ---------- arbre d'intervalles (AVL sur (lo, sub, box), augmenté du max des hi) ---------- */
+
+typedef struct ITNode {
+    int lo, hi;
+    int sub, box;
+    int max_hi;
+    int height;
+    struct ITNode* left;
+    struct ITNode* right;
+} ITNode;
+
+static int it_height(const ITNode* n) { return n ? n->height : 0; }
+
+static void it_fix(ITNode* n) {
+    int hl = it_height(n->left), hr = it_height(n->right);
+    n->height = 1 + (hl > hr ? hl : hr);
+    n->max_hi = n->hi;
+    if (n->left && n->left->max_hi > n->max_hi) n->max_hi = n->left->max_hi;
+    if (n->right && n->right->max_hi > n->max_hi) n->max_hi = n->right->max_hi;
+}
+
+static ITNode* it_rotate_right(ITNode* y) {
+    ITNode* x = y->left;
+    y->left = x->right;
+    x->right = y;
+    it_fix(y);
+    it_fix(x);
+    return x;
+}
+
+static ITNode* it_rotate_left(ITNode* x) {
+    ITNode* y = x->right;
+    x->right = y->left;
+    y->left = x;
+    it_fix(x);
+    it_fix(y);
+    return y;
+}
+
+static ITNode* it_balance(ITNode* n) {
+    it_fix(n);
+    int b = it_height(n->left) - it_height(n->right);
+    if (b > 1) {
+        if (it_height(n->left->left) < it_height(n->left->right)) n->left = it_rotate_left(n->left);
+        return it_rotate_right(n);
+    }
+    if (b < -1) {
+        if (it_height(n->right->right) < it_height(n->right->left)) n->right = it_rotate_right(n->right);
+        return it_rotate_left(n);
+    }
+    return n;
+}
+
+static int it_cmp(int lo, int sub, int box, const ITNode* n) {
+    if (lo != n->lo) return lo < n->lo ? -1 : 1;
+    if (sub != n->sub) return sub < n->sub ? -1 : 1;
+    return (box > n->box) - (box < n->box);
+}
+
+static ITNode* it_insert(ITNode* n, ITNode* x) {
+    if (!n) return x;
+    if (it_cmp(x->lo, x->sub, x->box, n) < 0) n->left = it_insert(n->left, x);
+    else n->right = it_insert(n->right, x);
+    return it_balance(n);
+}
+
+static ITNode* it_remove(ITNode* n, int lo, int sub, int box) {
+    if (!n) return NULL;
+    int c = it_cmp(lo, sub, box, n);
+    if (c < 0) n->left = it_remove(n->left, lo, sub, box);
+    else if (c > 0) n->right = it_remove(n->right, lo, sub, box);
+    else {
+        if (!n->left || !n->right) {
+            ITNode* child = n->left ? n->left : n->right;
+            free(n);
+            return child;
+        }
+        // deux enfants : le successeur prend la place du noeud
+        ITNode* s = n->right;
+        while (s->left) s = s->left;
+        n->lo = s->lo;
+        n->hi = s->hi;
+        n->sub = s->sub;
+        n->box = s->box;
+        n->right = it_remove(n->right, s->lo, s->sub, s->box);
+    }
+    return it_balance(n);
+}
+
+static void it_free(ITNode* n) {
+    if (!n) return;
+    it_free(n->left);
+    it_free(n->right);
+    free(n);
+}
+
+/* ---------- index par dimension d'ancrage ---------- */
+
+static int grow_ints(int** a, int* cap, int need) {
+    if (need <= *cap) return 1;
+    int nc = *cap ? *cap * 2 : 64;
+    while (nc < need) nc *= 2;
+    int* na = (int*)realloc(*a, sizeof(int) * nc);
+    if (!na) return 0;
+    *a = na;
+    *cap = nc;
+    return 1;
+}
+
+static int index_add(SubIndex* ix, int anchor, const SubBox* b, int sub, int box) {
+    if (anchor < 0) {
+        if (!grow_ints(&ix->open, &ix->open_cap, ix->n_open + 1)) return 0;
+        ix->open[ix->n_open++] = sub;
+        return 1;
+    }
+    ITNode* x = (ITNode*)malloc(sizeof(ITNode));
+    if (!x) return 0;
+    x->lo = b->lo[anchor];
+    x->hi = b->hi[anchor];
+    x->sub = sub;
+    x->box = box;
+    x->left = x->right = NULL;
+    it_fix(x);
+    ix->trees[anchor] = it_insert(ix->trees[anchor], x);
+    return 1;
+}
+
+/* sans effet si la boîte n'y est pas (annulation d'un enregistrement incomplet) */
+static void index_remove(SubIndex* ix, int anchor, const SubBox* b, int sub, int box) {
+    if (anchor >= 0) {
+        ix->trees[anchor] = it_remove(ix->trees[anchor], b->lo[anchor], sub, box);
+        return;
+    }
+    for (int i = 0; i < ix->n_open; i++)
+        if (ix->open[i] == sub) { ix->open[i] = ix->open[--ix->n_open]; return; }
+}
+
+static void index_free(SubIndex* ix) {
+    for (int d = 0; d < SUB_DIMS; d++) it_free(ix->trees[d]);
+    free(ix->open);
+    memset(ix, 0, sizeof *ix);
+}
+
+/* premier seau de frontière >= boundary */
+static int bucket_lower(const SubEngine* e, int boundary) {
+    int lo = 0, hi = e->n_cross;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (e->crossings[mid].boundary < boundary) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static SubIndex* bucket_get(SubEngine* e, int boundary, int create) {
+    int i = bucket_lower(e, boundary);
+    if (i < e->n_cross && e->crossings[i].boundary == boundary) return &e->crossings[i].idx;
+    if (!create) return NULL;
+    if (e->n_cross == e->cross_cap) {
+        int nc = e->cross_cap ? e->cross_cap * 2 : 16;
+        SlotBucket* nb = (SlotBucket*)realloc(e->crossings, sizeof(SlotBucket) * nc);
+        if (!nb) return NULL;
+        e->crossings = nb;
+        e->cross_cap = nc;
+    }
+    memmove(&e->crossings[i + 1], &e->crossings[i], sizeof(SlotBucket) * (size_t)(e->n_cross - i));
+    e->n_cross++;
+    memset(&e->crossings[i], 0, sizeof(SlotBucket));
+    e->crossings[i].boundary = boundary;
+    return &e->crossings[i].idx;
+}
+
+/* ---------- forme des règles ---------- */
+
+static int attr_of(int d, int station_id, const StationInfo* in) {
+    switch (d) {
+        case RA_ID:    return station_id;
+        case RA_POWER: return in->power_kW;
+        case RA_PRICE: return in->price_cents;
+        default:       return in->slots_free;
+    }
+}
+
+/* dimension bornée la plus étroite relativement à son domaine nominal (skip exclue) */
+static int narrowest_dim(const SubBox* b, int skip) {
+    int anchor = DIM_NONE;
+    double best = 0;
+    for (int d = 0; d < SUB_DIMS; d++) {
+        if (d == skip || (b->lo[d] == INT_MIN && b->hi[d] == INT_MAX)) continue;
+        double lo = b->lo[d] > DOMAIN_LO[d] ? b->lo[d] : DOMAIN_LO[d];
+        double hi = b->hi[d] < DOMAIN_HI[d] ? b->hi[d] : DOMAIN_HI[d];
+        double width = (hi < lo ? 0 : hi - lo + 1) / (DOMAIN_HI[d] - DOMAIN_LO[d] + 1);
+        if (anchor == DIM_NONE || width < best) {
+            anchor = d;
+            best = width;
+        }
+    }
+    return anchor;
+}
+
+static void box_full(SubBox* b) {
+    for (int d = 0; d < SUB_DIMS; d++) {
+        b->lo[d] = INT_MIN;
+        b->hi[d] = INT_MAX;
+    }
+    b->anchor = b->cross_anchor = DIM_NONE;
+}
+
+/**
+ * Boîte d'une disjonction : intersection de ses conjonctions de plage.
+ * Retourne 0 si la boîte est vide ; *exact passe à 0 s'il reste un filtre.
+ */
+static int box_of(const Rule* r, int node, SubBox* b, int* exact) {
+    box_full(b);
+    int conj[SUB_MAX_CONJ];
+    int n = rule_conjuncts(r, node, conj, SUB_MAX_CONJ);
+    if (n > SUB_MAX_CONJ) {
+        *exact = 0;
+        n = SUB_MAX_CONJ;
+    }
+    for (int i = 0; i < n; i++) {
+        int lo, hi;
+        int d = rule_conj_range(r, conj[i], &lo, &hi);
+        if (d < 0 || d >= SUB_DIMS) { *exact = 0; continue; }
+        if (lo > b->lo[d]) b->lo[d] = lo;
+        if (hi < b->hi[d]) b->hi[d] = hi;
+    }
+    for (int d = 0; d < SUB_DIMS; d++)
+        if (b->lo[d] > b->hi[d]) return 0;
+    b->anchor = narrowest_dim(b, DIM_NONE);
+    b->cross_anchor = narrowest_dim(b, RA_SLOTS);
+    return 1;
+}
+
+/* boîtes d'une règle normalisée ; retourne leur nombre */
+static int sub_shape(const Rule* r, SubBox* boxes, int* exact) {
+    *exact = 1;
+    const RuleNode* root = &r->nodes[r->root];
+    if (root->kind == RK_CONST) {
+        if (!root->value) return 0;
+        box_full(&boxes[0]);
+        return 1;
+    }
+    int disj[SUB_MAX_BOXES];
+    int n = rule_disjuncts(r, r->root, disj, SUB_MAX_BOXES);
+    if (n > SUB_MAX_BOXES) {
+        // trop de disjonctions : une seule boîte non bornée, filtre complet
+        *exact = 0;
+        box_full(&boxes[0]);
+        return 1;
+    }
+    int kept = 0;
+    for (int i = 0; i < n; i++)
+        kept += box_of(r, disj[i], &boxes[kept], exact);
+    return kept;
+}
+
+/* frontières de créneaux d'une boîte d'une règle exacte (0, 1 ou 2) */
+static int slot_boundaries(const Subscription* s, const SubBox* b, int out[2]) {
+    int n = 0;
+    if (!s->exact) return 0;
+    if (b->lo[RA_SLOTS] != INT_MIN) out[n++] = b->lo[RA_SLOTS];
+    if (b->hi[RA_SLOTS] != INT_MAX) out[n++] = b->hi[RA_SLOTS] + 1;
+    return n;
+}
+
+/* ---------- moteur ---------- */
+
+void sub_init(SubEngine* e, SubNotifyFn fn, void* ctx) {
+    memset(e, 0, sizeof *e);
+    e->fn = fn;
+    e->ctx = ctx;
+}
+
+static int sub_place(SubEngine* e, int id) {
+    const Subscription* s = &e->subs[id];
+    SubIndex* ix = s->exact ? &e->exact : &e->residual;
+    for (int k = 0; k < s->n_boxes; k++) {
+        const SubBox* b = &s->boxes[k];
+        if (!index_add(ix, b->anchor, b, id, k)) return 0;
+        int bounds[2];
+        int nb = slot_boundaries(s, b, bounds);
+        for (int i = 0; i < nb; i++) {
+            SubIndex* bx = bucket_get(e, bounds[i], 1);
+            if (!bx || !index_add(bx, b->cross_anchor, b, id, k)) return 0;
+        }
+    }
+    return 1;
+}
+
+static void sub_unplace(SubEngine* e, int id) {
+    const Subscription* s = &e->subs[id];
+    SubIndex* ix = s->exact ? &e->exact : &e->residual;
+    for (int k = 0; k < s->n_boxes; k++) {
+        const SubBox* b = &s->boxes[k];
+        index_remove(ix, b->anchor, b, id, k);
+        int bounds[2];
+        int nb = slot_boundaries(s, b, bounds);
+        for (int i = 0; i < nb; i++) {
+            SubIndex* bx = bucket_get(e, bounds[i], 0);
+            if (bx) index_remove(bx, b->cross_anchor, b, id, k);
+        }
+    }
+}
+
+static int sub_alloc_id(SubEngine* e) {
+    if (!grow_ints(&e->free_ids, &e->free_cap, e->count + 1)) return -1; // place pour un futur retrait
+    if (e->n_free) return e->free_ids[--e->n_free];
+    if (e->count == e->cap) {
+        int nc = e->cap ? e->cap * 2 : 64;
+        Subscription* ns = (Subscription*)realloc(e->subs, sizeof(Subscription) * nc);
+        if (!ns) return -1;
+        e->subs = ns;
+        unsigned* nseen = (unsigned*)realloc(e->seen, sizeof(unsigned) * nc);
+        if (!nseen) return -1;
+        e->seen = nseen;
+        e->cap = nc;
+    }
+    e->seen[e->count] = 0;
+    e->subs[e->count].nodes = NULL;
+    return e->count++;
+}
+
+int sub_register(SubEngine* e, const char* text, char* err, size_t err_len) {
+    Rule* r = (Rule*)malloc(sizeof(Rule));
+    if (!r) return -1;
+    if (!rule_parse(text, r, err, err_len)) { free(r); return -1; }
+    rule_normalize(r);
+
+    RuleNode tmp[RULE_MAX_NODES];
+    SubBox boxes[SUB_MAX_BOXES];
+    Subscription s;
+    int n = rule_compact(r, tmp, RULE_MAX_NODES);
+    s.n_boxes = sub_shape(r, boxes, &s.exact);
+    free(r);
+    s.nodes = n > 0 ? (RuleNode*)malloc(sizeof(RuleNode) * n) : NULL;
+    s.boxes = (SubBox*)malloc(sizeof(SubBox) * (s.n_boxes ? s.n_boxes : 1));
+    if (!s.nodes || !s.boxes) { free(s.nodes); free(s.boxes); return -1; }
+    memcpy(s.nodes, tmp, sizeof(RuleNode) * n);
+    memcpy(s.boxes, boxes, sizeof(SubBox) * s.n_boxes);
+
+    int id = sub_alloc_id(e);
+    if (id < 0) { free(s.nodes); free(s.boxes); return -1; }
+    e->subs[id] = s;
+    e->live++;
+    if (!sub_place(e, id)) {
+        sub_unregister(e, id);
+        return -1;
+    }
+    return id;
+}
+
+int sub_unregister(SubEngine* e, int sub_id) {
+    if (!e || sub_id < 0 || sub_id >= e->count || !e->subs[sub_id].nodes) return 0;
+    sub_unplace(e, sub_id);
+    free(e->subs[sub_id].nodes);
+    free(e->subs[sub_id].boxes);
+    e->subs[sub_id].nodes = NULL;
+    e->free_ids[e->n_free++] = sub_id; // place réservée par sub_alloc_id
+    e->live--;
+    return 1;
+}
+
+typedef struct UpdateCtx {
+    int station_id;
+    const StationInfo* before;
+    const StationInfo* after;
+    int notified;
+} UpdateCtx;
+
+static int in_box(const SubBox* b, int station_id, const StationInfo* in) {
+    for (int d = 0; d < SUB_DIMS; d++) {
+        int v = attr_of(d, station_id, in);
+        if (v < b->lo[d] || v > b->hi[d]) return 0;
+    }
+    return 1;
+}
+
+static int sub_holds(SubEngine* e, const Subscription* s, int station_id, const StationInfo* in) {
+    if (!in) return 0;
+    int k = 0;
+    while (k < s->n_boxes && !in_box(&s->boxes[k], station_id, in)) k++;
+    if (k == s->n_boxes) return 0;
+    if (s->exact) return 1;
+    e->stats.evaluations++;
+    return rule_eval_nodes(s->nodes, 0, station_id, in) != 0;
+}
+
+static void visit(SubEngine* e, int sub, UpdateCtx* u) {
+    if (e->seen[sub] == e->epoch) return;
+    e->seen[sub] = e->epoch;
+    e->stats.candidates++;
+    const Subscription* s = &e->subs[sub];
+    int was = sub_holds(e, s, u->station_id, u->before);
+    int now = sub_holds(e, s, u->station_id, u->after);
+    if (was == now) return;
+    if (now) e->stats.matches++;
+    else e->stats.unmatches++;
+    u->notified++;
+    if (e->fn) e->fn(e->ctx, sub, u->station_id, now);
+}
+
+/* visite les boîtes dont l'intervalle contient x */
+static void stab(SubEngine* e, const ITNode* n, int x, UpdateCtx* u) {
+    while (n && n->max_hi >= x) {
+        stab(e, n->left, x, u);
+        if (n->lo > x) return; // tout le sous-arbre droit commence après x
+        if (n->hi >= x) visit(e, n->sub, u);
+        n = n->right;
+    }
+}
+
+/* candidates d'un index : intervalle contenant l'ancien ou le nouvel état */
+static void index_stab(SubEngine* e, const SubIndex* ix, UpdateCtx* u) {
+    for (int d = 0; d < SUB_DIMS; d++) {
+        if (!ix->trees[d]) continue;
+        int xb = u->before ? attr_of(d, u->station_id, u->before) : 0;
+        int xa = u->after ? attr_of(d, u->station_id, u->after) : 0;
+        if (u->before) stab(e, ix->trees[d], xb, u);
+        if (u->after && (!u->before || xa != xb)) stab(e, ix->trees[d], xa, u);
+    }
+    for (int i = 0; i < ix->n_open; i++) visit(e, ix->open[i], u);
+}
+
+int sub_on_update(SubEngine* e, int station_id, const StationInfo* before, const StationInfo* after) {
+    if (!e || (!before && !after)) return 0;
+    e->stats.updates++;
+    if (++e->epoch == 0) {
+        // tour complet du compteur : on repart d'un marquage propre
+        memset(e->seen, 0, sizeof(unsigned) * (size_t)e->count);
+        e->epoch = 1;
+    }
+    UpdateCtx u = { station_id, before, after, 0 };
+    int slots_only = before && after && before->power_kW == after->power_kW
+                  && before->price_cents == after->price_cents;
+
+    index_stab(e, &e->residual, &u);
+    if (!slots_only) {
+        index_stab(e, &e->exact, &u);
+    } else if (before->slots_free != after->slots_free) {
+        // seules les règles exactes dont une frontière est franchie peuvent basculer
+        int lo = before->slots_free < after->slots_free ? before->slots_free : after->slots_free;
+        int hi = before->slots_free ^ after->slots_free ^ lo;
+        for (int i = bucket_lower(e, lo + 1); i < e->n_cross && e->crossings[i].boundary <= hi; i++)
+            index_stab(e, &e->crossings[i].idx, &u);
+    }
+    return u.notified;
+}
+
+void sub_print_stats(const SubEngine* e) {
+    if (!e) return;
+    const SubStats* s = &e->stats;
+    double per = s->updates ? (double)s->candidates / (double)s->updates : 0.0;
+    printf("[SUBS] %d règles (%d toujours candidates, %d frontières de créneaux) : %lld mises à jour, "
+           "%.1f candidates/maj, %lld évaluations, +%lld / -%lld notifications\n",
+           e->live, e->residual.n_open, e->n_cross, s->updates, per, s->evaluations, s->matches, s->unmatches);
+}
+
+void sub_clear(SubEngine* e) {
+    if (!e) return;
+    for (int i = 0; i < e->count; i++) {
+        if (!e->subs[i].nodes) continue; // id libre : boîtes déjà libérées
+        free(e->subs[i].nodes);
+        free(e->subs[i].boxes);
+    }
+    index_free(&e->exact);
+    index_free(&e->residual);
+    for (int i = 0; i < e->n_cross; i++) index_free(&e->crossings[i].idx);
+    free(e->crossings);
+    free(e->subs);
+    free(e->free_ids);
+    free(e->seen);
+    sub_init(e, e->fn, e->ctx);
+}
@@ -0,0 +1,114 @@
+#ifndef DS_SUBSCRIBE_H
+#define DS_SUBSCRIBE_H
+#include <stddef.h>
+#include "station_index.h"
+#include "rule_expr.h"
+
+/**
+ * @brief Abonnements : règles infixes permanentes réévaluées à chaque mise à jour de station.
+ *
+ * Chaque disjonction de tête d'une règle donne une boîte sur (id, power, price,
+ * slots), formée de ses conjonctions "attribut op constante" ; la boîte est
+ * rangée dans l'arbre d'intervalles de sa dimension la plus étroite. Une mise
+ * à jour ne réexamine que les règles dont une boîte contient l'ancien ou le
+ * nouvel état : les autres étaient fausses et le restent.
+ *
+ * Cas courant d'un branchement ou débranchement (seuls les créneaux changent) :
+ * une règle décidée par ses boîtes ne peut basculer que si une borne de
+ * créneaux d'une boîte est franchie. Ces boîtes sont donc aussi rangées par
+ * frontière de créneaux, puis par leur dimension la plus étroite hors créneaux.
+ */
+
+#define SUB_DIMS 4       /* RA_ID, RA_POWER, RA_PRICE, RA_SLOTS */
+#define SUB_MAX_BOXES 8  /* au-delà, la règle devient une boîte non bornée */
+
+/* matched = 1 : la station vient de satisfaire la règle, 0 : elle ne la satisfait plus */
+typedef void (*SubNotifyFn)(void* ctx, int sub_id, int station_id, int matched);
+
+typedef struct SubBox {
+    int lo[SUB_DIMS], hi[SUB_DIMS];
+    int anchor;                /* dimension indexée, -1 : aucune borne (toujours candidate) */
+    int cross_anchor;          /* dimension indexée parmi les frontières de créneaux, -1 : aucune */
+} SubBox;
+
+typedef struct Subscription {
+    RuleNode* nodes;           /* règle normalisée compactée, racine en 0 ; NULL si id libre */
+    SubBox* boxes;             /* aucune boîte : règle toujours fausse */
+    int n_boxes;
+    int exact;                 /* les boîtes suffisent, pas de filtre résiduel */
+} Subscription;
+
+typedef struct SubStats {
+    long long updates;         /* mises à jour reçues */
+    long long candidates;      /* règles examinées */
+    long long evaluations;     /* évaluations complètes de règle */
+    long long matches, unmatches;
+} SubStats;
+
+struct ITNode;
+
+/* boîtes rangées par dimension d'ancrage */
+typedef struct SubIndex {
+    struct ITNode* trees[SUB_DIMS];
+    int* open;                 /* règles ayant une boîte sans dimension bornée */
+    int n_open, open_cap;
+} SubIndex;
+
+/* boîtes exactes dont l'intervalle de créneaux commence ou finit à boundary */
+typedef struct SlotBucket {
+    int boundary;              /* la règle bascule quand slots passe de boundary - 1 à boundary */
+    SubIndex idx;
+} SlotBucket;
+
+typedef struct SubEngine {
+    Subscription* subs;        /* indexé par identifiant d'abonnement */
+    int count, cap, live;
+    int* free_ids;
+    int n_free, free_cap;
+    SubIndex exact;            /* règles décidées par leur boîte */
+    SubIndex residual;         /* règles avec filtre résiduel */
+    SlotBucket* crossings;     /* triés par frontière */
+    int n_cross, cross_cap;
+    unsigned* seen;            /* époque de dernière visite, pour dédoublonner */
+    unsigned epoch;
+    SubNotifyFn fn;
+    void* ctx;
+    SubStats stats;
+} SubEngine;
+
+void sub_init(SubEngine* e, SubNotifyFn fn, void* ctx);                  /* O(1) */
+
+/**
+ * Enregistre une règle permanente.
+ *
+ * @param e Moteur d'abonnements.
+ * @param rule Règle infixe (voir rule_expr.h).
+ * @param err Message d'erreur de syntaxe (peut être NULL).
+ * @param err_len Taille de err.
+ * @return Identifiant d'abonnement (>= 0), -1 si la règle est invalide ou en cas d'échec d'allocation.
+ */
+int  sub_register(SubEngine* e, const char* rule, char* err, size_t err_len); /* O(log r) */
+
+/**
+ * Retire un abonnement ; son identifiant pourra être réutilisé.
+ *
+ * @return 1 si l'abonnement existait, 0 sinon.
+ */
+int  sub_unregister(SubEngine* e, int sub_id);                           /* O(log r) */
+
+/**
+ * Signale la mise à jour d'une station et notifie les règles dont le résultat change.
+ *
+ * @param e Moteur d'abonnements.
+ * @param station_id Station modifiée.
+ * @param before État avant la mise à jour, NULL pour une nouvelle station.
+ * @param after État après la mise à jour, NULL pour une station supprimée.
+ * @return Nombre de notifications émises.
+ */
+int  sub_on_update(SubEngine* e, int station_id, const StationInfo* before, const StationInfo* after);
+                                                                         /* O(log r + candidats) */
+
+void sub_print_stats(const SubEngine* e);
+void sub_clear(SubEngine* e);                                            /* O(r) */
+
+#endif
@@ -0,0 +1,371 @@
+#define _POSIX_C_SOURCE 200809L
+#include "wal.h"
+#include "pipeline.h"
+#include "pricing.h"
+#include "connector.h"
+#include "hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct WalHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t base_lsn;
+} WalHeader;
+
+typedef struct WalRecord {
+    uint64_t lsn;
+    int32_t ts, vehicle_id, station_id, action;
+    uint32_t reserved;
+    uint32_t checksum;              /* ds_hash_bytes des 28 octets précédents */
+} WalRecord;
+
+typedef struct CkptHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t n_stations, n_vehicles, capacity, reserved;
+    uint64_t lsn;                   /* dernier événement couvert */
+    uint64_t checksum;              /* ds_hash_bytes du contenu qui suit l'en-tête */
+} CkptHeader;
+
+/* contenu : n_stations x CkptStation, n_vehicles longueurs (octets), puis les identifiants bout à bout */
+typedef struct CkptStation {
+    int32_t id, slots_free, last_ts;
+} CkptStation;
+
+_Static_assert(sizeof(WalHeader) == WAL_HEADER && sizeof(WalRecord) == WAL_RECORD, "format du journal");
+
+#define WAL_READ_CHUNK 2048         /* enregistrements relus à la fois */
+
+static long long mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t record_sum(const WalRecord* r) {
+    return (uint32_t)ds_hash_bytes(r, offsetof(WalRecord, checksum), DS_HASH_SEED);
+}
+
+static int write_all(int fd, const void* p, size_t n) {
+    const unsigned char* c = (const unsigned char*)p;
+    while (n > 0) {
+        ssize_t k = write(fd, c, n);
+        if (k <= 0) return 0;
+        c += k;
+        n -= (size_t)k;
+    }
+    return 1;
+}
+
+static int read_all(int fd, void* p, size_t n, off_t off) {
+    return pread(fd, p, n, off) == (ssize_t)n;
+}
+
+/* relit les enregistrements ; le premier incomplet, faux ou hors séquence termine le journal */
+static int scan(Wal* w, off_t size) {
+    WalRecord* recs = (WalRecord*)malloc(sizeof(WalRecord) * WAL_READ_CHUNK);
+    if (!recs) return 0;
+    off_t off = sizeof(WalHeader);
+    uint64_t expect = w->base_lsn + 1;
+    for (int done = 0; !done && off + WAL_RECORD <= size;) {
+        size_t n = (size_t)((size - off) / WAL_RECORD);
+        if (n > WAL_READ_CHUNK) n = WAL_READ_CHUNK;
+        if (!read_all(w->fd, recs, n * WAL_RECORD, off)) { free(recs); return 0; }
+        for (size_t i = 0; i < n; i++) {
+            if (recs[i].lsn != expect || recs[i].checksum != record_sum(&recs[i])) { done = 1; break; }
+            expect++;
+            off += WAL_RECORD;
+        }
+    }
+    free(recs);
+    if (off < size) {
+        if (ftruncate(w->fd, off) != 0 || fsync(w->fd) != 0) return 0;
+        w->stats.torn_bytes = (long long)(size - off);
+    }
+    w->file_end = off;
+    w->next_lsn = expect;
+    w->durable_lsn = expect - 1;
+    return 1;
+}
+
+int wal_open(Wal* w, const char* path, size_t group_bytes, int group_us) {
+    memset(w, 0, sizeof *w);
+    size_t cap = group_bytes / WAL_RECORD * WAL_RECORD;
+    w->cap = cap ? cap : WAL_RECORD;
+    w->group_us = group_us;
+    w->buf = (unsigned char*)malloc(w->cap);
+    w->path = (char*)malloc(strlen(path) + 1);
+    w->fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat st;
+    if (!w->buf || !w->path || w->fd < 0 || fstat(w->fd, &st) != 0) goto fail;
+    strcpy(w->path, path);
+    WalHeader h;
+    if (st.st_size < (off_t)sizeof h) {
+        // journal neuf (ou en-tête jamais terminé : rien ne le suivait)
+        h = (WalHeader){ WAL_MAGIC, WAL_VERSION, 0 };
+        if (ftruncate(w->fd, 0) != 0 || pwrite(w->fd, &h, sizeof h, 0) != (ssize_t)sizeof h || fsync(w->fd) != 0)
+            goto fail;
+        st.st_size = sizeof h;
+    } else if (!read_all(w->fd, &h, sizeof h, 0) || h.magic != WAL_MAGIC || h.version != WAL_VERSION) {
+        fprintf(stderr, "[WAL] %s n'est pas un journal ChargeCraft\n", path);
+        goto fail;
+    }
+    w->base_lsn = h.base_lsn;
+    if (!scan(w, st.st_size) || lseek(w->fd, w->file_end, SEEK_SET) < 0) goto fail;
+    return 1;
+fail:
+    wal_close(w);
+    return 0;
+}
+
+int wal_commit(Wal* w) {
+    if (w->failed) return 0;
+    if (w->len == 0) return 1;
+    long long t0 = mono_ns();
+    if (!write_all(w->fd, w->buf, w->len) || fdatasync(w->fd) != 0) {
+        // état du fichier inconnu au-delà de file_end : plus rien n'est accepté
+        w->failed = 1;
+        fprintf(stderr, "[WAL] écriture impossible dans %s\n", w->path);
+        return 0;
+    }
+    w->file_end += (off_t)w->len;
+    w->durable_lsn = w->next_lsn - 1;
+    w->len = 0;
+    w->stats.commits++;
+    w->stats.sync_ns += mono_ns() - t0;
+    return 1;
+}
+
+uint64_t wal_append(Wal* w, const Event* e) {
+    if (w->failed) return 0;
+    WalRecord r = { w->next_lsn, e->ts, e->vehicle_id, e->station_id, e->action, 0, 0 };
+    r.checksum = record_sum(&r);
+    long long now = w->group_us > 0 || w->len == 0 ? mono_ns() : 0;
+    if (w->len == 0) w->first_pending_ns = now;
+    memcpy(w->buf + w->len, &r, sizeof r);
+    w->len += sizeof r;
+    w->next_lsn++;
+    w->stats.appends++;
+    // groupe plein, ou le plus ancien enregistrement a assez attendu
+    if ((w->len + WAL_RECORD > w->cap || (w->group_us > 0 && now - w->first_pending_ns >= w->group_us * 1000LL)) &&
+        !wal_commit(w))
+        return 0;
+    return r.lsn;
+}
+
+/* ---------- point de reprise ---------- */
+
+static int sync_parent(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char dir[PATH_MAX];
+    if (!slash) strcpy(dir, ".");
+    else if (slash == path) strcpy(dir, "/");
+    else {
+        size_t n = (size_t)(slash - path);
+        if (n >= sizeof dir) return 0;
+        memcpy(dir, path, n);
+        dir[n] = '\0';
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return 0;
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/*
+ * Vide le journal après un point de reprise couvrant lsn. L'en-tête est rendu
+ * durable avant la troncature : une panne entre les deux laisse des
+ * enregistrements déjà couverts, hors séquence pour le nouvel en-tête, que
+ * wal_open coupe. Dans l'ordre inverse, un en-tête resté à l'ancien LSN ferait
+ * couper à la réouverture les enregistrements validés ensuite.
+ */
+static int reset_log(Wal* w, uint64_t lsn) {
+    WalHeader wh = { WAL_MAGIC, WAL_VERSION, lsn };
+    if (pwrite(w->fd, &wh, sizeof wh, 0) != (ssize_t)sizeof wh || fdatasync(w->fd) != 0 ||
+        ftruncate(w->fd, sizeof wh) != 0 || fdatasync(w->fd) != 0 || lseek(w->fd, sizeof wh, SEEK_SET) < 0) {
+        // le point de reprise est écrit : les enregistrements restants seraient ignorés à la reprise
+        w->failed = 1;
+        fprintf(stderr, "[WAL] troncature impossible de %s\n", w->path);
+        return 0;
+    }
+    w->base_lsn = lsn;
+    w->file_end = sizeof wh;
+    return 1;
+}
+
+int wal_checkpoint(Wal* w, const char* ckpt_path, const Pipeline* pl) {
+    if (!wal_commit(w)) return 0;
+    const SList* mru = pl->mru;
+    int n_vehicles = mru ? pl->n_vehicles : 0, capacity = pl->mru_capacity;
+    if (capacity < 0 || capacity > 255) return 0;
+    size_t bytes = sizeof(CkptHeader) + sizeof(CkptStation) * (size_t)pl->idx->size + (size_t)n_vehicles +
+                   sizeof(int32_t) * (size_t)n_vehicles * capacity;
+    unsigned char* buf = (unsigned char*)malloc(bytes);
+    if (!buf) return 0;
+
+    CkptHeader h = { WAL_CKPT_MAGIC, WAL_VERSION, 0, n_vehicles, capacity, 0, w->durable_lsn, 0 };
+    CkptStation* st = (CkptStation*)(buf + sizeof h);
+    SiCursor cur;
+    si_cursor_begin(&cur, pl->idx, INT_MIN, INT_MAX);
+    for (StationNode* node; (node = si_cursor_next(&cur)) != NULL; h.n_stations++)
+        st[h.n_stations] = (CkptStation){ node->station_id, node->info.slots_free, node->info.last_ts };
+    unsigned char* lens = (unsigned char*)(st + h.n_stations);
+    unsigned char* p = lens + n_vehicles;
+    for (int v = 0; v < n_vehicles; v++) {
+        int k = 0;
+        for (const SNode* m = mru[v].head; m && k < capacity; m = m->next, k++) {
+            int32_t id = m->value;
+            memcpy(p, &id, sizeof id);
+            p += sizeof id;
+        }
+        lens[v] = (unsigned char)k;
+    }
+    bytes = (size_t)(p - buf);
+    h.checksum = ds_hash_bytes(buf + sizeof h, bytes - sizeof h, DS_HASH_SEED);
+    memcpy(buf, &h, sizeof h);
+
+    // fichier temporaire rendu durable, puis renommé : l'ancien point de reprise reste valide jusque-là
+    char tmp[PATH_MAX];
+    int ok = snprintf(tmp, sizeof tmp, "%s.tmp", ckpt_path) < (int)sizeof tmp;
+    int fd = ok ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    ok = fd >= 0 && write_all(fd, buf, bytes) && fsync(fd) == 0;
+    if (fd >= 0 && close(fd) != 0) ok = 0;
+    ok = ok && rename(tmp, ckpt_path) == 0 && sync_parent(ckpt_path);
+    free(buf);
+    if (!ok) {
+        if (fd >= 0) remove(tmp);
+        fprintf(stderr, "[WAL] point de reprise %s non écrit\n", ckpt_path);
+        return 0;
+    }
+
+    if (!reset_log(w, h.lsn)) return 0;
+    w->stats.checkpoints++;
+    return 1;
+}
+
+/* applique le point de reprise sur l'index et les historiques ; renvoie son LSN, -1 s'il est illisible */
+static long long load_checkpoint(const char* path, Pipeline* pl) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    unsigned char* buf = NULL;
+    long long lsn = -1;
+    CkptHeader h;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof h || !(buf = (unsigned char*)malloc((size_t)st.st_size)) ||
+        !read_all(fd, buf, (size_t)st.st_size, 0))
+        goto done;
+    memcpy(&h, buf, sizeof h);
+    size_t size = (size_t)st.st_size, body = size - sizeof h;
+    if (h.magic != WAL_CKPT_MAGIC || h.version != WAL_VERSION || h.n_stations < 0 || h.n_vehicles < 0 ||
+        h.capacity < 0 || h.capacity > 255 ||
+        sizeof(CkptStation) * (size_t)h.n_stations + (size_t)h.n_vehicles > body ||
+        ds_hash_bytes(buf + sizeof h, body, DS_HASH_SEED) != h.checksum)
+        goto done;
+
+    const CkptStation* s = (const CkptStation*)(buf + sizeof h);
+    for (int i = 0; i < h.n_stations; i++) {
+        // station absente du jeu chargé : son état est perdu avec elle
+        StationNode* node = si_find(pl->idx->root, s[i].id);
+        if (!node || (node->info.slots_free == s[i].slots_free && node->info.last_ts == s[i].last_ts)) continue;
+        if (node->gen != pl->idx->gen && !(node = si_find_mut(pl->idx, s[i].id))) goto done;
+        int before = node->info.slots_free;
+        node->info.slots_free = s[i].slots_free;
+        node->info.last_ts = s[i].last_ts;
+        // occupants non conservés : les connecteurs occupés le sont par des inconnus
+        if (pl->idx->conns && cn_set_free(pl->idx->conns, s[i].id, s[i].slots_free))
+            node->info.slots_free = cn_free(pl->idx->conns, s[i].id);
+        if (pl->pricing && pr_on_event(pl->pricing, node, before, s[i].last_ts)) si_touch_attr(pl->idx, s[i].id);
+        else si_touch(pl->idx, s[i].id);
+    }
+    const unsigned char* lens = (const unsigned char*)(s + h.n_stations);
+    const unsigned char* p = lens + h.n_vehicles;
+    const unsigned char* end = buf + size;
+    for (int v = 0; v < h.n_vehicles; v++) {
+        if (p + sizeof(int32_t) * lens[v] > end) goto done;
+        if (pl->mru && v < pl->n_vehicles) {
+            ds_slist_clear(&pl->mru[v]);
+            // du plus ancien au plus récent, comme à l'application des événements
+            for (int k = lens[v] - 1; k >= 0; k--) {
+                int32_t id;
+                memcpy(&id, p + sizeof id * (size_t)k, sizeof id);
+                ds_slist_update_mru(&pl->mru[v], id, pl->mru_capacity);
+            }
+        }
+        p += sizeof(int32_t) * lens[v];
+    }
+    lsn = (long long)h.lsn;
+done:
+    free(buf);
+    close(fd);
+    if (lsn < 0) fprintf(stderr, "[WAL] point de reprise %s illisible\n", path);
+    return lsn;
+}
+
+long long wal_recover(Wal* w, const char* ckpt_path, Pipeline* pl) {
+    long long ckpt = ckpt_path ? load_checkpoint(ckpt_path, pl) : 0;
+    if (ckpt < 0) return -1;
+    if ((uint64_t)ckpt < w->base_lsn) {
+        fprintf(stderr, "[WAL] %s commence après le LSN %llu mais le point de reprise s'arrête au LSN %lld\n",
+                w->path, (unsigned long long)w->base_lsn, ckpt);
+        return -1;
+    }
+    WalRecord* recs = (WalRecord*)malloc(sizeof(WalRecord) * WAL_READ_CHUNK);
+    if (!recs) return -1;
+    // le rejeu ne se journalise pas une seconde fois
+    struct Wal* attached = pl->wal;
+    pl->wal = NULL;
+    long long replayed = 0;
+    for (off_t off = sizeof(WalHeader); off < w->file_end;) {
+        size_t n = (size_t)((w->file_end - off) / WAL_RECORD);
+        if (n > WAL_READ_CHUNK) n = WAL_READ_CHUNK;
+        if (!read_all(w->fd, recs, n * WAL_RECORD, off)) { replayed = -1; break; }
+        for (size_t i = 0; i < n; i++) {
+            // déjà couvert : panne entre le point de reprise et la troncature
+            if (recs[i].lsn <= (uint64_t)ckpt) continue;
+            Event e = { recs[i].ts, recs[i].vehicle_id, recs[i].station_id, recs[i].action };
+            pl_apply(pl, &e);
+            replayed++;
+        }
+        off += (off_t)(n * WAL_RECORD);
+    }
+    free(recs);
+    pl->wal = attached;
+    if (replayed < 0) return -1;
+    w->stats.replayed += replayed;
+    // en-tête en retard sur le point de reprise (panne pendant wal_checkpoint) : les
+    // enregistrements suivants ne prolongeraient pas l'en-tête et seraient coupés à la réouverture
+    if ((uint64_t)ckpt > w->base_lsn) {
+        // enregistrements au-delà du point de reprise (journal d'une version précédente) : nouveau point de reprise
+        if (w->durable_lsn > (uint64_t)ckpt) return wal_checkpoint(w, ckpt_path, pl) ? replayed : -1;
+        if (!reset_log(w, (uint64_t)ckpt)) return -1;
+        w->next_lsn = (uint64_t)ckpt + 1;
+        w->durable_lsn = (uint64_t)ckpt;
+    }
+    return replayed;
+}
+
+void wal_print_stats(const Wal* w) {
+    const WalStats* st = &w->stats;
+    printf("[WAL] %lld événements journalisés, %lld validations (%.1f par validation, %.1f µs par événement) | "
+           "%lld rejoués, %lld octets coupés, %lld points de reprise\n",
+           st->appends, st->commits, st->commits ? (double)st->appends / st->commits : 0.0,
+           st->appends ? st->sync_ns / 1e3 / st->appends : 0.0, st->replayed, st->torn_bytes, st->checkpoints);
+}
+
+int wal_close(Wal* w) {
+    int ok = w->fd < 0 || wal_commit(w);
+    if (w->fd >= 0 && close(w->fd) != 0) ok = 0;
+    free(w->buf);
+    free(w->path);
+    memset(w, 0, sizeof *w);
+    w->fd = -1;
+    return ok;
+}
@@ -0,0 +1,120 @@
+#ifndef DS_WAL_H
+#define DS_WAL_H
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "events.h"
+#include "station_index.h"
+#include "slist.h"
+
+struct Pipeline;
+
+/**
+ * @brief Journal des événements appliqués (write-ahead log), pour la durabilité.
+ *
+ * Chaque événement appliqué par le pipeline (pl->wal) devient un
+ * enregistrement de 32 octets : numéro de séquence (LSN), événement et
+ * empreinte. Les enregistrements s'accumulent dans un tampon ; un seul
+ * write + fdatasync (validation groupée) les rend durables quand le tampon
+ * atteint group_bytes, quand le plus ancien attend depuis group_us, ou sur
+ * wal_commit. L'événement est journalisé après son application en mémoire,
+ * mais rien n'en est visible au dehors avant sa validation : un serveur valide
+ * chaque lot avant d'en envoyer les réponses.
+ *
+ * Point de reprise (wal_checkpoint) : créneaux libres et horodatage de chaque
+ * station, historiques MRU et LSN couvert, écrits dans un fichier temporaire
+ * puis renommé ; le journal est ensuite vidé : son en-tête prend le LSN couvert
+ * (rendu durable) avant la troncature. Une panne entre ces étapes laisse des
+ * enregistrements déjà couverts, que la reprise ignore, ou un en-tête en retard
+ * sur le point de reprise, que la reprise remet à jour.
+ *
+ * Reprise (wal_recover) : le point de reprise est appliqué sur l'état chargé
+ * (jeu de stations), puis les enregistrements suivants sont rejoués par
+ * pl_apply. Une écriture déchirée (enregistrement incomplet, empreinte fausse
+ * ou LSN non consécutif) marque la fin du journal : wal_open tronque le reste.
+ * L'en-tête du fichier porte le LSN couvert par le dernier point de reprise :
+ * un journal qui ne prolonge pas le point de reprise est refusé à la reprise.
+ * Puissance et prix ne sont pas journalisés : ils viennent du jeu de stations.
+ * Tarification et suivi des connecteurs s'attachent avant la reprise (leur
+ * capacité est celle du jeu) : le point de reprise et le rejeu passent par
+ * eux, les occupants des connecteurs du point de reprise restant inconnus.
+ */
+
+#define WAL_MAGIC 0x4c415743u           /* "CWAL" */
+#define WAL_CKPT_MAGIC 0x504b4343u      /* "CCKP" */
+#define WAL_VERSION 1u
+#define WAL_HEADER 16                   /* en-tête du journal : magic, version, LSN couvert */
+#define WAL_RECORD 32
+#define WAL_GROUP_BYTES (64 << 10)      /* validation groupée par défaut : 2048 enregistrements */
+#define WAL_GROUP_US 2000               /* ou 2 ms d'attente */
+
+typedef struct WalStats {
+    long long appends;          /* enregistrements ajoutés */
+    long long commits;          /* write + fdatasync */
+    long long sync_ns;          /* temps passé dans les validations */
+    long long replayed;         /* enregistrements rejoués à la reprise */
+    long long torn_bytes;       /* octets coupés en fin de journal à l'ouverture */
+    long long checkpoints;
+} WalStats;
+
+typedef struct Wal {
+    int fd;
+    char* path;
+    unsigned char* buf;         /* enregistrements en attente de validation */
+    size_t len, cap;
+    int group_us;
+    long long first_pending_ns; /* horloge du plus ancien enregistrement en attente */
+    uint64_t next_lsn;          /* prochain LSN attribué */
+    uint64_t durable_lsn;       /* dernier LSN sur disque */
+    uint64_t base_lsn;          /* LSN couvert par le dernier point de reprise (en-tête du fichier) */
+    off_t file_end;             /* fin des enregistrements valides */
+    int failed;                 /* une écriture a échoué : plus rien n'est accepté */
+    WalStats stats;
+} Wal;
+
+/**
+ * Ouvre (ou crée) un journal, vérifie ses enregistrements et coupe une fin déchirée.
+ *
+ * @param group_bytes Taille du tampon de validation groupée (au moins un enregistrement).
+ * @param group_us Attente maximale d'un enregistrement avant validation.
+ * @return 1 si succès, 0 si le fichier est illisible ou n'est pas un journal.
+ */
+int  wal_open(Wal* w, const char* path, size_t group_bytes, int group_us);   /* O(taille du journal) */
+
+/**
+ * Journalise un événement appliqué ; valide le groupe s'il est plein ou trop ancien.
+ *
+ * @return LSN attribué, 0 en cas d'échec d'écriture.
+ */
+uint64_t wal_append(Wal* w, const Event* e);                                  /* O(1) amorti */
+
+/**
+ * Rend durables les enregistrements en attente (write puis fdatasync).
+ *
+ * @return 1 si succès ou rien à valider, 0 en cas d'échec (le journal refuse ensuite tout ajout).
+ */
+int  wal_commit(Wal* w);
+
+/**
+ * Reprise : applique le point de reprise s'il existe, puis rejoue les
+ * enregistrements qu'il ne couvre pas par pl_apply (sans les journaliser à nouveau).
+ *
+ * @param ckpt_path Fichier de point de reprise (absent : rejeu complet du journal).
+ * @return Enregistrements rejoués, -1 si le point de reprise est corrompu ou si
+ *         le journal ne le prolonge pas (enregistrements manquants).
+ */
+long long wal_recover(Wal* w, const char* ckpt_path, struct Pipeline* pl);    /* O(n + journal) */
+
+/**
+ * Écrit un point de reprise de l'état du pipeline puis vide le journal.
+ *
+ * @return 1 si succès, 0 en cas d'échec (le journal est alors conservé).
+ */
+int  wal_checkpoint(Wal* w, const char* ckpt_path, const struct Pipeline* pl); /* O(n + véhicules) */
+
+void wal_print_stats(const Wal* w);
+
+/* valide ce qui reste puis ferme le journal */
+int  wal_close(Wal* w);
+
+#endif